@@ -0,0 +1,404 @@
+/**
+ * @file batch.c
+ * @brief netopeer2-cli batch execution of commands in concurrent sessions
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+#include "commands.h"
+#include "batch.h"
+
+extern int done;
+extern struct nc_session *session;
+
+int cmd_disconnect(const char *arg, char **tmp_config_file);
+
+/* shared between the session processes and the parent */
+struct batch_result {
+    uint32_t executed;      /* commands executed successfully */
+    uint32_t failed_line;   /* line of the failed command, 0 if none */
+    int finished;           /* all the commands executed or quit */
+    uint64_t elapsed;       /* ms */
+};
+
+struct batch_cmd {
+    char *line;
+    uint32_t line_no;
+};
+
+char *
+batch_getline(FILE *f, char **line, size_t *size, uint32_t *line_no)
+{
+    ssize_t len;
+    char *ptr;
+
+    while ((len = getline(line, size, f)) != -1) {
+        ++(*line_no);
+        while (len && (((*line)[len - 1] == '\n') || ((*line)[len - 1] == '\r'))) {
+            (*line)[--len] = '\0';
+        }
+
+        /* skip empty lines and comments */
+        for (ptr = *line; *ptr == ' '; ++ptr);
+        if (ptr[0] && (ptr[0] != '#')) {
+            return ptr;
+        }
+    }
+
+    return NULL;
+}
+
+void *
+batch_shared_alloc(size_t size)
+{
+    void *mem;
+
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    memset(mem, 0, size);
+
+    return mem;
+}
+
+void
+batch_shared_free(void *mem, size_t size)
+{
+    if (mem) {
+        munmap(mem, size);
+    }
+}
+
+void
+batch_fork(uint32_t count, uint32_t first, uint32_t limit, int (*job)(uint32_t idx, void *arg), void *arg,
+           int *status)
+{
+    uint32_t next = 0, running = 0, cur_limit, i;
+    pid_t *pids, pid;
+    int wstatus;
+
+    for (i = 0; i < count; ++i) {
+        status[i] = -1;
+    }
+    pids = calloc(count, sizeof *pids);
+    if (!pids) {
+        ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        return;
+    }
+
+    /* nothing buffered may be printed twice */
+    fflush(NULL);
+
+    cur_limit = first ? first : limit;
+    while ((next < count) || running) {
+        while ((next < count) && (running < cur_limit)) {
+            pid = fork();
+            if (pid == -1) {
+                ERROR("batch", "Failed to start job %" PRIu32 " (%s).", next + 1, strerror(errno));
+                break;
+            } else if (!pid) {
+                /* the buffers inherited from the parent must not be flushed */
+                _exit(job(next, arg));
+            }
+            pids[next++] = pid;
+            ++running;
+        }
+        if (!running) {
+            /* fork failed with nothing left to wait for */
+            break;
+        }
+
+        pid = waitpid(-1, &wstatus, 0);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERROR("batch", "Waiting for the job processes failed (%s).", strerror(errno));
+            break;
+        }
+        for (i = 0; (i < next) && (pids[i] != pid); ++i);
+        if (i == next) {
+            /* not ours */
+            continue;
+        }
+        pids[i] = 0;
+        status[i] = wstatus;
+        --running;
+        cur_limit = limit;
+    }
+
+    /* a failed wait, do not leave the rest behind */
+    for (i = 0; i < next; ++i) {
+        if (pids[i]) {
+            while ((waitpid(pids[i], &status[i], 0) == -1) && (errno == EINTR));
+        }
+    }
+    free(pids);
+}
+
+void
+batch_summary_head(int name_width, const char *name, const char *count)
+{
+    printf("%-*s %-8s %-10s %-10s %s\n", name_width, name, "Result", count, "Time [s]", "Output");
+}
+
+void
+batch_summary_row(int name_width, const char *name, const char *result, const char *count, uint64_t elapsed,
+                  const char *output)
+{
+    if (!count) {
+        printf("%-*s %-8s", name_width, name, result);
+        return;
+    }
+    printf("%-*s %-8s %-10s %-10.3f %s", name_width, name, result, count, elapsed / 1000.0, output);
+}
+
+static int
+batch_read_cmds(const char *cmd_file, struct batch_cmd **cmds, uint32_t *cmd_count)
+{
+    FILE *f;
+    char *line = NULL, *ptr;
+    size_t size = 0;
+    uint32_t line_no = 0;
+    void *mem;
+
+    f = fopen(cmd_file, "r");
+    if (!f) {
+        ERROR("batch", "Failed to open file \"%s\" (%s).", cmd_file, strerror(errno));
+        return -1;
+    }
+
+    *cmds = NULL;
+    *cmd_count = 0;
+    while ((ptr = batch_getline(f, &line, &size, &line_no))) {
+        mem = realloc(*cmds, (*cmd_count + 1) * sizeof **cmds);
+        if (!mem) {
+            ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto error;
+        }
+        *cmds = mem;
+        (*cmds)[*cmd_count].line = strdup(ptr);
+        if (!(*cmds)[*cmd_count].line) {
+            ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto error;
+        }
+        (*cmds)[*cmd_count].line_no = line_no;
+        ++(*cmd_count);
+    }
+
+    free(line);
+    fclose(f);
+    return 0;
+
+error:
+    while (*cmd_count) {
+        free((*cmds)[--(*cmd_count)].line);
+    }
+    free(*cmds);
+    *cmds = NULL;
+    free(line);
+    fclose(f);
+    return -1;
+}
+
+int
+batch_exec(const char *cmdline)
+{
+    char *cmd, *tmp_config_file = NULL;
+    const char *args;
+    int i, ret;
+
+    args = strchr(cmdline, ' ');
+    cmd = args ? strndup(cmdline, args - cmdline) : strdup(cmdline);
+    if (!cmd) {
+        ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; commands[i].name; i++) {
+        if (!strcmp(cmd, commands[i].name)) {
+            break;
+        }
+    }
+
+    if (!commands[i].name) {
+        fprintf(stderr, "%s: No such command, type 'help' for more information.\n", cmd);
+        ret = EXIT_FAILURE;
+    } else if (args && (!strncmp(args + 1, "-h", 2) || !strncmp(args + 1, "--help", 6))) {
+        if (commands[i].help_func) {
+            commands[i].help_func();
+        } else {
+            printf("%s\n", commands[i].helpstring);
+        }
+        ret = EXIT_SUCCESS;
+    } else {
+        ret = commands[i].func(cmdline, &tmp_config_file);
+    }
+
+    free(tmp_config_file);
+    free(cmd);
+    return ret;
+}
+
+struct batch_args {
+    struct batch_cmd *cmds;
+    uint32_t cmd_count;
+    char **out_paths;
+    struct batch_result *results;
+};
+
+/* runs in its own process, it has its own session and the output goes to its own file */
+static int
+batch_session(uint32_t idx, void *arg)
+{
+    struct batch_args *args = arg;
+    struct batch_cmd *cmds = args->cmds;
+    struct batch_result *result = &args->results[idx];
+    uint64_t start;
+    uint32_t i;
+
+    if (!freopen(args->out_paths[idx], "w", stdout) || (dup2(fileno(stdout), STDERR_FILENO) == -1)) {
+        fprintf(stderr, "batch: Failed to open output file \"%s\" (%s).\n", args->out_paths[idx], strerror(errno));
+        result->failed_line = cmds[0].line_no;
+        return EXIT_FAILURE;
+    }
+    setvbuf(stderr, NULL, _IONBF, 0);
+
+    start = cli_time_us() / 1000;
+    for (i = 0; (i < args->cmd_count) && !done; ++i) {
+        printf("%s%s\n", PROMPT, cmds[i].line);
+        fflush(stdout);
+        if (batch_exec(cmds[i].line)) {
+            fprintf(stderr, "batch: Command on line %" PRIu32 " failed, stopping.\n", cmds[i].line_no);
+            result->failed_line = cmds[i].line_no;
+            break;
+        }
+        ++result->executed;
+    }
+    if (!result->failed_line) {
+        result->finished = 1;
+    }
+
+    if (session) {
+        cmd_disconnect(NULL, NULL);
+    }
+    result->elapsed = cli_time_us() / 1000 - start;
+    fflush(stdout);
+    nc_client_destroy();
+
+    return result->finished ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+batch_run(const char *cmd_file, unsigned int session_count, const char *out_dir)
+{
+    struct batch_args args = {NULL, 0, NULL, NULL};
+    uint32_t i, succeeded = 0;
+    int *status = NULL, ret = EXIT_FAILURE;
+    char name[16], count[24];
+    uint64_t start;
+
+    if (batch_read_cmds(cmd_file, &args.cmds, &args.cmd_count)) {
+        return EXIT_FAILURE;
+    }
+    if (!args.cmd_count) {
+        ERROR("batch", "No commands in \"%s\".", cmd_file);
+        goto cleanup;
+    }
+
+    if (mkdir(out_dir, 00755) && (errno != EEXIST)) {
+        ERROR("batch", "Failed to create directory \"%s\" (%s).", out_dir, strerror(errno));
+        goto cleanup;
+    }
+
+    args.results = batch_shared_alloc(session_count * sizeof *args.results);
+    status = calloc(session_count, sizeof *status);
+    args.out_paths = calloc(session_count, sizeof *args.out_paths);
+    if (!args.results || !status || !args.out_paths) {
+        ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        goto cleanup;
+    }
+    for (i = 0; i < session_count; ++i) {
+        if (asprintf(&args.out_paths[i], "%s/session-%" PRIu32 ".out", out_dir, i + 1) == -1) {
+            args.out_paths[i] = NULL;
+            ERROR("batch", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto cleanup;
+        }
+    }
+
+    /* all the sessions at once */
+    start = cli_time_us() / 1000;
+    batch_fork(session_count, 0, session_count, batch_session, &args, status);
+
+    batch_summary_head(9, "Session", "Commands");
+    for (i = 0; i < session_count; ++i) {
+        sprintf(name, "%" PRIu32, i + 1);
+        if (status[i] == -1) {
+            batch_summary_row(9, name, "NOTRUN", NULL, 0, NULL);
+            printf("\n");
+            continue;
+        }
+        if (WIFEXITED(status[i]) && (WEXITSTATUS(status[i]) == EXIT_SUCCESS)) {
+            ++succeeded;
+        } else {
+            /* crashed, it failed in the command it was executing */
+            args.results[i].finished = 0;
+            if (!args.results[i].failed_line && (args.results[i].executed < args.cmd_count)) {
+                args.results[i].failed_line = args.cmds[args.results[i].executed].line_no;
+            }
+        }
+
+        sprintf(count, "%" PRIu32 "/%" PRIu32, args.results[i].executed, args.cmd_count);
+        batch_summary_row(9, name, args.results[i].finished ? "OK" : "FAILED", count, args.results[i].elapsed,
+                          args.out_paths[i]);
+        if (args.results[i].failed_line) {
+            printf(" (line %" PRIu32 ")", args.results[i].failed_line);
+        }
+        printf("\n");
+    }
+    printf("Batch of %" PRIu32 " commands in %u sessions took %.3f s: %" PRIu32 " succeeded, %" PRIu32 " failed.\n",
+           args.cmd_count, session_count, (cli_time_us() / 1000 - start) / 1000.0, succeeded,
+           session_count - succeeded);
+
+    if (succeeded == session_count) {
+        ret = EXIT_SUCCESS;
+    }
+
+cleanup:
+    batch_shared_free(args.results, session_count * sizeof *args.results);
+    if (args.out_paths) {
+        for (i = 0; i < session_count; ++i) {
+            free(args.out_paths[i]);
+        }
+    }
+    free(args.out_paths);
+    free(status);
+    for (i = 0; i < args.cmd_count; ++i) {
+        free(args.cmds[i].line);
+    }
+    free(args.cmds);
+    return ret;
+}
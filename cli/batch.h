@@ -0,0 +1,105 @@
+/**
+ * @file batch.h
+ * @brief netopeer2-cli batch execution header
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @brief Execute commands from a file in several concurrent sessions.
+ *
+ * @param[in] cmd_file File with a command on each line.
+ * @param[in] session_count Number of concurrently executed sessions.
+ * @param[in] out_dir Directory for the output files of the sessions.
+ * @return EXIT_SUCCESS if all the commands succeeded in all the sessions, EXIT_FAILURE otherwise.
+ */
+int batch_run(const char *cmd_file, unsigned int session_count, const char *out_dir);
+
+/**
+ * @brief Execute a single command line the same way as the interactive loop.
+ *
+ * @param[in] cmdline Command with its arguments.
+ * @return Return value of the command.
+ */
+int batch_exec(const char *cmdline);
+
+/*
+ * Both the batch and the fan-out run each of their jobs in its own process, so that every job has its own session.
+ * The jobs report their results in memory shared with the parent and the parent prints a summary of them.
+ */
+
+/**
+ * @brief Read the next line of a file that is not empty or a comment ('#').
+ *
+ * @param[in] f File to read.
+ * @param[in,out] line Buffer of the line, free it after the last call.
+ * @param[in,out] size Size of the buffer.
+ * @param[in,out] line_no Number of the last read line.
+ * @return The line without leading spaces and the line break, NULL at the end of the file.
+ */
+char *batch_getline(FILE *f, char **line, size_t *size, uint32_t *line_no);
+
+/**
+ * @brief Allocate zeroed memory shared with the job processes.
+ *
+ * @param[in] size Size of the memory.
+ * @return Memory, NULL on error.
+ */
+void *batch_shared_alloc(size_t size);
+
+/**
+ * @brief Free memory allocated by batch_shared_alloc().
+ *
+ * @param[in] mem Memory to free, can be NULL.
+ * @param[in] size Its size.
+ */
+void batch_shared_free(void *mem, size_t size);
+
+/**
+ * @brief Run jobs, each in a new process, and wait for all of them.
+ *
+ * @param[in] count Number of jobs.
+ * @param[in] first Number of jobs run alone first, the others are started only after one of them finished.
+ * @param[in] limit Maximum number of jobs running at the same time.
+ * @param[in] job Function of the job, its return value is the exit status of the process.
+ * @param[in] arg Argument of the job function.
+ * @param[out] status Wait status of each job, -1 if it was not run.
+ */
+void batch_fork(uint32_t count, uint32_t first, uint32_t limit, int (*job)(uint32_t idx, void *arg), void *arg,
+                int *status);
+
+/**
+ * @brief Print the header of a summary, each job has its row there.
+ *
+ * @param[in] name_width Width of the name column.
+ * @param[in] name Title of the name column.
+ * @param[in] count Title of the column with a count of the job.
+ */
+void batch_summary_head(int name_width, const char *name, const char *count);
+
+/**
+ * @brief Print a row of a summary, without the line break.
+ *
+ * @param[in] name_width Width of the name column.
+ * @param[in] name Name of the job.
+ * @param[in] result Result of the job.
+ * @param[in] count Count of the job, NULL if it was not run and no other columns are printed.
+ * @param[in] elapsed ms, time the job took.
+ * @param[in] output Output file of the job.
+ */
+void batch_summary_row(int name_width, const char *name, const char *result, const char *count, uint64_t elapsed,
+                       const char *output);
+
+#endif /* BATCH_H_ */
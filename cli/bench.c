@@ -0,0 +1,519 @@
+/**
+ * @file bench.c
+ * @brief netopeer2-cli load generator measuring RPC latencies of a NETCONF server
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+#include "commands.h"
+#include "bench.h"
+
+extern int rpc_send_timeout;
+extern int rpc_recv_timeout;
+
+const char *bench_op_names[BENCH_OP_COUNT] = {"get", "get-config", "edit-config", "lock", "unlock", "create-subscription"};
+
+/* latencies of one operation in one session */
+struct bench_lat {
+    uint32_t *us;
+    uint32_t count;
+    uint32_t size;
+    uint32_t errors;
+};
+
+struct bench_worker {
+    pthread_t tid;
+    uint32_t idx;
+    struct nc_session *session;
+    const struct bench_opts *opts;
+    struct bench_lat lat[BENCH_OP_COUNT];
+    uint32_t notifs;
+    int failed;
+};
+
+static volatile int bench_stop;
+static uint64_t bench_seq;
+
+static int
+bench_lat_add(struct bench_lat *lat, uint64_t us)
+{
+    uint32_t *mem;
+
+    if (lat->count == lat->size) {
+        mem = realloc(lat->us, (lat->size ? lat->size * 2 : 1024) * sizeof *lat->us);
+        if (!mem) {
+            return -1;
+        }
+        lat->us = mem;
+        lat->size = lat->size ? lat->size * 2 : 1024;
+    }
+    lat->us[lat->count++] = (us > UINT32_MAX) ? UINT32_MAX : us;
+
+    return 0;
+}
+
+/* replaces all "{seq}" in the template with a number unique for the whole benchmark */
+static char *
+bench_edit_content(const char *template)
+{
+    const char *ptr, *next;
+    char seq[21], *content;
+    size_t len, seq_len, count = 0;
+
+    sprintf(seq, "%" PRIu64, __sync_add_and_fetch(&bench_seq, 1));
+    seq_len = strlen(seq);
+
+    for (ptr = strstr(template, "{seq}"); ptr; ptr = strstr(ptr + 5, "{seq}")) {
+        ++count;
+    }
+    len = strlen(template) + count * seq_len - count * 5;
+    content = malloc(len + 1);
+    if (!content) {
+        return NULL;
+    }
+
+    len = 0;
+    for (ptr = template; (next = strstr(ptr, "{seq}")); ptr = next + 5) {
+        memcpy(content + len, ptr, next - ptr);
+        len += next - ptr;
+        memcpy(content + len, seq, seq_len);
+        len += seq_len;
+    }
+    strcpy(content + len, ptr);
+
+    return content;
+}
+
+/* receives the reply waiting at most the receive timeout, notifications are handled by the dispatch thread */
+static NC_MSG_TYPE
+bench_recv(struct nc_session *session, struct nc_rpc *rpc, uint64_t msgid, struct nc_reply **reply)
+{
+    int timeout;
+    uint64_t deadline = 0, now;
+    NC_MSG_TYPE msgtype;
+
+    if (rpc_recv_timeout > -1) {
+        deadline = cli_time_us() + (uint64_t)rpc_recv_timeout * 1000;
+    }
+
+    do {
+        if (deadline) {
+            now = cli_time_us();
+            timeout = (now < deadline) ? (int)((deadline - now) / 1000) : 0;
+        } else {
+            timeout = -1;
+        }
+        msgtype = nc_recv_reply(session, rpc, msgid, timeout, LYD_OPT_DESTRUCT | LYD_OPT_NOSIBLINGS, reply);
+        if (msgtype == NC_MSG_REPLY_ERR_MSGID) {
+            /* a reply to another RPC, should not happen with one RPC at a time */
+            nc_reply_free(*reply);
+            msgtype = NC_MSG_WOULDBLOCK;
+        }
+    } while ((msgtype == NC_MSG_WOULDBLOCK) && (!deadline || (cli_time_us() < deadline)));
+
+    return msgtype;
+}
+
+/*
+ * sends the RPC and records its latency since start, returns 0 on OK/data reply, 1 on an error reply, -1 on failure,
+ * it runs in the worker threads so errors are printed directly, ERROR() uses a shared buffer
+ */
+static int
+bench_rpc(struct bench_worker *w, BENCH_OP op, struct nc_rpc *rpc, uint64_t start)
+{
+    uint64_t msgid;
+    NC_MSG_TYPE msgtype;
+    struct nc_reply *reply;
+    int ret;
+
+    msgtype = nc_send_rpc(w->session, rpc, rpc_send_timeout, &msgid);
+    if (msgtype != NC_MSG_RPC) {
+        fprintf(stderr, "bench: Session %" PRIu32 ": failed to send <%s>.\n", w->idx + 1, bench_op_names[op]);
+        return -1;
+    }
+
+    msgtype = bench_recv(w->session, rpc, msgid, &reply);
+    if (msgtype != NC_MSG_REPLY) {
+        fprintf(stderr, "bench: Session %" PRIu32 ": failed to receive the reply to <%s>.\n", w->idx + 1, bench_op_names[op]);
+        return -1;
+    }
+
+    ret = (reply->type == NC_RPL_ERROR) ? 1 : 0;
+    nc_reply_free(reply);
+
+    if (ret) {
+        ++w->lat[op].errors;
+    } else if (bench_lat_add(&w->lat[op], cli_time_us() - start)) {
+        fprintf(stderr, "bench: Memory allocation failed (%s:%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    return ret;
+}
+
+static void
+bench_ntf_clb(struct nc_session *session, const struct nc_notif *UNUSED(notif))
+{
+    struct bench_worker *w = nc_session_get_data(session);
+
+    __sync_add_and_fetch(&w->notifs, 1);
+}
+
+static BENCH_OP
+bench_pick_op(const struct bench_opts *opts, unsigned int *seed)
+{
+    uint32_t total = 0, r;
+    BENCH_OP op;
+
+    for (op = BENCH_OP_GET; op <= BENCH_OP_LOCK; ++op) {
+        total += opts->weights[op];
+    }
+    r = rand_r(seed) % total;
+    for (op = BENCH_OP_GET; op < BENCH_OP_LOCK; ++op) {
+        if (r < opts->weights[op]) {
+            break;
+        }
+        r -= opts->weights[op];
+    }
+
+    return op;
+}
+
+static void *
+bench_worker_thread(void *arg)
+{
+    struct bench_worker *w = arg;
+    const struct bench_opts *opts = w->opts;
+    struct nc_rpc *get = NULL, *getconfig = NULL, *lock = NULL, *unlock = NULL, *rpc;
+    char *content;
+    uint64_t start, next = 0, interval = 0, now;
+    unsigned int seed = w->idx + 1;
+    struct timespec ts;
+    BENCH_OP op;
+    int r;
+
+    if (opts->stream) {
+        rpc = nc_rpc_subscribe(opts->stream, NULL, NULL, NULL, NC_PARAMTYPE_CONST);
+        if (!rpc) {
+            goto fail;
+        }
+        r = bench_rpc(w, BENCH_OP_SUBSCRIBE, rpc, cli_time_us());
+        nc_rpc_free(rpc);
+        if (r) {
+            goto fail;
+        }
+        nc_session_set_data(w->session, w);
+        if (nc_recv_notif_dispatch(w->session, bench_ntf_clb)) {
+            fprintf(stderr, "bench: Session %" PRIu32 ": failed to create notification thread.\n", w->idx + 1);
+            goto fail;
+        }
+    }
+
+    get = nc_rpc_get(opts->filter, 0, NC_PARAMTYPE_CONST);
+    getconfig = nc_rpc_getconfig(opts->datastore, opts->filter, 0, NC_PARAMTYPE_CONST);
+    lock = nc_rpc_lock(opts->datastore);
+    unlock = nc_rpc_unlock(opts->datastore);
+    if (!get || !getconfig || !lock || !unlock) {
+        fprintf(stderr, "bench: RPC creation failed.\n");
+        goto fail;
+    }
+
+    if (opts->rate > 0) {
+        /* open loop, the RPCs of a session are scheduled in regular intervals */
+        interval = (opts->sessions * 1000000.0) / opts->rate;
+        next = cli_time_us() + (interval * w->idx) / opts->sessions;
+    }
+
+    while (!bench_stop) {
+        if (interval) {
+            now = cli_time_us();
+            if (now < next) {
+                ts.tv_sec = (next - now) / 1000000;
+                ts.tv_nsec = ((next - now) % 1000000) * 1000;
+                nanosleep(&ts, NULL);
+                if (bench_stop) {
+                    break;
+                }
+            }
+            /* latency includes the time the RPC waited for the previous one */
+            start = next;
+            next += interval;
+        } else {
+            start = cli_time_us();
+        }
+
+        op = bench_pick_op(opts, &seed);
+        switch (op) {
+        case BENCH_OP_GET:
+            r = bench_rpc(w, op, get, start);
+            break;
+        case BENCH_OP_GETCONFIG:
+            r = bench_rpc(w, op, getconfig, start);
+            break;
+        case BENCH_OP_EDIT:
+            content = bench_edit_content(opts->edit_template);
+            rpc = content ? nc_rpc_edit(opts->datastore, 0, 0, 0, content, NC_PARAMTYPE_FREE) : NULL;
+            if (!rpc) {
+                free(content);
+                fprintf(stderr, "bench: RPC creation failed.\n");
+                goto fail;
+            }
+            r = bench_rpc(w, op, rpc, start);
+            nc_rpc_free(rpc);
+            break;
+        default:
+            r = bench_rpc(w, BENCH_OP_LOCK, lock, start);
+            if (!r) {
+                r = bench_rpc(w, BENCH_OP_UNLOCK, unlock, cli_time_us());
+            }
+            break;
+        }
+        if (r == -1) {
+            goto fail;
+        }
+    }
+
+    nc_rpc_free(get);
+    nc_rpc_free(getconfig);
+    nc_rpc_free(lock);
+    nc_rpc_free(unlock);
+    return NULL;
+
+fail:
+    w->failed = 1;
+    nc_rpc_free(get);
+    nc_rpc_free(getconfig);
+    nc_rpc_free(lock);
+    nc_rpc_free(unlock);
+    return NULL;
+}
+
+static int
+bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* merges the latencies of an operation from all the sessions into the first one and sorts them */
+static int
+bench_lat_merge(struct bench_worker *workers, uint32_t count, BENCH_OP op, struct bench_lat *all)
+{
+    uint32_t i;
+
+    memset(all, 0, sizeof *all);
+    for (i = 0; i < count; ++i) {
+        all->count += workers[i].lat[op].count;
+        all->errors += workers[i].lat[op].errors;
+    }
+    if (!all->count) {
+        return 0;
+    }
+
+    all->us = malloc(all->count * sizeof *all->us);
+    if (!all->us) {
+        return -1;
+    }
+    all->count = 0;
+    for (i = 0; i < count; ++i) {
+        memcpy(all->us + all->count, workers[i].lat[op].us, workers[i].lat[op].count * sizeof *all->us);
+        all->count += workers[i].lat[op].count;
+    }
+    qsort(all->us, all->count, sizeof *all->us, bench_cmp_u32);
+
+    return 0;
+}
+
+static uint32_t
+bench_pct(const struct bench_lat *lat, uint32_t permille)
+{
+    uint64_t rank;
+
+    if (!lat->count) {
+        return 0;
+    }
+
+    /* nearest rank */
+    rank = ((uint64_t)lat->count * permille + 999) / 1000;
+    return lat->us[rank ? rank - 1 : 0];
+}
+
+static void
+bench_print(const struct bench_opts *opts, struct bench_lat *all, uint32_t notifs, uint32_t failed, double elapsed)
+{
+    FILE *out = opts->output;
+    uint32_t count = 0, errors = 0;
+    BENCH_OP op;
+    int first = 1;
+
+    for (op = 0; op < BENCH_OP_COUNT; ++op) {
+        count += all[op].count;
+        errors += all[op].errors;
+    }
+
+    if (opts->json) {
+        fprintf(out, "{\"sessions\":%" PRIu32 ",\"duration\":%.3f,\"rate\":%.1f,\"failed-sessions\":%" PRIu32 ",\"operations\":{",
+                opts->sessions, elapsed, opts->rate, failed);
+        for (op = 0; op < BENCH_OP_COUNT; ++op) {
+            if (!all[op].count && !all[op].errors) {
+                continue;
+            }
+            fprintf(out, "%s\"%s\":{\"count\":%" PRIu32 ",\"errors\":%" PRIu32 ",\"throughput\":%.1f,\"latency-us\":{"
+                    "\"p50\":%" PRIu32 ",\"p90\":%" PRIu32 ",\"p99\":%" PRIu32 ",\"p999\":%" PRIu32 ",\"max\":%" PRIu32 "}}",
+                    first ? "" : ",", bench_op_names[op], all[op].count, all[op].errors, all[op].count / elapsed,
+                    bench_pct(&all[op], 500), bench_pct(&all[op], 900), bench_pct(&all[op], 990),
+                    bench_pct(&all[op], 999), bench_pct(&all[op], 1000));
+            first = 0;
+        }
+        fprintf(out, "},\"total\":{\"count\":%" PRIu32 ",\"errors\":%" PRIu32 ",\"throughput\":%.1f},\"notifications\":%" PRIu32 "}\n",
+                count, errors, count / elapsed, notifs);
+        return;
+    }
+
+    fprintf(out, "%" PRIu32 " sessions, %s, %.3f s", opts->sessions, (opts->rate > 0) ? "open loop" : "closed loop", elapsed);
+    if (opts->rate > 0) {
+        fprintf(out, ", target %.1f RPC/s", opts->rate);
+    }
+    fprintf(out, "\n%-20s %9s %7s %10s %9s %9s %9s %9s %9s\n", "Operation", "Count", "Errors", "RPC/s",
+            "p50 [ms]", "p90 [ms]", "p99 [ms]", "p99.9", "max");
+    for (op = 0; op < BENCH_OP_COUNT; ++op) {
+        if (!all[op].count && !all[op].errors) {
+            continue;
+        }
+        fprintf(out, "%-20s %9" PRIu32 " %7" PRIu32 " %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n", bench_op_names[op],
+                all[op].count, all[op].errors, all[op].count / elapsed, bench_pct(&all[op], 500) / 1000.0,
+                bench_pct(&all[op], 900) / 1000.0, bench_pct(&all[op], 990) / 1000.0, bench_pct(&all[op], 999) / 1000.0,
+                bench_pct(&all[op], 1000) / 1000.0);
+    }
+    fprintf(out, "%-20s %9" PRIu32 " %7" PRIu32 " %10.1f\n", "total", count, errors, count / elapsed);
+    if (opts->stream) {
+        fprintf(out, "Notifications received: %" PRIu32 "\n", notifs);
+    }
+    if (failed) {
+        fprintf(out, "Sessions failed: %" PRIu32 "\n", failed);
+    }
+}
+
+int
+bench_run(struct nc_session *template_session, const struct bench_opts *opts)
+{
+    struct bench_worker *workers;
+    struct bench_lat all[BENCH_OP_COUNT];
+    struct ly_ctx *ctx;
+    const char *host;
+    uint16_t port;
+    uint32_t i, started = 0, notifs = 0, failed = 0;
+    uint64_t start, stop;
+    NC_TRANSPORT_IMPL ti;
+    BENCH_OP op;
+    int ret = EXIT_FAILURE;
+
+    ti = nc_session_get_ti(template_session);
+    host = nc_session_get_host(template_session);
+    port = nc_session_get_port(template_session);
+    /* the new sessions share the context, the schemas are not retrieved again */
+    ctx = nc_session_get_ctx(template_session);
+
+    memset(all, 0, sizeof all);
+    workers = calloc(opts->sessions, sizeof *workers);
+    if (!workers) {
+        ERROR("bench", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    /* connect sequentially, there may be interactive authentication */
+    for (i = 0; i < opts->sessions; ++i) {
+        workers[i].idx = i;
+        workers[i].opts = opts;
+        switch (ti) {
+#ifdef NC_ENABLED_SSH
+        case NC_TI_LIBSSH:
+            nc_client_ssh_set_username(nc_session_get_username(template_session));
+            workers[i].session = nc_connect_ssh(host, port, ctx);
+            break;
+#endif
+#ifdef NC_ENABLED_TLS
+        case NC_TI_OPENSSL:
+            workers[i].session = nc_connect_tls(host, port, ctx);
+            break;
+#endif
+        default:
+            ERROR("bench", "Unsupported transport of the current session.");
+            goto cleanup;
+        }
+        if (!workers[i].session) {
+            ERROR("bench", "Failed to open session %" PRIu32 " to %s:%u.", i + 1, host, port);
+            goto cleanup;
+        }
+    }
+
+    bench_stop = 0;
+    bench_seq = 0;
+    start = cli_time_us();
+    for (started = 0; started < opts->sessions; ++started) {
+        if (pthread_create(&workers[started].tid, NULL, bench_worker_thread, &workers[started])) {
+            ERROR("bench", "Failed to create thread (%s).", strerror(errno));
+            bench_stop = 1;
+            break;
+        }
+    }
+
+    stop = start + (uint64_t)opts->duration * 1000000;
+    while (!bench_stop && (cli_time_us() < stop)) {
+        usleep(10000);
+    }
+    bench_stop = 1;
+    for (i = 0; i < started; ++i) {
+        pthread_join(workers[i].tid, NULL);
+        failed += workers[i].failed;
+        notifs += workers[i].notifs;
+    }
+    if (started < opts->sessions) {
+        goto cleanup;
+    }
+
+    for (op = 0; op < BENCH_OP_COUNT; ++op) {
+        if (bench_lat_merge(workers, opts->sessions, op, &all[op])) {
+            ERROR("bench", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto cleanup;
+        }
+    }
+    bench_print(opts, all, notifs, failed, (cli_time_us() - start) / 1000000.0);
+    ret = failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+cleanup:
+    for (op = 0; op < BENCH_OP_COUNT; ++op) {
+        free(all[op].us);
+    }
+    for (i = 0; i < opts->sessions; ++i) {
+        if (workers[i].session) {
+            nc_session_free(workers[i].session, NULL);
+        }
+        for (op = 0; op < BENCH_OP_COUNT; ++op) {
+            free(workers[i].lat[op].us);
+        }
+    }
+    free(workers);
+    return ret;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file bench.h
+ * @brief netopeer2-cli load generator header
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <nc_client.h>
+
+/* operations of the RPC mix, lock is always followed by unlock */
+typedef enum {
+    BENCH_OP_GET,
+    BENCH_OP_GETCONFIG,
+    BENCH_OP_EDIT,
+    BENCH_OP_LOCK,
+    BENCH_OP_UNLOCK,
+    BENCH_OP_SUBSCRIBE,
+    BENCH_OP_COUNT
+} BENCH_OP;
+
+extern const char *bench_op_names[BENCH_OP_COUNT];
+
+struct bench_opts {
+    uint32_t sessions;              /**< number of sessions, each with its own thread */
+    uint32_t duration;              /**< s */
+    double rate;                    /**< RPC/s of all the sessions together, 0 for closed loop */
+    uint32_t weights[BENCH_OP_COUNT]; /**< relative frequency of the operations */
+    NC_DATASTORE datastore;         /**< get-config source, edit-config and lock target */
+    const char *filter;             /**< subtree or XPath filter of get and get-config */
+    const char *edit_template;      /**< edit-config content, "{seq}" is replaced by a unique number */
+    const char *stream;             /**< stream to subscribe to in every session, NULL for none */
+    int json;                       /**< print the results as JSON */
+    FILE *output;
+};
+
+/**
+ * @brief Open new sessions to the server of an existing session and measure the latency of the RPC mix.
+ *
+ * @param[in] template_session Session with the server, its transport, host, port and user are used.
+ * @param[in] opts Benchmark parameters.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int bench_run(struct nc_session *template_session, const struct bench_opts *opts);
+
+#endif /* BENCH_H_ */
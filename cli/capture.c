@@ -0,0 +1,217 @@
+/**
+ * @file capture.c
+ * @brief netopeer2-cli notification capture into a file
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+#include "commands.h"
+#include "capture.h"
+
+/* the stream is flushed only when this buffer fills up or the capture is closed */
+#define CAPTURE_BUF_SIZE (1024 * 1024)
+
+#define CAPTURE_NTF_XML_START "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>"
+#define CAPTURE_NTF_XML_TIME_END "</eventTime>"
+#define CAPTURE_NTF_XML_END "</notification>"
+
+extern volatile int interleave;
+
+/* the counters are written only by the notification thread */
+static struct {
+    FILE *file;
+    char *buf;
+    char *path;
+    CAPTURE_FORMAT format;
+    uint64_t start;                 /* ms */
+    volatile uint64_t events;
+    volatile uint64_t bytes;
+    volatile uint64_t write_errors;
+    uint64_t sec_start;             /* ms, start of the current rate interval */
+    uint64_t sec_events;            /* events in the current rate interval */
+    volatile uint64_t last_rate;    /* events/s in the last finished interval */
+    volatile uint64_t peak_rate;
+} capture;
+
+int
+capture_open(const char *path, CAPTURE_FORMAT format)
+{
+    if (capture.file) {
+        ERROR("capture", "Already capturing notifications into \"%s\".", capture.path);
+        return -1;
+    }
+
+    capture.buf = malloc(CAPTURE_BUF_SIZE);
+    capture.path = strdup(path);
+    if (!capture.buf || !capture.path) {
+        ERROR("capture", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        goto error;
+    }
+
+    capture.file = fopen(path, "w");
+    if (!capture.file) {
+        ERROR("capture", "Failed to open file \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+    if (setvbuf(capture.file, capture.buf, _IOFBF, CAPTURE_BUF_SIZE)) {
+        ERROR("capture", "Failed to set the buffer of \"%s\".", path);
+        fclose(capture.file);
+        capture.file = NULL;
+        goto error;
+    }
+
+    capture.format = format;
+    capture.events = 0;
+    capture.bytes = 0;
+    capture.write_errors = 0;
+    capture.sec_events = 0;
+    capture.last_rate = 0;
+    capture.peak_rate = 0;
+    capture.start = capture.sec_start = cli_time_us() / 1000;
+    return 0;
+
+error:
+    free(capture.buf);
+    capture.buf = NULL;
+    free(capture.path);
+    capture.path = NULL;
+    return -1;
+}
+
+static int
+capture_write_xml(const struct nc_notif *notif)
+{
+    char *data = NULL;
+    size_t len;
+    int r;
+
+    if (lyd_print_mem(&data, notif->tree, LYD_XML, LYP_WITHSIBLINGS) || !data) {
+        free(data);
+        return -1;
+    }
+
+    len = strlen(CAPTURE_NTF_XML_START) + strlen(notif->datetime) + strlen(CAPTURE_NTF_XML_TIME_END)
+            + strlen(data) + strlen(CAPTURE_NTF_XML_END);
+    r = fprintf(capture.file, "%zu\n%s%s%s%s%s", len, CAPTURE_NTF_XML_START, notif->datetime,
+                CAPTURE_NTF_XML_TIME_END, data, CAPTURE_NTF_XML_END);
+    free(data);
+
+    return (r < 0) ? -1 : r;
+}
+
+static int
+capture_write_json(const struct nc_notif *notif)
+{
+    char *data = NULL;
+    int r;
+
+    /* without LYP_FORMAT the whole tree is printed on a single line */
+    if (lyd_print_mem(&data, notif->tree, LYD_JSON, LYP_WITHSIBLINGS) || !data) {
+        free(data);
+        return -1;
+    }
+
+    r = fprintf(capture.file, "{\"eventTime\":\"%s\",\"notification\":%s}\n", notif->datetime, data);
+    free(data);
+
+    return (r < 0) ? -1 : r;
+}
+
+void
+capture_ntf_clb(struct nc_session *UNUSED(session), const struct nc_notif *notif)
+{
+    uint64_t now;
+    int r;
+
+    if (capture.format == CAPTURE_XML) {
+        r = capture_write_xml(notif);
+    } else {
+        r = capture_write_json(notif);
+    }
+    if (r < 0) {
+        ++capture.write_errors;
+    } else {
+        capture.bytes += r;
+    }
+    ++capture.events;
+
+    /* rate over whole seconds */
+    now = cli_time_us() / 1000;
+    if (now - capture.sec_start >= 1000) {
+        capture.last_rate = (capture.sec_events * 1000) / (now - capture.sec_start);
+        if (capture.last_rate > capture.peak_rate) {
+            capture.peak_rate = capture.last_rate;
+        }
+        capture.sec_start = now;
+        capture.sec_events = 0;
+    }
+    ++capture.sec_events;
+
+    if (!strcmp(notif->tree->schema->name, "notificationComplete")
+            && !strcmp(notif->tree->schema->module->name, "nc-notifications")) {
+        interleave = 1;
+    }
+}
+
+void
+capture_print_stats(FILE *out)
+{
+    uint64_t elapsed, events;
+
+    if (!capture.file) {
+        return;
+    }
+
+    events = capture.events;
+    elapsed = cli_time_us() / 1000 - capture.start;
+    fprintf(out, "Notification capture:\n");
+    fprintf(out, "  File        : %s (%s)\n", capture.path, (capture.format == CAPTURE_XML) ? "xml" : "json");
+    fprintf(out, "  Events      : %" PRIu64 "\n", events);
+    fprintf(out, "  Bytes       : %" PRIu64 "\n", capture.bytes);
+    if (capture.write_errors) {
+        fprintf(out, "  Write errors: %" PRIu64 "\n", capture.write_errors);
+    }
+    fprintf(out, "  Time        : %.3f s\n", elapsed / 1000.0);
+    fprintf(out, "  Rate        : %.1f events/s average, %" PRIu64 " last second, %" PRIu64 " peak\n",
+            elapsed ? (events * 1000.0) / elapsed : 0.0, capture.last_rate, capture.peak_rate);
+}
+
+void
+capture_close(FILE *out)
+{
+    if (!capture.file) {
+        return;
+    }
+
+    if (fflush(capture.file)) {
+        ERROR("capture", "Failed to write into \"%s\" (%s).", capture.path, strerror(errno));
+    }
+    if (out) {
+        capture_print_stats(out);
+    }
+
+    fclose(capture.file);
+    capture.file = NULL;
+    free(capture.buf);
+    capture.buf = NULL;
+    free(capture.path);
+    capture.path = NULL;
+}
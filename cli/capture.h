@@ -0,0 +1,56 @@
+/**
+ * @file capture.h
+ * @brief netopeer2-cli notification capture header
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdio.h>
+
+#include <nc_client.h>
+
+typedef enum {
+    CAPTURE_XML,    /**< decimal length and a newline followed by the raw notification XML */
+    CAPTURE_JSON    /**< one JSON object per line */
+} CAPTURE_FORMAT;
+
+/**
+ * @brief Open a capture file, there can be only one at a time.
+ *
+ * @param[in] path Path of the file, it is truncated.
+ * @param[in] format Format of the records.
+ * @return 0 on success, -1 on error.
+ */
+int capture_open(const char *path, CAPTURE_FORMAT format);
+
+/**
+ * @brief Notification callback writing into the opened capture file.
+ */
+void capture_ntf_clb(struct nc_session *session, const struct nc_notif *notif);
+
+/**
+ * @brief Print the capture counters, nothing if there is no capture.
+ *
+ * @param[in] out Output stream.
+ */
+void capture_print_stats(FILE *out);
+
+/**
+ * @brief Flush and close the capture file and print the final counters.
+ *
+ * Call only after the notification thread has finished, when the session was freed.
+ *
+ * @param[in] out Output stream for the counters, NULL to print nothing.
+ */
+void capture_close(FILE *out);
+
+#endif /* CAPTURE_H_ */
@@ -28,6 +28,8 @@
 #include <getopt.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include <libyang/libyang.h>
 #include <nc_client.h>
@@ -40,6 +42,11 @@
 #include "commands.h"
 #include "configuration.h"
 #include "completion.h"
+#include "bench.h"
+#include "capture.h"
+#include "fanout.h"
+#include "batch.h"
+#include "schema_cache.h"
 
 #define CLI_CH_TIMEOUT 60 /* 1 minute */
 
@@ -64,6 +71,8 @@ char *config_editor;
 struct nc_session *session;
 volatile pthread_t ntf_tid;
 volatile int interleave;
+int rpc_send_timeout = 1000;   /* ms, -1 for infinite */
+int rpc_recv_timeout = 10000;  /* ms, -1 for infinite */
 
 int cmd_disconnect(const char *arg, char **tmp_config_file);
 
@@ -198,44 +207,53 @@ cli_ntf_clb(struct nc_session *session, const struct nc_notif *notif)
     }
 }
 
+/* prints the anyxml data of a reply to a generic <get> or <get-config> as received */
 static int
-cli_send_recv(struct nc_rpc *rpc, FILE *output, NC_WD_MODE wd_mode)
+cli_print_raw_data(struct nc_reply_data *data_rpl, FILE *output)
 {
-    char *str, *model_data;
-    int ret = 0, ly_wd;
-    uint16_t i, j;
-    uint64_t msgid;
     struct lyd_node_anydata *any;
-    NC_MSG_TYPE msgtype;
-    struct nc_reply *reply;
-    struct nc_reply_data *data_rpl;
-    struct nc_reply_error *error;
+    const char *top_elem;
 
-    msgtype = nc_send_rpc(session, rpc, 1000, &msgid);
-    if (msgtype == NC_MSG_ERROR) {
-        ERROR(__func__, "Failed to send the RPC.");
-        if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
-            cmd_disconnect(NULL, NULL);
-        }
-        return -1;
-    } else if (msgtype == NC_MSG_WOULDBLOCK) {
-        ERROR(__func__, "Timeout for sending the RPC expired.");
+    /* <get>/<get-config> -> <data> */
+    if (!data_rpl->data->child || (data_rpl->data->child->schema->nodetype != LYS_ANYXML)) {
+        ERROR(__func__, "Unexpected data reply.");
         return -1;
     }
+    any = (struct lyd_node_anydata *)data_rpl->data->child;
+    top_elem = strcmp(data_rpl->data->schema->name, "get-config") ? "data" : "config";
 
-recv_reply:
-    msgtype = nc_recv_reply(session, rpc, msgid, 10000,
-                            LYD_OPT_DESTRUCT | LYD_OPT_NOSIBLINGS, &reply);
-    if (msgtype == NC_MSG_ERROR) {
-        ERROR(__func__, "Failed to receive a reply.");
-        if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
-            cmd_disconnect(NULL, NULL);
-        }
-        return -1;
-    } else if (msgtype == NC_MSG_WOULDBLOCK) {
-        ERROR(__func__, "Timeout for receiving a reply expired.");
+    fprintf(output, "<%s xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">\n", top_elem);
+    switch (any->value_type) {
+    case LYD_ANYDATA_CONSTSTRING:
+    case LYD_ANYDATA_STRING:
+        fputs(any->value.str, output);
+        break;
+    case LYD_ANYDATA_DATATREE:
+        lyd_print_file(output, any->value.tree, LYD_XML, LYP_WITHSIBLINGS);
+        break;
+    case LYD_ANYDATA_XML:
+        lyxml_print_file(output, any->value.xml, LYXML_PRINT_SIBLINGS);
+        break;
+    default:
+        /* none of the others can appear here */
+        ERROR(__func__, "Unexpected anydata value format.");
         return -1;
     }
+    fprintf(output, "\n</%s>\n", top_elem);
+
+    return 0;
+}
+
+/* prints the reply to the RPC, returns 0 on success, 1 on an error reply, -1 on failure */
+static int
+cli_print_reply(struct nc_reply *reply, struct nc_rpc *rpc, FILE *output, NC_WD_MODE wd_mode, int raw)
+{
+    char *str, *model_data;
+    int ret = 0, ly_wd;
+    uint16_t i, j;
+    struct lyd_node_anydata *any;
+    struct nc_reply_data *data_rpl;
+    struct nc_reply_error *error;
 
     switch (reply->type) {
     case NC_RPL_OK:
@@ -244,6 +262,11 @@ recv_reply:
     case NC_RPL_DATA:
         data_rpl = (struct nc_reply_data *)reply;
 
+        if (raw) {
+            ret = cli_print_raw_data(data_rpl, output);
+            break;
+        }
+
         /* special case */
         if (nc_rpc_get_type(rpc) == NC_RPC_GETSCHEMA) {
             if (output == stdout) {
@@ -380,9 +403,48 @@ recv_reply:
         break;
     default:
         ERROR(__func__, "Internal error.");
-        nc_reply_free(reply);
+        ret = -1;
+        break;
+    }
+
+    return ret;
+}
+
+static int
+cli_send_recv_print(struct nc_rpc *rpc, FILE *output, NC_WD_MODE wd_mode, int raw)
+{
+    int ret;
+    uint64_t msgid;
+    NC_MSG_TYPE msgtype;
+    struct nc_reply *reply;
+
+    msgtype = nc_send_rpc(session, rpc, rpc_send_timeout, &msgid);
+    if (msgtype == NC_MSG_ERROR) {
+        ERROR(__func__, "Failed to send the RPC.");
+        if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
+            cmd_disconnect(NULL, NULL);
+        }
+        return -1;
+    } else if (msgtype == NC_MSG_WOULDBLOCK) {
+        ERROR(__func__, "Timeout for sending the RPC expired.");
+        return -1;
+    }
+
+recv_reply:
+    msgtype = nc_recv_reply(session, rpc, msgid, rpc_recv_timeout,
+                            LYD_OPT_DESTRUCT | LYD_OPT_NOSIBLINGS, &reply);
+    if (msgtype == NC_MSG_ERROR) {
+        ERROR(__func__, "Failed to receive a reply.");
+        if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
+            cmd_disconnect(NULL, NULL);
+        }
+        return -1;
+    } else if (msgtype == NC_MSG_WOULDBLOCK) {
+        ERROR(__func__, "Timeout for receiving a reply expired.");
         return -1;
     }
+
+    ret = cli_print_reply(reply, rpc, output, wd_mode, raw);
     nc_reply_free(reply);
 
     if (msgtype == NC_MSG_REPLY_ERR_MSGID) {
@@ -393,6 +455,92 @@ recv_reply:
     return ret;
 }
 
+static int
+cli_send_recv(struct nc_rpc *rpc, FILE *output, NC_WD_MODE wd_mode)
+{
+    return cli_send_recv_print(rpc, output, wd_mode, 0);
+}
+
+static void
+print_xml_escaped(FILE *out, const char *str)
+{
+    for (; *str; ++str) {
+        switch (*str) {
+        case '&':
+            fputs("&amp;", out);
+            break;
+        case '<':
+            fputs("&lt;", out);
+            break;
+        case '"':
+            fputs("&quot;", out);
+            break;
+        default:
+            fputc(*str, out);
+            break;
+        }
+    }
+}
+
+/*
+ * sends <get> (source is 0) or <get-config> as a generic RPC, the <data> in the reply are then kept as anyxml,
+ * neither parsed into a data tree nor validated, and printed into output as received
+ */
+static int
+cli_send_recv_raw(NC_DATASTORE source, const char *filter, NC_WD_MODE wd_mode, FILE *output)
+{
+    char *content = NULL;
+    size_t size;
+    FILE *f;
+    struct nc_rpc *rpc;
+    int ret;
+
+    f = open_memstream(&content, &size);
+    if (!f) {
+        ERROR(__func__, "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        return -1;
+    }
+    fprintf(f, "<%s xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">", source ? "get-config" : "get");
+    switch (source) {
+    case NC_DATASTORE_RUNNING:
+        fputs("<source><running/></source>", f);
+        break;
+    case NC_DATASTORE_STARTUP:
+        fputs("<source><startup/></source>", f);
+        break;
+    case NC_DATASTORE_CANDIDATE:
+        fputs("<source><candidate/></source>", f);
+        break;
+    default:
+        break;
+    }
+    if (filter && (filter[0] == '<')) {
+        fprintf(f, "<filter type=\"subtree\">%s</filter>", filter);
+    } else if (filter) {
+        fputs("<filter type=\"xpath\" select=\"", f);
+        print_xml_escaped(f, filter);
+        fputs("\"/>", f);
+    }
+    if (wd_mode) {
+        fprintf(f, "<with-defaults xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-with-defaults\">%s</with-defaults>",
+                (wd_mode == NC_WD_ALL) ? "report-all" : (wd_mode == NC_WD_ALL_TAG) ? "report-all-tagged"
+                : (wd_mode == NC_WD_TRIM) ? "trim" : "explicit");
+    }
+    fprintf(f, "</%s>", source ? "get-config" : "get");
+    fclose(f);
+
+    rpc = nc_rpc_act_generic_xml(content, NC_PARAMTYPE_FREE);
+    if (!rpc) {
+        ERROR(__func__, "RPC creation failed.");
+        free(content);
+        return -1;
+    }
+
+    ret = cli_send_recv_print(rpc, output, wd_mode, 1);
+    nc_rpc_free(rpc);
+    return ret;
+}
+
 static char *
 trim_top_elem(char *data, const char *top_elem, const char *top_elem_ns)
 {
@@ -812,7 +960,7 @@ cmd_get_help(void)
         xpath = "";
     }
 
-    fprintf(stdout, "get [--help] [--filter-subtree[=<file>]%s] %s[--out <file>]\n", xpath, defaults);
+    fprintf(stdout, "get [--help] [--filter-subtree[=<file>]%s] %s[--out <file> [--validate]]\n", xpath, defaults);
 }
 
 void
@@ -845,7 +993,7 @@ cmd_getconfig_help(void)
         candidate = "";
     }
 
-    printf("get-config [--help] --source running%s%s [--filter-subtree[=<file>]%s] %s[--out <file>]\n",
+    printf("get-config [--help] --source running%s%s [--filter-subtree[=<file>]%s] %s[--out <file> [--validate]]\n",
            startup, candidate, xpath, defaults);
 }
 
@@ -948,11 +1096,14 @@ cmd_subscribe_help(void)
         xpath = "";
     }
 
-    printf("subscribe [--help] [--filter-subtree[=<file>]%s] [--begin <time>] [--end <time>] [--stream <stream>] [--out <file>]\n", xpath);
+    printf("subscribe [--help] [--filter-subtree[=<file>]%s] [--begin <time>] [--end <time>] [--stream <stream>]\n"
+           "          [--out <file> | --capture <file> [--capture-format xml|json]]\n", xpath);
     printf("\t<time> has following format:\n");
     printf("\t\t+<num>  - current time plus the given number of seconds.\n");
     printf("\t\t<num>   - absolute time as number of seconds since 1970-01-01.\n");
     printf("\t\t-<num>  - current time minus the given number of seconds.\n");
+    printf("\t--capture writes the notifications in a compact form with buffered writes, the counters\n"
+           "\tare shown by \"status\" and the file is closed on \"disconnect\".\n");
 }
 
 void
@@ -972,6 +1123,37 @@ cmd_userrpc_help(void)
     printf("user-rpc [--help] [--content <file>] [--out <file>]\n");
 }
 
+void
+cmd_pipeline_help(void)
+{
+    printf("pipeline [--help] [--window <count>] [--out <file>] <rpcs-file>\n");
+}
+
+void
+cmd_bench_help(void)
+{
+    printf("bench [--help] [--sessions <count>] [--duration <sec>] [--rate <rpc-per-sec>]\n"
+           "      [--mix <op>=<weight>[,<op>=<weight>]...] [--datastore running|startup|candidate]\n"
+           "      [--filter-subtree <file> | --filter-xpath <XPath>] [--edit-template <file>]\n"
+           "      [--subscribe[=<stream>]] [--json] [--out <file>]\n"
+           "  op: get, get-config, edit-config, lock\n");
+}
+
+void
+cmd_fanout_help(void)
+{
+    printf("fanout [--help] --inventory <file> [--out-dir <dir>] [--jobs <count>] [--retries <count>]\n"
+           "       [--backoff <msec>] <command> [<arguments>]\n"
+           "  The inventory has \"<name> <connect arguments>\" on each line, the output of the command\n"
+           "  on each device is written into <dir>/<name>.out and its log into <dir>/<name>.log.\n");
+}
+
+void
+cmd_timeout_help(void)
+{
+    printf("timeout [--help] [--send <msec>] [--receive <msec>]\n");
+}
+
 #ifdef NC_ENABLED_SSH
 
 void
@@ -1409,7 +1591,7 @@ cmd_connect_listen_ssh(struct arglist *cmd, int is_connect)
 
         nc_client_ssh_set_username(user);
         /* create the session */
-        session = nc_connect_ssh(host, port, NULL);
+        session = scache_connect(nc_connect_ssh, host, port);
         if (session == NULL) {
             ERROR(func_name, "Connecting to the %s:%d as user \"%s\" failed.", host, port, user);
             return EXIT_FAILURE;
@@ -2198,7 +2380,7 @@ cmd_connect_listen_tls(struct arglist *cmd, int is_connect)
         }
 
         /* create the session */
-        session = nc_connect_tls(host, port, NULL);
+        session = scache_connect(nc_connect_tls, host, port);
         if (session == NULL) {
             ERROR(func_name, "Connecting to the %s:%d failed.", host, port);
             goto error_cleanup;
@@ -2345,6 +2527,95 @@ cmd_verb(const char *arg, char **UNUSED(tmp_config_file))
     return 0;
 }
 
+static int
+parse_timeout(const char *str, int *timeout)
+{
+    char *ptr;
+    long val;
+
+    errno = 0;
+    val = strtol(str, &ptr, 10);
+    if (errno || ptr[0] || (val < -1) || !val || (val > INT32_MAX)) {
+        ERROR("timeout", "Invalid timeout \"%s\", expected milliseconds or -1 for infinite.", str);
+        return 1;
+    }
+
+    *timeout = val;
+    return 0;
+}
+
+int
+cmd_timeout(const char *arg, char **UNUSED(tmp_config_file))
+{
+    int c, ret = EXIT_FAILURE;
+    struct arglist cmd;
+    struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"send", 1, 0, 's'},
+            {"receive", 1, 0, 'r'},
+            {0, 0, 0, 0}
+    };
+    int option_index = 0;
+
+    /* set back to start to be able to use getopt() repeatedly */
+    optind = 0;
+
+    init_arglist(&cmd);
+    if (addargs(&cmd, "%s", arg)) {
+        return EXIT_FAILURE;
+    }
+
+    if (cmd.count == 1) {
+        if (rpc_send_timeout == -1) {
+            printf("Send timeout:    infinite\n");
+        } else {
+            printf("Send timeout:    %d ms\n", rpc_send_timeout);
+        }
+        if (rpc_recv_timeout == -1) {
+            printf("Receive timeout: infinite\n");
+        } else {
+            printf("Receive timeout: %d ms\n", rpc_recv_timeout);
+        }
+        ret = EXIT_SUCCESS;
+        goto cleanup;
+    }
+
+    while ((c = getopt_long(cmd.count, cmd.list, "hs:r:", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 'h':
+            cmd_timeout_help();
+            ret = EXIT_SUCCESS;
+            goto cleanup;
+        case 's':
+            if (parse_timeout(optarg, &rpc_send_timeout)) {
+                goto cleanup;
+            }
+            break;
+        case 'r':
+            if (parse_timeout(optarg, &rpc_recv_timeout)) {
+                goto cleanup;
+            }
+            break;
+        default:
+            ERROR(__func__, "Unknown option -%c.", c);
+            cmd_timeout_help();
+            goto cleanup;
+        }
+    }
+
+    if (cmd.list[optind]) {
+        ERROR(__func__, "Unparsed command arguments.");
+        cmd_timeout_help();
+        goto cleanup;
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    clear_arglist(&cmd);
+    return ret;
+}
+
 int
 cmd_disconnect(const char *UNUSED(arg), char **UNUSED(tmp_config_file))
 {
@@ -2355,6 +2626,10 @@ cmd_disconnect(const char *UNUSED(arg), char **UNUSED(tmp_config_file))
         ntf_tid = 0;
         nc_session_free(session, NULL);
         session = NULL;
+        scache_ctx_destroy();
+
+        /* the notification thread is finished now */
+        capture_close(stdout);
     }
 
     return EXIT_SUCCESS;
@@ -2398,6 +2673,7 @@ cmd_status(const char *UNUSED(arg), char **UNUSED(tmp_config_file))
         for (i = 0; cpblts[i]; ++i) {
             printf("\t%s\n", cpblts[i]);
         }
+        capture_print_stats(stdout);
     }
 
     return EXIT_SUCCESS;
@@ -3277,7 +3553,7 @@ fail:
 int
 cmd_get(const char *arg, char **tmp_config_file)
 {
-    int c, config_fd, ret = EXIT_FAILURE, filter_param = 0;
+    int c, config_fd, ret = EXIT_FAILURE, filter_param = 0, validate = 0;
     struct stat config_stat;
     char *filter = NULL, *config_m = NULL;
     struct nc_rpc *rpc;
@@ -3290,6 +3566,7 @@ cmd_get(const char *arg, char **tmp_config_file)
             {"filter-xpath", 1, 0, 'x'},
             {"defaults", 1, 0, 'd'},
             {"out", 1, 0, 'o'},
+            {"validate", 0, 0, 'v'},
             {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -3302,7 +3579,7 @@ cmd_get(const char *arg, char **tmp_config_file)
         return EXIT_FAILURE;
     }
 
-    while ((c = getopt_long(cmd.count, cmd.list, "hs::x:d:o:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(cmd.count, cmd.list, "hs::x:d:o:v", long_options, &option_index)) != -1) {
         switch (c) {
         case 'h':
             cmd_get_help();
@@ -3383,6 +3660,9 @@ cmd_get(const char *arg, char **tmp_config_file)
                 goto fail;
             }
             break;
+        case 'v':
+            validate = 1;
+            break;
         default:
             ERROR(__func__, "Unknown option -%c.", c);
             cmd_get_help();
@@ -3416,6 +3696,12 @@ cmd_get(const char *arg, char **tmp_config_file)
         }
     }
 
+    if (output && !validate && (output_format == LYD_XML)) {
+        /* the data are only stored, they need not be parsed */
+        ret = cli_send_recv_raw(0, filter, wd, output);
+        goto fail;
+    }
+
     /* create requests */
     rpc = nc_rpc_get(filter, wd, NC_PARAMTYPE_CONST);
     if (!rpc) {
@@ -3443,7 +3729,7 @@ fail:
 int
 cmd_getconfig(const char *arg, char **tmp_config_file)
 {
-    int c, config_fd, ret = EXIT_FAILURE, filter_param = 0;
+    int c, config_fd, ret = EXIT_FAILURE, filter_param = 0, validate = 0;
     struct stat config_stat;
     char *filter = NULL, *config_m = NULL;
     struct nc_rpc *rpc;
@@ -3458,6 +3744,7 @@ cmd_getconfig(const char *arg, char **tmp_config_file)
             {"filter-xpath", 1, 0, 'x'},
             {"defaults", 1, 0, 'd'},
             {"out", 1, 0, 'o'},
+            {"validate", 0, 0, 'v'},
             {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -3470,7 +3757,7 @@ cmd_getconfig(const char *arg, char **tmp_config_file)
         return EXIT_FAILURE;
     }
 
-    while ((c = getopt_long(cmd.count, cmd.list, "hu:s::x:d:o:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(cmd.count, cmd.list, "hu:s::x:d:o:v", long_options, &option_index)) != -1) {
         switch (c) {
         case 'h':
             cmd_getconfig_help();
@@ -3563,6 +3850,9 @@ cmd_getconfig(const char *arg, char **tmp_config_file)
                 goto fail;
             }
             break;
+        case 'v':
+            validate = 1;
+            break;
         default:
             ERROR(__func__, "Unknown option -%c.", c);
             cmd_getconfig_help();
@@ -3602,6 +3892,12 @@ cmd_getconfig(const char *arg, char **tmp_config_file)
         }
     }
 
+    if (output && !validate && (output_format == LYD_XML)) {
+        /* the data are only stored, they need not be parsed */
+        ret = cli_send_recv_raw(source, filter, wd, output);
+        goto fail;
+    }
+
     /* create requests */
     rpc = nc_rpc_getconfig(source, filter, wd, NC_PARAMTYPE_CONST);
     if (!rpc) {
@@ -4042,7 +4338,8 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
     int c, config_fd, ret = EXIT_FAILURE, filter_param = 0;
     struct stat config_stat;
     char *filter = NULL, *config_m = NULL, *start = NULL, *stop = NULL;
-    const char *stream = NULL;
+    const char *stream = NULL, *capture_path = NULL;
+    CAPTURE_FORMAT capture_format = CAPTURE_XML;
     struct nc_rpc *rpc;
     time_t t;
     FILE *output = NULL;
@@ -4055,6 +4352,8 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
             {"end", 1, 0, 'e'},
             {"stream", 1, 0, 't'},
             {"out", 1, 0, 'o'},
+            {"capture", 1, 0, 'c'},
+            {"capture-format", 1, 0, 'f'},
             {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -4067,7 +4366,7 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
         return EXIT_FAILURE;
     }
 
-    while ((c = getopt_long(cmd.count, cmd.list, "hs::x:b:e:t:o:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(cmd.count, cmd.list, "hs::x:b:e:t:o:c:f:", long_options, &option_index)) != -1) {
         switch (c) {
         case 'h':
             cmd_subscribe_help();
@@ -4157,6 +4456,20 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
                 goto fail;
             }
             break;
+        case 'c':
+            capture_path = optarg;
+            break;
+        case 'f':
+            if (!strcmp(optarg, "xml")) {
+                capture_format = CAPTURE_XML;
+            } else if (!strcmp(optarg, "json")) {
+                capture_format = CAPTURE_JSON;
+            } else {
+                ERROR(__func__, "Unknown capture format \"%s\".", optarg);
+                cmd_subscribe_help();
+                goto fail;
+            }
+            break;
         default:
             ERROR(__func__, "Unknown option -%c.", c);
             cmd_subscribe_help();
@@ -4170,6 +4483,11 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
         goto fail;
     }
 
+    if (output && capture_path) {
+        ERROR(__func__, "Mixing --out and --capture parameters is not allowed.");
+        goto fail;
+    }
+
     if (!session) {
         ERROR(__func__, "Not connected to a NETCONF server, no RPCs can be sent.");
         goto fail;
@@ -4205,18 +4523,29 @@ cmd_subscribe(const char *arg, char **tmp_config_file)
     }
 
     /* create notification thread */
-    if (!output) {
-        output = stdout;
+    if (capture_path) {
+        if (capture_open(capture_path, capture_format)) {
+            ret = EXIT_FAILURE;
+            goto fail;
+        }
+        ret = nc_recv_notif_dispatch(session, capture_ntf_clb);
+        if (ret) {
+            capture_close(NULL);
+        }
+    } else {
+        if (!output) {
+            output = stdout;
+        }
+        nc_session_set_data(session, output);
+        ret = nc_recv_notif_dispatch(session, cli_ntf_clb);
     }
-    nc_session_set_data(session, output);
-    ret = nc_recv_notif_dispatch(session, cli_ntf_clb);
     if (ret) {
         ERROR(__func__, "Failed to create notification thread.");
         goto fail;
     }
 
     if (!nc_session_cpblt(session, NC_CAP_INTERLEAVE_ID)) {
-        fprintf(output, "NETCONF server does not support interleave, you\n"
+        fprintf(output ? output : stdout, "NETCONF server does not support interleave, you\n"
                         "cannot issue any RPCs during the subscription.\n"
                         "Close the session with \"disconnect\".\n");
         interleave = 0;
@@ -4471,6 +4800,598 @@ fail:
     return ret;
 }
 
+uint64_t
+cli_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* receives and prints the reply to a pipelined RPC, returns as cli_print_reply() */
+static int
+cli_pipeline_recv(struct nc_rpc *rpc, uint64_t msgid, uint32_t idx, FILE *output)
+{
+    int ret, timeout;
+    uint64_t deadline = 0, now;
+    NC_MSG_TYPE msgtype;
+    struct nc_reply *reply;
+
+    if (rpc_recv_timeout > -1) {
+        deadline = cli_time_us() / 1000 + rpc_recv_timeout;
+    }
+
+    do {
+        if (deadline) {
+            now = cli_time_us() / 1000;
+            timeout = (now < deadline) ? (int)(deadline - now) : 0;
+        } else {
+            timeout = -1;
+        }
+        /* also returns without a reply if a notification was received meanwhile */
+        msgtype = nc_recv_reply(session, rpc, msgid, timeout, LYD_OPT_DESTRUCT | LYD_OPT_NOSIBLINGS, &reply);
+    } while ((msgtype == NC_MSG_WOULDBLOCK) && (!deadline || (cli_time_us() / 1000 < deadline)));
+
+    if (msgtype == NC_MSG_ERROR) {
+        ERROR("pipeline", "Failed to receive the reply to RPC #%" PRIu32 ".", idx);
+        return -1;
+    } else if (msgtype == NC_MSG_WOULDBLOCK) {
+        ERROR("pipeline", "Timeout for receiving the reply to RPC #%" PRIu32 " expired.", idx);
+        return -1;
+    }
+
+    if (msgtype == NC_MSG_REPLY_ERR_MSGID) {
+        /* libnetconf2 returns replies in the order they arrive, it cannot be matched with any other RPC */
+        fprintf(output, "RPC #%" PRIu32 " (message-id %" PRIu64 "): reply with an unexpected message-id, ", idx, msgid);
+    } else {
+        fprintf(output, "RPC #%" PRIu32 " (message-id %" PRIu64 "): ", idx, msgid);
+    }
+    ret = cli_print_reply(reply, rpc, output, 0, 0);
+    nc_reply_free(reply);
+
+    return ret;
+}
+
+int
+cmd_pipeline(const char *arg, char **UNUSED(tmp_config_file))
+{
+    int c, r, ret = EXIT_FAILURE, stop = 0;
+    char *content, *ptr;
+    long val;
+    uint32_t window = 16, rpc_count = 0, sent = 0, received = 0, ok = 0, errors = 0, failed, i;
+    uint64_t *msgids = NULL, start, elapsed;
+    struct ly_ctx *ctx = NULL;
+    struct lyxml_elem *xml = NULL, *elem;
+    struct nc_rpc **rpcs = NULL;
+    NC_MSG_TYPE msgtype;
+    FILE *output = NULL;
+    struct arglist cmd;
+    struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"window", 1, 0, 'w'},
+            {"out", 1, 0, 'o'},
+            {0, 0, 0, 0}
+    };
+    int option_index = 0;
+
+    /* set back to start to be able to use getopt() repeatedly */
+    optind = 0;
+
+    init_arglist(&cmd);
+    if (addargs(&cmd, "%s", arg)) {
+        return EXIT_FAILURE;
+    }
+
+    while ((c = getopt_long(cmd.count, cmd.list, "hw:o:", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 'h':
+            cmd_pipeline_help();
+            ret = EXIT_SUCCESS;
+            goto cleanup;
+        case 'w':
+            val = strtol(optarg, &ptr, 10);
+            if (ptr[0] || (val < 1) || (val > UINT16_MAX)) {
+                ERROR(__func__, "Invalid window \"%s\".", optarg);
+                goto cleanup;
+            }
+            window = val;
+            break;
+        case 'o':
+            if (output) {
+                ERROR(__func__, "Duplicated \"out\" option.");
+                cmd_pipeline_help();
+                goto cleanup;
+            }
+            output = fopen(optarg, "w");
+            if (!output) {
+                ERROR(__func__, "Failed to open file \"%s\" (%s).", optarg, strerror(errno));
+                goto cleanup;
+            }
+            break;
+        default:
+            ERROR(__func__, "Unknown option -%c.", c);
+            cmd_pipeline_help();
+            goto cleanup;
+        }
+    }
+
+    if (!cmd.list[optind] || cmd.list[optind + 1]) {
+        ERROR(__func__, "Exactly one file with RPCs expected.");
+        cmd_pipeline_help();
+        goto cleanup;
+    }
+
+    if (!session) {
+        ERROR(__func__, "Not connected to a NETCONF server, no RPCs can be sent.");
+        goto cleanup;
+    }
+
+    if (!interleave) {
+        ERROR(__func__, "NETCONF server does not support interleaving RPCs and notifications.");
+        goto cleanup;
+    }
+
+    /* the file contains the RPCs one after another, each as user-rpc content */
+    ctx = nc_session_get_ctx(session);
+    xml = lyxml_parse_path(ctx, cmd.list[optind], LYXML_PARSE_MULTIROOT);
+    if (!xml) {
+        ERROR(__func__, "Failed to parse RPCs from \"%s\".", cmd.list[optind]);
+        goto cleanup;
+    }
+    LY_TREE_FOR(xml, elem) {
+        ++rpc_count;
+    }
+
+    rpcs = calloc(rpc_count, sizeof *rpcs);
+    msgids = calloc(rpc_count, sizeof *msgids);
+    if (!rpcs || !msgids) {
+        ERROR(__func__, "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        goto cleanup;
+    }
+    rpc_count = 0;
+    LY_TREE_FOR(xml, elem) {
+        if (lyxml_print_mem(&content, elem, 0) < 1) {
+            ERROR(__func__, "Failed to print RPC #%" PRIu32 ".", rpc_count + 1);
+            goto cleanup;
+        }
+        rpcs[rpc_count] = nc_rpc_act_generic_xml(content, NC_PARAMTYPE_FREE);
+        if (!rpcs[rpc_count]) {
+            ERROR(__func__, "RPC creation failed.");
+            free(content);
+            goto cleanup;
+        }
+        ++rpc_count;
+    }
+    lyxml_free_withsiblings(ctx, xml);
+    xml = NULL;
+
+    if (!output) {
+        output = stdout;
+    }
+
+    start = cli_time_us() / 1000;
+    while (1) {
+        /* keep up to window RPCs waiting for their replies */
+        while (!stop && (sent < rpc_count) && (sent - received < window)) {
+            msgtype = nc_send_rpc(session, rpcs[sent], rpc_send_timeout, &msgids[sent]);
+            if (msgtype == NC_MSG_WOULDBLOCK) {
+                ERROR(__func__, "Timeout for sending RPC #%" PRIu32 " expired.", sent + 1);
+                stop = 1;
+            } else if (msgtype != NC_MSG_RPC) {
+                ERROR(__func__, "Failed to send RPC #%" PRIu32 ".", sent + 1);
+                stop = 1;
+            } else {
+                ++sent;
+            }
+        }
+        if (received == sent) {
+            break;
+        }
+
+        /* the server replies in the order of the RPCs */
+        r = cli_pipeline_recv(rpcs[received], msgids[received], received + 1, output);
+        if (r == -1) {
+            break;
+        }
+        ++received;
+        if (r) {
+            ++errors;
+        } else {
+            ++ok;
+        }
+    }
+    elapsed = cli_time_us() / 1000 - start;
+    failed = rpc_count - ok - errors;
+
+    if (output != stdout) {
+        fclose(output);
+    }
+    output = NULL;
+
+    printf("Pipelined %" PRIu32 " RPCs in %.3f s", rpc_count, elapsed / 1000.0);
+    if (elapsed) {
+        printf(" (%.1f RPC/s)", received / (elapsed / 1000.0));
+    }
+    printf(": %" PRIu32 " OK, %" PRIu32 " error replies, %" PRIu32 " failed.\n", ok, errors, failed);
+
+    if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
+        cmd_disconnect(NULL, NULL);
+    }
+    if (!failed) {
+        ret = errors ? 1 : EXIT_SUCCESS;
+    }
+
+cleanup:
+    lyxml_free_withsiblings(ctx, xml);
+    if (rpcs) {
+        for (i = 0; i < rpc_count; ++i) {
+            nc_rpc_free(rpcs[i]);
+        }
+    }
+    free(rpcs);
+    free(msgids);
+    clear_arglist(&cmd);
+    if (output && (output != stdout)) {
+        fclose(output);
+    }
+    return ret;
+}
+
+/* reads the whole file into a string */
+static char *
+cli_read_file(const char *path)
+{
+    int fd;
+    struct stat st;
+    char *content;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        ERROR(__func__, "Unable to open the file \"%s\" (%s).", path, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0) {
+        ERROR(__func__, "fstat failed (%s).", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    content = malloc(st.st_size + 1);
+    if (!content) {
+        ERROR(__func__, "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        close(fd);
+        return NULL;
+    }
+    if (read(fd, content, st.st_size) != st.st_size) {
+        ERROR(__func__, "Failed to read the file \"%s\" (%s).", path, strerror(errno));
+        free(content);
+        close(fd);
+        return NULL;
+    }
+    content[st.st_size] = '\0';
+    close(fd);
+
+    return content;
+}
+
+/* parses "<op>=<weight>[,...]" into the weights of the benchmark operations */
+static int
+parse_bench_mix(const char *mix, uint32_t *weights)
+{
+    const char *ptr = mix, *eq;
+    char *end;
+    unsigned long weight;
+    BENCH_OP op;
+
+    memset(weights, 0, BENCH_OP_COUNT * sizeof *weights);
+    while (ptr[0]) {
+        eq = strchr(ptr, '=');
+        if (!eq) {
+            goto error;
+        }
+        for (op = BENCH_OP_GET; op <= BENCH_OP_LOCK; ++op) {
+            if (!strncmp(ptr, bench_op_names[op], eq - ptr) && !bench_op_names[op][eq - ptr]) {
+                break;
+            }
+        }
+        if (op > BENCH_OP_LOCK) {
+            goto error;
+        }
+        errno = 0;
+        weight = strtoul(eq + 1, &end, 10);
+        if (errno || (end == eq + 1) || (end[0] && (end[0] != ',')) || (weight > UINT16_MAX)) {
+            goto error;
+        }
+        weights[op] = weight;
+        ptr = end[0] ? end + 1 : end;
+    }
+
+    for (op = BENCH_OP_GET; op <= BENCH_OP_LOCK; ++op) {
+        if (weights[op]) {
+            return 0;
+        }
+    }
+
+error:
+    ERROR("bench", "Invalid operation mix \"%s\".", mix);
+    return 1;
+}
+
+int
+cmd_bench(const char *arg, char **UNUSED(tmp_config_file))
+{
+    int c, ret = EXIT_FAILURE;
+    char *ptr, *filter = NULL, *edit_template = NULL;
+    long num;
+    double val;
+    struct bench_opts opts;
+    struct arglist cmd;
+    struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"sessions", 1, 0, 'n'},
+            {"duration", 1, 0, 't'},
+            {"rate", 1, 0, 'r'},
+            {"mix", 1, 0, 'm'},
+            {"datastore", 1, 0, 'd'},
+            {"filter-subtree", 1, 0, 's'},
+            {"filter-xpath", 1, 0, 'x'},
+            {"edit-template", 1, 0, 'e'},
+            {"subscribe", 2, 0, 'S'},
+            {"json", 0, 0, 'j'},
+            {"out", 1, 0, 'o'},
+            {0, 0, 0, 0}
+    };
+    int option_index = 0;
+
+    /* set back to start to be able to use getopt() repeatedly */
+    optind = 0;
+
+    memset(&opts, 0, sizeof opts);
+    opts.sessions = 1;
+    opts.duration = 10;
+    opts.weights[BENCH_OP_GETCONFIG] = 1;
+    opts.datastore = NC_DATASTORE_RUNNING;
+
+    init_arglist(&cmd);
+    if (addargs(&cmd, "%s", arg)) {
+        return EXIT_FAILURE;
+    }
+
+    while ((c = getopt_long(cmd.count, cmd.list, "hn:t:r:m:d:s:x:e:S::jo:", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 'h':
+            cmd_bench_help();
+            ret = EXIT_SUCCESS;
+            goto cleanup;
+        case 'n':
+        case 't':
+            num = strtol(optarg, &ptr, 10);
+            if (ptr[0] || (num < 1) || (num > UINT16_MAX)) {
+                ERROR(__func__, "Invalid %s \"%s\".", (c == 'n') ? "number of sessions" : "duration", optarg);
+                goto cleanup;
+            }
+            if (c == 'n') {
+                opts.sessions = num;
+            } else {
+                opts.duration = num;
+            }
+            break;
+        case 'r':
+            val = strtod(optarg, &ptr);
+            if (ptr[0] || (val < 0)) {
+                ERROR(__func__, "Invalid rate \"%s\".", optarg);
+                goto cleanup;
+            }
+            opts.rate = val;
+            break;
+        case 'm':
+            if (parse_bench_mix(optarg, opts.weights)) {
+                goto cleanup;
+            }
+            break;
+        case 'd':
+            if (!strcmp(optarg, "running")) {
+                opts.datastore = NC_DATASTORE_RUNNING;
+            } else if (!strcmp(optarg, "startup")) {
+                opts.datastore = NC_DATASTORE_STARTUP;
+            } else if (!strcmp(optarg, "candidate")) {
+                opts.datastore = NC_DATASTORE_CANDIDATE;
+            } else {
+                ERROR(__func__, "Invalid datastore specified (%s).", optarg);
+                goto cleanup;
+            }
+            break;
+        case 's':
+        case 'x':
+            if (filter) {
+                ERROR(__func__, "Mixing --filter-subtree, and --filter-xpath parameters is not allowed.");
+                goto cleanup;
+            }
+            filter = (c == 's') ? cli_read_file(optarg) : strdup(optarg);
+            if (!filter) {
+                goto cleanup;
+            }
+            break;
+        case 'e':
+            free(edit_template);
+            edit_template = cli_read_file(optarg);
+            if (!edit_template) {
+                goto cleanup;
+            }
+            break;
+        case 'S':
+            opts.stream = optarg ? optarg : "NETCONF";
+            break;
+        case 'j':
+            opts.json = 1;
+            break;
+        case 'o':
+            if (opts.output) {
+                ERROR(__func__, "Duplicated \"out\" option.");
+                cmd_bench_help();
+                goto cleanup;
+            }
+            opts.output = fopen(optarg, "w");
+            if (!opts.output) {
+                ERROR(__func__, "Failed to open file \"%s\" (%s).", optarg, strerror(errno));
+                goto cleanup;
+            }
+            break;
+        default:
+            ERROR(__func__, "Unknown option -%c.", c);
+            cmd_bench_help();
+            goto cleanup;
+        }
+    }
+
+    if (cmd.list[optind]) {
+        ERROR(__func__, "Unparsed command arguments.");
+        cmd_bench_help();
+        goto cleanup;
+    }
+
+    if (opts.weights[BENCH_OP_EDIT] && !edit_template) {
+        ERROR(__func__, "The edit-config operation requires --edit-template.");
+        goto cleanup;
+    }
+
+    if (!session) {
+        ERROR(__func__, "Not connected to a NETCONF server, the benchmark sessions connect to the same one.");
+        goto cleanup;
+    }
+
+    opts.filter = filter;
+    opts.edit_template = edit_template;
+    if (!opts.output) {
+        opts.output = stdout;
+    }
+    ret = bench_run(session, &opts);
+
+cleanup:
+    clear_arglist(&cmd);
+    if (opts.output && (opts.output != stdout)) {
+        fclose(opts.output);
+    }
+    free(filter);
+    free(edit_template);
+    return ret;
+}
+
+int
+cmd_fanout(const char *arg, char **UNUSED(tmp_config_file))
+{
+    int c, i, ret = EXIT_FAILURE;
+    char *ptr, *cmdline = NULL;
+    size_t len;
+    long num;
+    struct fanout_opts opts;
+    struct arglist cmd;
+    struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"inventory", 1, 0, 'i'},
+            {"out-dir", 1, 0, 'o'},
+            {"jobs", 1, 0, 'j'},
+            {"retries", 1, 0, 'r'},
+            {"backoff", 1, 0, 'b'},
+            {0, 0, 0, 0}
+    };
+    int option_index = 0;
+
+    /* set back to start to be able to use getopt() repeatedly */
+    optind = 0;
+
+    memset(&opts, 0, sizeof opts);
+    opts.out_dir = ".";
+    opts.jobs = 16;
+    opts.retries = 2;
+    opts.backoff = 1000;
+
+    init_arglist(&cmd);
+    if (addargs(&cmd, "%s", arg)) {
+        return EXIT_FAILURE;
+    }
+
+    /* stop at the command, its options are not ours */
+    while ((c = getopt_long(cmd.count, cmd.list, "+hi:o:j:r:b:", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 'h':
+            cmd_fanout_help();
+            ret = EXIT_SUCCESS;
+            goto cleanup;
+        case 'i':
+            opts.inventory = optarg;
+            break;
+        case 'o':
+            opts.out_dir = optarg;
+            break;
+        case 'j':
+        case 'r':
+        case 'b':
+            num = strtol(optarg, &ptr, 10);
+            if (ptr[0] || (num < ((c == 'j') ? 1 : 0)) || (num > UINT16_MAX)) {
+                ERROR(__func__, "Invalid %s \"%s\".",
+                      (c == 'j') ? "number of jobs" : ((c == 'r') ? "number of retries" : "backoff"), optarg);
+                goto cleanup;
+            }
+            if (c == 'j') {
+                opts.jobs = num;
+            } else if (c == 'r') {
+                opts.retries = num;
+            } else {
+                opts.backoff = num;
+            }
+            break;
+        default:
+            ERROR(__func__, "Unknown option -%c.", c);
+            cmd_fanout_help();
+            goto cleanup;
+        }
+    }
+
+    if (!opts.inventory) {
+        ERROR(__func__, "Missing the inventory.");
+        cmd_fanout_help();
+        goto cleanup;
+    }
+    if (!cmd.list[optind]) {
+        ERROR(__func__, "Missing the command.");
+        cmd_fanout_help();
+        goto cleanup;
+    }
+    if (!strcmp(cmd.list[optind], "fanout") || !strcmp(cmd.list[optind], "connect")
+            || !strcmp(cmd.list[optind], "listen") || !strcmp(cmd.list[optind], "disconnect")) {
+        ERROR(__func__, "Command \"%s\" cannot be executed on the devices.", cmd.list[optind]);
+        goto cleanup;
+    }
+
+    /* the arguments were split on spaces, joining them back gives the same command */
+    len = 0;
+    for (i = optind; cmd.list[i]; ++i) {
+        len += strlen(cmd.list[i]) + 1;
+    }
+    cmdline = malloc(len);
+    if (!cmdline) {
+        ERROR(__func__, "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        goto cleanup;
+    }
+    cmdline[0] = '\0';
+    for (i = optind; cmd.list[i]; ++i) {
+        if (i > optind) {
+            strcat(cmdline, " ");
+        }
+        strcat(cmdline, cmd.list[i]);
+    }
+    opts.cmdline = cmdline;
+
+    ret = fanout_run(&opts);
+
+cleanup:
+    clear_arglist(&cmd);
+    free(cmdline);
+    return ret;
+}
+
 COMMAND commands[] = {
 #ifdef NC_ENABLED_SSH
         {"auth", cmd_auth, cmd_auth_help, "Manage SSH authentication options"},
@@ -4483,6 +5404,7 @@ COMMAND commands[] = {
         {"outputformat", cmd_outputformat, cmd_outputformat_help, "Set the output format of all the data"},
         {"searchpath", cmd_searchpath, cmd_searchpath_help, "Set the search path for models"},
         {"verb", cmd_verb, cmd_verb_help, "Change verbosity"},
+        {"timeout", cmd_timeout, cmd_timeout_help, "Set the timeouts for sending RPCs and receiving replies"},
         {"version", cmd_version, NULL, "Print Netopeer2 CLI version"},
         {"disconnect", cmd_disconnect, NULL, "Disconnect from a NETCONF server"},
         {"status", cmd_status, NULL, "Display information about the current NETCONF session"},
@@ -4506,6 +5428,9 @@ COMMAND commands[] = {
         {"subscribe", cmd_subscribe, cmd_subscribe_help, "notifications <create-subscription> operation"},
         {"get-schema", cmd_getschema, cmd_getschema_help, "ietf-netconf-monitoring <get-schema> operation"},
         {"user-rpc", cmd_userrpc, cmd_userrpc_help, "Send your own content in an RPC envelope (for DEBUG purposes)"},
+        {"pipeline", cmd_pipeline, cmd_pipeline_help, "Send many RPCs without waiting for each reply"},
+        {"bench", cmd_bench, cmd_bench_help, "Measure RPC throughput and latencies of the NETCONF server"},
+        {"fanout", cmd_fanout, cmd_fanout_help, "Execute a command on all the devices of an inventory"},
         /* synonyms for previous commands */
         {"?", cmd_help, NULL, "Display commands description"},
         {"exit", cmd_quit, NULL, "Quit the program"},
@@ -28,6 +28,7 @@ char some_msg[4096];
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #define PROMPT "> "
 
@@ -40,4 +41,7 @@ typedef struct {
 
 extern COMMAND commands[];
 
+/* monotonic time in microseconds, for timing and deadlines of all the commands */
+uint64_t cli_time_us(void);
+
 #endif /* COMMANDS_H_ */
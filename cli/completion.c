@@ -93,10 +93,19 @@ complete_cmd(const char *buf, const char *hint, linenoiseCompletions *lc)
     } else if ((!strncmp(buf, "get ", 4) || !strncmp(buf, "get-config ", 11) || !strncmp(buf, "subscribe ", 10))
             && (last_opt(buf, hint, "--filter-subtree") || last_opt(buf, hint, "--out"))) {
         linenoisePathCompletion(buf, hint, lc);
+    } else if (!strncmp(buf, "subscribe ", 10) && last_opt(buf, hint, "--capture")) {
+        linenoisePathCompletion(buf, hint, lc);
     } else if (!strncmp(buf, "get-schema ", 11) && last_opt(buf, hint, "--out")) {
         linenoisePathCompletion(buf, hint, lc);
     } else if (!strncmp(buf, "user-rpc ", 9) && last_opt(buf, hint, "--content")) {
         linenoisePathCompletion(buf, hint, lc);
+    } else if (!strncmp(buf, "pipeline ", 9) && !last_opt(buf, hint, "--window")) {
+        linenoisePathCompletion(buf, hint, lc);
+    } else if (!strncmp(buf, "bench ", 6) && (last_opt(buf, hint, "--filter-subtree")
+            || last_opt(buf, hint, "--edit-template") || last_opt(buf, hint, "--out"))) {
+        linenoisePathCompletion(buf, hint, lc);
+    } else if (!strncmp(buf, "fanout ", 7) && (last_opt(buf, hint, "--inventory") || last_opt(buf, hint, "--out-dir"))) {
+        linenoisePathCompletion(buf, hint, lc);
     } else if (!strchr(buf, ' ') && hint[0]) {
         get_cmd_completion(hint, &matches, &match_count);
 
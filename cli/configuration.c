@@ -35,6 +35,8 @@
 extern LYD_FORMAT output_format;
 extern int output_flag;
 extern char *config_editor;
+extern int rpc_send_timeout;
+extern int rpc_recv_timeout;
 
 /* NetConf Client home (appended to ~/) */
 #define NCC_DIR ".netopeer2-cli"
@@ -253,8 +255,9 @@ void
 load_config(void)
 {
     char *netconf_dir, *history_file, *config_file = NULL;
-    struct lyxml_elem *config_xml = NULL, *child;
+    struct lyxml_elem *config_xml = NULL, *child, *timeout_child;
     struct ly_ctx *ctx;
+    int timeout;
 
 #ifdef NC_ENABLED_SSH
     const char *key_pub, *key_priv;
@@ -318,6 +321,20 @@ load_config(void)
                                 output_format = LYD_XML;
                                 output_flag = 0;
                             } /* else default (formatted XML) */
+                        } else if (!strcmp(child->name, "rpc-timeout")) {
+                            /* doc -> <netconf-client> -> <rpc-timeout> */
+                            LY_TREE_FOR(child->child, timeout_child) {
+                                /* 0 would mean not waiting at all, keep the default then */
+                                timeout = atoi(timeout_child->content);
+                                if (!timeout || (timeout < -1)) {
+                                    continue;
+                                }
+                                if (!strcmp(timeout_child->name, "send")) {
+                                    rpc_send_timeout = timeout;
+                                } else if (!strcmp(timeout_child->name, "receive")) {
+                                    rpc_recv_timeout = timeout;
+                                }
+                            }
                         }
 #ifdef NC_ENABLED_SSH
                         else if (!strcmp(child->name, "authentication")) {
@@ -426,6 +443,16 @@ store_config(void)
         }
         fprintf(config_f, "</output-format>\n");
 
+        /* rpc-timeout */
+        fprintf(config_f, "%*.s<rpc-timeout>\n", indent, "");
+        ++indent;
+
+        fprintf(config_f, "%*.s<send>%d</send>\n", indent, "", rpc_send_timeout);
+        fprintf(config_f, "%*.s<receive>%d</receive>\n", indent, "", rpc_recv_timeout);
+
+        --indent;
+        fprintf(config_f, "%*.s</rpc-timeout>\n", indent, "");
+
         /* authentication */
         fprintf(config_f, "%*.s<authentication>\n", indent, "");
         ++indent;
@@ -0,0 +1,344 @@
+/**
+ * @file fanout.c
+ * @brief netopeer2-cli execution of a command on many devices
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+#include "commands.h"
+#include "batch.h"
+#include "fanout.h"
+
+/* ms, maximum delay between two attempts */
+#define FANOUT_MAX_BACKOFF 60000
+
+extern struct nc_session *session;
+
+int cmd_disconnect(const char *arg, char **tmp_config_file);
+
+typedef enum {
+    FANOUT_NOTRUN = 0,
+    FANOUT_OK,
+    FANOUT_CONNECT_FAILED,  /* retried */
+    FANOUT_SESSION_LOST,    /* retried */
+    FANOUT_CMD_FAILED,      /* the command failed in an established session, not retried */
+    FANOUT_CRASHED
+} FANOUT_STATUS;
+
+static const char *fanout_status_names[] = {"NOTRUN", "OK", "NOCONN", "LOST", "FAILED", "CRASHED"};
+
+/* shared between the device processes and the parent */
+struct fanout_result {
+    FANOUT_STATUS status;
+    uint32_t attempts;
+    uint64_t elapsed;       /* ms */
+};
+
+struct fanout_device {
+    char *name;
+    char *connect_args;
+};
+
+static void
+fanout_free_devices(struct fanout_device *devs, uint32_t dev_count)
+{
+    uint32_t i;
+
+    for (i = 0; i < dev_count; ++i) {
+        free(devs[i].name);
+        free(devs[i].connect_args);
+    }
+    free(devs);
+}
+
+static int
+fanout_read_inventory(const char *inventory, struct fanout_device **devs, uint32_t *dev_count)
+{
+    FILE *f;
+    char *line = NULL, *name, *args, *ptr;
+    size_t size = 0;
+    uint32_t line_no = 0, i;
+    void *mem;
+
+    f = fopen(inventory, "r");
+    if (!f) {
+        ERROR("fanout", "Failed to open file \"%s\" (%s).", inventory, strerror(errno));
+        return -1;
+    }
+
+    *devs = NULL;
+    *dev_count = 0;
+    while ((name = batch_getline(f, &line, &size, &line_no))) {
+        /* <name> <connect arguments> */
+        args = strchr(name, ' ');
+        if (args) {
+            *args = '\0';
+            for (++args; *args == ' '; ++args);
+        }
+        if (!args || !args[0]) {
+            ERROR("fanout", "Missing connect arguments of \"%s\" on line %" PRIu32 ".", name, line_no);
+            goto error;
+        }
+        for (ptr = name; *ptr; ++ptr) {
+            if (*ptr == '/') {
+                *ptr = '_';
+            }
+        }
+        for (i = 0; i < *dev_count; ++i) {
+            if (!strcmp((*devs)[i].name, name)) {
+                ERROR("fanout", "Duplicate device \"%s\" on line %" PRIu32 ".", name, line_no);
+                goto error;
+            }
+        }
+
+        mem = realloc(*devs, (*dev_count + 1) * sizeof **devs);
+        if (!mem) {
+            ERROR("fanout", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto error;
+        }
+        *devs = mem;
+        (*devs)[*dev_count].name = strdup(name);
+        (*devs)[*dev_count].connect_args = strdup(args);
+        ++(*dev_count);
+        if (!(*devs)[*dev_count - 1].name || !(*devs)[*dev_count - 1].connect_args) {
+            ERROR("fanout", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto error;
+        }
+    }
+
+    free(line);
+    fclose(f);
+    return 0;
+
+error:
+    fanout_free_devices(*devs, *dev_count);
+    *devs = NULL;
+    *dev_count = 0;
+    free(line);
+    fclose(f);
+    return -1;
+}
+
+static void
+fanout_sleep_ms(uint32_t ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) && (errno == EINTR));
+}
+
+struct fanout_args {
+    const struct fanout_opts *opts;
+    struct fanout_device *devs;
+    char **out_paths;
+    char **log_paths;
+    struct fanout_result *results;
+};
+
+/* runs in its own process, the output of the command and the log go to the files of the device */
+static int
+fanout_device(uint32_t idx, void *arg)
+{
+    struct fanout_args *args = arg;
+    const struct fanout_opts *opts = args->opts;
+    struct fanout_result *result = &args->results[idx];
+    char *connect_line = NULL;
+    uint32_t attempt, delay = 0;
+    uint64_t start;
+    unsigned int seed = getpid();
+    int r, fd;
+
+    start = cli_time_us() / 1000;
+
+    /* the session of the parent belongs to it, it must not be closed from here */
+    session = NULL;
+
+    /* nobody can answer any prompt */
+    fd = open("/dev/null", O_RDONLY);
+    if ((fd == -1) || (dup2(fd, STDIN_FILENO) == -1)) {
+        result->status = FANOUT_CRASHED;
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    if (!freopen(args->log_paths[idx], "w", stderr)) {
+        result->status = FANOUT_CRASHED;
+        return EXIT_FAILURE;
+    }
+    setvbuf(stderr, NULL, _IONBF, 0);
+#ifdef NC_ENABLED_SSH
+    nc_client_ssh_set_auth_pref(NC_SSH_AUTH_PASSWORD, -1);
+    nc_client_ssh_set_auth_pref(NC_SSH_AUTH_INTERACTIVE, -1);
+#endif
+
+    if (asprintf(&connect_line, "connect %s", args->devs[idx].connect_args) == -1) {
+        fprintf(stderr, "fanout: Memory allocation failed (%s:%d)\n", __FILE__, __LINE__);
+        result->status = FANOUT_CRASHED;
+        return EXIT_FAILURE;
+    }
+
+    for (attempt = 1; attempt <= opts->retries + 1; ++attempt) {
+        if (attempt > 1) {
+            /* exponential backoff with jitter so that the retries of all the devices are spread */
+            delay = delay ? delay * 2 : opts->backoff;
+            if (delay > FANOUT_MAX_BACKOFF) {
+                delay = FANOUT_MAX_BACKOFF;
+            }
+            r = delay + rand_r(&seed) % (delay / 2 + 1);
+            fprintf(stderr, "fanout: Retrying in %d ms.\n", r);
+            fanout_sleep_ms(r);
+        }
+        fprintf(stderr, "fanout: Attempt %" PRIu32 " of %" PRIu32 ".\n", attempt, opts->retries + 1);
+        result->attempts = attempt;
+
+        /* only the output of the last attempt is kept */
+        if (!freopen(args->out_paths[idx], "w", stdout)) {
+            fprintf(stderr, "fanout: Failed to open output file \"%s\" (%s).\n", args->out_paths[idx],
+                    strerror(errno));
+            result->status = FANOUT_CRASHED;
+            break;
+        }
+
+        if (batch_exec(connect_line) || !session) {
+            result->status = FANOUT_CONNECT_FAILED;
+            continue;
+        }
+
+        r = batch_exec(opts->cmdline);
+        if (!r) {
+            result->status = FANOUT_OK;
+        } else if (nc_session_get_status(session) != NC_STATUS_RUNNING) {
+            result->status = FANOUT_SESSION_LOST;
+        } else {
+            result->status = FANOUT_CMD_FAILED;
+        }
+        cmd_disconnect(NULL, NULL);
+
+        if (result->status != FANOUT_SESSION_LOST) {
+            break;
+        }
+    }
+
+    fflush(stdout);
+    free(connect_line);
+    result->elapsed = cli_time_us() / 1000 - start;
+
+    return (result->status == FANOUT_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+fanout_run(const struct fanout_opts *opts)
+{
+    struct fanout_args args = {opts, NULL, NULL, NULL, NULL};
+    uint32_t dev_count = 0, i, count[FANOUT_CRASHED + 1];
+    int *status = NULL, ret = EXIT_FAILURE;
+    char attempts[16];
+    uint64_t start;
+
+    if (fanout_read_inventory(opts->inventory, &args.devs, &dev_count)) {
+        return EXIT_FAILURE;
+    }
+    if (!dev_count) {
+        ERROR("fanout", "No devices in \"%s\".", opts->inventory);
+        goto cleanup;
+    }
+
+    if (mkdir(opts->out_dir, 00755) && (errno != EEXIST)) {
+        ERROR("fanout", "Failed to create directory \"%s\" (%s).", opts->out_dir, strerror(errno));
+        goto cleanup;
+    }
+
+    args.results = batch_shared_alloc(dev_count * sizeof *args.results);
+    status = calloc(dev_count, sizeof *status);
+    args.out_paths = calloc(dev_count, sizeof *args.out_paths);
+    args.log_paths = calloc(dev_count, sizeof *args.log_paths);
+    if (!args.results || !status || !args.out_paths || !args.log_paths) {
+        ERROR("fanout", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+        goto cleanup;
+    }
+    for (i = 0; i < dev_count; ++i) {
+        if ((asprintf(&args.out_paths[i], "%s/%s.out", opts->out_dir, args.devs[i].name) == -1)
+                || (asprintf(&args.log_paths[i], "%s/%s.log", opts->out_dir, args.devs[i].name) == -1)) {
+            ERROR("fanout", "Memory allocation failed (%s:%d)", __FILE__, __LINE__);
+            goto cleanup;
+        }
+    }
+
+    /* the first device is processed alone so that the others find the schemas in the cache */
+    start = cli_time_us() / 1000;
+    batch_fork(dev_count, 1, opts->jobs, fanout_device, &args, status);
+
+    memset(count, 0, sizeof count);
+    batch_summary_head(20, "Device", "Attempts");
+    for (i = 0; i < dev_count; ++i) {
+        if ((status[i] != -1) && (!WIFEXITED(status[i]) || (args.results[i].status == FANOUT_NOTRUN))) {
+            args.results[i].status = FANOUT_CRASHED;
+        }
+        ++count[args.results[i].status];
+        if (args.results[i].status == FANOUT_NOTRUN) {
+            batch_summary_row(20, args.devs[i].name, fanout_status_names[FANOUT_NOTRUN], NULL, 0, NULL);
+            printf("\n");
+            continue;
+        }
+        sprintf(attempts, "%" PRIu32, args.results[i].attempts);
+        batch_summary_row(20, args.devs[i].name, fanout_status_names[args.results[i].status], attempts,
+                          args.results[i].elapsed,
+                          (args.results[i].status == FANOUT_OK) ? args.out_paths[i] : args.log_paths[i]);
+        printf("\n");
+    }
+    printf("\"%s\" on %" PRIu32 " devices took %.3f s: %" PRIu32 " succeeded", opts->cmdline, dev_count,
+           (cli_time_us() / 1000 - start) / 1000.0, count[FANOUT_OK]);
+    for (i = FANOUT_CONNECT_FAILED; i <= FANOUT_CRASHED; ++i) {
+        if (count[i]) {
+            printf(", %" PRIu32 " %s", count[i], fanout_status_names[i]);
+        }
+    }
+    if (count[FANOUT_NOTRUN]) {
+        printf(", %" PRIu32 " %s", count[FANOUT_NOTRUN], fanout_status_names[FANOUT_NOTRUN]);
+    }
+    printf(".\n");
+
+    if (count[FANOUT_OK] == dev_count) {
+        ret = EXIT_SUCCESS;
+    }
+
+cleanup:
+    batch_shared_free(args.results, dev_count * sizeof *args.results);
+    for (i = 0; i < dev_count; ++i) {
+        if (args.out_paths) {
+            free(args.out_paths[i]);
+        }
+        if (args.log_paths) {
+            free(args.log_paths[i]);
+        }
+    }
+    free(args.out_paths);
+    free(args.log_paths);
+    free(status);
+    fanout_free_devices(args.devs, dev_count);
+    return ret;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file fanout.h
+ * @brief netopeer2-cli execution of a command on many devices header
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef FANOUT_H_
+#define FANOUT_H_
+
+#include <stdint.h>
+
+struct fanout_opts {
+    const char *inventory;  /**< file with "<name> <connect arguments>" on each line */
+    const char *out_dir;    /**< directory for the output and log of each device */
+    const char *cmdline;    /**< command executed on every device */
+    uint32_t jobs;          /**< maximum number of devices processed concurrently */
+    uint32_t retries;       /**< additional attempts after a connection failure */
+    uint32_t backoff;       /**< ms, delay before the first retry, doubled for every next one */
+};
+
+/**
+ * @brief Connect to all the devices of an inventory and execute a command on each of them.
+ *
+ * @param[in] opts Fan-out parameters.
+ * @return EXIT_SUCCESS if the command succeeded on all the devices, EXIT_FAILURE otherwise.
+ */
+int fanout_run(const struct fanout_opts *opts);
+
+#endif /* FANOUT_H_ */
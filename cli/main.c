@@ -15,6 +15,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <getopt.h>
@@ -31,6 +32,9 @@
 #include "commands.h"
 #include "completion.h"
 #include "configuration.h"
+#include "batch.h"
+#include "schema_cache.h"
+#include "capture.h"
 #include "linenoise/linenoise.h"
 
 int done;
@@ -122,11 +126,58 @@ ly_print_clb(LY_LOG_LEVEL level, const char *msg, const char *path)
     }
 }
 
+static void
+print_usage(const char *progname)
+{
+    printf("Usage: %s [-h] [-b file [-n sessions] [-o dir]]\n", progname);
+    printf(" -h, --help            Show this help.\n");
+    printf(" -b, --batch <file>    Execute the commands from the file instead of reading them interactively.\n");
+    printf(" -n, --sessions <num>  Number of concurrent sessions executing the batch (default 1).\n");
+    printf(" -o, --out-dir <dir>   Directory for the output file of each session (default \".\").\n");
+}
+
 int
-main(void)
+main(int argc, char **argv)
 {
-    char *cmd, *cmdline, *cmdstart, *tmp_config_file = NULL;
-    int i, j;
+    char *cmd, *cmdline, *cmdstart, *tmp_config_file = NULL, *ptr;
+    const char *batch_file = NULL, *out_dir = ".";
+    unsigned long session_count = 1;
+    int i, j, c, ret = 0;
+    struct option long_options[] = {
+        {"help", 0, 0, 'h'},
+        {"batch", 1, 0, 'b'},
+        {"sessions", 1, 0, 'n'},
+        {"out-dir", 1, 0, 'o'},
+        {0, 0, 0, 0}
+    };
+
+    while ((c = getopt_long(argc, argv, "hb:n:o:", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'h':
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        case 'b':
+            batch_file = optarg;
+            break;
+        case 'n':
+            session_count = strtoul(optarg, &ptr, 10);
+            if (ptr[0] || !session_count || (session_count > UINT16_MAX)) {
+                fprintf(stderr, "Invalid number of sessions \"%s\".\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            out_dir = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
 
     nc_client_init();
 
@@ -147,6 +198,12 @@ main(void)
         config_editor = strdup("vi");
     }
 
+    if (batch_file) {
+        /* the configuration is loaded, but the history is not modified */
+        ret = batch_run(batch_file, session_count, out_dir);
+        done = 1;
+    }
+
     while (!done) {
         /* get the command from user */
         cmdline = linenoise(PROMPT);
@@ -203,16 +260,20 @@ main(void)
         free(cmdline);
     }
 
-    store_config();
+    if (!batch_file) {
+        store_config();
+    }
 
     free(config_editor);
 
     ntf_tid = 0;
     if (session) {
         nc_session_free(session, NULL);
+        scache_ctx_destroy();
+        capture_close(stdout);
     }
 
     nc_client_destroy();
 
-    return 0;
+    return ret;
 }
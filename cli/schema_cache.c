@@ -0,0 +1,508 @@
+/**
+ * @file schema_cache.c
+ * @brief netopeer2-cli on-disk cache of server schemas
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+#include "commands.h"
+#include "configuration.h"
+#include "schema_cache.h"
+
+/*
+ * ~/.netopeer2-cli/schemas/modules/<name>[@<revision>].yang - (sub)module texts as retrieved from servers,
+ *                                                              a revision always identifies the same content
+ * ~/.netopeer2-cli/schemas/servers/<host>@<port>           - "<module> <revision|-> <feature,...|->" of
+ *                                                              each module in the last hello of the server
+ */
+#define SCACHE_DIR "schemas"
+#define SCACHE_MODULES_DIR "modules"
+#define SCACHE_SERVERS_DIR "servers"
+
+#define NC_CAP_MONITORING_ID "urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring"
+
+extern int rpc_send_timeout;
+extern int rpc_recv_timeout;
+
+/* context shared with the current session, libnetconf2 does not destroy it */
+static struct ly_ctx *scache_session_ctx;
+
+static char *
+scache_path(const char *sub)
+{
+    char *netconf_dir, *path;
+
+    netconf_dir = get_netconf_dir();
+    if (!netconf_dir) {
+        return NULL;
+    }
+
+    if (asprintf(&path, "%s/%s/%s", netconf_dir, SCACHE_DIR, sub) == -1) {
+        free(netconf_dir);
+        return NULL;
+    }
+    free(netconf_dir);
+
+    return path;
+}
+
+static int
+scache_mkdirs(const char *modules_dir, const char *servers_dir)
+{
+    char *dir;
+
+    dir = strndup(modules_dir, strrchr(modules_dir, '/') - modules_dir);
+    if (!dir) {
+        return -1;
+    }
+    if ((mkdir(dir, 00700) && (errno != EEXIST)) || (mkdir(modules_dir, 00700) && (errno != EEXIST))
+            || (mkdir(servers_dir, 00700) && (errno != EEXIST))) {
+        ERROR("schema cache", "Failed to create the cache directory (%s).", strerror(errno));
+        free(dir);
+        return -1;
+    }
+    free(dir);
+
+    return 0;
+}
+
+static char *
+scache_server_path(const char *servers_dir, const char *host, uint16_t port)
+{
+    char *path, *ptr;
+
+    if (asprintf(&path, "%s/%s@%u", servers_dir, host, port) == -1) {
+        return NULL;
+    }
+    for (ptr = path + strlen(servers_dir) + 1; *ptr; ++ptr) {
+        if (*ptr == '/') {
+            *ptr = '_';
+        }
+    }
+
+    return path;
+}
+
+/* gets a parameter of a module capability, the returned value is not terminated, returns its length */
+static int
+scache_cpblt_param(const char *cpblt, const char *param, const char **value)
+{
+    const char *ptr;
+    size_t len = strlen(param);
+
+    ptr = strchr(cpblt, '?');
+    while (ptr) {
+        ++ptr;
+        if (!strncmp(ptr, param, len) && (ptr[len] == '=')) {
+            *value = ptr + len + 1;
+            return strcspn(*value, "&");
+        }
+        ptr = strchr(ptr, '&');
+    }
+
+    *value = NULL;
+    return 0;
+}
+
+/* reads a whole file, NULL if it cannot be read */
+static char *
+scache_read_file(const char *path)
+{
+    FILE *f;
+    char *buf;
+    long size;
+
+    f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) || ((size = ftell(f)) == -1) || fseek(f, 0, SEEK_SET)) {
+        fclose(f);
+        return NULL;
+    }
+
+    buf = malloc(size + 1);
+    if (!buf) {
+        fclose(f);
+        return NULL;
+    }
+    if (fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    buf[size] = '\0';
+    fclose(f);
+
+    return buf;
+}
+
+/* the cached (sub)module file of a revision, or of the latest one if there is no revision */
+static char *
+scache_module_path(const char *modules_dir, const char *name, const char *rev)
+{
+    DIR *dir;
+    struct dirent *file;
+    char *path, *latest = NULL;
+    size_t len = strlen(name);
+
+    if (asprintf(&path, "%s/%s%s%s.yang", modules_dir, name, rev ? "@" : "", rev ? rev : "") == -1) {
+        return NULL;
+    }
+    if (rev || !access(path, F_OK)) {
+        return path;
+    }
+    free(path);
+
+    dir = opendir(modules_dir);
+    if (!dir) {
+        return NULL;
+    }
+    while ((file = readdir(dir))) {
+        /* <name>@YYYY-MM-DD.yang, the dates compare as strings */
+        if (strncmp(file->d_name, name, len) || (file->d_name[len] != '@') || (strlen(file->d_name + len) != 16)) {
+            continue;
+        }
+        if (!latest || (strcmp(file->d_name, latest) > 0)) {
+            free(latest);
+            latest = strdup(file->d_name);
+        }
+    }
+    closedir(dir);
+
+    if (!latest || (asprintf(&path, "%s/%s", modules_dir, latest) == -1)) {
+        path = NULL;
+    }
+    free(latest);
+    return path;
+}
+
+/* libyang looks for the (sub)modules in the cache first, then in the searchpath */
+static char *
+scache_module_clb(const char *mod_name, const char *mod_rev, const char *submod_name, const char *sub_rev,
+                  void *user_data, LYS_INFORMAT *format, void (**free_module_data)(void *model_data))
+{
+    char *path, *text;
+
+    if (submod_name) {
+        path = scache_module_path(user_data, submod_name, sub_rev);
+    } else {
+        path = scache_module_path(user_data, mod_name, mod_rev);
+    }
+    if (!path) {
+        return NULL;
+    }
+    text = scache_read_file(path);
+    free(path);
+
+    *format = LYS_IN_YANG;
+    *free_module_data = free;
+    return text;
+}
+
+/* creates a context with the modules the server advertised last time */
+static struct ly_ctx *
+scache_ctx_load(const char *server_path, const char *list, const char *modules_dir)
+{
+    struct ly_ctx *ctx;
+    const struct lys_module *mod;
+    char *lines, *line, *name, *rev, *features, *feature, *saveptr, *saveptr2;
+
+    lines = strdup(list);
+    if (!lines) {
+        return NULL;
+    }
+
+    /* keep the searchpath of the user, the cache only takes precedence */
+    ctx = ly_ctx_new(nc_client_get_schema_searchpath());
+    if (!ctx) {
+        free(lines);
+        return NULL;
+    }
+    ly_ctx_set_module_clb(ctx, scache_module_clb, (void *)modules_dir);
+
+    for (line = strtok_r(lines, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+        name = strtok_r(line, " ", &saveptr2);
+        rev = strtok_r(NULL, " ", &saveptr2);
+        features = strtok_r(NULL, " ", &saveptr2);
+        if (!name || !rev || !features) {
+            goto invalid;
+        }
+
+        mod = ly_ctx_load_module(ctx, name, strcmp(rev, "-") ? rev : NULL);
+        if (!mod) {
+            goto invalid;
+        }
+        if (strcmp(features, "-")) {
+            for (feature = strtok_r(features, ",", &saveptr2); feature; feature = strtok_r(NULL, ",", &saveptr2)) {
+                lys_features_enable(mod, feature);
+            }
+        }
+    }
+
+    /* libnetconf2 retrieves what is still missing with <get-schema> */
+    ly_ctx_set_module_clb(ctx, NULL, NULL);
+    free(lines);
+    return ctx;
+
+invalid:
+    /* the next connect retrieves the schemas from the server again */
+    ERROR("schema cache", "Cached schemas of the server are invalid, not using them.");
+    unlink(server_path);
+    free(lines);
+    ly_ctx_destroy(ctx, NULL);
+    return NULL;
+}
+
+/* "<module> <revision|-> <feature,...|->" line of each module advertised in the hello of the session */
+static char *
+scache_hello_list(struct nc_session *session)
+{
+    const char * const *cpblts;
+    const char *name, *rev, *features;
+    char *list = NULL;
+    size_t size;
+    int i, name_len, rev_len, features_len;
+    FILE *f;
+
+    f = open_memstream(&list, &size);
+    if (!f) {
+        return NULL;
+    }
+    cpblts = nc_session_get_cpblts(session);
+    for (i = 0; cpblts[i]; ++i) {
+        name_len = scache_cpblt_param(cpblts[i], "module", &name);
+        rev_len = scache_cpblt_param(cpblts[i], "revision", &rev);
+        features_len = scache_cpblt_param(cpblts[i], "features", &features);
+        if (!name) {
+            continue;
+        }
+        fprintf(f, "%.*s %.*s %.*s\n", name_len, name, rev ? rev_len : 1, rev ? rev : "-",
+                features_len ? features_len : 1, features_len ? features : "-");
+    }
+    if (fclose(f)) {
+        free(list);
+        return NULL;
+    }
+
+    return list;
+}
+
+/* stores the text of a (sub)module into the cache using <get-schema>, if not there yet or if it may be outdated */
+static void
+scache_fetch(struct nc_session *session, const char *modules_dir, const char *name, const char *rev, int update)
+{
+    char *path = NULL, *tmp_path = NULL;
+    struct nc_rpc *rpc = NULL;
+    struct nc_reply *reply = NULL;
+    struct nc_reply_data *data_rpl;
+    struct lyd_node_anydata *any;
+    uint64_t msgid;
+    NC_MSG_TYPE msgtype;
+    FILE *f;
+    int r;
+
+    if (asprintf(&path, "%s/%s%s%s.yang", modules_dir, name, rev ? "@" : "", rev ? rev : "") == -1) {
+        return;
+    }
+    if (!update && !access(path, F_OK)) {
+        goto cleanup;
+    }
+
+    rpc = nc_rpc_getschema(name, rev, "yang", NC_PARAMTYPE_CONST);
+    if (!rpc || (nc_send_rpc(session, rpc, rpc_send_timeout, &msgid) != NC_MSG_RPC)) {
+        goto cleanup;
+    }
+    do {
+        msgtype = nc_recv_reply(session, rpc, msgid, rpc_recv_timeout, LYD_OPT_DESTRUCT | LYD_OPT_NOSIBLINGS, &reply);
+        if (msgtype == NC_MSG_REPLY_ERR_MSGID) {
+            nc_reply_free(reply);
+            reply = NULL;
+        }
+    } while (msgtype == NC_MSG_REPLY_ERR_MSGID);
+    if ((msgtype != NC_MSG_REPLY) || (reply->type != NC_RPL_DATA)) {
+        goto cleanup;
+    }
+
+    data_rpl = (struct nc_reply_data *)reply;
+    if (!data_rpl->data || !data_rpl->data->child || (data_rpl->data->child->schema->nodetype != LYS_ANYXML)) {
+        goto cleanup;
+    }
+    any = (struct lyd_node_anydata *)data_rpl->data->child;
+    if ((any->value_type != LYD_ANYDATA_CONSTSTRING) && (any->value_type != LYD_ANYDATA_STRING)) {
+        goto cleanup;
+    }
+
+    /* never leave a partially written module */
+    if (asprintf(&tmp_path, "%s.%d", path, getpid()) == -1) {
+        tmp_path = NULL;
+        goto cleanup;
+    }
+    f = fopen(tmp_path, "w");
+    if (!f) {
+        goto cleanup;
+    }
+    r = fputs(any->value.str, f);
+    if (fclose(f) || (r == EOF) || rename(tmp_path, path)) {
+        unlink(tmp_path);
+    }
+
+cleanup:
+    nc_reply_free(reply);
+    nc_rpc_free(rpc);
+    free(tmp_path);
+    free(path);
+}
+
+/* caches the schemas of the modules advertised by the server that are missing or may have changed, and their list */
+static void
+scache_store(struct nc_session *session, const char *server_path, const char *modules_dir, const char *list,
+             const char *cached_list)
+{
+    struct ly_ctx *ctx = nc_session_get_ctx(session);
+    const struct lys_module *mod;
+    const char * const *cpblts;
+    const char *name, *rev;
+    char *name_str, *rev_str, *tmp_path;
+    int i, j, name_len, rev_len, changed;
+    FILE *f;
+
+    if (!nc_session_cpblt(session, NC_CAP_MONITORING_ID)) {
+        /* no <get-schema>, the schemas are always loaded from the searchpath */
+        return;
+    }
+    changed = !cached_list || strcmp(list, cached_list);
+
+    cpblts = nc_session_get_cpblts(session);
+    for (i = 0; cpblts[i]; ++i) {
+        name_len = scache_cpblt_param(cpblts[i], "module", &name);
+        rev_len = scache_cpblt_param(cpblts[i], "revision", &rev);
+        if (!name) {
+            continue;
+        }
+
+        name_str = strndup(name, name_len);
+        rev_str = rev ? strndup(rev, rev_len) : NULL;
+        if (!name_str || (rev && !rev_str)) {
+            free(name_str);
+            free(rev_str);
+            continue;
+        }
+
+        /* a revision always identifies the same text, a module without one may have changed with the hello */
+        scache_fetch(session, modules_dir, name_str, rev_str, !rev_str && changed);
+        mod = ly_ctx_get_module(ctx, name_str, rev_str);
+        for (j = 0; mod && (j < mod->inc_size); ++j) {
+            scache_fetch(session, modules_dir, mod->inc[j].submodule->name,
+                         mod->inc[j].submodule->rev_size ? mod->inc[j].submodule->rev[0].date : NULL,
+                         !mod->inc[j].submodule->rev_size && changed);
+        }
+        free(name_str);
+        free(rev_str);
+    }
+
+    if (!changed) {
+        return;
+    }
+    if (asprintf(&tmp_path, "%s.%d", server_path, getpid()) == -1) {
+        return;
+    }
+    f = fopen(tmp_path, "w");
+    if (!f) {
+        free(tmp_path);
+        return;
+    }
+    fputs(list, f);
+    if (fclose(f) || rename(tmp_path, server_path)) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+}
+
+struct nc_session *
+scache_connect(struct nc_session *(*connect)(const char *, uint16_t, struct ly_ctx *), const char *host, uint16_t port)
+{
+    struct nc_session *new_session = NULL;
+    struct ly_ctx *ctx = NULL;
+    char *modules_dir, *servers_dir, *server_path = NULL, *cached_list = NULL, *list = NULL;
+
+    modules_dir = scache_path(SCACHE_MODULES_DIR);
+    servers_dir = scache_path(SCACHE_SERVERS_DIR);
+    if (!modules_dir || !servers_dir || scache_mkdirs(modules_dir, servers_dir)
+            || !(server_path = scache_server_path(servers_dir, host, port))) {
+        /* connect without the cache */
+        new_session = connect(host, port, NULL);
+        goto cleanup;
+    }
+
+    cached_list = scache_read_file(server_path);
+    if (cached_list) {
+        ctx = scache_ctx_load(server_path, cached_list, modules_dir);
+    }
+    new_session = connect(host, port, ctx);
+    if (new_session && !(list = scache_hello_list(new_session))) {
+        /* just cannot be cached */
+        goto cleanup;
+    }
+    if (new_session && ctx && strcmp(list, cached_list)) {
+        /* any module, revision or feature differs, the context cannot be fixed */
+        ERROR("schema cache", "Cached schemas of %s:%u are outdated, reconnecting.", host, port);
+        nc_session_free(new_session, NULL);
+        ly_ctx_destroy(ctx, NULL);
+        ctx = NULL;
+        free(list);
+        list = NULL;
+        new_session = connect(host, port, NULL);
+        if (new_session && !(list = scache_hello_list(new_session))) {
+            goto cleanup;
+        }
+    }
+    if (!new_session) {
+        if (ctx) {
+            ly_ctx_destroy(ctx, NULL);
+        }
+        goto cleanup;
+    }
+
+    scache_store(new_session, server_path, modules_dir, list, cached_list);
+
+cleanup:
+    if (new_session) {
+        scache_session_ctx = ctx;
+    }
+    free(list);
+    free(cached_list);
+    free(modules_dir);
+    free(servers_dir);
+    free(server_path);
+    return new_session;
+}
+
+void
+scache_ctx_destroy(void)
+{
+    if (scache_session_ctx) {
+        ly_ctx_destroy(scache_session_ctx, NULL);
+        scache_session_ctx = NULL;
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file schema_cache.h
+ * @brief netopeer2-cli on-disk cache of server schemas header
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef SCHEMA_CACHE_H_
+#define SCHEMA_CACHE_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+#include <nc_client.h>
+
+/**
+ * @brief Connect to a server with a context created from the cached schemas it advertised last time.
+ *
+ * The schemas missing in the cache are stored into it after the session is established.
+ *
+ * @param[in] connect Transport-specific libnetconf2 connect function.
+ * @param[in] host Server host.
+ * @param[in] port Server port.
+ * @return Established session, NULL on error.
+ */
+struct nc_session *scache_connect(struct nc_session *(*connect)(const char *, uint16_t, struct ly_ctx *),
+                                  const char *host, uint16_t port);
+
+/**
+ * @brief Destroy the context of the last session, call after it was freed.
+ */
+void scache_ctx_destroy(void);
+
+#endif /* SCHEMA_CACHE_H_ */
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include <sysrepo.h>
@@ -32,9 +33,20 @@
 
 #include "config.h"
 
+/* public key metadata as provided in the operational data */
+struct ks_pubkey {
+    char *name;
+    uint32_t key_length;    /* 0 if it could not be learned */
+    char *pubkey;           /* base64-encoded SubjectPublicKeyInfo */
+};
+
 struct keystored_ctx {
     sr_subscription_ctx_t *subscription;
     sr_session_ctx_t *session;
+
+    struct ks_pubkey *pubkeys;  /* sorted by name */
+    uint32_t pubkey_count;
+    pthread_mutex_t pubkey_lock;
 };
 
 static char *
@@ -104,11 +116,326 @@ error:
     return NULL;
 }
 
+static unsigned char *
+keystored_base64_decode(const char *in, size_t *out_len)
+{
+    const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char *ptr;
+    unsigned char *out;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    out = malloc((strlen(in) / 4 + 1) * 3);
+    if (!out) {
+        return NULL;
+    }
+
+    *out_len = 0;
+    for (; *in && (*in != '='); ++in) {
+        if ((*in == '\n') || (*in == '\r')) {
+            continue;
+        }
+        ptr = strchr(alphabet, *in);
+        if (!ptr) {
+            free(out);
+            return NULL;
+        }
+
+        acc = (acc << 6) | (ptr - alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out[(*out_len)++] = (acc >> bits) & 0xFF;
+        }
+    }
+
+    return out;
+}
+
+/* checks DER tag, learns content length, returns the content or NULL */
+static const unsigned char *
+keystored_der_read(const unsigned char *der, const unsigned char *end, unsigned char tag, size_t *len)
+{
+    size_t i, bytes;
+
+    if ((end - der < 2) || (der[0] != tag)) {
+        return NULL;
+    }
+    ++der;
+
+    if (der[0] & 0x80) {
+        bytes = der[0] & 0x7F;
+        ++der;
+        if (!bytes || (bytes > sizeof *len) || ((size_t)(end - der) < bytes)) {
+            return NULL;
+        }
+        *len = 0;
+        for (i = 0; i < bytes; ++i) {
+            *len = (*len << 8) | der[i];
+        }
+        der += bytes;
+    } else {
+        *len = der[0];
+        ++der;
+    }
+
+    if ((size_t)(end - der) < *len) {
+        return NULL;
+    }
+    return der;
+}
+
+/* learns RSA modulus length in bits from a base64-encoded SubjectPublicKeyInfo, 0 on error */
+static uint32_t
+keystored_pubkey_rsa_length(const char *pubkey)
+{
+    unsigned char *der;
+    const unsigned char *ptr, *end;
+    size_t der_len, len;
+    uint32_t bits = 0;
+    unsigned char msb;
+
+    der = keystored_base64_decode(pubkey, &der_len);
+    if (!der) {
+        return 0;
+    }
+    end = der + der_len;
+
+    /* SubjectPublicKeyInfo ::= SEQUENCE { algorithm AlgorithmIdentifier, subjectPublicKey BIT STRING } */
+    if (!(ptr = keystored_der_read(der, end, 0x30, &len))) {
+        goto cleanup;
+    }
+    end = ptr + len;
+    if (!(ptr = keystored_der_read(ptr, end, 0x30, &len))) {
+        goto cleanup;
+    }
+    ptr += len;
+    if (!(ptr = keystored_der_read(ptr, end, 0x03, &len)) || !len || ptr[0]) {
+        goto cleanup;
+    }
+    end = ptr + len;
+    ++ptr;
+
+    /* RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER } */
+    if (!(ptr = keystored_der_read(ptr, end, 0x30, &len))) {
+        goto cleanup;
+    }
+    if (!(ptr = keystored_der_read(ptr, ptr + len, 0x02, &len))) {
+        goto cleanup;
+    }
+    while (len && !ptr[0]) {
+        ++ptr;
+        --len;
+    }
+    if (!len) {
+        goto cleanup;
+    }
+
+    bits = (len - 1) * 8;
+    for (msb = ptr[0]; msb; msb >>= 1) {
+        ++bits;
+    }
+
+cleanup:
+    free(der);
+    return bits;
+}
+
+/* binary search, if not found, idx is set to the position the key would be inserted at */
+static struct ks_pubkey *
+ks_pubkey_find(struct keystored_ctx *ctx, const char *name, uint32_t *idx)
+{
+    uint32_t low = 0, high = ctx->pubkey_count, mid;
+    int cmp;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        cmp = strcmp(name, ctx->pubkeys[mid].name);
+        if (!cmp) {
+            if (idx) {
+                *idx = mid;
+            }
+            return &ctx->pubkeys[mid];
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    if (idx) {
+        *idx = low;
+    }
+    return NULL;
+}
+
+/* (re)reads the public key of a private key and stores it in the cache */
+static int
+ks_pubkey_cache_add(struct keystored_ctx *ctx, const char *name)
+{
+    char *path, *pubkey, *dup_name;
+    struct ks_pubkey *key, *new_keys;
+    uint32_t idx;
+
+    if (asprintf(&path, "%s/%s.pub.pem", KEYSTORED_KEYS_DIR, name) == -1) {
+        SRP_LOG_ERR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+        return SR_ERR_NOMEM;
+    }
+    if (access(path, F_OK) == -1) {
+        SRP_LOG_ERR("File \"%s\" could not be accessed (%s).", path, strerror(errno));
+        free(path);
+        return SR_ERR_IO;
+    }
+    pubkey = keystored_read_pubkey_skip_type(path);
+    free(path);
+    if (!pubkey) {
+        return SR_ERR_IO;
+    }
+
+    pthread_mutex_lock(&ctx->pubkey_lock);
+
+    key = ks_pubkey_find(ctx, name, &idx);
+    if (!key) {
+        dup_name = strdup(name);
+        new_keys = realloc(ctx->pubkeys, (ctx->pubkey_count + 1) * sizeof *ctx->pubkeys);
+        if (!dup_name || !new_keys) {
+            pthread_mutex_unlock(&ctx->pubkey_lock);
+            SRP_LOG_ERR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+            if (new_keys) {
+                ctx->pubkeys = new_keys;
+            }
+            free(dup_name);
+            free(pubkey);
+            return SR_ERR_NOMEM;
+        }
+        ctx->pubkeys = new_keys;
+
+        memmove(&ctx->pubkeys[idx + 1], &ctx->pubkeys[idx], (ctx->pubkey_count - idx) * sizeof *ctx->pubkeys);
+        ++ctx->pubkey_count;
+        key = &ctx->pubkeys[idx];
+        key->name = dup_name;
+    } else {
+        free(key->pubkey);
+    }
+    key->pubkey = pubkey;
+    key->key_length = keystored_pubkey_rsa_length(pubkey);
+
+    pthread_mutex_unlock(&ctx->pubkey_lock);
+    return SR_ERR_OK;
+}
+
+static void
+ks_pubkey_cache_del(struct keystored_ctx *ctx, const char *name)
+{
+    struct ks_pubkey *key;
+    uint32_t idx;
+
+    pthread_mutex_lock(&ctx->pubkey_lock);
+
+    key = ks_pubkey_find(ctx, name, &idx);
+    if (key) {
+        free(key->name);
+        free(key->pubkey);
+        --ctx->pubkey_count;
+        memmove(&ctx->pubkeys[idx], &ctx->pubkeys[idx + 1], (ctx->pubkey_count - idx) * sizeof *ctx->pubkeys);
+    }
+
+    pthread_mutex_unlock(&ctx->pubkey_lock);
+}
+
+static void
+ks_pubkey_cache_clear(struct keystored_ctx *ctx)
+{
+    uint32_t i;
+
+    for (i = 0; i < ctx->pubkey_count; ++i) {
+        free(ctx->pubkeys[i].name);
+        free(ctx->pubkeys[i].pubkey);
+    }
+    free(ctx->pubkeys);
+    ctx->pubkeys = NULL;
+    ctx->pubkey_count = 0;
+}
+
+/* reads all the public keys found in the keys directory */
+static int
+ks_pubkey_cache_init(struct keystored_ctx *ctx)
+{
+    DIR *dir;
+    struct dirent *ent;
+    size_t len;
+    char *name;
+
+    dir = opendir(KEYSTORED_KEYS_DIR);
+    if (!dir) {
+        /* not fatal, the keys are then read when they are requested */
+        SRP_LOG_WRN("Opening the directory \"%s\" failed (%s), no public keys cached.", KEYSTORED_KEYS_DIR,
+                    strerror(errno));
+        return SR_ERR_OK;
+    }
+
+    while ((ent = readdir(dir))) {
+        len = strlen(ent->d_name);
+        if ((len < 9) || strcmp(ent->d_name + len - 8, ".pub.pem")) {
+            continue;
+        }
+
+        name = strndup(ent->d_name, len - 8);
+        if (!name) {
+            SRP_LOG_ERR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+            closedir(dir);
+            return SR_ERR_NOMEM;
+        }
+        if (ks_pubkey_cache_add(ctx, name)) {
+            SRP_LOG_WRN("Public key \"%s\" could not be cached.", name);
+        }
+        free(name);
+    }
+
+    closedir(dir);
+    SRP_LOG_DBG("Cached %u public keys.", ctx->pubkey_count);
+    return SR_ERR_OK;
+}
+
 static int
-ks_privkey_change_cb(sr_session_ctx_t *UNUSED(session), const char *UNUSED(module_name), sr_notif_event_t UNUSED(event),
-                     void *UNUSED(private_ctx))
+ks_privkey_change_cb(sr_session_ctx_t *session, const char *UNUSED(module_name), sr_notif_event_t event,
+                     void *private_ctx)
 {
+    struct keystored_ctx *ctx = (struct keystored_ctx *)private_ctx;
+    sr_change_iter_t *iter = NULL;
+    sr_change_oper_t oper;
+    sr_val_t *old_val = NULL, *new_val = NULL;
+    char *name;
+    int rc;
+
     /* TODO forbid adding keys this way */
+
+    if (event != SR_EV_APPLY) {
+        return SR_ERR_OK;
+    }
+
+    /* forget public keys of the removed private keys */
+    rc = sr_get_changes_iter(session, "/ietf-keystore:keystore/private-keys/private-key", &iter);
+    if (rc != SR_ERR_OK) {
+        SRP_LOG_ERR("Failed to get changes iterator (%s).", sr_strerror(rc));
+        return rc;
+    }
+    while ((rc = sr_get_change_next(session, iter, &oper, &old_val, &new_val)) == SR_ERR_OK) {
+        if ((oper == SR_OP_DELETED) && (old_val->type == SR_LIST_T)
+                && (name = strstr(old_val->xpath, "private-key[name='"))) {
+            name += 18;
+            name[strcspn(name, "'")] = '\0';
+            ks_pubkey_cache_del(ctx, name);
+        }
+        sr_free_val(old_val);
+        sr_free_val(new_val);
+    }
+    sr_free_change_iter(iter);
+    if ((rc != SR_ERR_OK) && (rc != SR_ERR_NOT_FOUND)) {
+        SRP_LOG_ERR("Failed to get next change (%s).", sr_strerror(rc));
+        return rc;
+    }
+
     return SR_ERR_OK;
 }
 
@@ -121,87 +448,135 @@ ks_cert_change_cb(sr_session_ctx_t *UNUSED(session), const char *UNUSED(module_n
 }
 
 static int
-ks_privkey_get_cb(const char *xpath, sr_val_t **values, size_t *values_cnt, void *UNUSED(private_ctx))
+ks_pubkey_set_val(const struct ks_pubkey *key, const char *leaf, sr_val_t *val)
+{
+    if (asprintf(&val->xpath, "/ietf-keystore:keystore/private-keys/private-key[name='%s']/%s", key->name, leaf) == -1) {
+        val->xpath = NULL;
+        return SR_ERR_NOMEM;
+    }
+
+    if (!strcmp(leaf, "algorithm")) {
+        val->type = SR_IDENTITYREF_T;
+        val->data.identityref_val = strdup("rsa");
+        if (!val->data.identityref_val) {
+            return SR_ERR_NOMEM;
+        }
+    } else if (!strcmp(leaf, "key-length")) {
+        val->type = SR_UINT32_T;
+        val->data.uint32_val = key->key_length;
+    } else {
+        val->type = SR_BINARY_T;
+        val->data.binary_val = strdup(key->pubkey);
+        if (!val->data.binary_val) {
+            return SR_ERR_NOMEM;
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+/* fills values of the requested leaf or all the leaves (leaf NULL) of a key */
+static int
+ks_pubkey_set_vals(const struct ks_pubkey *key, const char *leaf, sr_val_t *vals, size_t *val_cnt)
 {
     int ret;
-    const char *name;
-    char *path;
-    sr_val_t *val = NULL;
+
+    if (!leaf || !strcmp(leaf, "algorithm")) {
+        if ((ret = ks_pubkey_set_val(key, "algorithm", &vals[(*val_cnt)++]))) {
+            return ret;
+        }
+    }
+    if ((!leaf || !strcmp(leaf, "key-length")) && key->key_length) {
+        if ((ret = ks_pubkey_set_val(key, "key-length", &vals[(*val_cnt)++]))) {
+            return ret;
+        }
+    }
+    if (!leaf || !strcmp(leaf, "public-key")) {
+        if ((ret = ks_pubkey_set_val(key, "public-key", &vals[(*val_cnt)++]))) {
+            return ret;
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+static int
+ks_privkey_get_cb(const char *xpath, sr_val_t **values, size_t *values_cnt, void *private_ctx)
+{
+    struct keystored_ctx *ctx = (struct keystored_ctx *)private_ctx;
+    int ret = SR_ERR_OK;
+    const char *name, *leaf = NULL;
+    char *key_name = NULL;
+    struct ks_pubkey *key;
+    sr_val_t *vals = NULL;
+    size_t val_cnt = 0;
 
     SRP_LOG_INF("Providing node \"%s\".", xpath);
 
     name = strstr(xpath, "private-key[name='");
     if (!name) {
-        SRP_LOG_ERR("Internal error (%s:%d).", __FILE__, __LINE__);
-        return SR_ERR_INTERNAL;
+        /* state is provided only for the configured list instances, sysrepo asks for each of them */
+        return SR_ERR_OK;
     }
     name += 18;
 
-    if (asprintf(&path, "%s/%.*s.pub.pem", KEYSTORED_KEYS_DIR, (int)(strchr(name, '\'') - name), name) == -1) {
+    key_name = strndup(name, strchr(name, '\'') - name);
+    if (!key_name) {
         SRP_LOG_ERR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
         return SR_ERR_NOMEM;
     }
 
-    if (access(path, F_OK) == -1) {
-        SRP_LOG_ERR("File \"%s\" could not be accessed (%s).", path, strerror(errno));
-        ret = SR_ERR_IO;
-        goto error;
-    }
-
     if (!strcmp(xpath + strlen(xpath) - 9, "algorithm")) {
-        /* algorithm */
-        val = calloc(1, sizeof *val);
-        if (!val) {
-            SRP_LOG_ERR("Memory allocation failed (%s).", strerror(errno));
-            ret = SR_ERR_NOMEM;
-            goto error;
-        }
-
-        val->xpath = strdup(xpath);
-        val->type = SR_IDENTITYREF_T;
-        val->data.identityref_val = strdup("rsa");
-        if (!val->xpath || !val->data.identityref_val) {
-            SRP_LOG_ERR("Memory allocation failed (%s).", strerror(errno));
-            ret = SR_ERR_NOMEM;
-            goto error;
-        }
+        leaf = "algorithm";
     } else if (!strcmp(xpath + strlen(xpath) - 10, "key-length")) {
-        /* no key-length */
-
+        leaf = "key-length";
     } else if (!strcmp(xpath + strlen(xpath) - 10, "public-key")) {
-        /* public-key */
-        val = calloc(1, sizeof *val);
-        if (!val) {
-            SRP_LOG_ERR("Memory allocation failed (%s).", strerror(errno));
-            ret = SR_ERR_NOMEM;
-            goto error;
+        leaf = "public-key";
+    } else if (xpath[strlen(xpath) - 1] != ']') {
+        SRP_LOG_ERR("Unknown node \"%s\" value requested.", xpath);
+        free(key_name);
+        return SR_ERR_INTERNAL;
+    }
+
+    pthread_mutex_lock(&ctx->pubkey_lock);
+    key = ks_pubkey_find(ctx, key_name, NULL);
+    if (!key) {
+        /* not created by us, try to read it */
+        pthread_mutex_unlock(&ctx->pubkey_lock);
+        ret = ks_pubkey_cache_add(ctx, key_name);
+        if (ret) {
+            free(key_name);
+            return ret;
         }
+        pthread_mutex_lock(&ctx->pubkey_lock);
+        key = ks_pubkey_find(ctx, key_name, NULL);
+    }
+    free(key_name);
 
-        val->xpath = strdup(xpath);
-        val->type = SR_BINARY_T;
-        val->data.binary_val = keystored_read_pubkey_skip_type(path);
-        if (!val->xpath || !val->data.binary_val) {
+    if (key) {
+        vals = calloc(3, sizeof *vals);
+        if (!vals) {
+            pthread_mutex_unlock(&ctx->pubkey_lock);
             SRP_LOG_ERR("Memory allocation failed (%s).", strerror(errno));
-            ret = SR_ERR_NOMEM;
-            goto error;
+            return SR_ERR_NOMEM;
         }
-    } else {
-        SRP_LOG_ERR("Unknown node \"%s\" value requested.", xpath);
-        ret = SR_ERR_INTERNAL;
-        goto error;
+        ret = ks_pubkey_set_vals(key, leaf, vals, &val_cnt);
     }
+    pthread_mutex_unlock(&ctx->pubkey_lock);
 
-    if (val) {
-        *values = val;
-        *values_cnt = 1;
+    if (ret) {
+        SRP_LOG_ERR("Memory allocation failed (%s).", strerror(errno));
+        sr_free_values(vals, val_cnt);
+        return ret;
     }
 
+    if (val_cnt) {
+        *values = vals;
+        *values_cnt = val_cnt;
+    } else {
+        free(vals);
+    }
     return SR_ERR_OK;
-
-error:
-    sr_free_val(val);
-    free(path);
-    return ret;
 }
 
 struct thread_arg {
@@ -296,7 +671,7 @@ ks_privkey_gen_cb(const char *UNUSED(xpath), const sr_node_t *input, const size_
 {
     struct keystored_ctx *ctx = (struct keystored_ctx *)private_ctx;
     pid_t pid;
-    int ret, status;
+    int ret = SR_ERR_OK, status;
     char *priv_path = NULL, *pub_path = NULL, len_arg[27];
 
     if ((input_cnt < 2) || (input[0].type != SR_STRING_T) || (input[1].type != SR_IDENTITYREF_T)
@@ -405,6 +780,12 @@ ks_privkey_gen_cb(const char *UNUSED(xpath), const sr_node_t *input, const size_
         goto cleanup;
     }*/
 
+    /* remember the public key */
+    ret = ks_pubkey_cache_add(ctx, input[0].data.string_val);
+    if (ret != SR_ERR_OK) {
+        goto cleanup;
+    }
+
     /* add the key to the configuration */
     ks_privkey_add(ctx->session, input[0].data.string_val);
 
@@ -520,6 +901,12 @@ ks_privkey_load_cb(const char *UNUSED(xpath), const sr_node_t *input, const size
         goto cleanup;
     }*/
 
+    /* remember the public key */
+    ret = ks_pubkey_cache_add(ctx, input[0].data.string_val);
+    if (ret != SR_ERR_OK) {
+        goto cleanup;
+    }
+
     /* add the key to the configuration */
     ks_privkey_add(ctx->session, input[0].data.string_val);
 
@@ -540,6 +927,13 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
 
     ctx = calloc(1, sizeof *ctx);
     if (!ctx) {
+        return SR_ERR_NOMEM;
+    }
+    pthread_mutex_init(&ctx->pubkey_lock, NULL);
+
+    /* public keys of the existing private keys */
+    rc = ks_pubkey_cache_init(ctx);
+    if (SR_ERR_OK != rc) {
         goto error;
     }
 
@@ -610,6 +1004,8 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
 error:
     SRP_LOG_ERR("keystored plugin initialization failed (%s).", sr_strerror(rc));
     sr_unsubscribe(session, ctx->subscription);
+    ks_pubkey_cache_clear(ctx);
+    pthread_mutex_destroy(&ctx->pubkey_lock);
     free(ctx);
     return rc;
 }
@@ -620,6 +1016,8 @@ sr_plugin_cleanup_cb(sr_session_ctx_t *session, void *private_ctx)
     struct keystored_ctx *ctx = (struct keystored_ctx *)private_ctx;
 
     sr_unsubscribe(session, ctx->subscription);
+    ks_pubkey_cache_clear(ctx);
+    pthread_mutex_destroy(&ctx->pubkey_lock);
     free(ctx);
     SRP_LOG_DBG_MSG("keystored plugin cleanup finished.");
 }
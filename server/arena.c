@@ -0,0 +1,242 @@
+/**
+ * @file arena.c
+ * @brief Per-thread arena for the temporary memory of one RPC
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "log.h"
+
+/* common RPCs fit into the first chunk, which is kept for the next RPC */
+#define NP2_ARENA_CHUNK_SIZE 16384
+#define NP2_ARENA_ALIGN 16
+
+struct np2_arena_chunk {
+    struct np2_arena_chunk *next;
+    size_t size;
+    size_t used;
+    char data[] __attribute__((aligned(NP2_ARENA_ALIGN)));
+};
+
+struct np2_arena {
+    struct np2_arena_chunk *first;
+    struct np2_arena_chunk *cur;    /* allocations are served from this chunk */
+    void *last;                     /* the last allocation, it can be resized in place */
+};
+
+static pthread_once_t np2_arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t np2_arena_key;
+
+static void
+np2_arena_free(void *ptr)
+{
+    struct np2_arena *arena = ptr;
+    struct np2_arena_chunk *chunk, *next;
+
+    for (chunk = arena->first; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    free(arena);
+}
+
+static void
+np2_arena_createkey(void)
+{
+    int r;
+
+    /* initiate */
+    while ((r = pthread_key_create(&np2_arena_key, np2_arena_free)) == EAGAIN);
+    pthread_setspecific(np2_arena_key, NULL);
+}
+
+static struct np2_arena *
+np2_arena_get(int create)
+{
+    struct np2_arena *arena;
+
+    pthread_once(&np2_arena_once, np2_arena_createkey);
+    arena = pthread_getspecific(np2_arena_key);
+    if (!arena && create) {
+        arena = calloc(1, sizeof *arena);
+        if (!arena) {
+            return NULL;
+        }
+        pthread_setspecific(np2_arena_key, arena);
+    }
+
+    return arena;
+}
+
+static size_t
+np2_arena_align(size_t size)
+{
+    if (!size) {
+        return NP2_ARENA_ALIGN;
+    }
+    return (size + NP2_ARENA_ALIGN - 1) & ~(size_t)(NP2_ARENA_ALIGN - 1);
+}
+
+void *
+np2_arena_alloc(size_t size)
+{
+    struct np2_arena *arena;
+    struct np2_arena_chunk *chunk;
+    void *ptr;
+
+    if (size > SIZE_MAX - sizeof *chunk - NP2_ARENA_ALIGN) {
+        EMEM;
+        return NULL;
+    }
+    size = np2_arena_align(size);
+
+    arena = np2_arena_get(1);
+    if (!arena) {
+        EMEM;
+        return NULL;
+    }
+
+    chunk = arena->cur;
+    if (!chunk || (chunk->size - chunk->used < size)) {
+        /* large allocations get a chunk of their own */
+        chunk = malloc(sizeof *chunk + ((size > NP2_ARENA_CHUNK_SIZE) ? size : NP2_ARENA_CHUNK_SIZE));
+        if (!chunk) {
+            EMEM;
+            return NULL;
+        }
+        chunk->next = NULL;
+        chunk->size = (size > NP2_ARENA_CHUNK_SIZE) ? size : NP2_ARENA_CHUNK_SIZE;
+        chunk->used = 0;
+
+        if (arena->cur) {
+            arena->cur->next = chunk;
+        } else {
+            arena->first = chunk;
+        }
+        arena->cur = chunk;
+    }
+
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+void *
+np2_arena_calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+
+    if (size && (nmemb > SIZE_MAX / size)) {
+        EMEM;
+        return NULL;
+    }
+
+    ptr = np2_arena_alloc(nmemb * size);
+    if (ptr) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+void *
+np2_arena_realloc(void *ptr, size_t old_size, size_t size)
+{
+    struct np2_arena *arena;
+    struct np2_arena_chunk *chunk;
+    size_t offset;
+    void *new_ptr;
+
+    if (!ptr) {
+        return np2_arena_alloc(size);
+    }
+
+    arena = np2_arena_get(0);
+    if (arena && (ptr == arena->last) && (size <= SIZE_MAX - NP2_ARENA_ALIGN)) {
+        /* nothing was allocated after it, so it can grow or shrink in place */
+        chunk = arena->cur;
+        offset = (char *)ptr - chunk->data;
+        if (np2_arena_align(size) <= chunk->size - offset) {
+            chunk->used = offset + np2_arena_align(size);
+            return ptr;
+        }
+    }
+    if (size <= old_size) {
+        return ptr;
+    }
+
+    new_ptr = np2_arena_alloc(size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+char *
+np2_arena_printf(const char *format, ...)
+{
+    va_list ap;
+    char *str;
+    int len;
+
+    va_start(ap, format);
+    len = vsnprintf(NULL, 0, format, ap);
+    va_end(ap);
+    if (len < 0) {
+        EINT;
+        return NULL;
+    }
+
+    str = np2_arena_alloc(len + 1);
+    if (!str) {
+        return NULL;
+    }
+    va_start(ap, format);
+    vsnprintf(str, len + 1, format, ap);
+    va_end(ap);
+
+    return str;
+}
+
+void
+np2_arena_reset(void)
+{
+    struct np2_arena *arena;
+    struct np2_arena_chunk *chunk, *next;
+
+    arena = np2_arena_get(0);
+    if (!arena || !arena->first) {
+        return;
+    }
+
+    /* only the first regular chunk is kept, the chunks of a large RPC are freed */
+    for (chunk = arena->first->next; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->first->next = NULL;
+    if (arena->first->size > NP2_ARENA_CHUNK_SIZE) {
+        free(arena->first);
+        arena->first = NULL;
+    } else {
+        arena->first->used = 0;
+    }
+    arena->cur = arena->first;
+    arena->last = NULL;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file arena.h
+ * @brief Per-thread arena for the temporary memory of one RPC
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_ARENA_H_
+#define NP2SRV_ARENA_H_
+
+#include <stddef.h>
+
+/*
+ * Memory allocated from the arena belongs to the RPC the calling thread is processing. It must not be freed
+ * or passed to free(), all of it is released at once by np2_arena_reset() when the worker thread has sent
+ * the reply. It must not be used for anything outliving the RPC and only in the threads resetting the arena.
+ */
+
+/**
+ * @brief Allocate memory from the arena of the current thread.
+ *
+ * @param[in] size Size of the memory.
+ * @return Allocated memory, NULL on error.
+ */
+void *np2_arena_alloc(size_t size);
+
+/**
+ * @brief Allocate zeroed memory from the arena of the current thread.
+ *
+ * @param[in] nmemb Number of members.
+ * @param[in] size Size of a member.
+ * @return Allocated memory, NULL on error.
+ */
+void *np2_arena_calloc(size_t nmemb, size_t size);
+
+/**
+ * @brief Change the size of memory allocated from the arena, the last allocation is resized in place.
+ *
+ * @param[in] ptr Memory from the arena, NULL to allocate a new one.
+ * @param[in] old_size Current size of \p ptr.
+ * @param[in] size New size.
+ * @return Resized memory, NULL on error (\p ptr stays valid).
+ */
+void *np2_arena_realloc(void *ptr, size_t old_size, size_t size);
+
+/**
+ * @brief Print a formatted string into the arena of the current thread.
+ *
+ * @param[in] format Format of the string.
+ * @return Printed string, NULL on error.
+ */
+char *np2_arena_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Release all the memory allocated from the arena of the current thread.
+ */
+void np2_arena_reset(void);
+
+#endif /* NP2SRV_ARENA_H_ */
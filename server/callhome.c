@@ -0,0 +1,651 @@
+/**
+ * @file callhome.c
+ * @brief netopeer2-server call-home connection manager
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
+
+#include "callhome.h"
+#include "common.h"
+#include "log.h"
+
+/*
+ * libnetconf2 keeps reconnecting a dispatched call-home client with its own fixed timing, so clients are
+ * dispatched only when the manager decides so. An attempt that does not result in a session in time, and
+ * a terminated session, stop the client in libnetconf2 and its next attempt is scheduled with a jittered
+ * exponential backoff. Attempts are kept in a timer wheel and at most NP2SRV_CH_MAX_CONNECTING of them
+ * are in progress at once, the others wait in a queue.
+ */
+
+/* timer wheel granularity (ms) and size, one revolution is 51.2 s */
+#define CHM_TICK 100
+#define CHM_WHEEL_SIZE 512
+
+enum chm_state {
+    CHM_WAITING,        /* waiting for the next attempt */
+    CHM_QUEUED,         /* attempt due, but there are too many attempts in progress */
+    CHM_CONNECTING,     /* dispatched, waiting for a session */
+    CHM_CONNECTED,      /* session established */
+    CHM_CLOSED          /* session terminated, to be stopped and rescheduled */
+};
+
+static const char *chm_state_str[] = {"waiting", "queued", "connecting", "connected", "closed"};
+
+enum chm_link {
+    CHM_UNLINKED,
+    CHM_WHEEL,
+    CHM_QUEUE
+};
+
+struct chm_client {
+    char *name;
+    NC_TRANSPORT_IMPL ti;
+    enum chm_state state;
+    struct nc_session *session;
+
+    uint32_t attempts;          /* all connection attempts */
+    uint32_t failures;          /* consecutive failed attempts */
+    uint32_t connects;          /* established sessions */
+    uint64_t due;               /* tick of the next event of the client */
+
+    enum chm_link link;
+    struct chm_client *next;    /* in a wheel slot or the queue */
+    struct chm_client *prev;
+};
+
+/* action performed on a client outside the manager lock */
+struct chm_action {
+    char *name;
+    NC_TRANSPORT_IMPL ti;
+    int start;
+};
+
+static struct {
+    struct chm_client **clients;    /* sorted by name */
+    uint32_t client_count;
+
+    struct chm_client *wheel[CHM_WHEEL_SIZE];
+    uint64_t tick;                  /* last processed tick */
+    struct chm_client *queue;
+    struct chm_client *queue_last;
+    uint32_t connecting;            /* attempts in progress */
+    unsigned int seed;
+
+    struct chm_action *actions;
+    uint32_t action_count;
+    uint32_t action_size;
+
+    pthread_t tid;
+    int running;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} chm;
+
+static uint64_t
+chm_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / CHM_TICK;
+}
+
+/* returns the index of the client or where it should be inserted */
+static uint32_t
+chm_client_idx(const char *name, int *found)
+{
+    uint32_t lo = 0, hi = chm.client_count, mid;
+    int cmp;
+
+    *found = 0;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        cmp = strcmp(name, chm.clients[mid]->name);
+        if (!cmp) {
+            *found = 1;
+            return mid;
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static struct chm_client *
+chm_client_find(const char *name)
+{
+    uint32_t idx;
+    int found;
+
+    idx = chm_client_idx(name, &found);
+    return found ? chm.clients[idx] : NULL;
+}
+
+static void
+chm_unlink(struct chm_client *client)
+{
+    switch (client->link) {
+    case CHM_WHEEL:
+        if (client->prev) {
+            client->prev->next = client->next;
+        } else {
+            chm.wheel[client->due % CHM_WHEEL_SIZE] = client->next;
+        }
+        if (client->next) {
+            client->next->prev = client->prev;
+        }
+        break;
+    case CHM_QUEUE:
+        if (client->prev) {
+            client->prev->next = client->next;
+        } else {
+            chm.queue = client->next;
+        }
+        if (client->next) {
+            client->next->prev = client->prev;
+        } else {
+            chm.queue_last = client->prev;
+        }
+        break;
+    case CHM_UNLINKED:
+        break;
+    }
+
+    client->link = CHM_UNLINKED;
+    client->next = NULL;
+    client->prev = NULL;
+}
+
+/* schedules the next event of the client in delay ms */
+static void
+chm_schedule(struct chm_client *client, uint64_t delay)
+{
+    struct chm_client **slot;
+
+    chm_unlink(client);
+
+    client->due = chm_now() + delay / CHM_TICK;
+    if (client->due <= chm.tick) {
+        client->due = chm.tick + 1;
+    }
+
+    slot = &chm.wheel[client->due % CHM_WHEEL_SIZE];
+    client->next = *slot;
+    if (*slot) {
+        (*slot)->prev = client;
+    }
+    *slot = client;
+    client->link = CHM_WHEEL;
+}
+
+static void
+chm_enqueue(struct chm_client *client)
+{
+    chm_unlink(client);
+
+    client->prev = chm.queue_last;
+    if (chm.queue_last) {
+        chm.queue_last->next = client;
+    } else {
+        chm.queue = client;
+    }
+    chm.queue_last = client;
+    client->link = CHM_QUEUE;
+}
+
+/* delay (ms) of the next attempt, doubled for every consecutive failure with the upper half randomized */
+static uint64_t
+chm_backoff(uint32_t failures)
+{
+    uint64_t delay = (uint64_t)NP2SRV_CH_BACKOFF_MIN * 1000;
+
+    while (failures && (delay < (uint64_t)NP2SRV_CH_BACKOFF_MAX * 1000)) {
+        delay *= 2;
+        --failures;
+    }
+    if (delay > (uint64_t)NP2SRV_CH_BACKOFF_MAX * 1000) {
+        delay = (uint64_t)NP2SRV_CH_BACKOFF_MAX * 1000;
+    }
+
+    return delay / 2 + rand_r(&chm.seed) % (delay / 2 + 1);
+}
+
+static int
+chm_action_add(struct chm_client *client, int start)
+{
+    struct chm_action *action;
+
+    if (chm.action_count == chm.action_size) {
+        action = realloc(chm.actions, (chm.action_size ? chm.action_size * 2 : 16) * sizeof *chm.actions);
+        if (!action) {
+            EMEM;
+            return EXIT_FAILURE;
+        }
+        chm.actions = action;
+        chm.action_size = (chm.action_size ? chm.action_size * 2 : 16);
+    }
+
+    action = &chm.actions[chm.action_count];
+    action->name = strdup(client->name);
+    if (!action->name) {
+        EMEM;
+        return EXIT_FAILURE;
+    }
+    action->ti = client->ti;
+    action->start = start;
+    ++chm.action_count;
+
+    return EXIT_SUCCESS;
+}
+
+static void
+chm_attempt_start(struct chm_client *client)
+{
+    chm_unlink(client);
+    if (chm_action_add(client, 1)) {
+        client->state = CHM_WAITING;
+        chm_schedule(client, chm_backoff(client->failures));
+        return;
+    }
+
+    client->state = CHM_CONNECTING;
+    ++client->attempts;
+    ++chm.connecting;
+    chm_schedule(client, (uint64_t)NP2SRV_CH_ATTEMPT_TIMEOUT * 1000);
+}
+
+static void
+chm_attempt_failed(struct chm_client *client)
+{
+    if (client->state == CHM_CONNECTING) {
+        --chm.connecting;
+    }
+    ++client->failures;
+    client->state = CHM_WAITING;
+    chm_schedule(client, chm_backoff(client->failures));
+}
+
+/* handles a due event of a client */
+static void
+chm_client_due(struct chm_client *client)
+{
+    switch (client->state) {
+    case CHM_WAITING:
+        if (chm.connecting < NP2SRV_CH_MAX_CONNECTING) {
+            chm_attempt_start(client);
+        } else {
+            client->state = CHM_QUEUED;
+            chm_enqueue(client);
+        }
+        break;
+    case CHM_CONNECTING:
+        /* no session in time, stop libnetconf2 from trying on its own */
+        VRB("Call Home client \"%s\" failed to connect (attempt %u).", client->name, client->failures + 1);
+        chm_action_add(client, 0);
+        chm_attempt_failed(client);
+        break;
+    case CHM_CLOSED:
+        /* the session is gone, libnetconf2 would reconnect immediately */
+        chm_action_add(client, 0);
+        client->state = CHM_WAITING;
+        chm_schedule(client, chm_backoff(0));
+        break;
+    case CHM_QUEUED:
+    case CHM_CONNECTED:
+        EINT;
+        chm_unlink(client);
+        break;
+    }
+}
+
+static void
+chm_process(void)
+{
+    struct chm_client *client, *next;
+    uint64_t now;
+
+    /* events scheduled meanwhile always fall into a later tick */
+    now = chm_now();
+    while (chm.tick < now) {
+        ++chm.tick;
+        for (client = chm.wheel[chm.tick % CHM_WHEEL_SIZE]; client; client = next) {
+            next = client->next;
+            if (client->due == chm.tick) {
+                chm_client_due(client);
+            }
+        }
+    }
+
+    /* start the queued attempts */
+    while (chm.queue && (chm.connecting < NP2SRV_CH_MAX_CONNECTING)) {
+        chm_attempt_start(chm.queue);
+    }
+}
+
+static void *
+chm_thread(void *UNUSED(arg))
+{
+    struct timespec ts;
+    struct chm_client *client;
+    struct chm_action *actions;
+    uint32_t i, count;
+    int rc;
+
+    pthread_mutex_lock(&chm.lock);
+    while (chm.running) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += CHM_TICK * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_nsec -= 1000000000;
+            ++ts.tv_sec;
+        }
+        pthread_cond_timedwait(&chm.cond, &chm.lock, &ts);
+        if (!chm.running) {
+            break;
+        }
+
+        chm_process();
+        if (!chm.action_count) {
+            continue;
+        }
+
+        /* starting and stopping the clients changes the server configuration, do it unlocked */
+        actions = chm.actions;
+        count = chm.action_count;
+        chm.actions = NULL;
+        chm.action_count = 0;
+        chm.action_size = 0;
+        pthread_mutex_unlock(&chm.lock);
+
+        for (i = 0; i < count; ++i) {
+            if (actions[i].start) {
+                rc = ietf_netconf_server_ch_client_start(actions[i].name);
+                if (rc) {
+                    ERR("Failed to start Call Home client \"%s\".", actions[i].name);
+                    ietf_netconf_server_ch_client_stop(actions[i].name, actions[i].ti);
+
+                    pthread_mutex_lock(&chm.lock);
+                    client = chm_client_find(actions[i].name);
+                    if (client && (client->state == CHM_CONNECTING)) {
+                        chm_attempt_failed(client);
+                    }
+                    pthread_mutex_unlock(&chm.lock);
+                }
+            } else {
+                ietf_netconf_server_ch_client_stop(actions[i].name, actions[i].ti);
+            }
+            free(actions[i].name);
+        }
+        free(actions);
+
+        pthread_mutex_lock(&chm.lock);
+    }
+    pthread_mutex_unlock(&chm.lock);
+
+    nc_thread_destroy();
+    return NULL;
+}
+
+int
+chm_init(void)
+{
+    pthread_condattr_t attr;
+
+    memset(&chm, 0, sizeof chm);
+    chm.seed = time(NULL) ^ getpid();
+    chm.tick = chm_now();
+    chm.running = 1;
+
+    pthread_mutex_init(&chm.lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&chm.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&chm.tid, NULL, chm_thread, NULL)) {
+        ERR("Failed to create the Call Home manager thread.");
+        chm.running = 0;
+        pthread_cond_destroy(&chm.cond);
+        pthread_mutex_destroy(&chm.lock);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void
+chm_client_free(struct chm_client *client)
+{
+    chm_unlink(client);
+    if (client->state == CHM_CONNECTING) {
+        --chm.connecting;
+    }
+    free(client->name);
+    free(client);
+}
+
+void
+chm_destroy(void)
+{
+    uint32_t i;
+
+    if (!chm.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&chm.lock);
+    chm.running = 0;
+    pthread_cond_signal(&chm.cond);
+    pthread_mutex_unlock(&chm.lock);
+    pthread_join(chm.tid, NULL);
+
+    for (i = 0; i < chm.client_count; ++i) {
+        chm_client_free(chm.clients[i]);
+    }
+    free(chm.clients);
+    for (i = 0; i < chm.action_count; ++i) {
+        free(chm.actions[i].name);
+    }
+    free(chm.actions);
+
+    pthread_cond_destroy(&chm.cond);
+    pthread_mutex_destroy(&chm.lock);
+    memset(&chm, 0, sizeof chm);
+}
+
+/* a (re)created client, its whole configuration is applied in libnetconf2 */
+void
+chm_client_add(const char *name, NC_TRANSPORT_IMPL ti)
+{
+    struct chm_client *client, **clients;
+    uint32_t idx;
+    int found;
+
+    pthread_mutex_lock(&chm.lock);
+
+    idx = chm_client_idx(name, &found);
+    if (found) {
+        client = chm.clients[idx];
+        client->ti = ti;
+        if (client->state == CHM_CONNECTING) {
+            /* being started right now */
+            goto cleanup;
+        }
+    } else {
+        client = calloc(1, sizeof *client);
+        clients = realloc(chm.clients, (chm.client_count + 1) * sizeof *chm.clients);
+        if (!client || !clients || !(client->name = strdup(name))) {
+            EMEM;
+            free(client);
+            if (clients) {
+                chm.clients = clients;
+            }
+            goto cleanup;
+        }
+        chm.clients = clients;
+        memmove(&chm.clients[idx + 1], &chm.clients[idx], (chm.client_count - idx) * sizeof *chm.clients);
+        chm.clients[idx] = client;
+        ++chm.client_count;
+        client->ti = ti;
+    }
+
+    /* spread the first attempts of many clients configured at once */
+    client->state = CHM_WAITING;
+    client->session = NULL;
+    client->failures = 0;
+    chm_schedule(client, chm_backoff(0));
+
+cleanup:
+    pthread_mutex_unlock(&chm.lock);
+}
+
+/* removes the client, all of the transport if no name is set */
+void
+chm_client_del(const char *name, NC_TRANSPORT_IMPL ti)
+{
+    uint32_t idx;
+    int found;
+
+    pthread_mutex_lock(&chm.lock);
+
+    if (name) {
+        idx = chm_client_idx(name, &found);
+        if (found) {
+            chm_client_free(chm.clients[idx]);
+            --chm.client_count;
+            memmove(&chm.clients[idx], &chm.clients[idx + 1], (chm.client_count - idx) * sizeof *chm.clients);
+        }
+    } else {
+        idx = 0;
+        while (idx < chm.client_count) {
+            if (ti && (chm.clients[idx]->ti != ti)) {
+                ++idx;
+                continue;
+            }
+            chm_client_free(chm.clients[idx]);
+            --chm.client_count;
+            memmove(&chm.clients[idx], &chm.clients[idx + 1], (chm.client_count - idx) * sizeof *chm.clients);
+        }
+    }
+
+    pthread_mutex_unlock(&chm.lock);
+}
+
+void
+chm_session_new(const char *name, struct nc_session *session)
+{
+    struct chm_client *client;
+
+    pthread_mutex_lock(&chm.lock);
+
+    client = chm_client_find(name);
+    if (!client) {
+        /* removed meanwhile */
+        goto cleanup;
+    }
+
+    if (client->state == CHM_CONNECTING) {
+        --chm.connecting;
+    }
+    chm_unlink(client);
+    client->state = CHM_CONNECTED;
+    client->session = session;
+    client->failures = 0;
+    ++client->connects;
+
+cleanup:
+    pthread_mutex_unlock(&chm.lock);
+}
+
+void
+chm_session_del(struct nc_session *session)
+{
+    uint32_t i;
+    struct chm_client *client;
+
+    pthread_mutex_lock(&chm.lock);
+
+    for (i = 0; i < chm.client_count; ++i) {
+        client = chm.clients[i];
+        if (client->session == session) {
+            client->session = NULL;
+            if (client->state == CHM_CONNECTED) {
+                client->state = CHM_CLOSED;
+                chm_schedule(client, 0);
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&chm.lock);
+}
+
+int
+chm_get_data(struct lyd_node *parent, const struct lys_module *mod)
+{
+    struct lyd_node *cont, *list;
+    struct chm_client *client;
+    char buf[26];
+    uint64_t now;
+    uint32_t i;
+    int ret = EXIT_FAILURE;
+
+    pthread_mutex_lock(&chm.lock);
+
+    cont = lyd_new(parent, mod, "call-home");
+    if (!cont) {
+        goto cleanup;
+    }
+    sprintf(buf, "%u", chm.connecting);
+    lyd_new_leaf(cont, mod, "connecting", buf);
+
+    now = chm_now();
+    for (i = 0; i < chm.client_count; ++i) {
+        client = chm.clients[i];
+
+        list = lyd_new(cont, mod, "netconf-client");
+        if (!list) {
+            goto cleanup;
+        }
+        lyd_new_leaf(list, mod, "name", client->name);
+        lyd_new_leaf(list, mod, "state", chm_state_str[client->state]);
+        sprintf(buf, "%u", client->attempts);
+        lyd_new_leaf(list, mod, "attempts", buf);
+        sprintf(buf, "%u", client->failures);
+        lyd_new_leaf(list, mod, "consecutive-failures", buf);
+        sprintf(buf, "%u", client->connects);
+        lyd_new_leaf(list, mod, "connects", buf);
+        if (client->state == CHM_WAITING) {
+            nc_time2datetime(time(NULL) + ((client->due > now) ? (client->due - now) * CHM_TICK / 1000 : 0), NULL, buf);
+            lyd_new_leaf(list, mod, "next-attempt", buf);
+        }
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    pthread_mutex_unlock(&chm.lock);
+    return ret;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file callhome.h
+ * @brief netopeer2-server call-home connection manager
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_CALLHOME_H_
+#define NP2SRV_CALLHOME_H_
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
+
+int chm_init(void);
+void chm_destroy(void);
+
+void chm_client_add(const char *name, NC_TRANSPORT_IMPL ti);
+void chm_client_del(const char *name, NC_TRANSPORT_IMPL ti);
+
+void chm_session_new(const char *name, struct nc_session *session);
+void chm_session_del(struct nc_session *session);
+
+int chm_get_data(struct lyd_node *parent, const struct lys_module *mod);
+
+#endif /* NP2SRV_CALLHOME_H_ */
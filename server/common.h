@@ -26,15 +26,35 @@
 #  define UNUSED(x) UNUSED_ ## x
 #endif
 
+/* SYSREPO session of a NETCONF session */
+struct np2_sr_handle {
+    sr_session_ctx_t *srs;  /* SYSREPO session, leased from the pool only while needed */
+    sr_datastore_t ds;      /* its current datastore */
+    sr_sess_options_t opts; /* its current options */
+};
+
+/* running and startup for every config-only option */
+#define NP2S_SR_READ_COUNT 4
+
 /* NETCONF - SYSREPO connections */
 struct np2_sessions {
     struct nc_session *ncs; /* NETCONF session */
-    sr_session_ctx_t *srs;  /* SYSREPO session */
-    sr_datastore_t ds;      /* current SYSREPO datastore */
-    sr_sess_options_t opts; /* current SYSREPO session options */
+    sr_session_ctx_t *srs;  /* SYSREPO session selected by the current RPC */
+    sr_datastore_t ds;      /* its SYSREPO datastore */
+    sr_sess_options_t opts; /* its SYSREPO session options */
+    struct np2_sr_handle *handle;   /* the selected handle */
+    struct np2_sr_handle edit;      /* session for modifications, locks and candidate */
+    struct np2_sr_handle read[NP2S_SR_READ_COUNT]; /* sessions only reading, they never switch */
+    uint32_t ncm_idx;       /* index in the ietf-netconf-monitoring statistics */
+    uint32_t ntf_idx;       /* index in the notification subscribers */
+    uint32_t dl_idx;        /* index in the sessions that can be killed */
+    int killed;             /* the session was killed, its RPC in progress is aborted (atomic) */
+    uint32_t killed_by;     /* ID of the session that killed it */
 
     int flags;              /* various flags */
 #define NP2S_CAND_CHANGED 0x01
+#define NP2S_CALL_HOME    0x02
+#define NP2S_UNIX_SOCKET  0x04
 };
 
 /* Netopeer server internal data */
@@ -44,8 +64,9 @@ struct np2srv {
     sr_subscription_ctx_t *sr_subscr; /**< sysrepo subscription context */
 
     struct nc_pollsession *nc_ps;  /**< libnetconf2 pollsession structure */
-    uint16_t nc_max_sessions;      /**< maximum number of running sessions */
+    uint32_t nc_max_sessions;      /**< maximum number of running sessions */
     pthread_t workers[NP2SRV_THREAD_COUNT]; /**< worker threads handling sessions */
+    uint16_t accept_shards;        /**< number of workers accepting new sessions, 0 for all */
 
     struct ly_ctx *ly_ctx;         /**< libyang's context */
     pthread_rwlock_t ly_ctx_lock;  /**< libyang's context rwlock */
@@ -53,6 +74,8 @@ struct np2srv {
 extern struct np2srv np2srv;
 
 int ietf_netconf_server_init(const struct lys_module *module);
+int ietf_netconf_server_ch_client_start(const char *client_name);
+void ietf_netconf_server_ch_client_stop(const char *client_name, NC_TRANSPORT_IMPL ti);
 int ietf_system_init(const struct lys_module *module);
 
 void np2srv_new_session_clb(const char *UNUSED(client_name), struct nc_session *new_session);
@@ -0,0 +1,267 @@
+/**
+ * @file deadline.c
+ * @brief Per-RPC deadlines and cancellation of the RPCs of killed sessions
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "deadline.h"
+
+/* the clock is read only on every n-th check, the killed flag on every one */
+#define NP2_DEADLINE_CLOCK_CHECKS 64
+
+struct np2_deadline {
+    struct np2_sessions *s;     /* session of the RPC in progress, NULL if there is none */
+    time_t end;                 /* monotonic time the RPC must be finished by, 0 for no deadline */
+    uint32_t timeout;           /* its timeout */
+    uint32_t countdown;         /* checks until the clock is read */
+    int failed;                 /* the RPC is being aborted */
+};
+
+static pthread_once_t np2_deadline_once = PTHREAD_ONCE_INIT;
+static pthread_key_t np2_deadline_key;
+
+/* sessions that can be killed */
+static struct {
+    struct np2_sessions **list;
+    uint32_t count;
+    uint32_t size;
+    pthread_mutex_t lock;
+} np2_killable = {NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+
+static void
+np2_deadline_createkey(void)
+{
+    int r;
+
+    /* initiate */
+    while ((r = pthread_key_create(&np2_deadline_key, free)) == EAGAIN);
+    pthread_setspecific(np2_deadline_key, NULL);
+}
+
+static struct np2_deadline *
+np2_deadline_get(int create)
+{
+    struct np2_deadline *dl;
+
+    pthread_once(&np2_deadline_once, np2_deadline_createkey);
+    dl = pthread_getspecific(np2_deadline_key);
+    if (!dl && create) {
+        dl = calloc(1, sizeof *dl);
+        if (!dl) {
+            return NULL;
+        }
+        pthread_setspecific(np2_deadline_key, dl);
+    }
+
+    return dl;
+}
+
+static time_t
+np2_deadline_now(void)
+{
+    struct timespec ts;
+
+    /* a tick of the coarse clock is enough for a deadline in seconds */
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+static uint32_t
+np2_deadline_extension(const struct lyd_node *rpc)
+{
+    struct lyd_attr *attr;
+
+    for (attr = rpc->attr; attr; attr = attr->next) {
+        if (!strcmp(attr->name, "timeout-extension") &&
+                !strcmp(attr->annotation->module->name, "netopeer2-deadline")) {
+            if (attr->value.uint32 > NP2SRV_RPC_TIMEOUT_EXT_MAX) {
+                return NP2SRV_RPC_TIMEOUT_EXT_MAX;
+            }
+            return attr->value.uint32;
+        }
+    }
+
+    return 0;
+}
+
+void
+np2_deadline_start(struct np2_sessions *s, const struct lyd_node *rpc)
+{
+    struct np2_deadline *dl;
+
+    dl = np2_deadline_get(1);
+    if (!dl) {
+        /* the RPC just cannot be aborted */
+        EMEM;
+        return;
+    }
+
+    dl->s = s;
+    dl->timeout = NP2SRV_RPC_TIMEOUT;
+    if (dl->timeout) {
+        dl->timeout += np2_deadline_extension(rpc);
+        dl->end = np2_deadline_now() + dl->timeout;
+    } else {
+        dl->end = 0;
+    }
+    dl->countdown = NP2_DEADLINE_CLOCK_CHECKS;
+    dl->failed = 0;
+}
+
+void
+np2_deadline_stop(void)
+{
+    struct np2_deadline *dl;
+
+    dl = np2_deadline_get(0);
+    if (dl) {
+        dl->s = NULL;
+    }
+}
+
+int
+np2_deadline_check(void)
+{
+    struct np2_deadline *dl;
+
+    dl = np2_deadline_get(0);
+    if (!dl || !dl->s) {
+        return 0;
+    }
+    if (dl->failed) {
+        return 1;
+    }
+
+    if (__atomic_load_n(&dl->s->killed, __ATOMIC_RELAXED)) {
+        dl->failed = 1;
+        ERR("Operation aborted, session %u was killed by session %u.", nc_session_get_id(dl->s->ncs),
+            __atomic_load_n(&dl->s->killed_by, __ATOMIC_RELAXED));
+        return 1;
+    }
+
+    if (dl->end && !--dl->countdown) {
+        dl->countdown = NP2_DEADLINE_CLOCK_CHECKS;
+        if (np2_deadline_now() >= dl->end) {
+            dl->failed = 1;
+            ERR("Operation aborted, it exceeded its deadline of %u s.", dl->timeout);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int
+np2_deadline_session_add(struct np2_sessions *s)
+{
+    struct np2_sessions **new;
+    uint32_t size;
+
+    pthread_mutex_lock(&np2_killable.lock);
+
+    if (np2_killable.count == np2_killable.size) {
+        size = np2_killable.size ? np2_killable.size * 2 : 16;
+        new = realloc(np2_killable.list, size * sizeof *np2_killable.list);
+        if (!new) {
+            EMEM;
+            pthread_mutex_unlock(&np2_killable.lock);
+            return EXIT_FAILURE;
+        }
+        np2_killable.list = new;
+        np2_killable.size = size;
+    }
+
+    s->dl_idx = np2_killable.count;
+    np2_killable.list[np2_killable.count++] = s;
+
+    pthread_mutex_unlock(&np2_killable.lock);
+    return EXIT_SUCCESS;
+}
+
+void
+np2_deadline_session_del(struct np2_sessions *s)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&np2_killable.lock);
+
+    i = s->dl_idx;
+    if ((i >= np2_killable.count) || (np2_killable.list[i] != s)) {
+        /* it was never added */
+        pthread_mutex_unlock(&np2_killable.lock);
+        return;
+    }
+
+    --np2_killable.count;
+    if (i < np2_killable.count) {
+        /* move here the session from the end of the list */
+        np2_killable.list[i] = np2_killable.list[np2_killable.count];
+        np2_killable.list[i]->dl_idx = i;
+    }
+
+    pthread_mutex_unlock(&np2_killable.lock);
+}
+
+int
+np2_deadline_session_kill(uint32_t sid, uint32_t killed_by)
+{
+    struct np2_sessions *s;
+    uint32_t i;
+
+    pthread_mutex_lock(&np2_killable.lock);
+
+    for (i = 0; i < np2_killable.count; ++i) {
+        if (nc_session_get_id(np2_killable.list[i]->ncs) == sid) {
+            break;
+        }
+    }
+    if (i == np2_killable.count) {
+        pthread_mutex_unlock(&np2_killable.lock);
+        return EXIT_FAILURE;
+    }
+    s = np2_killable.list[i];
+
+    /* the session cannot be freed while we hold the lock, it is terminated on its next poll */
+    nc_session_set_term_reason(s->ncs, NC_SESSION_TERM_KILLED);
+    nc_session_set_status(s->ncs, NC_STATUS_INVALID);
+
+    /* and its RPC in progress (if any) is aborted on its next check */
+    __atomic_store_n(&s->killed_by, killed_by, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->killed, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&np2_killable.lock);
+    return EXIT_SUCCESS;
+}
+
+void
+np2_deadline_destroy(void)
+{
+    pthread_mutex_lock(&np2_killable.lock);
+
+    free(np2_killable.list);
+    np2_killable.list = NULL;
+    np2_killable.count = 0;
+    np2_killable.size = 0;
+
+    pthread_mutex_unlock(&np2_killable.lock);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file deadline.h
+ * @brief Per-RPC deadlines and cancellation of the RPCs of killed sessions
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_DEADLINE_H_
+#define NP2SRV_DEADLINE_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+
+#include "common.h"
+
+/*
+ * Work of an RPC cannot be interrupted from the outside, the long loops of the operations call np2_deadline_check()
+ * instead and abort the RPC when it fails. The deadline is NP2SRV_RPC_TIMEOUT extended by the netopeer2-deadline
+ * timeout-extension annotation of the RPC, but at most by NP2SRV_RPC_TIMEOUT_EXT_MAX. The RPC of a killed session
+ * is aborted on its next check as well.
+ */
+
+/**
+ * @brief Start the deadline of an RPC processed by the current thread.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ * @param[in] rpc Received RPC.
+ */
+void np2_deadline_start(struct np2_sessions *s, const struct lyd_node *rpc);
+
+/**
+ * @brief Stop the deadline of the RPC processed by the current thread.
+ */
+void np2_deadline_stop(void);
+
+/**
+ * @brief Check that the RPC processed by the current thread may continue, cheap enough for every loop iteration.
+ *
+ * Once it fails, it keeps failing until the RPC ends. The reason is printed as an error, so it is the message of
+ * the operation-failed error of the RPC.
+ *
+ * @return 0 if the RPC may continue (or there is none), non-zero if its deadline passed or its session was killed.
+ */
+int np2_deadline_check(void);
+
+/**
+ * @brief Add a NETCONF session to the sessions that can be killed.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int np2_deadline_session_add(struct np2_sessions *s);
+
+/**
+ * @brief Remove a NETCONF session from the sessions that can be killed, it is not killed anymore after it returns.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ */
+void np2_deadline_session_del(struct np2_sessions *s);
+
+/**
+ * @brief Kill a NETCONF session, it is terminated and its RPC in progress is aborted.
+ *
+ * @param[in] sid ID of the session to kill.
+ * @param[in] killed_by ID of the session killing it.
+ * @return EXIT_SUCCESS or EXIT_FAILURE if there is no such session.
+ */
+int np2_deadline_session_kill(uint32_t sid, uint32_t killed_by);
+
+/**
+ * @brief Destroy the list of the sessions that can be killed.
+ */
+void np2_deadline_destroy(void);
+
+#endif /* NP2SRV_DEADLINE_H_ */
@@ -25,7 +25,9 @@
 #include <sysrepo.h>
 
 #include "common.h"
+#include "callhome.h"
 #include "ietf_keystore.h"
+#include "unix_socket.h"
 
 /* setters */
 
@@ -90,48 +92,6 @@ set_listen_idle_timeout(sr_change_oper_t sr_oper, sr_val_t *UNUSED(sr_old_val),
     return EXIT_SUCCESS;
 }
 
-static int
-set_listen_endpoint_address(const char *endpt_name, sr_change_oper_t sr_oper, sr_val_t *UNUSED(sr_old_val),
-                            sr_val_t *sr_new_val)
-{
-    int rc = EXIT_FAILURE;
-
-    switch (sr_oper) {
-    case SR_OP_CREATED:
-    case SR_OP_MODIFIED:
-        rc = nc_server_endpt_set_address(endpt_name, sr_new_val->data.string_val);
-        break;
-    case SR_OP_DELETED:
-        rc = nc_server_endpt_set_address(endpt_name, "0.0.0.0");
-        break;
-    case SR_OP_MOVED:
-        EINT;
-        break;
-    }
-
-    return rc;
-}
-
-static int
-set_listen_endpoint_port(const char *endpt_name, sr_change_oper_t sr_oper, sr_val_t *UNUSED(sr_old_val),
-                         sr_val_t *sr_new_val)
-{
-    int rc = EXIT_FAILURE;
-
-    switch (sr_oper) {
-    case SR_OP_CREATED:
-    case SR_OP_MODIFIED:
-        rc = nc_server_endpt_set_port(endpt_name, sr_new_val->data.uint16_val);
-        break;
-    case SR_OP_DELETED:
-    case SR_OP_MOVED:
-        EINT;
-        break;
-    }
-
-    return rc;
-}
-
 struct thread_arg {
     sr_session_ctx_t *session;
     int listen_or_ch;
@@ -230,6 +190,28 @@ set_listen_endpoint_ssh_host_key(sr_session_ctx_t *session, const char *endpt_na
     return rc;
 }
 
+static int
+set_listen_endpoint_unix(const char *endpt_name, const char *leaf, sr_change_oper_t sr_oper,
+                         sr_val_t *UNUSED(sr_old_val), sr_val_t *sr_new_val)
+{
+    int rc = EXIT_FAILURE;
+
+    switch (sr_oper) {
+    case SR_OP_CREATED:
+    case SR_OP_MODIFIED:
+        rc = usock_endpt_set(endpt_name, leaf, sr_new_val->data.string_val);
+        break;
+    case SR_OP_DELETED:
+        rc = usock_endpt_set(endpt_name, leaf, NULL);
+        break;
+    case SR_OP_MOVED:
+        EINT;
+        break;
+    }
+
+    return rc;
+}
+
 static int
 set_tls_cert(const char *config_name, sr_change_oper_t sr_oper, sr_val_t *UNUSED(sr_old_val), sr_val_t *sr_new_val,
              int listen_or_ch)
@@ -387,46 +369,6 @@ add_tls_ctn(const char *xpath, const char *config_name, sr_change_oper_t sr_oper
     return rc;
 }
 
-static int
-set_ch_client_endpoint_address(const char *client_name, const char *endpt_name, sr_change_oper_t sr_oper,
-                               sr_val_t *UNUSED(sr_old_val), sr_val_t *sr_new_val)
-{
-    int rc = EXIT_FAILURE;
-
-    switch (sr_oper) {
-    case SR_OP_CREATED:
-    case SR_OP_MODIFIED:
-        rc = nc_server_ch_client_endpt_set_address(client_name, endpt_name, sr_new_val->data.string_val);
-        break;
-    case SR_OP_DELETED:
-    case SR_OP_MOVED:
-        EINT;
-        break;
-    }
-
-    return rc;
-}
-
-static int
-set_ch_client_endpoint_port(const char *client_name, const char *endpt_name, sr_change_oper_t sr_oper,
-                            sr_val_t *UNUSED(sr_old_val), sr_val_t *sr_new_val)
-{
-    int rc = EXIT_FAILURE;
-
-    switch (sr_oper) {
-    case SR_OP_CREATED:
-    case SR_OP_MODIFIED:
-        rc = nc_server_ch_client_endpt_set_port(client_name, endpt_name, sr_new_val->data.uint16_val);
-        break;
-    case SR_OP_DELETED:
-    case SR_OP_MOVED:
-        EINT;
-        break;
-    }
-
-    return rc;
-}
-
 static int
 set_ch_client_ssh_host_key(sr_session_ctx_t *session, const char *client_name, sr_change_oper_t sr_oper,
                            sr_val_t *sr_old_val, sr_val_t *sr_new_val)
@@ -669,265 +611,828 @@ parse_list_key(const char **predicate, const char **key_val, const char *key_nam
     ++(*predicate);
 }
 
+/* libnetconf2 listen and call-home endpoints as currently configured */
+struct endpt_state {
+    char *client_name;      /* NULL for listen endpoints */
+    char *name;
+    NC_TRANSPORT_IMPL ti;   /* NC_TI_FD for UNIX socket endpoints, not in libnetconf2 */
+    char *address;
+    uint16_t port;
+};
+
+static struct endpt_state *endpt_states;
+static uint32_t endpt_state_count;
+
+/* desired changes of a listen or call-home endpoint in a single commit */
+struct plan_endpt {
+    char *client_name;      /* NULL for listen endpoints */
+    char *name;
+    int del;                /* endpoint removed (and possibly re-created) */
+    int add;                /* endpoint created */
+    NC_TRANSPORT_IMPL ti;   /* transport of a created listen endpoint, NC_TI_FD for a UNIX socket */
+    char *address;          /* new address, NULL if unchanged */
+    int32_t port;           /* new port, -1 if unchanged */
+};
+
+/* desired changes of a call-home client in a single commit */
+struct plan_client {
+    char *name;
+    int del;                /* client removed (and possibly re-created) */
+    NC_TRANSPORT_IMPL ti;   /* transport of a created client, 0 otherwise */
+};
+
+struct plan {
+    struct plan_endpt *endpts;
+    uint32_t endpt_count;
+    struct plan_client *clients;
+    uint32_t client_count;
+};
+
+/* a single change of the configuration */
+struct cfg_change {
+    sr_change_oper_t sr_oper;
+    sr_val_t *sr_old_val;
+    sr_val_t *sr_new_val;
+    int skip;               /* change of a stopped call-home client */
+};
+
+/* call-home clients removed from libnetconf2 by the call-home manager until their next attempt,
+ * their whole configuration is applied from running when they are started again */
+struct ch_stopped {
+    char *name;
+    NC_TRANSPORT_IMPL ti;
+};
+
+static struct ch_stopped *ch_stopped;
+static uint32_t ch_stopped_count;
+
+/* serializes configuration changes with the call-home manager starting and stopping clients */
+static pthread_mutex_t cfg_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int
-module_change_resolve(sr_session_ctx_t *session, sr_change_oper_t sr_oper, sr_val_t *sr_old_val, sr_val_t *sr_new_val,
-                      const char **list1_key_del, const char **list2_key_del)
+ch_stopped_find(const char *name)
 {
-    int rc = -2;
-    const char *xpath, *list1_key = NULL, *list2_key = NULL, *oper_str = NULL;
-    char quot;
+    uint32_t i;
 
-    xpath = (sr_old_val ? sr_old_val->xpath : sr_new_val->xpath);
-    assert(!strncmp(xpath, "/ietf-netconf-server:netconf-server", 35));
+    for (i = 0; i < ch_stopped_count; ++i) {
+        if (!strcmp(name, ch_stopped[i].name)) {
+            return i;
+        }
+    }
 
-    switch (sr_oper) {
-    case SR_OP_CREATED:
-        oper_str = "created";
-        break;
-    case SR_OP_DELETED:
-        oper_str = "deleted";
-        break;
-    case SR_OP_MODIFIED:
-        oper_str = "modified";
-        break;
-    case SR_OP_MOVED:
-        oper_str = "moved";
-        break;
+    return -1;
+}
+
+/* removing an item moves only the last one */
+static void
+ch_stopped_remove(uint32_t idx)
+{
+    free(ch_stopped[idx].name);
+    --ch_stopped_count;
+    if (idx < ch_stopped_count) {
+        memcpy(&ch_stopped[idx], &ch_stopped[ch_stopped_count], sizeof *ch_stopped);
     }
 
-    VRB("Path \"%s\" %s.", xpath, oper_str);
+    if (!ch_stopped_count) {
+        free(ch_stopped);
+        ch_stopped = NULL;
+    }
+}
 
-    xpath += 35;
+/* removes stopped clients matching all the specified (non-NULL/non-zero) parameters */
+static void
+ch_stopped_del(const char *name, NC_TRANSPORT_IMPL ti)
+{
+    uint32_t i;
 
-    if (!xpath[0]) {
-        /* while container was deleted/created, ok, whatever */
-        return 0;
+    i = 0;
+    while (i < ch_stopped_count) {
+        if ((name && strcmp(name, ch_stopped[i].name)) || (ti && (ti != ch_stopped[i].ti))) {
+            ++i;
+            continue;
+        }
+        ch_stopped_remove(i);
     }
+}
 
-    assert(xpath[0] == '/');
-    ++xpath;
+/* marks changes of stopped call-home clients to be skipped, forgets the removed ones */
+static int
+ch_stopped_filter(struct cfg_change *changes, uint32_t change_count)
+{
+    uint32_t i, j;
+    const char *xpath, *client_name;
+    int idx, *removed;
 
-    if (!strcmp(xpath, "session-options")) {
-        rc = 0;
-    } else if (!strncmp(xpath, "session-options/", 16)) {
-        xpath += 16;
-        if (!strcmp(xpath, "hello-timeout")) {
-            rc = set_session_options_hello_timeout(sr_oper, sr_old_val, sr_new_val);
+    if (!ch_stopped_count) {
+        for (i = 0; i < change_count; ++i) {
+            changes[i].skip = 0;
         }
-    } else if (!strcmp(xpath, "listen")) {
-        rc = 0;
-    } else if (!strncmp(xpath, "listen/", 7)) {
-        xpath += 7;
-        if (!strcmp(xpath, "max-sessions")) {
-            rc = set_listen_max_sessions(sr_oper, sr_old_val, sr_new_val);
-        } else if (!strcmp(xpath, "idle-timeout")) {
-            rc = set_listen_idle_timeout(sr_oper, sr_old_val, sr_new_val);
-        } else if (!strncmp(xpath, "endpoint", 8)) {
-            xpath += 8;
-            assert(xpath[0] == '[');
+        return EXIT_SUCCESS;
+    }
 
-            parse_list_key(&xpath, &list1_key, "name");
+    /* 1 - client removed, 2 - client (re)created */
+    removed = calloc(ch_stopped_count, sizeof *removed);
+    if (!removed) {
+        EMEM;
+        return EXIT_FAILURE;
+    }
 
-            assert(xpath[0] == '/');
-            ++xpath;
+    for (i = 0; i < change_count; ++i) {
+        changes[i].skip = 0;
 
-            if (list1_key_del && *list1_key_del && (sr_oper == SR_OP_DELETED) && !strcmp(list1_key, *list1_key_del)) {
-                /* whole endpoint already deleted */
-                lydict_remove(np2srv.ly_ctx, list1_key);
-                return EXIT_SUCCESS;
+        xpath = (changes[i].sr_old_val ? changes[i].sr_old_val->xpath : changes[i].sr_new_val->xpath);
+        if (strncmp(xpath, "/ietf-netconf-server:netconf-server/call-home/netconf-client[", 61)) {
+            continue;
+        }
+        xpath += 60;
+        parse_list_key(&xpath, &client_name, "name");
+
+        idx = ch_stopped_find(client_name);
+        if (idx > -1) {
+            changes[i].skip = 1;
+            if (!strcmp(xpath, "/name")) {
+                removed[idx] |= (changes[i].sr_oper == SR_OP_DELETED) ? 1 : 2;
             }
+        }
+        lydict_remove(np2srv.ly_ctx, client_name);
+    }
 
-            if (!strcmp(xpath, "name")) {
-                if (sr_oper == SR_OP_DELETED) {
-                    assert(list1_key_del);
-                    rc = nc_server_del_endpt(sr_old_val->data.string_val, 0);
-                    if (!rc) {
-                        if (*list1_key_del) {
-                            lydict_remove(np2srv.ly_ctx, *list1_key_del);
-                        }
-                        *list1_key_del = list1_key;
-                        list1_key = NULL;
-                    }
-                } else {
-                    /* we don't care it was created, ssh or tls container will be created too */
-                    rc = 0;
-                }
-            } else if (!strcmp(xpath, "ssh")) {
-                if (sr_oper == SR_OP_CREATED) {
-                    rc = nc_server_add_endpt(list1_key, NC_TI_LIBSSH);
-                } else {
-                    rc = 0;
-                }
-            } else if (!strncmp(xpath, "ssh/", 4)) {
-                xpath += 4;
-                if (!strcmp(xpath, "address")) {
-                    rc = set_listen_endpoint_address(list1_key, sr_oper, sr_old_val, sr_new_val);
-                } else if (!strcmp(xpath, "port")) {
-                    rc = set_listen_endpoint_port(list1_key, sr_oper, sr_old_val, sr_new_val);
-                } else if (!strcmp(xpath, "host-keys")) {
-                    /* ignore */
-                    rc = 0;
-                } else if (!strncmp(xpath, "host-keys/", 10)) {
-                    xpath += 10;
-                    if (!strncmp(xpath, "host-key", 8)) {
-                        xpath += 8;
-                        assert(xpath[0] == '[');
-
-                        parse_list_key(&xpath, &list2_key, "name");
+    /* going backwards, only already processed items are moved */
+    for (j = ch_stopped_count; j > 0; --j) {
+        if (removed[j - 1] == 1) {
+            chm_client_del(ch_stopped[j - 1].name, 0);
+            ch_stopped_remove(j - 1);
+        }
+    }
 
-                        if (!xpath[0]) {
-                            /* list moved */
-                            rc = set_listen_endpoint_ssh_host_key(session, list1_key, sr_oper, sr_old_val, sr_new_val);
-                        } else if (xpath[0] == '/') {
-                            ++xpath;
+    free(removed);
+    return EXIT_SUCCESS;
+}
 
-                            if (!strcmp(xpath, "name")) {
-                                /* we just don't care  */
-                                rc = EXIT_SUCCESS;
-                            } else if (!strcmp(xpath, "public-key")) {
-                                rc = set_listen_endpoint_ssh_host_key(session, list1_key, sr_oper, sr_old_val, sr_new_val);
-                            }
-                        }
-                    }
-                }
-            } else if (!strcmp(xpath, "tls")) {
-                if (sr_oper == SR_OP_CREATED) {
-                    rc = nc_server_add_endpt(list1_key, NC_TI_OPENSSL);
-                } else {
-                    rc = 0;
-                }
-            } else if (!strncmp(xpath, "tls/", 4)) {
-                xpath += 4;
-                if (!strcmp(xpath, "address")) {
-                    rc = set_listen_endpoint_address(list1_key, sr_oper, sr_old_val, sr_new_val);
-                } else if (!strcmp(xpath, "port")) {
-                    rc = set_listen_endpoint_port(list1_key, sr_oper, sr_old_val, sr_new_val);
-                } else if (!strcmp(xpath, "certificates")) {
-                    /* ignore */
-                    rc = 0;
-                } else if (!strncmp(xpath, "certificates/", 13)) {
-                    xpath += 13;
-                    if (!strncmp(xpath, "certificate", 11)) {
-                        xpath += 11;
-                        assert(!strncmp(xpath, "[name=", 6));
-                        xpath += 6;
-                        quot = xpath[0];
-                        ++xpath;
-                        xpath = strchr(xpath, quot);
-                        ++xpath;
-                        assert(!strncmp(xpath, "]/", 2));
-                        xpath += 2;
+static struct endpt_state *
+endpt_state_find(const char *client_name, const char *name)
+{
+    uint32_t i;
 
-                        if (!strcmp(xpath, "name")) {
-                            rc = set_tls_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
-                        }
-                    }
-                } else if (!strcmp(xpath, "client-auth")) {
-                    /* ignore */
-                    rc = 0;
-                } else if (!strncmp(xpath, "client-auth/", 12)) {
-                    xpath += 12;
-                    if (!strcmp(xpath, "trusted-ca-certs")) {
-                        rc = add_tls_trusted_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
-                    } else if (!strcmp(xpath, "trusted-client-certs")) {
-                        rc = add_tls_trusted_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
-                    } else if (!strcmp(xpath, "cert-maps")) {
-                        /* ignore */
-                        rc = 0;
-                    } else if (!strncmp(xpath, "cert-maps/", 10)) {
-                        xpath += 10;
-                        rc = add_tls_ctn(xpath, list1_key, sr_oper, sr_old_val, sr_new_val, 0);
-                    }
-                }
-            }
+    for (i = 0; i < endpt_state_count; ++i) {
+        if ((!client_name != !endpt_states[i].client_name)
+                || (client_name && strcmp(client_name, endpt_states[i].client_name))) {
+            continue;
         }
-    } else if (!strcmp(xpath, "call-home")) {
-        /* ignore */
-        rc = 0;
-    } else if (!strncmp(xpath, "call-home/", 10)) {
-        xpath += 10;
-        if (!strncmp(xpath, "netconf-client", 14)) {
-            xpath += 14;
-            assert(xpath[0] == '[');
+        if (!strcmp(name, endpt_states[i].name)) {
+            return &endpt_states[i];
+        }
+    }
 
-            parse_list_key(&xpath, &list1_key, "name");
+    return NULL;
+}
 
-            assert(xpath[0] == '/');
-            ++xpath;
+static struct endpt_state *
+endpt_state_add(const char *client_name, const char *name, NC_TRANSPORT_IMPL ti)
+{
+    struct endpt_state *state;
 
-            if (list1_key_del && *list1_key_del && (sr_oper == SR_OP_DELETED) && !strcmp(list1_key, *list1_key_del)) {
-                /* whole client already deleted */
-                lydict_remove(np2srv.ly_ctx, list1_key);
-                return EXIT_SUCCESS;
+    state = realloc(endpt_states, (endpt_state_count + 1) * sizeof *endpt_states);
+    if (!state) {
+        EMEM;
+        return NULL;
+    }
+    endpt_states = state;
+
+    state = &endpt_states[endpt_state_count];
+    memset(state, 0, sizeof *state);
+    state->client_name = (client_name ? strdup(client_name) : NULL);
+    state->name = strdup(name);
+    state->ti = ti;
+    if ((client_name && !state->client_name) || !state->name) {
+        EMEM;
+        free(state->client_name);
+        free(state->name);
+        return NULL;
+    }
+
+    ++endpt_state_count;
+    return state;
+}
+
+/* removes endpoints matching all the specified (non-NULL/non-zero) parameters */
+static void
+endpt_state_del(int ch, const char *client_name, const char *name, NC_TRANSPORT_IMPL ti)
+{
+    uint32_t i;
+
+    i = 0;
+    while (i < endpt_state_count) {
+        if ((ch != !!endpt_states[i].client_name)
+                || (client_name && strcmp(client_name, endpt_states[i].client_name))
+                || (name && strcmp(name, endpt_states[i].name))
+                || (ti && (ti != endpt_states[i].ti))) {
+            ++i;
+            continue;
+        }
+
+        free(endpt_states[i].client_name);
+        free(endpt_states[i].name);
+        free(endpt_states[i].address);
+        --endpt_state_count;
+        if (i < endpt_state_count) {
+            memcpy(&endpt_states[i], &endpt_states[endpt_state_count], sizeof *endpt_states);
+        }
+    }
+
+    if (!endpt_state_count) {
+        free(endpt_states);
+        endpt_states = NULL;
+    }
+}
+
+static struct plan_endpt *
+plan_get_endpt(struct plan *plan, const char *client_name, const char *name)
+{
+    struct plan_endpt *endpt;
+    uint32_t i;
+
+    for (i = 0; i < plan->endpt_count; ++i) {
+        endpt = &plan->endpts[i];
+        if ((!client_name == !endpt->client_name) && (!client_name || !strcmp(client_name, endpt->client_name))
+                && !strcmp(name, endpt->name)) {
+            return endpt;
+        }
+    }
+
+    endpt = realloc(plan->endpts, (plan->endpt_count + 1) * sizeof *plan->endpts);
+    if (!endpt) {
+        EMEM;
+        return NULL;
+    }
+    plan->endpts = endpt;
+
+    endpt = &plan->endpts[plan->endpt_count];
+    memset(endpt, 0, sizeof *endpt);
+    endpt->client_name = (client_name ? strdup(client_name) : NULL);
+    endpt->name = strdup(name);
+    endpt->port = -1;
+    if ((client_name && !endpt->client_name) || !endpt->name) {
+        EMEM;
+        free(endpt->client_name);
+        free(endpt->name);
+        return NULL;
+    }
+
+    ++plan->endpt_count;
+    return endpt;
+}
+
+static struct plan_client *
+plan_get_client(struct plan *plan, const char *name)
+{
+    struct plan_client *client;
+    char *name_dup;
+    uint32_t i;
+
+    for (i = 0; i < plan->client_count; ++i) {
+        if (!strcmp(name, plan->clients[i].name)) {
+            return &plan->clients[i];
+        }
+    }
+
+    /* nothing is left allocated for the entry if any of this fails */
+    name_dup = strdup(name);
+    if (!name_dup) {
+        EMEM;
+        return NULL;
+    }
+
+    client = realloc(plan->clients, (plan->client_count + 1) * sizeof *plan->clients);
+    if (!client) {
+        EMEM;
+        free(name_dup);
+        return NULL;
+    }
+    plan->clients = client;
+
+    client = &plan->clients[plan->client_count];
+    memset(client, 0, sizeof *client);
+    client->name = name_dup;
+
+    ++plan->client_count;
+    return client;
+}
+
+/* whether the endpoint or client (endpt_name NULL) is removed in this commit, or re-created as well if set */
+static int
+plan_removed(struct plan *plan, const char *client_name, const char *endpt_name, int or_recreated)
+{
+    uint32_t i;
+
+    if (client_name) {
+        for (i = 0; i < plan->client_count; ++i) {
+            if (!strcmp(client_name, plan->clients[i].name)) {
+                if (plan->clients[i].del && (or_recreated || !plan->clients[i].ti)) {
+                    return 1;
+                }
+                break;
+            }
+        }
+    }
+
+    if (endpt_name) {
+        for (i = 0; i < plan->endpt_count; ++i) {
+            if ((!client_name == !plan->endpts[i].client_name)
+                    && (!client_name || !strcmp(client_name, plan->endpts[i].client_name))
+                    && !strcmp(endpt_name, plan->endpts[i].name)) {
+                return plan->endpts[i].del && (or_recreated || !plan->endpts[i].add);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void
+plan_free(struct plan *plan)
+{
+    uint32_t i;
+
+    for (i = 0; i < plan->endpt_count; ++i) {
+        free(plan->endpts[i].client_name);
+        free(plan->endpts[i].name);
+        free(plan->endpts[i].address);
+    }
+    free(plan->endpts);
+
+    for (i = 0; i < plan->client_count; ++i) {
+        free(plan->clients[i].name);
+    }
+    free(plan->clients);
+}
+
+/* learns address and port changes, xpath is relative to the transport container */
+static int
+plan_endpt_address_port(struct plan *plan, const char *client_name, const char *endpt_name, const char *xpath,
+                        sr_change_oper_t sr_oper, sr_val_t *sr_new_val)
+{
+    struct plan_endpt *endpt;
+
+    if (strcmp(xpath, "address") && strcmp(xpath, "port")) {
+        /* not our concern */
+        return EXIT_SUCCESS;
+    }
+
+    endpt = plan_get_endpt(plan, client_name, endpt_name);
+    if (!endpt) {
+        return EXIT_FAILURE;
+    }
+
+    switch (sr_oper) {
+    case SR_OP_CREATED:
+    case SR_OP_MODIFIED:
+        if (!strcmp(xpath, "address")) {
+            free(endpt->address);
+            endpt->address = strdup(sr_new_val->data.string_val);
+            if (!endpt->address) {
+                EMEM;
+                return EXIT_FAILURE;
+            }
+        } else {
+            endpt->port = sr_new_val->data.uint16_val;
+        }
+        break;
+    case SR_OP_DELETED:
+        if (!strcmp(xpath, "address") && !client_name) {
+            free(endpt->address);
+            endpt->address = strdup("0.0.0.0");
+            if (!endpt->address) {
+                EMEM;
+                return EXIT_FAILURE;
+            }
+        }
+        /* otherwise the whole endpoint is being deleted */
+        break;
+    case SR_OP_MOVED:
+        EINT;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* learns what is to happen with endpoints and call-home clients */
+static int
+plan_collect(struct plan *plan, sr_change_oper_t sr_oper, sr_val_t *sr_old_val, sr_val_t *sr_new_val)
+{
+    int rc = EXIT_SUCCESS;
+    const char *xpath, *list1_key = NULL, *list2_key = NULL;
+    struct plan_endpt *endpt;
+    struct plan_client *client;
+
+    xpath = (sr_old_val ? sr_old_val->xpath : sr_new_val->xpath);
+
+    if (!strncmp(xpath, "/ietf-netconf-server:netconf-server/listen/endpoint[", 52)) {
+        xpath += 51;
+        parse_list_key(&xpath, &list1_key, "name");
+        if (xpath[0] != '/') {
+            goto cleanup;
+        }
+        ++xpath;
+
+        if (!strcmp(xpath, "name") || !strcmp(xpath, "ssh") || !strcmp(xpath, "tls")
+                || !strcmp(xpath, "netopeer2-netconf-server:unix-socket")) {
+            endpt = plan_get_endpt(plan, NULL, list1_key);
+            if (!endpt) {
+                rc = EXIT_FAILURE;
+                goto cleanup;
+            }
+
+            if (sr_oper == SR_OP_DELETED) {
+                /* either the endpoint or its transport was removed */
+                endpt->del = 1;
+            } else if ((sr_oper == SR_OP_CREATED) && strcmp(xpath, "name")) {
+                endpt->add = 1;
+                if (!strcmp(xpath, "ssh")) {
+                    endpt->ti = NC_TI_LIBSSH;
+                } else if (!strcmp(xpath, "tls")) {
+                    endpt->ti = NC_TI_OPENSSL;
+                } else {
+                    endpt->ti = NC_TI_FD;
+                }
+            }
+        } else if (!strncmp(xpath, "ssh/", 4) || !strncmp(xpath, "tls/", 4)) {
+            rc = plan_endpt_address_port(plan, NULL, list1_key, xpath + 4, sr_oper, sr_new_val);
+        }
+    } else if (!strncmp(xpath, "/ietf-netconf-server:netconf-server/call-home/netconf-client[", 61)) {
+        xpath += 60;
+        parse_list_key(&xpath, &list1_key, "name");
+        if (xpath[0] != '/') {
+            goto cleanup;
+        }
+        ++xpath;
+
+        if (!strcmp(xpath, "name") || !strcmp(xpath, "ssh") || !strcmp(xpath, "tls")) {
+            client = plan_get_client(plan, list1_key);
+            if (!client) {
+                rc = EXIT_FAILURE;
+                goto cleanup;
             }
 
+            if (sr_oper == SR_OP_DELETED) {
+                /* either the client or its transport was removed */
+                client->del = 1;
+            } else if ((sr_oper == SR_OP_CREATED) && strcmp(xpath, "name")) {
+                client->ti = (!strcmp(xpath, "ssh") ? NC_TI_LIBSSH : NC_TI_OPENSSL);
+            }
+        } else if ((!strncmp(xpath, "ssh", 3) || !strncmp(xpath, "tls", 3))
+                && !strncmp(xpath + 3, "/endpoints/endpoint[", 20)) {
+            xpath += 22;
+            parse_list_key(&xpath, &list2_key, "name");
+            if (xpath[0] != '/') {
+                goto cleanup;
+            }
+            ++xpath;
+
             if (!strcmp(xpath, "name")) {
+                endpt = plan_get_endpt(plan, list1_key, list2_key);
+                if (!endpt) {
+                    rc = EXIT_FAILURE;
+                    goto cleanup;
+                }
+
                 if (sr_oper == SR_OP_DELETED) {
-                    assert(list1_key_del);
-                    rc = nc_server_ch_del_client(sr_old_val->data.string_val, 0);
-                    if (!rc) {
-                        if (*list1_key_del) {
-                            lydict_remove(np2srv.ly_ctx, *list1_key_del);
-                        }
-                        *list1_key_del = list1_key;
-                        list1_key = NULL;
-                    }
-                } else {
-                    /* we don't care it was created, ssh or tls container will be created too */
-                    rc = 0;
+                    endpt->del = 1;
+                } else if (sr_oper == SR_OP_CREATED) {
+                    endpt->add = 1;
                 }
-            } else if (!strcmp(xpath, "ssh")) {
-                if (sr_oper == SR_OP_CREATED) {
-                    rc = nc_server_ch_add_client(list1_key, NC_TI_LIBSSH);
-                    if (!rc) {
-                        rc = nc_connect_ch_client_dispatch(list1_key, np2srv_new_session_clb);
-                    }
-                } else {
-                    rc = 0;
+            } else {
+                rc = plan_endpt_address_port(plan, list1_key, list2_key, xpath, sr_oper, sr_new_val);
+            }
+        }
+    }
+
+cleanup:
+    lydict_remove(np2srv.ly_ctx, list1_key);
+    lydict_remove(np2srv.ly_ctx, list2_key);
+    return rc;
+}
+
+/* removes, creates and binds endpoints and call-home clients, each at most once */
+static int
+plan_apply(struct plan *plan)
+{
+    uint32_t i;
+    int rc;
+    struct plan_endpt *endpt;
+    struct plan_client *client;
+    struct endpt_state *state;
+
+    /* 1) removed call-home clients and endpoints, also those with a changed transport */
+    for (i = 0; i < plan->client_count; ++i) {
+        client = &plan->clients[i];
+        if (client->del) {
+            rc = nc_server_ch_del_client(client->name, 0);
+            if (rc) {
+                return rc;
+            }
+            endpt_state_del(1, client->name, NULL, 0);
+            if (!client->ti) {
+                chm_client_del(client->name, 0);
+            }
+        }
+    }
+    for (i = 0; i < plan->endpt_count; ++i) {
+        endpt = &plan->endpts[i];
+        if (!endpt->del) {
+            continue;
+        }
+
+        if (endpt->client_name) {
+            if (!plan_removed(plan, endpt->client_name, NULL, 1)) {
+                rc = nc_server_ch_client_del_endpt(endpt->client_name, endpt->name);
+                if (rc) {
+                    return rc;
+                }
+            }
+        } else {
+            state = endpt_state_find(NULL, endpt->name);
+            if (state && (state->ti == NC_TI_FD)) {
+                usock_endpt_del(endpt->name);
+            } else {
+                rc = nc_server_del_endpt(endpt->name, 0);
+                if (rc) {
+                    return rc;
+                }
+            }
+        }
+        endpt_state_del(!!endpt->client_name, endpt->client_name, endpt->name, 0);
+    }
+
+    /* 2) new call-home clients and endpoints */
+    for (i = 0; i < plan->client_count; ++i) {
+        client = &plan->clients[i];
+        if (client->ti) {
+            rc = nc_server_ch_add_client(client->name, client->ti);
+            if (rc) {
+                return rc;
+            }
+        }
+    }
+    for (i = 0; i < plan->endpt_count; ++i) {
+        endpt = &plan->endpts[i];
+        if (!endpt->add) {
+            continue;
+        }
+
+        if (endpt->client_name) {
+            rc = nc_server_ch_client_add_endpt(endpt->client_name, endpt->name);
+        } else if (endpt->ti == NC_TI_FD) {
+            rc = usock_endpt_add(endpt->name);
+        } else {
+            rc = nc_server_add_endpt(endpt->name, endpt->ti);
+        }
+        if (rc) {
+            return rc;
+        }
+        if (!endpt_state_add(endpt->client_name, endpt->name, endpt->ti)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* 3) addresses and ports that actually differ from the current ones */
+    for (i = 0; i < plan->endpt_count; ++i) {
+        endpt = &plan->endpts[i];
+        if ((!endpt->address && (endpt->port == -1)) || plan_removed(plan, endpt->client_name, endpt->name, 0)) {
+            continue;
+        }
+
+        state = endpt_state_find(endpt->client_name, endpt->name);
+        if (!state) {
+            /* endpoint configured before we started tracking it */
+            state = endpt_state_add(endpt->client_name, endpt->name, 0);
+            if (!state) {
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (endpt->address && (!state->address || strcmp(endpt->address, state->address))) {
+            if (endpt->client_name) {
+                rc = nc_server_ch_client_endpt_set_address(endpt->client_name, endpt->name, endpt->address);
+            } else {
+                rc = nc_server_endpt_set_address(endpt->name, endpt->address);
+            }
+            if (rc) {
+                return rc;
+            }
+
+            free(state->address);
+            state->address = endpt->address;
+            endpt->address = NULL;
+        }
+
+        if ((endpt->port > -1) && (endpt->port != state->port)) {
+            if (endpt->client_name) {
+                rc = nc_server_ch_client_endpt_set_port(endpt->client_name, endpt->name, endpt->port);
+            } else {
+                rc = nc_server_endpt_set_port(endpt->name, endpt->port);
+            }
+            if (rc) {
+                return rc;
+            }
+
+            state->port = endpt->port;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* passes created call-home clients to the call-home manager, their whole configuration is applied */
+static void
+plan_dispatch(struct plan *plan)
+{
+    uint32_t i;
+
+    for (i = 0; i < plan->client_count; ++i) {
+        if (plan->clients[i].ti) {
+            chm_client_add(plan->clients[i].name, plan->clients[i].ti);
+        }
+    }
+}
+
+/* applies all the changes except those learned by plan_collect() */
+static int
+module_change_resolve(sr_session_ctx_t *session, sr_change_oper_t sr_oper, sr_val_t *sr_old_val, sr_val_t *sr_new_val,
+                      struct plan *plan)
+{
+    int rc = -2;
+    const char *xpath, *list1_key = NULL, *list2_key = NULL, *oper_str = NULL;
+    char quot;
+
+    xpath = (sr_old_val ? sr_old_val->xpath : sr_new_val->xpath);
+    assert(!strncmp(xpath, "/ietf-netconf-server:netconf-server", 35));
+
+    switch (sr_oper) {
+    case SR_OP_CREATED:
+        oper_str = "created";
+        break;
+    case SR_OP_DELETED:
+        oper_str = "deleted";
+        break;
+    case SR_OP_MODIFIED:
+        oper_str = "modified";
+        break;
+    case SR_OP_MOVED:
+        oper_str = "moved";
+        break;
+    }
+
+    VRB("Path \"%s\" %s.", xpath, oper_str);
+
+    xpath += 35;
+
+    if (!xpath[0]) {
+        /* while container was deleted/created, ok, whatever */
+        return 0;
+    }
+
+    assert(xpath[0] == '/');
+    ++xpath;
+
+    if (!strcmp(xpath, "session-options")) {
+        rc = 0;
+    } else if (!strncmp(xpath, "session-options/", 16)) {
+        xpath += 16;
+        if (!strcmp(xpath, "hello-timeout")) {
+            rc = set_session_options_hello_timeout(sr_oper, sr_old_val, sr_new_val);
+        }
+    } else if (!strcmp(xpath, "listen")) {
+        rc = 0;
+    } else if (!strncmp(xpath, "listen/", 7)) {
+        xpath += 7;
+        if (!strcmp(xpath, "max-sessions")) {
+            rc = set_listen_max_sessions(sr_oper, sr_old_val, sr_new_val);
+        } else if (!strcmp(xpath, "idle-timeout")) {
+            rc = set_listen_idle_timeout(sr_oper, sr_old_val, sr_new_val);
+        } else if (!strncmp(xpath, "endpoint", 8)) {
+            xpath += 8;
+            assert(xpath[0] == '[');
+
+            parse_list_key(&xpath, &list1_key, "name");
+
+            assert(xpath[0] == '/');
+            ++xpath;
+
+            if ((sr_oper == SR_OP_DELETED) && plan_removed(plan, NULL, list1_key, 1)) {
+                /* whole endpoint already deleted */
+                rc = 0;
+            } else if (!strcmp(xpath, "name") || !strcmp(xpath, "ssh") || !strcmp(xpath, "tls")
+                    || !strcmp(xpath, "netopeer2-netconf-server:unix-socket")) {
+                /* applied by the plan */
+                rc = 0;
+            } else if (!strncmp(xpath, "netopeer2-netconf-server:unix-socket/", 37)) {
+                xpath += 37;
+                if (!strcmp(xpath, "path") || !strcmp(xpath, "mode") || !strcmp(xpath, "owner")
+                        || !strcmp(xpath, "group")) {
+                    rc = set_listen_endpoint_unix(list1_key, xpath, sr_oper, sr_old_val, sr_new_val);
                 }
             } else if (!strncmp(xpath, "ssh/", 4)) {
                 xpath += 4;
-                if (!strcmp(xpath, "endpoints")) {
+                if (!strcmp(xpath, "address") || !strcmp(xpath, "port")) {
+                    /* applied by the plan */
+                    rc = 0;
+                } else if (!strcmp(xpath, "host-keys")) {
                     /* ignore */
                     rc = 0;
-                } else if (!strncmp(xpath, "endpoints/", 10)) {
+                } else if (!strncmp(xpath, "host-keys/", 10)) {
                     xpath += 10;
-                    if (!strncmp(xpath, "endpoint", 8)) {
+                    if (!strncmp(xpath, "host-key", 8)) {
                         xpath += 8;
                         assert(xpath[0] == '[');
 
                         parse_list_key(&xpath, &list2_key, "name");
 
-                        assert(xpath[0] == '/');
-                        ++xpath;
+                        if (!xpath[0]) {
+                            /* list moved */
+                            rc = set_listen_endpoint_ssh_host_key(session, list1_key, sr_oper, sr_old_val, sr_new_val);
+                        } else if (xpath[0] == '/') {
+                            ++xpath;
 
-                        if (list2_key_del && *list2_key_del && (sr_oper == SR_OP_DELETED) && !strcmp(list2_key, *list2_key_del)) {
-                            /* whole endpoint already deleted */
-                            lydict_remove(np2srv.ly_ctx, list2_key);
-                            return EXIT_SUCCESS;
+                            if (!strcmp(xpath, "name")) {
+                                /* we just don't care  */
+                                rc = EXIT_SUCCESS;
+                            } else if (!strcmp(xpath, "public-key")) {
+                                rc = set_listen_endpoint_ssh_host_key(session, list1_key, sr_oper, sr_old_val, sr_new_val);
+                            }
                         }
+                    }
+                }
+            } else if (!strncmp(xpath, "tls/", 4)) {
+                xpath += 4;
+                if (!strcmp(xpath, "address") || !strcmp(xpath, "port")) {
+                    /* applied by the plan */
+                    rc = 0;
+                } else if (!strcmp(xpath, "certificates")) {
+                    /* ignore */
+                    rc = 0;
+                } else if (!strncmp(xpath, "certificates/", 13)) {
+                    xpath += 13;
+                    if (!strncmp(xpath, "certificate", 11)) {
+                        xpath += 11;
+                        assert(!strncmp(xpath, "[name=", 6));
+                        xpath += 6;
+                        quot = xpath[0];
+                        ++xpath;
+                        xpath = strchr(xpath, quot);
+                        ++xpath;
+                        assert(!strncmp(xpath, "]/", 2));
+                        xpath += 2;
 
                         if (!strcmp(xpath, "name")) {
-                            if (sr_oper == SR_OP_DELETED) {
-                                assert(list2_key_del);
-                                rc = nc_server_ch_client_del_endpt(list1_key, sr_old_val->data.string_val);
-                                if (!rc) {
-                                    if (*list2_key_del) {
-                                        lydict_remove(np2srv.ly_ctx, *list2_key_del);
-                                    }
-                                    *list2_key_del = list2_key;
-                                    list2_key = NULL;
-                                }
-                            } else {
-                                assert(sr_oper == SR_OP_CREATED);
-                                rc = nc_server_ch_client_add_endpt(list1_key, sr_new_val->data.string_val);
-                            }
-                        } else if (!strcmp(xpath, "address")) {
-                            rc = set_ch_client_endpoint_address(list1_key, list2_key, sr_oper, sr_old_val, sr_new_val);
-                        } else if (!strcmp(xpath, "port")) {
-                            rc = set_ch_client_endpoint_port(list1_key, list2_key, sr_oper, sr_old_val, sr_new_val);
+                            rc = set_tls_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
                         }
                     }
+                } else if (!strcmp(xpath, "client-auth")) {
+                    /* ignore */
+                    rc = 0;
+                } else if (!strncmp(xpath, "client-auth/", 12)) {
+                    xpath += 12;
+                    if (!strcmp(xpath, "trusted-ca-certs")) {
+                        rc = add_tls_trusted_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
+                    } else if (!strcmp(xpath, "trusted-client-certs")) {
+                        rc = add_tls_trusted_cert(list1_key, sr_oper, sr_old_val, sr_new_val, 0);
+                    } else if (!strcmp(xpath, "cert-maps")) {
+                        /* ignore */
+                        rc = 0;
+                    } else if (!strncmp(xpath, "cert-maps/", 10)) {
+                        xpath += 10;
+                        rc = add_tls_ctn(xpath, list1_key, sr_oper, sr_old_val, sr_new_val, 0);
+                    }
+                }
+            }
+        }
+    } else if (!strcmp(xpath, "call-home")) {
+        /* ignore */
+        rc = 0;
+    } else if (!strncmp(xpath, "call-home/", 10)) {
+        xpath += 10;
+        if (!strncmp(xpath, "netconf-client", 14)) {
+            xpath += 14;
+            assert(xpath[0] == '[');
+
+            parse_list_key(&xpath, &list1_key, "name");
+
+            assert(xpath[0] == '/');
+            ++xpath;
+
+            if ((sr_oper == SR_OP_DELETED) && plan_removed(plan, list1_key, NULL, 1)) {
+                /* whole client already deleted */
+                rc = 0;
+            } else if (!strcmp(xpath, "name") || !strcmp(xpath, "ssh") || !strcmp(xpath, "tls")) {
+                /* applied by the plan */
+                rc = 0;
+            } else if (!strncmp(xpath, "ssh/", 4)) {
+                xpath += 4;
+                if (!strcmp(xpath, "endpoints") || !strncmp(xpath, "endpoints/", 10)) {
+                    /* applied by the plan */
+                    rc = 0;
                 } else if (!strcmp(xpath, "host-keys")) {
                     /* ignore */
                     rc = 0;
@@ -954,58 +1459,11 @@ module_change_resolve(sr_session_ctx_t *session, sr_change_oper_t sr_oper, sr_va
                         }
                     }
                 }
-            } else if (!strcmp(xpath, "tls")) {
-                if (sr_oper == SR_OP_CREATED) {
-                    rc = nc_server_ch_add_client(list1_key, NC_TI_OPENSSL);
-                    if (!rc) {
-                        rc = nc_connect_ch_client_dispatch(list1_key, np2srv_new_session_clb);
-                    }
-                } else {
-                    rc = 0;
-                }
             } else if (!strncmp(xpath, "tls/", 4)) {
                 xpath += 4;
-                if (!strcmp(xpath, "endpoints")) {
-                    /* ignore */
+                if (!strcmp(xpath, "endpoints") || !strncmp(xpath, "endpoints/", 10)) {
+                    /* applied by the plan */
                     rc = 0;
-                } else if (!strncmp(xpath, "endpoints/", 10)) {
-                    xpath += 10;
-                    if (!strncmp(xpath, "endpoint", 8)) {
-                        xpath += 8;
-                        assert(xpath[0] == '[');
-
-                        parse_list_key(&xpath, &list2_key, "name");
-
-                        assert(xpath[0] == '/');
-                        ++xpath;
-
-                        if (list2_key_del && *list2_key_del && (sr_oper == SR_OP_DELETED) && !strcmp(list2_key, *list2_key_del)) {
-                            /* whole endpoint already deleted */
-                            lydict_remove(np2srv.ly_ctx, list2_key);
-                            return EXIT_SUCCESS;
-                        }
-
-                        if (!strcmp(xpath, "name")) {
-                            if (sr_oper == SR_OP_DELETED) {
-                                assert(list2_key_del);
-                                rc = nc_server_ch_client_del_endpt(list1_key, sr_old_val->data.string_val);
-                                if (!rc) {
-                                    if (*list2_key_del) {
-                                        lydict_remove(np2srv.ly_ctx, *list2_key_del);
-                                    }
-                                    *list2_key_del = list2_key;
-                                    list2_key = NULL;
-                                }
-                            } else {
-                                assert(sr_oper == SR_OP_CREATED);
-                                rc = nc_server_ch_client_add_endpt(list1_key, sr_new_val->data.string_val);
-                            }
-                        } else if (!strcmp(xpath, "address")) {
-                            rc = set_ch_client_endpoint_address(list1_key, list2_key, sr_oper, sr_old_val, sr_new_val);
-                        } else if (!strcmp(xpath, "port")) {
-                            rc = set_ch_client_endpoint_port(list1_key, list2_key, sr_oper, sr_old_val, sr_new_val);
-                        }
-                    }
                 } else if (!strcmp(xpath, "certificates")) {
                     /* ignore */
                     rc = 0;
@@ -1106,15 +1564,86 @@ module_change_resolve(sr_session_ctx_t *session, sr_change_oper_t sr_oper, sr_va
     return rc;
 }
 
+/* applies all the changes of a single commit */
+static int
+module_change_apply(sr_session_ctx_t *session, struct cfg_change *changes, uint32_t change_count)
+{
+    int rc = EXIT_SUCCESS;
+    uint32_t i;
+    struct plan plan;
+
+    memset(&plan, 0, sizeof plan);
+
+    /* 0) stopped call-home clients are not in libnetconf2, they get the current configuration when started */
+    rc = ch_stopped_filter(changes, change_count);
+    if (rc) {
+        goto cleanup;
+    }
+
+    /* 1) learn what is to happen with endpoints and call-home clients */
+    for (i = 0; i < change_count; ++i) {
+        if (changes[i].skip) {
+            continue;
+        }
+        rc = plan_collect(&plan, changes[i].sr_oper, changes[i].sr_old_val, changes[i].sr_new_val);
+        if (rc) {
+            goto cleanup;
+        }
+    }
+
+    /* 2) remove, create and bind them, each at most once */
+    rc = plan_apply(&plan);
+    if (rc) {
+        goto cleanup;
+    }
+
+    /* 3) apply their remaining configuration */
+    for (i = 0; i < change_count; ++i) {
+        if (changes[i].skip) {
+            continue;
+        }
+        rc = module_change_resolve(session, changes[i].sr_oper, changes[i].sr_old_val, changes[i].sr_new_val, &plan);
+        if (rc) {
+            goto cleanup;
+        }
+    }
+
+    /* 4) bind the completely configured UNIX sockets */
+    rc = usock_apply();
+    if (rc) {
+        goto cleanup;
+    }
+
+    /* 5) start the completely configured call-home clients */
+    plan_dispatch(&plan);
+
+cleanup:
+    plan_free(&plan);
+    return rc;
+}
+
+static void
+cfg_changes_free(struct cfg_change *changes, uint32_t change_count)
+{
+    uint32_t i;
+
+    for (i = 0; i < change_count; ++i) {
+        sr_free_val(changes[i].sr_old_val);
+        sr_free_val(changes[i].sr_new_val);
+    }
+    free(changes);
+}
+
 static int
 module_change_cb(sr_session_ctx_t *session, const char *UNUSED(module_name), sr_notif_event_t event,
                  void *UNUSED(private_ctx))
 {
-    int rc, rc2, sr_rc = SR_ERR_OK;
+    int rc, sr_rc = SR_ERR_OK;
     sr_change_iter_t *sr_iter = NULL;
     sr_change_oper_t sr_oper;
     sr_val_t *sr_old_val = NULL, *sr_new_val = NULL;
-    const char *list1_key_del = NULL, *list2_key_del = NULL;
+    struct cfg_change *changes = NULL, *new_changes;
+    uint32_t change_count = 0, change_size = 0;
 
     if (event != SR_EV_APPLY) {
         ERR("%s: unexpected event.", __func__);
@@ -1132,37 +1661,121 @@ module_change_cb(sr_session_ctx_t *session, const char *UNUSED(module_name), sr_
                 || (sr_new_val
                 && ((sr_new_val->type == SR_LIST_T) && (sr_oper != SR_OP_MOVED)))) {
             /* no semantic meaning */
+            sr_free_val(sr_old_val);
+            sr_free_val(sr_new_val);
             continue;
         }
 
-        rc2 = module_change_resolve(session, sr_oper, sr_old_val, sr_new_val, &list1_key_del, &list2_key_del);
-
-        sr_free_val(sr_old_val);
-        sr_free_val(sr_new_val);
-
-        if (rc2) {
-            sr_rc = SR_ERR_OPERATION_FAILED;
-            break;
+        /* collect the whole commit first */
+        if (change_count == change_size) {
+            change_size = (change_size ? change_size * 2 : 16);
+            new_changes = realloc(changes, change_size * sizeof *changes);
+            if (!new_changes) {
+                EMEM;
+                sr_free_val(sr_old_val);
+                sr_free_val(sr_new_val);
+                sr_rc = SR_ERR_NOMEM;
+                break;
+            }
+            changes = new_changes;
         }
+        changes[change_count].sr_oper = sr_oper;
+        changes[change_count].sr_old_val = sr_old_val;
+        changes[change_count].sr_new_val = sr_new_val;
+        ++change_count;
     }
-    lydict_remove(np2srv.ly_ctx, list1_key_del);
-    lydict_remove(np2srv.ly_ctx, list2_key_del);
     sr_free_change_iter(sr_iter);
-    if ((rc != SR_ERR_OK) && (rc != SR_ERR_NOT_FOUND)) {
+    if ((sr_rc == SR_ERR_OK) && (rc != SR_ERR_OK) && (rc != SR_ERR_NOT_FOUND)) {
         ERR("%s: sr_get_change_next error: %s", __func__, sr_strerror(rc));
-        return rc;
+        sr_rc = rc;
+    }
+
+    if (sr_rc == SR_ERR_OK) {
+        pthread_mutex_lock(&cfg_lock);
+        if (module_change_apply(session, changes, change_count)) {
+            sr_rc = SR_ERR_OPERATION_FAILED;
+        }
+        pthread_mutex_unlock(&cfg_lock);
     }
 
+    cfg_changes_free(changes, change_count);
     return sr_rc;
 }
 
+/* gets the current configuration as if just created */
+static int
+cfg_changes_get(const char *path, struct cfg_change **changes, uint32_t *change_count)
+{
+    int rc, ret = EXIT_SUCCESS;
+    sr_val_iter_t *sr_iter;
+    sr_val_t *sr_val;
+    struct cfg_change *new_changes;
+    uint32_t change_size = 0;
+
+    *changes = NULL;
+    *change_count = 0;
+
+    rc = sr_get_items_iter(np2srv.sr_sess.srs, path, &sr_iter);
+    if (rc != SR_ERR_OK) {
+        ERR("Failed to get \"%s\" values iterator from sysrepo (%s).", path, sr_strerror(rc));
+        return EXIT_FAILURE;
+    }
+
+    while ((rc = sr_get_item_next(np2srv.sr_sess.srs, sr_iter, &sr_val)) == SR_ERR_OK) {
+        if (sr_val->type == SR_LIST_T) {
+            /* no semantic meaning */
+            sr_free_val(sr_val);
+            continue;
+        }
+
+        if (*change_count == change_size) {
+            change_size = (change_size ? change_size * 2 : 16);
+            new_changes = realloc(*changes, change_size * sizeof **changes);
+            if (!new_changes) {
+                EMEM;
+                sr_free_val(sr_val);
+                ret = EXIT_FAILURE;
+                break;
+            }
+            *changes = new_changes;
+        }
+        (*changes)[*change_count].sr_oper = SR_OP_CREATED;
+        (*changes)[*change_count].sr_old_val = NULL;
+        (*changes)[*change_count].sr_new_val = sr_val;
+        ++(*change_count);
+    }
+    sr_free_val_iter(sr_iter);
+    if (!ret && (rc != SR_ERR_OK) && (rc != SR_ERR_NOT_FOUND)) {
+        ERR("Failed to get the next value from sysrepo iterator (%s).", sr_strerror(rc));
+        ret = EXIT_FAILURE;
+    }
+
+    return ret;
+}
+
+/* applies the current configuration of the nodes as if just created */
+static int
+cfg_apply_current(const char *path)
+{
+    int rc;
+    struct cfg_change *changes = NULL;
+    uint32_t change_count = 0;
+
+    rc = cfg_changes_get(path, &changes, &change_count);
+    if (!rc) {
+        pthread_mutex_lock(&cfg_lock);
+        rc = module_change_apply(np2srv.sr_sess.srs, changes, change_count);
+        pthread_mutex_unlock(&cfg_lock);
+    }
+    cfg_changes_free(changes, change_count);
+
+    return rc;
+}
+
 int
 feature_change_ietf_netconf_server(const char *feature_name, bool enabled)
 {
-    int rc, rc2 = 0;
     const char *path = NULL;
-    sr_val_iter_t *sr_iter;
-    sr_val_t *sr_val;
 
     assert(feature_name);
 
@@ -1180,54 +1793,122 @@ feature_change_ietf_netconf_server(const char *feature_name, bool enabled)
             return EXIT_SUCCESS;
         }
 
-        rc = sr_get_items_iter(np2srv.sr_sess.srs, path, &sr_iter);
-        if (rc != SR_ERR_OK) {
-            ERR("Failed to get \"%s\" values iterator from sysrepo (%s).", sr_strerror(rc));
-            return EXIT_FAILURE;
-        }
-
-        while ((rc = sr_get_item_next(np2srv.sr_sess.srs, sr_iter, &sr_val)) == SR_ERR_OK) {
-            if (sr_val->type == SR_LIST_T) {
-                /* no semantic meaning */
-                continue;
-            }
-
-            rc2 = module_change_resolve(np2srv.sr_sess.srs, SR_OP_CREATED, NULL, sr_val, NULL, NULL);
-            sr_free_val(sr_val);
-            if (rc2) {
-                ERR("Failed to enable nodes depending on the \"%s\" ietf-netconf-server feature.", feature_name);
-                break;
-            }
-        }
-        sr_free_val_iter(sr_iter);
-        if (rc2) {
-            return EXIT_FAILURE;
-        } else if ((rc != SR_ERR_OK) && (rc != SR_ERR_NOT_FOUND)) {
-            ERR("Failed to get the next value from sysrepo iterator (%s).", sr_strerror(rc));
+        if (cfg_apply_current(path)) {
+            ERR("Failed to enable nodes depending on the \"%s\" ietf-netconf-server feature.", feature_name);
             return EXIT_FAILURE;
         }
     } else {
+        pthread_mutex_lock(&cfg_lock);
         if (!strcmp(feature_name, "ssh-listen")) {
             nc_server_del_endpt(NULL, NC_TI_LIBSSH);
+            endpt_state_del(0, NULL, NULL, NC_TI_LIBSSH);
         } else if (!strcmp(feature_name, "tls-listen")) {
             nc_server_del_endpt(NULL, NC_TI_OPENSSL);
+            endpt_state_del(0, NULL, NULL, NC_TI_OPENSSL);
         } else if (!strcmp(feature_name, "ssh-call-home")) {
+            chm_client_del(NULL, NC_TI_LIBSSH);
+            ch_stopped_del(NULL, NC_TI_LIBSSH);
             nc_server_ch_del_client(NULL, NC_TI_LIBSSH);
+            /* call-home endpoints are not tracked per transport, forget them all */
+            endpt_state_del(1, NULL, NULL, 0);
         } else if (!strcmp(feature_name, "tls-call-home")) {
+            chm_client_del(NULL, NC_TI_OPENSSL);
+            ch_stopped_del(NULL, NC_TI_OPENSSL);
             nc_server_ch_del_client(NULL, NC_TI_OPENSSL);
+            endpt_state_del(1, NULL, NULL, 0);
         } else {
             VRB("Unknown or unsupported feature \"%s\" disabled, ignoring.", feature_name);
-            return EXIT_SUCCESS;
         }
+        pthread_mutex_unlock(&cfg_lock);
     }
 
     return EXIT_SUCCESS;
 }
 
+/* called by the call-home manager, dispatches the client, configures it first if it was stopped */
+int
+ietf_netconf_server_ch_client_start(const char *client_name)
+{
+    int rc = EXIT_SUCCESS, idx;
+    char *path;
+    struct cfg_change *changes;
+    uint32_t change_count;
+
+    pthread_mutex_lock(&cfg_lock);
+
+    idx = ch_stopped_find(client_name);
+    if (idx > -1) {
+        ch_stopped_remove(idx);
+
+        if (asprintf(&path, "/ietf-netconf-server:netconf-server/call-home/netconf-client[name='%s']//*",
+                     client_name) == -1) {
+            EMEM;
+            rc = EXIT_FAILURE;
+            goto cleanup;
+        }
+        rc = cfg_changes_get(path, &changes, &change_count);
+        free(path);
+        if (!rc) {
+            rc = module_change_apply(np2srv.sr_sess.srs, changes, change_count);
+        }
+        cfg_changes_free(changes, change_count);
+        if (rc) {
+            goto cleanup;
+        }
+    }
+
+    rc = nc_connect_ch_client_dispatch(client_name, np2srv_new_session_clb);
+
+cleanup:
+    pthread_mutex_unlock(&cfg_lock);
+    return rc;
+}
+
+/* called by the call-home manager, removes the client from libnetconf2 until started again */
+void
+ietf_netconf_server_ch_client_stop(const char *client_name, NC_TRANSPORT_IMPL ti)
+{
+    struct ch_stopped *new_stopped;
+
+    pthread_mutex_lock(&cfg_lock);
+
+    if (ch_stopped_find(client_name) > -1) {
+        goto cleanup;
+    }
+
+    new_stopped = realloc(ch_stopped, (ch_stopped_count + 1) * sizeof *ch_stopped);
+    if (!new_stopped) {
+        EMEM;
+        goto cleanup;
+    }
+    ch_stopped = new_stopped;
+    ch_stopped[ch_stopped_count].name = strdup(client_name);
+    if (!ch_stopped[ch_stopped_count].name) {
+        EMEM;
+        goto cleanup;
+    }
+    ch_stopped[ch_stopped_count].ti = ti;
+    ++ch_stopped_count;
+
+    /* libnetconf2 stops the client thread once the client is gone */
+    nc_server_ch_del_client(client_name, 0);
+    endpt_state_del(1, client_name, NULL, 0);
+
+cleanup:
+    pthread_mutex_unlock(&cfg_lock);
+}
+
 int
 ietf_netconf_server_init(const struct lys_module *module)
 {
     int rc;
+    const struct lys_module *np2_mod;
+
+    /* nothing is configured in a fresh libnetconf2 (after a restart) */
+    endpt_state_del(0, NULL, NULL, 0);
+    endpt_state_del(1, NULL, NULL, 0);
+    ch_stopped_del(NULL, 0);
+    usock_endpt_del(NULL);
 
     rc = sr_module_change_subscribe(np2srv.sr_sess.srs, "ietf-netconf-server", module_change_cb, NULL, 0,
                                     SR_SUBSCR_APPLY_ONLY | SR_SUBSCR_CTX_REUSE, &np2srv.sr_subscr);
@@ -1263,5 +1944,14 @@ ietf_netconf_server_init(const struct lys_module *module)
         }
     }
 
+    /* UNIX socket endpoints are a netopeer2 extension */
+    np2_mod = ly_ctx_get_module(np2srv.ly_ctx, "netopeer2-netconf-server", NULL);
+    if (np2_mod && np2_mod->implemented && (lys_features_state(module, "listen") == 1)) {
+        if (cfg_apply_current("/ietf-netconf-server:netconf-server/listen/endpoint[netopeer2-netconf-server:unix-socket]//*")) {
+            ERR("Failed to apply UNIX socket listen endpoints.");
+            return EXIT_FAILURE;
+        }
+    }
+
     return EXIT_SUCCESS;
 }
@@ -37,6 +37,11 @@
 #include "common.h"
 #include "operations.h"
 #include "netconf_monitoring.h"
+#include "callhome.h"
+#include "unix_socket.h"
+#include "arena.h"
+#include "sr_pool.h"
+#include "deadline.h"
 
 #include "../modules/ietf-netconf@2011-06-01.h"
 #include "../modules/ietf-netconf-monitoring.h"
@@ -44,12 +49,15 @@
 #include "../modules/nc-notifications@2008-07-14.h"
 #include "../modules/notifications@2008-07-14.h"
 #include "../modules/ietf-netconf-notifications@2012-02-06.h"
+#include "../modules/netopeer2-monitoring.h"
+#include "../modules/netopeer2-deadline.h"
 
 struct np2srv np2srv;
 struct np2srv_dslock dslock;
 pthread_rwlock_t dslock_rwl = PTHREAD_RWLOCK_INITIALIZER;
 
 static void *worker_thread(void *arg);
+static struct nc_server_reply *np2srv_op_generic(struct lyd_node *rpc, struct nc_session *ncs);
 
 /**
  * @brief Control flags for the main loop
@@ -76,9 +84,9 @@ print_version(void)
  * @brief Command line options definition for getopt()
  */
 #ifndef NDEBUG
-#   define OPTSTRING "dhv:Vc:"
+#   define OPTSTRING "a:dhv:Vc:"
 #else
-#   define OPTSTRING "dhv:V"
+#   define OPTSTRING "a:dhv:V"
 #endif
 /**
  * @brief Print command line options description
@@ -87,7 +95,9 @@ print_version(void)
 static void
 print_usage(char* progname)
 {
-    fprintf(stdout, "Usage: %s [-dhV] [-v level]\n", progname);
+    fprintf(stdout, "Usage: %s [-dhV] [-a shards] [-v level]\n", progname);
+    fprintf(stdout, " -a shards           number of worker threads accepting new sessions (default all %d),\n", NP2SRV_THREAD_COUNT);
+    fprintf(stdout, "                     the remaining workers only handle requests on established sessions\n");
     fprintf(stdout, " -d                  debug mode (do not daemonize and print\n");
     fprintf(stdout, "                     verbose messages to stderr instead of syslog)\n");
     fprintf(stdout, " -h                  display help\n");
@@ -164,7 +174,7 @@ np2srv_module_assign_clbs(const struct lys_module *mod)
     notif = 0;
     LY_TREE_DFS_BEGIN(mod->data, next, snode) {
         if (snode->nodetype & (LYS_RPC | LYS_ACTION)) {
-            nc_set_rpc_callback(snode, op_generic);
+            nc_set_rpc_callback(snode, np2srv_op_generic);
             goto dfs_nextsibling;
         } else if (snode->nodetype == LYS_NOTIF) {
             notif = 1;
@@ -237,10 +247,10 @@ free_ds(void *ptr)
 
     if (ptr) {
         s = (struct np2_sessions *)ptr;
-        if (s->srs) {
-            sr_session_stop(s->srs);
-        }
+        np2_deadline_session_del(s);
+        np2srv_sr_free(s);
         np2srv_clean_dslock(s->ncs);
+        usock_session_del(s->ncs);
         free(s);
     }
 }
@@ -517,7 +527,6 @@ static int
 connect_ds(struct nc_session *ncs)
 {
     struct np2_sessions *s;
-    int rc;
 
     if (!ncs) {
         return EXIT_FAILURE;
@@ -531,30 +540,123 @@ connect_ds(struct nc_session *ncs)
     s->ncs = ncs;
     s->ds = SR_DS_RUNNING;
     s->opts = SR_SESS_DEFAULT;
-    rc = sr_session_start_user(np2srv.sr_conn, nc_session_get_username(ncs), s->ds, s->opts, &s->srs);
-    if (rc != SR_ERR_OK) {
-        ERR("Unable to create sysrepo session for NETCONF session %d (%s; datastore %d; options %d).",
-            nc_session_get_id(ncs), sr_strerror(rc), s->ds, s->opts);
-        goto error;
+    if (np2_deadline_session_add(s)) {
+        free(s);
+        return EXIT_FAILURE;
     }
 
-    /* connect sysrepo sessions (datastore) with NETCONF session */
+    /* connect sysrepo sessions (datastore) with NETCONF session, the sysrepo session itself is leased
+     * from the pool for every RPC */
     nc_session_set_data(ncs, s);
 
     return EXIT_SUCCESS;
+}
 
-error:
-    if (s->srs) {
-        sr_session_stop(s->srs);
+/* RPC callbacks working with the sysrepo session of the NETCONF session */
+static struct nc_server_reply *
+np2srv_sr_rpc(struct nc_server_reply *(*op_clb)(struct lyd_node *, struct nc_session *), struct lyd_node *rpc,
+              struct nc_session *ncs)
+{
+    struct nc_server_reply *reply;
+    struct np2_sessions *sessions;
+
+    sessions = (struct np2_sessions *)nc_session_get_data(ncs);
+
+    /* the operation selects the sessions it needs and aborts itself when its deadline passes */
+    np2_deadline_start(sessions, rpc);
+    reply = op_clb(rpc, ncs);
+    np2_deadline_stop();
+
+    np2srv_sr_release(sessions);
+    return reply;
+}
+
+static struct nc_server_reply *
+np2srv_op_get(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_get, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_editconfig, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_copyconfig, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_deleteconfig(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_deleteconfig, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_lock(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_lock, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_unlock(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_unlock, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_commit(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_commit, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_discardchanges(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_discardchanges, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_validate(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_validate, rpc, ncs);
+}
+
+static struct nc_server_reply *
+np2srv_op_generic(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    return np2srv_sr_rpc(op_generic, rpc, ncs);
+}
+
+/* sessions of the transports ietf-netconf-monitoring can describe, SSH, TLS and UNIX socket (netopeer2-netconf-server) */
+static int
+np2srv_session_monitored(struct nc_session *ncs)
+{
+    switch (nc_session_get_ti(ncs)) {
+#ifdef NC_ENABLED_SSH
+    case NC_TI_LIBSSH:
+#endif
+#ifdef NC_ENABLED_TLS
+    case NC_TI_OPENSSL:
+#endif
+#if defined(NC_ENABLED_SSH) || defined(NC_ENABLED_TLS)
+        return 1;
+#endif
+    default:
+        break;
     }
-    free(s);
-    return EXIT_FAILURE;
+
+    return (((struct np2_sessions *)nc_session_get_data(ncs))->flags & NP2S_UNIX_SOCKET) ? 1 : 0;
 }
 
 void
-np2srv_new_session_clb(const char *UNUSED(client_name), struct nc_session *new_session)
+np2srv_new_session_clb(const char *client_name, struct nc_session *new_session)
 {
     int c, monitored;
+    struct np2_sessions *sessions;
     sr_val_t *event_data;
     const struct lys_module *mod;
     char *host;
@@ -563,27 +665,22 @@ np2srv_new_session_clb(const char *UNUSED(client_name), struct nc_session *new_s
         /* error */
         ERR("Terminating session %d due to failure when connecting to sysrepo.",
             nc_session_get_id(new_session));
+        usock_session_del(new_session);
         nc_session_free(new_session, free_ds);
         return;
     }
 
-    switch (nc_session_get_ti(new_session)) {
-#ifdef NC_ENABLED_SSH
-    case NC_TI_LIBSSH:
-#endif
-#ifdef NC_ENABLED_TLS
-    case NC_TI_OPENSSL:
-#endif
-#if defined(NC_ENABLED_SSH) || defined(NC_ENABLED_TLS)
+    if (usock_session_is(new_session)) {
+        sessions = (struct np2_sessions *)nc_session_get_data(new_session);
+        sessions->flags |= NP2S_UNIX_SOCKET;
+    }
+
+    monitored = np2srv_session_monitored(new_session);
+    if (monitored) {
         ncm_session_add(new_session);
-        monitored = 1;
-        break;
-#endif
-    default:
+    } else {
         WRN("Session %d uses a transport protocol not supported by ietf-netconf-monitoring, will not be monitored.",
             nc_session_get_id(new_session));
-        monitored = 0;
-        break;
     }
 
     c = 0;
@@ -600,6 +697,11 @@ np2srv_new_session_clb(const char *UNUSED(client_name), struct nc_session *new_s
             ncm_session_del(new_session);
         }
         nc_session_free(new_session, free_ds);
+    } else if (client_name) {
+        /* Call Home session, let the manager know it succeeded */
+        sessions = (struct np2_sessions *)nc_session_get_data(new_session);
+        sessions->flags |= NP2S_CALL_HOME;
+        chm_session_new(client_name, new_session);
     }
 
     if ((mod = ly_ctx_get_module(np2srv.ly_ctx, "ietf-netconf-notifications", NULL)) && mod->implemented) {
@@ -639,25 +741,21 @@ np2srv_del_session_clb(struct nc_session *session)
     }
     nc_ps_del_session(np2srv.nc_ps, session);
 
-    switch (nc_session_get_ti(session)) {
-#ifdef NC_ENABLED_SSH
-    case NC_TI_LIBSSH:
-#endif
-#ifdef NC_ENABLED_TLS
-    case NC_TI_OPENSSL:
-#endif
-#if defined(NC_ENABLED_SSH) || defined(NC_ENABLED_TLS)
+    if (np2srv_session_monitored(session)) {
         ncm_session_del(session);
-        break;
-#endif
-    default:
-        break;
+    }
+
+    if (((struct np2_sessions *)nc_session_get_data(session))->flags & NP2S_CALL_HOME) {
+        chm_session_del(session);
     }
 
     if ((mod = ly_ctx_get_module(np2srv.ly_ctx, "ietf-netconf-notifications", NULL)) && mod->implemented) {
         /* generate ietf-netconf-notification's netconf-session-end event for sysrepo */
         host = (char*)nc_session_get_host(session);
         c = host ? 4 : 3;
+        if (nc_session_get_termreason(session) == NC_SESSION_TERM_KILLED) {
+            ++c;
+        }
         i = 0;
         event_data = calloc(c, sizeof *event_data);
         event_data[i].xpath = "/ietf-netconf-notifications:netconf-session-end/username";
@@ -678,8 +776,10 @@ np2srv_del_session_clb(struct nc_session *session)
             event_data[i++].data.enum_val = "closed";
             break;
         case NC_SESSION_TERM_KILLED:
-            /* TODO killed-by */
             event_data[i++].data.enum_val = "killed";
+            event_data[i].xpath = "/ietf-netconf-notifications:netconf-session-end/killed-by";
+            event_data[i].type = SR_UINT32_T;
+            event_data[i++].data.uint32_val = ((struct np2_sessions *)nc_session_get_data(session))->killed_by;
             break;
         case NC_SESSION_TERM_DROPPED:
             event_data[i++].data.enum_val = "dropped";
@@ -827,6 +927,18 @@ np2srv_init_schemas(int first)
         goto error;
     }
 
+    /* ... netopeer2-monitoring */
+    if (!ly_ctx_get_module(np2srv.ly_ctx, "netopeer2-monitoring", NULL) &&
+            !lys_parse_mem(np2srv.ly_ctx, (const char *)netopeer2_monitoring_yin, LYS_IN_YIN)) {
+        goto error;
+    }
+
+    /* ... netopeer2-deadline */
+    if (!ly_ctx_get_module(np2srv.ly_ctx, "netopeer2-deadline", NULL) &&
+            !lys_parse_mem(np2srv.ly_ctx, (const char *)netopeer2_deadline_yin, LYS_IN_YIN)) {
+        goto error;
+    }
+
     /* debug - list schemas
     struct lyd_node *ylib = ly_ctx_info(np2srv.ly_ctx);
     lyd_print_file(stdout, ylib, LYD_JSON, LYP_WITHSIBLINGS);
@@ -889,6 +1001,11 @@ server_init(void)
     /* init monitoring */
     ncm_init();
 
+    /* init Call Home manager */
+    if (chm_init()) {
+        goto error;
+    }
+
     /* init libnetconf2 */
     if (nc_server_init(np2srv.ly_ctx)) {
         goto error;
@@ -906,41 +1023,41 @@ server_init(void)
 
     /* set NETCONF operations callbacks */
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:get-config");
-    nc_set_rpc_callback(snode, op_get);
+    nc_set_rpc_callback(snode, np2srv_op_get);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:edit-config");
-    nc_set_rpc_callback(snode, op_editconfig);
+    nc_set_rpc_callback(snode, np2srv_op_editconfig);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:copy-config");
-    nc_set_rpc_callback(snode, op_copyconfig);
+    nc_set_rpc_callback(snode, np2srv_op_copyconfig);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:delete-config");
-    nc_set_rpc_callback(snode, op_deleteconfig);
+    nc_set_rpc_callback(snode, np2srv_op_deleteconfig);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:lock");
-    nc_set_rpc_callback(snode, op_lock);
+    nc_set_rpc_callback(snode, np2srv_op_lock);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:unlock");
-    nc_set_rpc_callback(snode, op_unlock);
+    nc_set_rpc_callback(snode, np2srv_op_unlock);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:get");
-    nc_set_rpc_callback(snode, op_get);
+    nc_set_rpc_callback(snode, np2srv_op_get);
 
     /* leave close-session RPC empty, libnetconf2 will use its callback */
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:commit");
-    nc_set_rpc_callback(snode, op_commit);
+    nc_set_rpc_callback(snode, np2srv_op_commit);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:discard-changes");
-    nc_set_rpc_callback(snode, op_discardchanges);
+    nc_set_rpc_callback(snode, np2srv_op_discardchanges);
 
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:validate");
-    nc_set_rpc_callback(snode, op_validate);
+    nc_set_rpc_callback(snode, np2srv_op_validate);
 
-    /* TODO
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:kill-session");
     nc_set_rpc_callback(snode, op_kill);
 
+    /* TODO
     snode = ly_ctx_get_node(np2srv.ly_ctx, NULL, "/ietf-netconf:cancel-commit");
     nc_set_rpc_callback(snode, op_cancel);
      */
@@ -1010,40 +1127,40 @@ worker_thread(void *arg)
             break;
         }
 
-        /* try to accept new NETCONF sessions */
-        if (nc_server_endpt_count()
+        /* try to accept new NETCONF sessions, only in the accepting workers */
+        if ((!np2srv.accept_shards || (idx < np2srv.accept_shards))
                 && (!np2srv.nc_max_sessions || (nc_ps_session_count(np2srv.nc_ps) < np2srv.nc_max_sessions))) {
-            msgtype = nc_accept(100, &ncs);
+            if (nc_server_endpt_count()) {
+                msgtype = nc_accept(100, &ncs);
+                if (msgtype == NC_MSG_HELLO) {
+                    np2srv_new_session_clb(NULL, ncs);
+                }
+            }
+
+            /* UNIX socket endpoints are not in libnetconf2 */
+            msgtype = usock_accept(&ncs);
             if (msgtype == NC_MSG_HELLO) {
                 np2srv_new_session_clb(NULL, ncs);
+            } else if (msgtype == NC_MSG_BAD_HELLO) {
+                ncm_bad_hello();
             }
         }
 
         /* listen for incoming requests on active NETCONF sessions */
         rc = nc_ps_poll(np2srv.nc_ps, 100, &ncs);
 
+        /* the reply was already sent, release the temporary memory of the RPC */
+        np2_arena_reset();
+
         if (rc & (NC_PSPOLL_NOSESSIONS | NC_PSPOLL_TIMEOUT)) {
             /* if there is no active session or timeout, rest for a while */
             pthread_rwlock_unlock(&np2srv.ly_ctx_lock);
+            np2srv_sr_hibernate();
             usleep(2000);
             continue;
         }
 
-        switch (nc_session_get_ti(ncs)) {
-#ifdef NC_ENABLED_SSH
-        case NC_TI_LIBSSH:
-#endif
-#ifdef NC_ENABLED_TLS
-        case NC_TI_OPENSSL:
-#endif
-#if defined(NC_ENABLED_SSH) || defined(NC_ENABLED_TLS)
-            monitored = 1;
-            break;
-#endif
-        default:
-            monitored = 0;
-            break;
-        }
+        monitored = np2srv_session_monitored(ncs);
 
         /* process the result of nc_ps_poll(), increase counters */
         if (rc & NC_PSPOLL_BAD_RPC) {
@@ -1111,6 +1228,14 @@ main(int argc, char *argv[])
     /* process command line options */
     while ((c = getopt(argc, argv, OPTSTRING)) != -1) {
         switch (c) {
+        case 'a':
+            c = atoi(optarg);
+            if ((c < 1) || (c > NP2SRV_THREAD_COUNT)) {
+                ERR("Invalid number of accepting workers \"%s\" (1 - %d).", optarg, NP2SRV_THREAD_COUNT);
+                return EXIT_FAILURE;
+            }
+            np2srv.accept_shards = c;
+            break;
         case 'd':
             daemonize = 0;
             break;
@@ -1293,6 +1418,13 @@ restart:
 
 cleanup:
 
+    /* Call Home manager cleanup, it starts and stops clients using sysrepo and libnetconf2 */
+    chm_destroy();
+
+    /* NETCONF sessions return their sysrepo sessions to the pool, stop them before disconnecting */
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    np2srv_sr_pool_destroy();
+
     /* disconnect from sysrepo */
     if (np2srv.sr_subscr) {
         sr_unsubscribe(np2srv.sr_sess.srs, np2srv.sr_subscr);
@@ -1303,12 +1435,13 @@ cleanup:
     sr_disconnect(np2srv.sr_conn);
 
     /* libnetconf2 cleanup */
-    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
     nc_ps_free(np2srv.nc_ps);
     nc_server_destroy();
+    usock_destroy();
 
     /* monitoring cleanup */
     ncm_destroy();
+    np2_deadline_destroy();
 
     /* libyang cleanup */
     ly_ctx_destroy(np2srv.ly_ctx, NULL);
@@ -21,6 +21,7 @@
 #include <nc_server.h>
 
 #include "netconf_monitoring.h"
+#include "callhome.h"
 #include "common.h"
 #include "log.h"
 #include "operations.h"
@@ -34,10 +35,12 @@ struct np_session_stats {
     uint32_t out_notifications;
 };
 
+/* the index of a session is kept in its np2_sessions */
 static struct {
     struct nc_session **sessions;
     struct np_session_stats *session_stats;
     uint32_t session_count;
+    uint32_t session_size;
 
     time_t netconf_start_time;
     uint32_t in_bad_hellos;
@@ -68,14 +71,13 @@ find_session_idx(struct nc_session *session)
 {
     uint32_t i;
 
-    for (i = 0; i < stats.session_count; ++i) {
-        if (nc_session_get_id(stats.sessions[i]) == nc_session_get_id(session)) {
-            return i;
-        }
+    i = ((struct np2_sessions *)nc_session_get_data(session))->ncm_idx;
+    if ((i >= stats.session_count) || (stats.sessions[i] != session)) {
+        EINT;
+        return 0;
     }
 
-    EINT;
-    return 0;
+    return i;
 }
 
 void
@@ -126,27 +128,35 @@ void
 ncm_session_add(struct nc_session *session)
 {
     void *new;
+    uint32_t size;
 
     pthread_mutex_lock(&stats.lock);
 
     ++stats.in_sessions;
 
-    ++stats.session_count;
-    new = realloc(stats.sessions, stats.session_count * sizeof *stats.sessions);
-    if (!new) {
-        EMEM;
-        return;
-    }
-    stats.sessions = new;
-    new = realloc(stats.session_stats, stats.session_count * sizeof *stats.session_stats);
-    if (!new) {
-        EMEM;
-        return;
+    if (stats.session_count == stats.session_size) {
+        size = stats.session_size ? stats.session_size * 2 : 16;
+        new = realloc(stats.sessions, size * sizeof *stats.sessions);
+        if (!new) {
+            EMEM;
+            pthread_mutex_unlock(&stats.lock);
+            return;
+        }
+        stats.sessions = new;
+        new = realloc(stats.session_stats, size * sizeof *stats.session_stats);
+        if (!new) {
+            EMEM;
+            pthread_mutex_unlock(&stats.lock);
+            return;
+        }
+        stats.session_stats = new;
+        stats.session_size = size;
     }
-    stats.session_stats = new;
 
-    stats.sessions[stats.session_count - 1] = session;
-    memset(&stats.session_stats[stats.session_count - 1], 0, sizeof *stats.session_stats);
+    ((struct np2_sessions *)nc_session_get_data(session))->ncm_idx = stats.session_count;
+    stats.sessions[stats.session_count] = session;
+    memset(&stats.session_stats[stats.session_count], 0, sizeof *stats.session_stats);
+    ++stats.session_count;
 
     pthread_mutex_unlock(&stats.lock);
 }
@@ -168,9 +178,11 @@ ncm_session_del(struct nc_session *session)
 
     i = find_session_idx(session);
     --stats.session_count;
-    if (stats.session_count && (i < stats.session_count)) {
-        memmove(&stats.sessions[i], &stats.sessions[i + 1], (stats.session_count - i) * sizeof *stats.sessions);
-        memmove(&stats.session_stats[i], &stats.session_stats[i + 1], (stats.session_count - i) * sizeof *stats.session_stats);
+    if (i < stats.session_count) {
+        /* move here the session from the end of the list */
+        stats.sessions[i] = stats.sessions[stats.session_count];
+        stats.session_stats[i] = stats.session_stats[stats.session_count];
+        ((struct np2_sessions *)nc_session_get_data(stats.sessions[i]))->ncm_idx = i;
     }
 
     pthread_mutex_unlock(&stats.lock);
@@ -294,6 +306,10 @@ ncm_get_data(void)
                 break;
 #endif
             default: /* NC_TI_FD, NC_TI_NONE */
+                if (((struct np2_sessions *)nc_session_get_data(stats.sessions[i]))->flags & NP2S_UNIX_SOCKET) {
+                    lyd_new_leaf(list, NULL, "transport", "netopeer2-netconf-server:netconf-unix-socket");
+                    break;
+                }
                 ERR("ietf-netconf-monitoring unsupported session transport type.");
                 goto error;
             }
@@ -335,6 +351,12 @@ ncm_get_data(void)
 
     pthread_mutex_unlock(&stats.lock);
 
+    /* Call Home manager */
+    mod = ly_ctx_get_module(np2srv.ly_ctx, "netopeer2-monitoring", NULL);
+    if (mod && chm_get_data(root, mod)) {
+        goto error;
+    }
+
     if (lyd_validate(&root, LYD_OPT_NOSIBLINGS, NULL)) {
         goto error;
     }
@@ -18,6 +18,7 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
 
 struct nc_server_reply *
 op_commit(struct lyd_node *UNUSED(rpc), struct nc_session *ncs)
@@ -28,10 +29,8 @@ op_commit(struct lyd_node *UNUSED(rpc), struct nc_session *ncs)
     /* get sysrepo connections for this session */
     sessions = (struct np2_sessions *)nc_session_get_data(ncs);
 
-    if (sessions->ds != SR_DS_CANDIDATE) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, SR_DS_CANDIDATE);
-        sessions->ds = SR_DS_CANDIDATE;
+    if (np2srv_sr_select_edit(sessions, SR_DS_CANDIDATE)) {
+        return op_build_err_sr_session();
     }
 
     rc = sr_commit(sessions->srs);
@@ -39,7 +38,6 @@ op_commit(struct lyd_node *UNUSED(rpc), struct nc_session *ncs)
         /* get the error */
         return op_build_err_sr(NULL, sessions->srs);
     }
-
     /* remove modify flag */
     sessions->flags &= ~NP2S_CAND_CHANGED;
 
@@ -55,10 +53,8 @@ op_discardchanges(struct lyd_node *UNUSED(rpc), struct nc_session *ncs)
     /* get sysrepo connections for this session */
     sessions = (struct np2_sessions *)nc_session_get_data(ncs);
 
-    if (sessions->ds != SR_DS_CANDIDATE) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, SR_DS_CANDIDATE);
-        sessions->ds = SR_DS_CANDIDATE;
+    if (np2srv_sr_select_edit(sessions, SR_DS_CANDIDATE)) {
+        return op_build_err_sr_session();
     }
 
     rc = sr_discard_changes(sessions->srs);
@@ -27,6 +27,22 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
+#include "deadline.h"
+
+/* drop the changes of a failed copy, in candidate they are all the changes of the session */
+static void
+op_copyconfig_discard(struct np2_sessions *sessions, int changed)
+{
+    if (!changed) {
+        return;
+    }
+
+    sr_discard_changes(sessions->srs);
+    if (sessions->ds == SR_DS_CANDIDATE) {
+        sessions->flags &= ~NP2S_CAND_CHANGED;
+    }
+}
 
 struct nc_server_reply *
 op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
@@ -40,7 +56,8 @@ op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
     char *str, path[1024];
     sr_val_t value;
     struct nc_server_error *e = NULL;
-    int rc = SR_ERR_OK, path_index = 0, missing_keys = 0, lastkey = 0;
+    struct nc_server_reply *ereply;
+    int rc = SR_ERR_OK, path_index = 0, missing_keys = 0, lastkey = 0, changed = 0;
     unsigned int i;
 
     /* get sysrepo connections for this session */
@@ -60,14 +77,12 @@ op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
     }
     /* TODO URL capability */
 
-    if (sessions->ds != target) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, target);
-        sessions->ds = target;
+    if (np2srv_sr_select_edit(sessions, target)) {
+        return op_build_err_sr_session();
     }
     if (sessions->ds != SR_DS_CANDIDATE) {
         /* update data from sysrepo */
-        if (sr_session_refresh(sessions->srs) != SR_ERR_OK) {
+        if (np2srv_sr_refresh(sessions) != SR_ERR_OK) {
             goto srerror;
         }
     }
@@ -123,6 +138,7 @@ op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
         LY_TREE_FOR(config, iter) {
             ly_set_add(nodeset, iter->schema->module, 0);
         }
+        changed = 1;
         for (i = 0; i < nodeset->number; i++) {
             snprintf(path, 1024, "/%s:*", ((struct lys_module *)nodeset->set.g[i])->name);
             sr_delete_item(sessions->srs, path, 0);
@@ -131,6 +147,11 @@ op_copyconfig(struct lyd_node *rpc, struct nc_session *ncs)
 
         /* and copy <config>'s content into sysrepo */
         LY_TREE_DFS_BEGIN(config, next, iter) {
+            if (np2_deadline_check()) {
+                /* aborted, the changes made so far are dropped */
+                goto error;
+            }
+
             /* maintain path */
             if (!missing_keys) {
                 if (!iter->parent || lyd_node_module(iter) != lyd_node_module(iter->parent)) {
@@ -284,16 +305,20 @@ srerror:
 
         /* handle error */
         if (!e) {
-            return op_build_err_sr(NULL, sessions->srs);
+            ereply = op_build_err_sr(NULL, sessions->srs);
         } else {
-            return nc_server_reply_err(e);
+            ereply = nc_server_reply_err(e);
         }
+
+        /* rollback, the session must not keep the operation half-done */
+        op_copyconfig_discard(sessions, changed);
+        return ereply;
     }
 
     if (sessions->ds == SR_DS_CANDIDATE) {
         if (sr_validate(sessions->srs) != SR_ERR_OK) {
             /* content is not valid, rollback */
-            sr_discard_changes(sessions->srs);
+            changed = 1;
             goto srerror;
         }
         /* mark candidate as modified */
@@ -307,6 +332,7 @@ srerror:
 
 error:
     lyd_free_withsiblings(config);
+    op_copyconfig_discard(sessions, changed);
     e = nc_err(NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
     nc_err_set_msg(e, np2log_lasterr(), "en");
     return nc_server_reply_err(e);
@@ -20,6 +20,7 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
 
 struct nc_server_reply *
 op_deleteconfig(struct lyd_node *rpc, struct nc_session *ncs)
@@ -48,14 +49,12 @@ op_deleteconfig(struct lyd_node *rpc, struct nc_session *ncs)
     }
     /* TODO URL capability */
 
-    if (sessions->ds != target) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, target);
-        sessions->ds = target;
+    if (np2srv_sr_select_edit(sessions, target)) {
+        return op_build_err_sr_session();
     }
 
     /* update data from sysrepo */
-    if (sr_session_refresh(sessions->srs) != SR_ERR_OK) {
+    if (np2srv_sr_refresh(sessions) != SR_ERR_OK) {
         goto error;
     }
 
@@ -27,6 +27,9 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
+#include "arena.h"
+#include "deadline.h"
 
 static enum NP2_EDIT_OP
 edit_get_op(struct lyd_node *node, enum NP2_EDIT_OP parentop, enum NP2_EDIT_DEFOP defop)
@@ -99,9 +102,8 @@ edit_get_move(struct lyd_node *node, const char *path, sr_move_position_t *pos,
                     *pos = SR_MOVE_AFTER;
                 }
             } else if (!strcmp(attr_iter->name, name)) {
-                if (asprintf(rel, format, path, attr_iter->value_str) < 0) {
-                    ERR("%s: memory allocation failed (%s) - %s:%d",
-                        __func__, strerror(errno), __FILE__, __LINE__);
+                *rel = np2_arena_printf(format, path, attr_iter->value_str);
+                if (!*rel) {
                     return EXIT_FAILURE;
                 }
             }
@@ -172,16 +174,16 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
     const char *cstr;
     enum NP2_EDIT_OP *op = NULL, *op_new;
     uint16_t *path_levels = NULL, *path_levels_new;
+    char *path_new;
     uint16_t path_levels_index, path_levels_size = 0;
     int op_index, op_size, path_index = 0, missing_keys = 0, lastkey = 0, np_cont;
     int ret, path_len, new_len;
     struct lyd_node_anydata *any;
 
-    /* init */
+    /* init, the temporary buffers are in the RPC arena */
     path_len = 128;
-    path = malloc(path_len);
+    path = np2_arena_alloc(path_len);
     if (!path) {
-        EMEM;
         goto internalerror;
     }
     path[path_index] = '\0';
@@ -204,10 +206,8 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
         ds = SR_DS_CANDIDATE;
     }
     /* edit-config on startup is not allowed by RFC 6241 */
-    if (ds != sessions->ds) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, ds);
-        sessions->ds = ds;
+    if (np2srv_sr_select_edit(sessions, ds)) {
+        return op_build_err_sr_session();
     }
 
     /* default-operation */
@@ -278,11 +278,9 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
         }
         ly_set_free(nodeset);
         if (ly_errno) {
-            free(path);
             return nc_server_reply_err(nc_err_libyang());
         } else if (!config) {
             /* nothing to do */
-            free(path);
             return nc_server_reply_ok();
         }
     } else {
@@ -299,9 +297,8 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
 
     if (sessions->ds != SR_DS_CANDIDATE) {
         /* update data from sysrepo */
-        if (sr_session_refresh(sessions->srs) != SR_ERR_OK) {
+        if (np2srv_sr_refresh(sessions) != SR_ERR_OK) {
             ereply = op_build_err_sr(ereply, sessions->srs);
-            free(path);
             return ereply;
         }
     }
@@ -311,52 +308,66 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
      */
     valbuf = NULL;
     path_levels_size = op_size = 16;
-    op = malloc(op_size * sizeof *op);
+    op = np2_arena_alloc(op_size * sizeof *op);
+    path_levels = np2_arena_alloc(path_levels_size * sizeof *path_levels);
+    if (!op || !path_levels) {
+        goto internalerror;
+    }
     op[0] = NP2_EDIT_NONE;
     op_index = 0;
-    path_levels = malloc(path_levels_size * sizeof *path_levels);
     path_levels_index = 0;
     LY_TREE_DFS_BEGIN(config, next, iter) {
+        /* aborted, the changes made so far are rolled back */
+        if (np2_deadline_check()) {
+            goto internalerror;
+        }
 
         /* maintain list of operations */
         if (!missing_keys) {
             op_index++;
             if (op_index == op_size) {
-                op_size += 16;
-                op_new = realloc(op, op_size * sizeof *op);
+                op_new = np2_arena_realloc(op, op_size * sizeof *op, (op_size + 16) * sizeof *op);
                 if (!op_new) {
-                    EMEM;
                     goto internalerror;
                 }
                 op = op_new;
+                op_size += 16;
             }
             op[op_index] = edit_get_op(iter, op[op_index - 1], defop);
 
             /* maintain path */
             if (path_levels_index == path_levels_size) {
-                path_levels_size += 16;
-                path_levels_new = realloc(path_levels, path_levels_size * sizeof *path_levels);
+                path_levels_new = np2_arena_realloc(path_levels, path_levels_size * sizeof *path_levels,
+                                                    (path_levels_size + 16) * sizeof *path_levels);
                 if (!path_levels_new) {
-                    EMEM;
                     goto internalerror;
                 }
                 path_levels = path_levels_new;
+                path_levels_size += 16;
             }
             path_levels[path_levels_index++] = path_index;
             if (!iter->parent || lyd_node_module(iter) != lyd_node_module(iter->parent)) {
                 /* with prefix */
                 new_len = path_index + 1 + strlen(lyd_node_module(iter)->name) + 1 + strlen(iter->schema->name) + 1;
                 if (new_len > path_len) {
+                    path_new = np2_arena_realloc(path, path_len, new_len);
+                    if (!path_new) {
+                        goto internalerror;
+                    }
+                    path = path_new;
                     path_len = new_len;
-                    path = realloc(path, new_len);
                 }
                 path_index += sprintf(&path[path_index], "/%s:%s", lyd_node_module(iter)->name, iter->schema->name);
             } else {
                 /* without prefix */
                 new_len = path_index + 1 + strlen(iter->schema->name) + 1;
                 if (new_len > path_len) {
+                    path_new = np2_arena_realloc(path, path_len, new_len);
+                    if (!path_new) {
+                        goto internalerror;
+                    }
+                    path = path_new;
                     path_len = new_len;
-                    path = realloc(path, new_len);
                 }
                 path_index += sprintf(&path[path_index], "/%s", iter->schema->name);
             }
@@ -391,8 +402,12 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
                 new_len = path_index + 1 + strlen(iter->schema->name) + 2
                           + strlen(((struct lyd_node_leaf_list *)iter)->value_str) + 3;
                 if (new_len > path_len) {
+                    path_new = np2_arena_realloc(path, path_len, new_len);
+                    if (!path_new) {
+                        goto internalerror;
+                    }
+                    path = path_new;
                     path_len = new_len;
-                    path = realloc(path, new_len);
                 }
 
                 if (strchr(((struct lyd_node_leaf_list *)iter)->value_str, '\'')) {
@@ -429,8 +444,12 @@ op_editconfig(struct lyd_node *rpc, struct nc_session *ncs)
             /* in leaf-list, the value is also the key, so add it into the path */
             new_len = path_index + 4 + strlen(((struct lyd_node_leaf_list *)iter)->value_str) + 3;
             if (new_len > path_len) {
+                path_new = np2_arena_realloc(path, path_len, new_len);
+                if (!path_new) {
+                    goto internalerror;
+                }
+                path = path_new;
                 path_len = new_len;
-                path = realloc(path, new_len);
             }
             if (strchr(((struct lyd_node_leaf_list *)iter)->value_str, '\'')) {
                 quot = '\"';
@@ -564,7 +583,6 @@ resultcheck:
         /* move user-ordered list/leaflist */
         if (pos != SR_MOVE_LAST) {
             ret = sr_move_item(sessions->srs, path, pos, rel);
-            free(rel);
             pos = SR_MOVE_LAST;
             goto resultcheck;
         }
@@ -630,12 +648,6 @@ dfs_parent:
 
 cleanup:
     /* cleanup */
-    free(path);
-    path = NULL;
-    free(op);
-    op = NULL;
-    free(path_levels);
-    path_levels = NULL;
     lyd_free_withsiblings(config);
     config = NULL;
 
@@ -694,9 +706,6 @@ internalerror:
     DBG("EDIT_CONFIG: fatal error, rolling back.");
     sr_discard_changes(sessions->srs);
 
-    free(path);
-    free(op);
-    free(path_levels);
     lyd_free_withsiblings(config);
     return ereply;
 }
@@ -27,52 +27,93 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
+#include "deadline.h"
 
 static int
-build_rpc_act_from_output(struct lyd_node *rpc_act, sr_val_t *output, size_t out_count)
+build_srnode(struct lyd_node *node, sr_node_t *srnode)
 {
-    struct lyd_node *node, *iter;
-    uint32_t i;
-    char buf[21];
-
-    for (i = 0; i < out_count; ++i) {
-        ly_errno = LY_SUCCESS;
-        node = lyd_new_path(rpc_act, np2srv.ly_ctx, output[i].xpath, op_get_srval(np2srv.ly_ctx, &output[i], buf),
-                            0, LYD_PATH_OPT_UPDATE | LYD_PATH_OPT_OUTPUT);
-        if (ly_errno) {
+    struct lyd_node *child;
+    sr_node_t *srchild;
+    const struct lys_module *mod;
+
+    if (np2_deadline_check() || op_set_srnode(node, srnode)) {
+        return -1;
+    }
+
+    if (node->schema->nodetype & (LYS_CONTAINER | LYS_LIST)) {
+        LY_TREE_FOR(node->child, child) {
+            /* sysrepo wants the module name only where it changes */
+            mod = lyd_node_module(child);
+            if (sr_node_add_child(srnode, child->schema->name, (mod != lyd_node_module(node)) ? mod->name : NULL,
+                                  &srchild) != SR_ERR_OK) {
+                EMEM;
+                return -1;
+            }
+            if (build_srnode(child, srchild)) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int
+build_input_trees(struct lyd_node *rpc_act, sr_node_t **input, size_t *in_count)
+{
+    struct lyd_node *child;
+    size_t count = 0, i;
+
+    LY_TREE_FOR(rpc_act->child, child) {
+        ++count;
+    }
+    if (!count) {
+        return 0;
+    }
+
+    if (sr_new_trees(count, input) != SR_ERR_OK) {
+        EMEM;
+        return -1;
+    }
+    *in_count = count;
+
+    i = 0;
+    LY_TREE_FOR(rpc_act->child, child) {
+        if ((sr_node_set_name(&(*input)[i], child->schema->name) != SR_ERR_OK)
+                || (sr_node_set_module(&(*input)[i], lyd_node_module(child)->name) != SR_ERR_OK)) {
+            EMEM;
+            return -1;
+        }
+        if (build_srnode(child, &(*input)[i])) {
             return -1;
         }
+        ++i;
+    }
 
-        if (node) {
-            /* propagate default flag */
-            if (output[i].dflt) {
-                /* go down */
-                for (iter = node;
-                     !(iter->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) && iter->child;
-                     iter = iter->child);
-                /* go up, back to the node */
-                for (; ; iter = iter->parent) {
-                    if (iter->schema->nodetype == LYS_CONTAINER && ((struct lys_node_container *)iter->schema)->presence) {
-                        /* presence container */
-                        break;
-                    } else if (iter->schema->nodetype == LYS_LIST && ((struct lys_node_list *)iter->schema)->keys_size) {
-                        /* list with keys */
-                        break;
-                    }
-                    iter->dflt = 1;
-                    if (iter == node) {
-                        /* done */
-                        break;
-                    }
-                }
-            } else { /* non default node, propagate it to the parents */
-                for (iter = node->parent; iter && iter->dflt; iter = iter->parent) {
-                    iter->dflt = 0;
-                }
-            }
+    return 0;
+}
+
+static int
+build_rpc_act_from_output(struct lyd_node *rpc_act, struct lyd_node *reply, sr_node_t *output, size_t out_count)
+{
+    const struct lys_node *soutput = NULL;
+
+    /* output trees are children of the output node, not of the RPC/action itself */
+    while ((soutput = lys_getnext(soutput, rpc_act->schema, NULL, LYS_GETNEXT_WITHINOUT))) {
+        if (soutput->nodetype == LYS_OUTPUT) {
+            break;
         }
     }
-    if (lyd_validate(&rpc_act, LYD_OPT_RPCREPLY, NULL)) {
+    if (!soutput) {
+        EINT;
+        return -1;
+    }
+
+    if (op_build_from_srtrees(rpc_act, soutput, output, out_count, 1)) {
+        return -1;
+    }
+    if (lyd_validate(&reply, LYD_OPT_RPCREPLY, NULL)) {
         return -1;
     }
 
@@ -83,14 +124,11 @@ struct nc_server_reply *
 op_generic(struct lyd_node *rpc, struct nc_session *ncs)
 {
     int rc;
-    uint32_t i;
     char *rpc_xpath;
-    sr_val_t *input = NULL, *output = NULL;
+    sr_node_t *input = NULL, *output = NULL;
     size_t in_count = 0, out_count = 0;
     struct np2_sessions *sessions;
     struct nc_server_error *e;
-    char *str;
-    struct ly_set *set = NULL, *strs = NULL;
     struct lyd_node *reply_data, *next, *act = NULL;
     NC_WD_MODE nc_wd;
 
@@ -99,74 +137,39 @@ op_generic(struct lyd_node *rpc, struct nc_session *ncs)
 
     /* perform operation on running to make notification
      * for the sysrepo's subscriber implementing the RPC */
-    if (sessions->ds != SR_DS_RUNNING) {
-        sr_session_switch_ds(sessions->srs, SR_DS_RUNNING);
-        sessions->ds = SR_DS_RUNNING;
+    if (np2srv_sr_select(sessions, SR_DS_RUNNING, 0)) {
+        return op_build_err_sr_session();
     }
 
     if (rpc->schema->nodetype != LYS_RPC) {
-        /* action */
-        act = lyd_dup(rpc, 1);
-        if (!act) {
-            EINT;
-            goto error;
-        }
-
-        LY_TREE_DFS_BEGIN(act, next, rpc) {
-            if (rpc->schema->nodetype == LYS_ACTION) {
+        /* action, find it in the data tree */
+        LY_TREE_DFS_BEGIN(rpc, next, act) {
+            if (act->schema->nodetype == LYS_ACTION) {
                 break;
             }
-            LY_TREE_DFS_END(act, next, rpc);
+            LY_TREE_DFS_END(rpc, next, act);
         }
-        if (!rpc) {
+        if (!act) {
             EINT;
             goto error;
         }
+        rpc = act;
     }
 
     /* process input into sysrepo format */
-    set = lyd_find_xpath(rpc, ".//*");
-    in_count = set->number;
-    if (in_count) {
-        input = calloc(in_count, sizeof *input);
-        strs = ly_set_new();
-        if (!input || !strs) {
-            EMEM;
-            goto error;
-        }
-        for (i = 0; i < in_count; ++i) {
-            if (op_set_srval(set->set.d[i], lyd_path(set->set.d[i]), 0, &input[i], &str)) {
-                goto error;
-            }
-            if (str) {
-                /* keep pointer to additional memory needed for input[i] */
-                ly_set_add(strs, str, LY_SET_OPT_USEASLIST);
-            }
-        }
+    if (build_input_trees(rpc, &input, &in_count)) {
+        goto error;
     }
-    ly_set_free(set);
-    set = NULL;
 
     rpc_xpath = lyd_path(rpc);
 
-    if (!act) {
-        rc = sr_rpc_send(sessions->srs, rpc_xpath, input, in_count, &output, &out_count);
+    if (rpc->schema->nodetype == LYS_RPC) {
+        rc = sr_rpc_send_tree(sessions->srs, rpc_xpath, input, in_count, &output, &out_count);
     } else {
-        rc = sr_action_send(sessions->srs, rpc_xpath, input, in_count, &output, &out_count);
+        rc = sr_action_send_tree(sessions->srs, rpc_xpath, input, in_count, &output, &out_count);
     }
     free(rpc_xpath);
-    /* free the additional memory chunks used in input[] */
-    if (strs) {
-        for (i = 0; i < strs->number; i++) {
-            free(strs->set.g[i]);
-        }
-        ly_set_free(strs);
-        strs = NULL;
-    }
-    for (i = 0; i < in_count; ++i) {
-        free(input[i].xpath);
-    }
-    free(input);
+    sr_free_trees(input, in_count);
     input = NULL;
     in_count = 0;
 
@@ -177,26 +180,38 @@ op_generic(struct lyd_node *rpc, struct nc_session *ncs)
         goto srerror;
     }
 
+    /* the provider cannot be interrupted, but its output need not be processed anymore */
+    if (np2_deadline_check()) {
+        sr_free_trees(output, out_count);
+        goto error;
+    }
+
     if (out_count) {
-        if (!act) {
-            reply_data = lyd_dup(rpc, 0);
-            rc = build_rpc_act_from_output(reply_data, output, out_count);
-        } else {
-            lyd_free_withsiblings(rpc->child);
-            rc = build_rpc_act_from_output(rpc, output, out_count);
-            reply_data = act;
+        /* the input is not part of the reply, only the RPC/action node (with its parents) */
+        reply_data = act = lyd_dup(rpc, 0);
+        if (!reply_data) {
+            EMEM;
+            sr_free_trees(output, out_count);
+            goto error;
         }
-
-        sr_free_values(output, out_count);
+        if (rpc->schema->nodetype != LYS_RPC) {
+            rc = op_dup_parents(rpc, &reply_data);
+        }
+        if (!rc) {
+            rc = build_rpc_act_from_output(act, reply_data, output, out_count);
+        }
+        sr_free_trees(output, out_count);
         if (rc) {
             lyd_free(reply_data);
+            if (np2_deadline_check()) {
+                goto error;
+            }
             goto srerror;
         }
 
         nc_server_get_capab_withdefaults(&nc_wd, NULL);
         return nc_server_reply_data(reply_data, nc_wd, NC_PARAMTYPE_FREE);
     } else {
-        lyd_free(act);
         return nc_server_reply_ok();
     }
 
@@ -207,18 +222,7 @@ error:
     e = nc_err(NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
     nc_err_set_msg(e, np2log_lasterr(), "en");
 
-    ly_set_free(set);
-    if (strs) {
-        for (i = 0; i < strs->number; i++) {
-            free(strs->set.g[i]);
-        }
-        ly_set_free(strs);
-    }
-    for (i = 0; i < in_count; ++i) {
-        free(input[i].xpath);
-    }
-    free(input);
-    sr_free_values(output, out_count);
+    sr_free_trees(input, in_count);
 
     return nc_server_reply_err(e);
 }
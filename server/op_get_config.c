@@ -27,6 +27,8 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
+#include "deadline.h"
 #include "netconf_monitoring.h"
 
 /* add whole subtree */
@@ -58,6 +60,12 @@ opget_build_subtree_from_sysrepo(sr_session_ctx_t *ds, struct lyd_node **root, c
 
     ly_errno = LY_SUCCESS;
     while (sr_get_item_next(ds, sriter, &value) == SR_ERR_OK) {
+        if (np2_deadline_check()) {
+            sr_free_val(value);
+            sr_free_val_iter(sriter);
+            return -1;
+        }
+
         ly_errno = LY_SUCCESS;
         node = lyd_new_path(*root, np2srv.ly_ctx, value->xpath,
                             op_get_srval(np2srv.ly_ctx, value, buf), 0, LYD_PATH_OPT_UPDATE);
@@ -148,14 +156,8 @@ op_get(struct lyd_node *rpc, struct nc_session *ncs)
 
         ly_set_free(nodeset);
     }
-    if (ds != sessions->ds || (sessions->opts & SR_SESS_CONFIG_ONLY) != config_only) {
-        /* update sysrepo session datastore */
-        sr_session_switch_ds(sessions->srs, ds);
-        sessions->ds = ds;
-
-        /* update sysrepo session config */
-        sr_session_set_options(sessions->srs, config_only);
-        sessions->opts = config_only;
+    if (np2srv_sr_select(sessions, ds, config_only)) {
+        return op_build_err_sr_session();
     }
 
     /* create filters */
@@ -209,22 +211,19 @@ op_get(struct lyd_node *rpc, struct nc_session *ncs)
     ly_set_free(nodeset);
 
 
-    if (sessions->ds != SR_DS_CANDIDATE) {
-        /* refresh sysrepo data */
-        if (sr_session_refresh(sessions->srs) != SR_ERR_OK) {
-            goto srerror;
-        }
-    } else if (!(sessions->flags & NP2S_CAND_CHANGED)) {
-        /* update candidate to be the same as running */
-        if (sr_session_refresh(sessions->srs)) {
-            goto srerror;
-        }
+    /* refresh sysrepo data, unchanged candidate is updated to be the same as running */
+    if (np2srv_sr_refresh(sessions) != SR_ERR_OK) {
+        goto srerror;
     }
 
     /*
      * create the data tree for the data reply
      */
     for (i = 0; (signed)i < filter_count; i++) {
+        if (np2_deadline_check()) {
+            goto error;
+        }
+
         /* special case, we have this data locally */
         if (!strncmp(filters[i], "/ietf-yang-library:", 19)) {
             if (config_only) {
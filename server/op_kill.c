@@ -0,0 +1,55 @@
+/**
+ * @file op_kill.c
+ * @brief NETCONF <kill-session> operation implementation
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "operations.h"
+#include "deadline.h"
+
+struct nc_server_reply *
+op_kill(struct lyd_node *rpc, struct nc_session *ncs)
+{
+    struct ly_set *nodeset;
+    struct nc_server_error *e;
+    uint32_t sid;
+
+    nodeset = lyd_find_xpath(rpc, "/ietf-netconf:kill-session/session-id");
+    sid = ((struct lyd_node_leaf_list *)nodeset->set.d[0])->value.uint32;
+    ly_set_free(nodeset);
+
+    if (sid == nc_session_get_id(ncs)) {
+        /* RFC 6241 7.9, use close-session instead */
+        ERR("Session %u cannot kill itself.", sid);
+        goto error;
+    }
+
+    /* the session is terminated and its RPC in progress aborted, its locks are released when it is freed */
+    if (np2_deadline_session_kill(sid, nc_session_get_id(ncs))) {
+        ERR("Session %u to kill does not exist.", sid);
+        goto error;
+    }
+
+    VRB("Session %u killed by session %u.", sid, nc_session_get_id(ncs));
+    return nc_server_reply_ok();
+
+error:
+    e = nc_err(NC_ERR_INVALID_VALUE, NC_ERR_TYPE_PROT);
+    nc_err_set_path(e, "/ietf-netconf:kill-session/session-id");
+    nc_err_set_msg(e, np2log_lasterr(), "en");
+    return nc_server_reply_err(e);
+}
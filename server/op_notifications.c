@@ -29,7 +29,7 @@
 #include "common.h"
 #include "operations.h"
 
-uint16_t sr_subsc_count;
+uint32_t sr_subsc_count;
 
 struct subscriber_s {
     struct nc_session *session;
@@ -39,14 +39,16 @@ struct subscriber_s {
     char **filters;
     int filter_count;
     struct nc_server_notif **replay_notifs;
-    uint16_t replay_notif_count;
-    uint16_t replay_complete_count;
-    uint16_t notif_complete_count;
+    uint32_t replay_notif_size;
+    uint32_t replay_notif_count;
+    uint32_t replay_complete_count;
+    uint32_t notif_complete_count;
 };
 
+/* the index of a subscriber is kept in np2_sessions of its session */
 struct {
-    uint16_t size;
-    uint16_t num;
+    uint32_t size;
+    uint32_t num;
     struct subscriber_s *list;
     pthread_mutex_t lock;
 } subscribers = {0, 0, NULL, PTHREAD_MUTEX_INITIALIZER};
@@ -54,8 +56,7 @@ struct {
 struct nc_server_reply *
 op_ntf_subscribe(struct lyd_node *rpc, struct nc_session *ncs)
 {
-    int ret, filter_count = 0;
-    uint16_t i;
+    int ret, i, filter_count = 0;
     uint32_t idx;
     time_t now = time(NULL), start = 0, stop = 0;
     const char *stream;
@@ -65,6 +66,7 @@ op_ntf_subscribe(struct lyd_node *rpc, struct nc_session *ncs)
     struct subscriber_s *new = NULL;
     struct nc_server_error *e = NULL;
     const struct lys_module *mod, *pstream;
+    struct np2_sessions *sessions;
 
     /*
      * parse RPC to get params
@@ -141,34 +143,34 @@ op_ntf_subscribe(struct lyd_node *rpc, struct nc_session *ncs)
         goto error;
     }
 
+    sessions = (struct np2_sessions *)nc_session_get_data(ncs);
+
     pthread_mutex_lock(&subscribers.lock);
 
-    /* check that the session is not in the current subscribers list */
-    for (i = 0; i < subscribers.num; i++) {
-        if (subscribers.list[i].session == ncs) {
-            /* already subscribed */
-            pthread_mutex_unlock(&subscribers.lock);
-            e = nc_err(NC_ERR_IN_USE, NC_ERR_TYPE_PROT);
-            nc_err_set_msg(e, "Already subscribed.", "en");
-            goto error;
-        }
+    /* check that the session is not in the current subscribers list, its status is set only under the lock */
+    if (nc_session_get_notif_status(ncs)) {
+        /* already subscribed */
+        pthread_mutex_unlock(&subscribers.lock);
+        e = nc_err(NC_ERR_IN_USE, NC_ERR_TYPE_PROT);
+        nc_err_set_msg(e, "Already subscribed.", "en");
+        goto error;
     }
 
     /* new subscriber, add it into the list */
     if (subscribers.num == subscribers.size) {
-        subscribers.size += 4;
-        new = realloc(subscribers.list, subscribers.size * sizeof *subscribers.list);
+        new = realloc(subscribers.list, (subscribers.size ? subscribers.size * 2 : 4) * sizeof *subscribers.list);
         if (!new) {
             /* realloc failed */
             pthread_mutex_unlock(&subscribers.lock);
             EMEM;
             e = nc_err(NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
-            subscribers.size -= 4;
             goto error;
         }
         subscribers.list = new;
+        subscribers.size = subscribers.size ? subscribers.size * 2 : 4;
     }
     new = &subscribers.list[subscribers.num];
+    sessions->ntf_idx = subscribers.num;
     subscribers.num++;
 
     /* store information about the new subscriber */
@@ -181,14 +183,15 @@ op_ntf_subscribe(struct lyd_node *rpc, struct nc_session *ncs)
     new->filter_count = filter_count;
     filter_count = 0;
     new->replay_notifs = NULL;
+    new->replay_notif_size = 0;
     new->replay_notif_count = 0;
     new->replay_complete_count = 0;
     new->notif_complete_count = 0;
 
-    pthread_mutex_unlock(&subscribers.lock);
-
     nc_session_set_notif_status(ncs, 1);
 
+    pthread_mutex_unlock(&subscribers.lock);
+
     /* subscribe for replay */
     if (start) {
         ret = sr_event_notif_replay(np2srv.sr_sess.srs, np2srv.sr_subscr, start, stop);
@@ -212,7 +215,7 @@ error:
 void
 op_ntf_unsubscribe(struct nc_session *session, int have_lock)
 {
-    unsigned int i, j;
+    uint32_t i, j;
     const struct lys_module *mod;
     struct lyd_node *event;
     struct nc_server_notif *notif;
@@ -221,13 +224,8 @@ op_ntf_unsubscribe(struct nc_session *session, int have_lock)
         pthread_mutex_lock(&subscribers.lock);
     }
 
-    for (i = 0; i < subscribers.num; i++) {
-        if (subscribers.list[i].session == session) {
-            break;
-        }
-    }
-
-    assert(i < subscribers.num);
+    i = ((struct np2_sessions *)nc_session_get_data(session))->ntf_idx;
+    assert((i < subscribers.num) && (subscribers.list[i].session == session));
 
     /* send notificationComplete */
     mod = ly_ctx_get_module(np2srv.ly_ctx, "nc-notifications", NULL);
@@ -250,6 +248,7 @@ op_ntf_unsubscribe(struct nc_session *session, int have_lock)
     if (i < subscribers.num) {
         /* move here the subscriber from the end of the list */
         memcpy(&subscribers.list[i], &subscribers.list[subscribers.num], sizeof *subscribers.list);
+        ((struct np2_sessions *)nc_session_get_data(subscribers.list[i].session))->ntf_idx = i;
     }
     nc_session_set_notif_status(session, 0);
 
@@ -281,7 +280,7 @@ op_notif_replay_send(struct subscriber_s *subscriber)
     const struct lys_module *mod;
     struct lyd_node *event;
     struct nc_server_notif *notif;
-    uint16_t i;
+    uint32_t i;
 
     assert(subscriber->replay_complete_count == sr_subsc_count);
 
@@ -297,6 +296,7 @@ op_notif_replay_send(struct subscriber_s *subscriber)
     }
     free(subscriber->replay_notifs);
 
+    subscriber->replay_notif_size = 0;
     subscriber->replay_notif_count = 0;
     subscriber->replay_notifs = NULL;
 
@@ -376,10 +376,11 @@ error:
 void
 np2srv_ntf_send(struct lyd_node *ntf, const char *UNUSED(xpath), time_t timestamp, const sr_ev_notif_type_t notif_type)
 {
-    int i, j;
+    uint32_t i, size;
+    int j;
     char *datetime;
     struct lyd_node *filtered_ntf;
-    struct nc_server_notif *ntf_msg = NULL;
+    struct nc_server_notif *ntf_msg = NULL, **replay_notifs;
 
     datetime = nc_time2datetime(timestamp, NULL, NULL);
 
@@ -451,11 +452,19 @@ np2srv_ntf_send(struct lyd_node *ntf, const char *UNUSED(xpath), time_t timestam
             nc_server_notif_send(subscribers.list[i].session, ntf_msg, 5000);
             nc_server_notif_free(ntf_msg);
         } else {
-            ++subscribers.list[i].replay_notif_count;
-            subscribers.list[i].replay_notifs =
-                realloc(subscribers.list[i].replay_notifs,
-                        subscribers.list[i].replay_notif_count * sizeof *subscribers.list[i].replay_notifs);
-            subscribers.list[i].replay_notifs[subscribers.list[i].replay_notif_count - 1] = ntf_msg;
+            if (subscribers.list[i].replay_notif_count == subscribers.list[i].replay_notif_size) {
+                /* the replay notifications are kept until the replay completes */
+                size = subscribers.list[i].replay_notif_size ? subscribers.list[i].replay_notif_size * 2 : 16;
+                replay_notifs = realloc(subscribers.list[i].replay_notifs, size * sizeof *replay_notifs);
+                if (!replay_notifs) {
+                    EMEM;
+                    nc_server_notif_free(ntf_msg);
+                    continue;
+                }
+                subscribers.list[i].replay_notifs = replay_notifs;
+                subscribers.list[i].replay_notif_size = size;
+            }
+            subscribers.list[i].replay_notifs[subscribers.list[i].replay_notif_count++] = ntf_msg;
         }
     }
 
@@ -469,13 +478,8 @@ void
 np2srv_ntf_clb(const sr_ev_notif_type_t notif_type, const char *xpath, const sr_node_t *trees, const size_t tree_cnt,
                time_t timestamp, void *UNUSED(private_ctx))
 {
-    const struct lys_node *snode;
-    struct lyd_node *ntf = NULL, *parent, *node;
-    const sr_node_t *srnode, *srnext;
-    const struct lys_module *mod = NULL;
-    size_t i;
-    const char *ntf_type_str, *module_name = NULL;
-    char numstr[21];
+    struct lyd_node *ntf = NULL;
+    const char *ntf_type_str;
 
     switch (notif_type) {
     case SR_EV_NOTIF_T_REALTIME:
@@ -507,85 +511,9 @@ np2srv_ntf_clb(const sr_ev_notif_type_t notif_type, const char *xpath, const sr_
             goto error;
         }
 
-        for (i = 0; i < tree_cnt; i++) {
-            parent = ntf;
-
-            for (srnode = srnext = &trees[i]; srnode; srnode = srnext) {
-                if(srnode->module_name) {
-                    module_name = srnode->module_name;
-                    mod = ly_ctx_get_module(np2srv.ly_ctx, module_name, NULL);
-                }
-                if (!mod) {
-                    ERR("Data from unknown module (%s%s) received in sysrepo notification \"%s\"", module_name,
-                        srnode->name, xpath);
-                    goto error;
-                } else if (!mod->implemented) {
-                    mod = lys_implemented_module(mod);
-                    if (!mod->implemented) {
-                        ERR("Non-implemented data (%s:%s) received in sysrepo notification \"%s\"", module_name,
-                            srnode->name, xpath);
-                        goto error;
-                    }
-                }
-
-                snode = NULL;
-                while ((snode = lys_getnext(snode, parent->schema, mod, 0))) {
-                    if (strcmp(srnode->name, snode->name) || strcmp(module_name, snode->module->name)) {
-                        continue;
-                    }
-                    /* match */
-                    break;
-                }
-                if (!snode) {
-                    ERR("Unknown data (%s:%s) received in sysrepo notification \"%s\"", module_name,
-                        srnode->name, xpath);
-                    goto error;
-                }
-                switch (snode->nodetype) {
-                case LYS_LEAFLIST:
-                case LYS_LEAF:
-                    node = lyd_new_leaf(parent, mod, srnode->name, op_get_srval(np2srv.ly_ctx, (sr_val_t *)srnode, numstr));
-                    break;
-                case LYS_CONTAINER:
-                case LYS_LIST:
-                    node = lyd_new(parent, mod, srnode->name);
-                    break;
-                case LYS_ANYXML:
-                case LYS_ANYDATA:
-                    node = lyd_new_anydata(parent, mod, srnode->name,
-                                        op_get_srval(np2srv.ly_ctx, (sr_val_t *)srnode, numstr), LYD_ANYDATA_SXML);
-                    break;
-                default:
-                    ERR("Invalid node type (%d) received in sysrepo notification \"%s\"", snode->nodetype, xpath);
-                    goto error;
-                }
-
-                if (!node) {
-                    ERR("Creating notification (%s) data (%d: %s:%s) failed.", xpath, snode->nodetype, module_name,
-                        srnode->name);
-                    goto error;
-                }
-
-                /* select element for the next run - children first */
-                srnext = srnode->first_child;
-                if (!srnext) {
-                    /* no children, try siblings */
-                    srnext = srnode->next;
-                } else {
-                    parent = node;
-                }
-                while (!srnext) {
-                    /* parent is already processed, go to its sibling */
-                    srnode = srnode->parent;
-
-                    if (srnode == trees->parent) {
-                        /* we are done, no next element to process */
-                        break;
-                    }
-                    srnext = srnode->next;
-                    parent = parent->parent;
-                }
-            }
+        if (op_build_from_srtrees(ntf, ntf->schema, trees, tree_cnt, 0)) {
+            ERR("Creating notification \"%s\" data failed.", xpath);
+            goto error;
         }
     }
 
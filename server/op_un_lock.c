@@ -27,6 +27,7 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
 
 struct nc_server_reply *
 op_lock(struct lyd_node *rpc, struct nc_session *ncs)
@@ -68,10 +69,8 @@ op_lock(struct lyd_node *rpc, struct nc_session *ncs)
         nc_err_set_msg(e, np2log_lasterr(), "en");
         return nc_server_reply_err(e);
     }
-    if (ds != sessions->ds) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, ds);
-        sessions->ds = ds;
+    if (np2srv_sr_select_edit(sessions, ds)) {
+        return op_build_err_sr_session();
     }
 
     pthread_rwlock_rdlock(&dslock_rwl);
@@ -160,10 +159,8 @@ op_unlock(struct lyd_node *rpc, struct nc_session *ncs)
         nc_err_set_msg(e, np2log_lasterr(), "en");
         return nc_server_reply_err(e);
     }
-    if (ds != sessions->ds) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, ds);
-        sessions->ds = ds;
+    if (np2srv_sr_select_edit(sessions, ds)) {
+        return op_build_err_sr_session();
     }
 
     pthread_rwlock_rdlock(&dslock_rwl);
@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "operations.h"
+#include "sr_pool.h"
 
 struct nc_server_reply *
 op_validate(struct lyd_node *rpc, struct nc_session *ncs)
@@ -81,14 +82,12 @@ op_validate(struct lyd_node *rpc, struct nc_session *ncs)
     }
     /* TODO support URL */
 
-    if (ds != sessions->ds) {
-        /* update sysrepo session */
-        sr_session_switch_ds(sessions->srs, ds);
-        sessions->ds = ds;
+    if (np2srv_sr_select(sessions, ds, 0)) {
+        return op_build_err_sr_session();
     }
     if (ds != SR_DS_CANDIDATE) {
         /* refresh datastore content */
-        if (sr_session_refresh(sessions->srs) != SR_ERR_OK) {
+        if (np2srv_sr_refresh(sessions) != SR_ERR_OK) {
             goto srerror;
         }
     }
@@ -20,6 +20,7 @@
 
 #include "common.h"
 #include "operations.h"
+#include "deadline.h"
 
 char *
 op_get_srval(struct ly_ctx *ctx, sr_val_t *value, char *buf)
@@ -274,6 +275,170 @@ settype:
     return 0;
 }
 
+int
+op_set_srnode(struct lyd_node *node, sr_node_t *srnode)
+{
+    sr_val_t val;
+    char *str;
+    int rc = SR_ERR_OK;
+
+    if (op_set_srval(node, NULL, 0, &val, &str)) {
+        return -1;
+    }
+
+    switch (val.type) {
+    case SR_STRING_T:
+    case SR_BINARY_T:
+    case SR_BITS_T:
+    case SR_ENUM_T:
+    case SR_IDENTITYREF_T:
+    case SR_INSTANCEID_T:
+    case SR_ANYDATA_T:
+    case SR_ANYXML_T:
+        /* strings must be copied into the node's own memory context */
+        rc = sr_node_set_str_data(srnode, val.type, val.data.string_val);
+        break;
+    default:
+        srnode->type = val.type;
+        srnode->data = val.data;
+        break;
+    }
+    srnode->dflt = node->dflt;
+
+    if (val.type == SR_BITS_T) {
+        /* bits are always built into a new string */
+        free(val.data.bits_val);
+    }
+    free(str);
+
+    if (rc != SR_ERR_OK) {
+        ERR("Setting value of node \"%s\" for sysrepo failed (%s).", node->schema->name, sr_strerror(rc));
+        return -1;
+    }
+    return 0;
+}
+
+int
+op_build_from_srtrees(struct lyd_node *parent, const struct lys_node *sparent, const sr_node_t *trees,
+                      size_t tree_cnt, int output)
+{
+    const struct lys_node *snode;
+    const struct lys_module *mod;
+    const sr_node_t *srnode, *srnext;
+    struct lyd_node *node, *lparent;
+    const char *str;
+    char numstr[32];
+    size_t i;
+
+    for (i = 0; i < tree_cnt; i++) {
+        lparent = parent;
+
+        for (srnode = srnext = &trees[i]; srnode; srnode = srnext) {
+            if (np2_deadline_check()) {
+                return -1;
+            }
+
+            if (srnode->module_name) {
+                mod = ly_ctx_get_module(np2srv.ly_ctx, srnode->module_name, NULL);
+            } else {
+                /* same module as the parent */
+                mod = lyd_node_module(lparent);
+            }
+            if (!mod) {
+                ERR("Data from unknown module (%s:%s) received from sysrepo.", srnode->module_name, srnode->name);
+                return -1;
+            } else if (!mod->implemented) {
+                mod = lys_implemented_module(mod);
+                if (!mod->implemented) {
+                    ERR("Non-implemented data (%s:%s) received from sysrepo.", mod->name, srnode->name);
+                    return -1;
+                }
+            }
+
+            snode = NULL;
+            while ((snode = lys_getnext(snode, (lparent == parent) ? sparent : lparent->schema, mod, 0))) {
+                if (strcmp(srnode->name, snode->name) || strcmp(mod->name, lys_node_module(snode)->name)) {
+                    continue;
+                }
+                /* match */
+                break;
+            }
+            if (!snode) {
+                ERR("Unknown data (%s:%s) received from sysrepo.", mod->name, srnode->name);
+                return -1;
+            }
+
+            switch (snode->nodetype) {
+            case LYS_LEAFLIST:
+            case LYS_LEAF:
+                if (srnode->type == SR_DECIMAL64_T) {
+                    /* the value has no xpath to learn fraction-digits from, but we have the schema node */
+                    sprintf(numstr, "%.*f", ((struct lys_node_leaf *)snode)->type.info.dec64.dig,
+                            srnode->data.decimal64_val);
+                    str = numstr;
+                } else {
+                    str = op_get_srval(np2srv.ly_ctx, (sr_val_t *)srnode, numstr);
+                }
+                if (output) {
+                    node = lyd_new_output_leaf(lparent, mod, srnode->name, str);
+                } else {
+                    node = lyd_new_leaf(lparent, mod, srnode->name, str);
+                }
+                break;
+            case LYS_CONTAINER:
+            case LYS_LIST:
+                if (output) {
+                    node = lyd_new_output(lparent, mod, srnode->name);
+                } else {
+                    node = lyd_new(lparent, mod, srnode->name);
+                }
+                break;
+            case LYS_ANYXML:
+            case LYS_ANYDATA:
+                str = op_get_srval(np2srv.ly_ctx, (sr_val_t *)srnode, numstr);
+                if (output) {
+                    node = lyd_new_output_anydata(lparent, mod, srnode->name, (void *)str, LYD_ANYDATA_SXML);
+                } else {
+                    node = lyd_new_anydata(lparent, mod, srnode->name, (void *)str, LYD_ANYDATA_SXML);
+                }
+                break;
+            default:
+                ERR("Invalid node type (%d) received from sysrepo.", snode->nodetype);
+                return -1;
+            }
+            if (!node) {
+                ERR("Creating data (%d: %s:%s) received from sysrepo failed.", snode->nodetype, mod->name,
+                    srnode->name);
+                return -1;
+            }
+            if (srnode->dflt && !(snode->nodetype == LYS_CONTAINER && ((struct lys_node_container *)snode)->presence)
+                    && (snode->nodetype != LYS_LIST)) {
+                node->dflt = 1;
+            }
+
+            /* select element for the next run - children first */
+            if (srnode->first_child) {
+                srnext = srnode->first_child;
+                lparent = node;
+                continue;
+            }
+            /* no children, try siblings, but never leave this top-level tree */
+            srnext = NULL;
+            while (srnode != &trees[i]) {
+                if (srnode->next) {
+                    srnext = srnode->next;
+                    break;
+                }
+                /* parent is already processed, go to its sibling */
+                srnode = srnode->parent;
+                lparent = lparent->parent;
+            }
+        }
+    }
+
+    return 0;
+}
+
 struct nc_server_reply *
 op_build_err_sr(struct nc_server_reply *ereply, sr_session_ctx_t *session)
 {
@@ -300,70 +465,103 @@ op_build_err_sr(struct nc_server_reply *ereply, sr_session_ctx_t *session)
     return ereply;
 }
 
+struct nc_server_reply *
+op_build_err_sr_session(void)
+{
+    struct nc_server_error *e;
+
+    e = nc_err(NC_ERR_RES_DENIED, NC_ERR_TYPE_APP);
+    nc_err_set_msg(e, np2log_lasterr(), "en");
+    return nc_server_reply_err(e);
+}
+
 int
-op_filter_get_tree_from_data(struct lyd_node **root, struct lyd_node *data, const char *subtree_path)
+op_dup_parents(const struct lyd_node *node, struct lyd_node **dup)
 {
-    struct ly_set *nodeset;
-    struct lyd_node *node, *node2, *key, *key2, *child, *tmp_root;
+    struct lyd_node *node2, *key, *key2, *child;
     struct lys_node_list *slist;
-    uint16_t i, j;
+    uint32_t j;
 
-    nodeset = lyd_find_xpath(data, subtree_path);
-    for (i = 0; i < nodeset->number; ++i) {
-        node = nodeset->set.d[i];
-        tmp_root = lyd_dup(node, 1);
-        if (!tmp_root) {
+    for (node = node->parent; node; node = node->parent) {
+        node2 = lyd_dup(node, 0);
+        if (!node2) {
             EMEM;
-            return -1;
+            goto error;
         }
-        for (node = node->parent; node; node = node->parent) {
-            node2 = lyd_dup(node, 0);
-            if (!node2) {
-                EMEM;
-                return -1;
-            }
-            if (lyd_insert(node2, tmp_root)) {
-                EINT;
-                lyd_free(node2);
-                return -1;
-            }
-            tmp_root = node2;
+        if (lyd_insert(node2, *dup)) {
+            EINT;
+            lyd_free(node2);
+            goto error;
+        }
+        *dup = node2;
 
-            /* we want to include all list keys in the result */
-            if (node2->schema->nodetype == LYS_LIST) {
-                slist = (struct lys_node_list *)node2->schema;
-                for (j = 0, key = node->child; j < slist->keys_size; ++j, key = key->next) {
-                    assert((struct lys_node *)slist->keys[j] == key->schema);
+        /* we want to include all list keys in the result */
+        if (node2->schema->nodetype == LYS_LIST) {
+            slist = (struct lys_node_list *)node2->schema;
+            for (j = 0, key = node->child; j < slist->keys_size; ++j, key = key->next) {
+                assert((struct lys_node *)slist->keys[j] == key->schema);
 
-                    /* was the key already duplicated? */
-                    LY_TREE_FOR(node2->child, child) {
-                        if (child->schema == (struct lys_node *)slist->keys[j]) {
-                            break;
-                        }
+                /* was the key already duplicated? */
+                LY_TREE_FOR(node2->child, child) {
+                    if (child->schema == (struct lys_node *)slist->keys[j]) {
+                        break;
                     }
+                }
 
-                    /* it wasn't */
-                    if (!child) {
-                        key2 = lyd_dup(key, 0);
-                        if (!key2) {
-                            EMEM;
-                            return -1;
-                        }
-                        if (lyd_insert(node2, key2)) {
-                            EINT;
-                            lyd_free(key2);
-                            return -1;
-                        }
+                /* it wasn't */
+                if (!child) {
+                    key2 = lyd_dup(key, 0);
+                    if (!key2) {
+                        EMEM;
+                        goto error;
+                    }
+                    if (lyd_insert(node2, key2)) {
+                        EINT;
+                        lyd_free(key2);
+                        goto error;
                     }
                 }
+            }
 
-                /* we added those keys at the end, if some existed before the order is wrong */
-                if (lyd_schema_sort(node2->child, 0)) {
-                    EINT;
-                    return -1;
-                }
+            /* we added those keys at the end, if some existed before the order is wrong */
+            if (lyd_schema_sort(node2->child, 0)) {
+                EINT;
+                goto error;
             }
         }
+    }
+
+    return 0;
+
+error:
+    lyd_free(*dup);
+    *dup = NULL;
+    return -1;
+}
+
+int
+op_filter_get_tree_from_data(struct lyd_node **root, struct lyd_node *data, const char *subtree_path)
+{
+    struct ly_set *nodeset;
+    struct lyd_node *node, *tmp_root;
+    uint32_t i;
+
+    nodeset = lyd_find_xpath(data, subtree_path);
+    for (i = 0; i < nodeset->number; ++i) {
+        if (np2_deadline_check()) {
+            ly_set_free(nodeset);
+            return -1;
+        }
+
+        node = nodeset->set.d[i];
+        tmp_root = lyd_dup(node, 1);
+        if (!tmp_root) {
+            EMEM;
+            return -1;
+        }
+        if (op_dup_parents(node, &tmp_root)) {
+            return -1;
+        }
 
         if (*root) {
             if (lyd_merge(*root, tmp_root, LYD_OPT_DESTRUCT)) {
@@ -17,7 +17,7 @@
 
 #include <nc_server.h>
 
-extern uint16_t sr_subsc_count;
+extern uint32_t sr_subsc_count;
 
 struct np2srv_dslock {
     struct nc_session *running;
@@ -77,11 +77,48 @@ char *op_get_srval(struct ly_ctx *ctx, sr_val_t *value, char *buf);
  */
 int op_set_srval(struct lyd_node *node, char *path, int dup, sr_val_t *val, char **val_buf);
 
+/**
+ * @brief Fill the value of a sysrepo tree node
+ *
+ * The node's name and module are expected to be already set. All the strings are
+ * copied into the \p srnode memory context so that the tree can be freed with sr_free_tree().
+ *
+ * @param[in] node Node from which the value is filled.
+ * @param[in,out] srnode Tree node to fill.
+ */
+int op_set_srnode(struct lyd_node *node, sr_node_t *srnode);
+
+/**
+ * @brief Build data from sysrepo trees directly, without any paths
+ *
+ * @param[in] parent Data node to create the trees in (RPC, action, notification, ...).
+ * @param[in] sparent Schema parent of the top-level trees, usually the output node of an RPC/action
+ *                 or \p parent's schema.
+ * @param[in] trees Sysrepo trees.
+ * @param[in] tree_cnt Number of \p trees.
+ * @param[in] output Flag if the data are RPC/action output.
+ */
+int op_build_from_srtrees(struct lyd_node *parent, const struct lys_node *sparent, const sr_node_t *trees,
+                          size_t tree_cnt, int output);
+
+/**
+ * @brief Put a duplicate of \p node under duplicates of all its parents (including list keys)
+ *
+ * @param[in] node Original node.
+ * @param[in,out] dup Duplicate of \p node, replaced by the new top-level node. Freed on error.
+ */
+int op_dup_parents(const struct lyd_node *node, struct lyd_node **dup);
+
 /**
  * @brief Build error reply based on errors from sysrepo
  */
 struct nc_server_reply *op_build_err_sr(struct nc_server_reply *ereply, sr_session_ctx_t *session);
 
+/**
+ * @brief Build error reply when no sysrepo session could be selected for the NETCONF session
+ */
+struct nc_server_reply *op_build_err_sr_session(void);
+
 int op_filter_get_tree_from_data(struct lyd_node **root, struct lyd_node *data, const char *subtree_path);
 int op_filter_xpath_add_filter(char *new_filter, char ***filters, int *filter_count);
 int op_filter_create(struct lyd_node *filter_node, char ***filters, int *filter_count);
@@ -96,6 +133,7 @@ struct nc_server_reply *op_commit(struct lyd_node *rpc, struct nc_session *ncs);
 struct nc_server_reply *op_discardchanges(struct lyd_node *rpc, struct nc_session *ncs);
 struct nc_server_reply *op_validate(struct lyd_node *rpc, struct nc_session *ncs);
 struct nc_server_reply *op_generic(struct lyd_node *rpc, struct nc_session *ncs);
+struct nc_server_reply *op_kill(struct lyd_node *rpc, struct nc_session *ncs);
 
 struct nc_server_reply *op_ntf_subscribe(struct lyd_node *rpc, struct nc_session *ncs);
 void op_ntf_unsubscribe(struct nc_session *session, int have_lock);
@@ -0,0 +1,288 @@
+/**
+ * @file sr_pool.c
+ * @brief Pool of sysrepo sessions leased to NETCONF sessions
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <nc_server.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "operations.h"
+#include "sr_pool.h"
+
+/* pool entry kind of the edit sessions, the read sessions use their index */
+#define NP2S_SR_EDIT (-1)
+
+struct np2srv_sr_idle {
+    char *user;
+    int kind;
+    time_t since;
+    struct np2_sr_handle handle;
+};
+
+/* idle sysrepo sessions, kept until the pool is full or they hibernate */
+static struct {
+    struct np2srv_sr_idle list[NP2SRV_SR_POOL_SIZE];
+    uint16_t count;
+    pthread_mutex_t lock;
+} sr_pool = {.count = 0, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* sysrepo sessions held by NETCONF sessions */
+static volatile uint32_t sr_held;
+
+/* time of the next check for hibernating sessions */
+static volatile time_t sr_hibernate_check;
+
+static int
+np2srv_sr_lease(struct np2_sessions *s, int kind, sr_datastore_t ds, sr_sess_options_t opts,
+                struct np2_sr_handle *handle)
+{
+    const char *user;
+    char *idle_user = NULL;
+    int i, rc;
+
+    user = s->ncs ? nc_session_get_username(s->ncs) : NULL;
+
+    pthread_mutex_lock(&sr_pool.lock);
+    for (i = 0; user && (i < sr_pool.count); ++i) {
+        if ((sr_pool.list[i].kind == kind) && !strcmp(sr_pool.list[i].user, user)) {
+            *handle = sr_pool.list[i].handle;
+            idle_user = sr_pool.list[i].user;
+            sr_pool.list[i] = sr_pool.list[--sr_pool.count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sr_pool.lock);
+
+    if (idle_user) {
+        free(idle_user);
+        __atomic_add_fetch(&sr_held, 1, __ATOMIC_RELAXED);
+        return EXIT_SUCCESS;
+    }
+
+    handle->ds = ds;
+    handle->opts = opts;
+    rc = sr_session_start_user(np2srv.sr_conn, user, ds, opts, &handle->srs);
+    if (rc != SR_ERR_OK) {
+        ERR("Unable to create sysrepo session for NETCONF session %d (%s; datastore %d; options %d).",
+            nc_session_get_id(s->ncs), sr_strerror(rc), ds, opts);
+        handle->srs = NULL;
+        return EXIT_FAILURE;
+    }
+    if (handle->srs) {
+        __atomic_add_fetch(&sr_held, 1, __ATOMIC_RELAXED);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+np2srv_sr_use(struct np2_sessions *s, int kind, sr_datastore_t ds, sr_sess_options_t opts)
+{
+    struct np2_sr_handle *handle;
+
+    handle = (kind == NP2S_SR_EDIT) ? &s->edit : &s->read[kind];
+    if (!handle->srs && np2srv_sr_lease(s, kind, ds, opts, handle)) {
+        return EXIT_FAILURE;
+    }
+
+    /* only the edit session ever switches */
+    if (handle->ds != ds) {
+        sr_session_switch_ds(handle->srs, ds);
+        handle->ds = ds;
+    }
+    if (handle->opts != opts) {
+        sr_session_set_options(handle->srs, opts);
+        handle->opts = opts;
+    }
+
+    s->handle = handle;
+    s->srs = handle->srs;
+    s->ds = ds;
+    s->opts = opts;
+    return EXIT_SUCCESS;
+}
+
+int
+np2srv_sr_select(struct np2_sessions *s, sr_datastore_t ds, sr_sess_options_t opts)
+{
+    opts &= SR_SESS_CONFIG_ONLY;
+    if (ds == SR_DS_CANDIDATE) {
+        /* candidate changes live in the edit session */
+        return np2srv_sr_use(s, NP2S_SR_EDIT, ds, opts);
+    }
+
+    return np2srv_sr_use(s, ((ds == SR_DS_RUNNING) ? 2 : 0) + (opts ? 1 : 0), ds, opts);
+}
+
+int
+np2srv_sr_select_edit(struct np2_sessions *s, sr_datastore_t ds)
+{
+    return np2srv_sr_use(s, NP2S_SR_EDIT, ds, 0);
+}
+
+int
+np2srv_sr_refresh(struct np2_sessions *s)
+{
+    if ((s->ds == SR_DS_CANDIDATE) && (s->flags & NP2S_CAND_CHANGED)) {
+        /* it no longer follows running */
+        return SR_ERR_OK;
+    }
+
+    /* sysrepo does not tell when another client committed, so never skip it */
+    return sr_session_refresh(s->srs);
+}
+
+/* the state of the NETCONF session lives in its edit session */
+static int
+np2srv_sr_has_state(struct np2_sessions *s)
+{
+    int ret;
+
+    if (s->flags & NP2S_CAND_CHANGED) {
+        return 1;
+    }
+
+    pthread_rwlock_rdlock(&dslock_rwl);
+    ret = (dslock.running == s->ncs) || (dslock.startup == s->ncs) || (dslock.candidate == s->ncs);
+    pthread_rwlock_unlock(&dslock_rwl);
+
+    return ret;
+}
+
+static void
+np2srv_sr_put(struct np2_sessions *s, int kind, struct np2_sr_handle *handle)
+{
+    char *user;
+    int pooled = 0;
+
+    if ((kind == NP2S_SR_EDIT) && (sr_discard_changes(handle->srs) != SR_ERR_OK)) {
+        /* changes of a failed RPC must never reach the next lessee, drop the session with them */
+        sr_session_stop(handle->srs);
+        memset(handle, 0, sizeof *handle);
+        __atomic_sub_fetch(&sr_held, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    user = s->ncs ? strdup(nc_session_get_username(s->ncs)) : NULL;
+
+    pthread_mutex_lock(&sr_pool.lock);
+    if (user && (sr_pool.count < NP2SRV_SR_POOL_SIZE)) {
+        sr_pool.list[sr_pool.count].user = user;
+        sr_pool.list[sr_pool.count].kind = kind;
+        sr_pool.list[sr_pool.count].since = time(NULL);
+        sr_pool.list[sr_pool.count].handle = *handle;
+        ++sr_pool.count;
+        pooled = 1;
+    }
+    pthread_mutex_unlock(&sr_pool.lock);
+
+    if (!pooled) {
+        /* the pool is full */
+        free(user);
+        sr_session_stop(handle->srs);
+    }
+    memset(handle, 0, sizeof *handle);
+    __atomic_sub_fetch(&sr_held, 1, __ATOMIC_RELAXED);
+}
+
+void
+np2srv_sr_release(struct np2_sessions *s)
+{
+    int i;
+
+    for (i = 0; i < NP2S_SR_READ_COUNT; ++i) {
+        if (s->read[i].srs) {
+            np2srv_sr_put(s, i, &s->read[i]);
+        }
+    }
+    if (s->edit.srs && !np2srv_sr_has_state(s)) {
+        np2srv_sr_put(s, NP2S_SR_EDIT, &s->edit);
+    }
+    s->srs = NULL;
+    s->handle = NULL;
+}
+
+void
+np2srv_sr_free(struct np2_sessions *s)
+{
+    if (s->edit.srs && np2srv_sr_has_state(s)) {
+        /* stopping the session releases its locks and drops its candidate */
+        sr_session_stop(s->edit.srs);
+        memset(&s->edit, 0, sizeof s->edit);
+        __atomic_sub_fetch(&sr_held, 1, __ATOMIC_RELAXED);
+    }
+    s->flags &= ~NP2S_CAND_CHANGED;
+
+    np2srv_sr_release(s);
+}
+
+void
+np2srv_sr_hibernate(void)
+{
+    sr_session_ctx_t *stop[NP2SRV_SR_POOL_SIZE];
+    time_t now, check;
+    uint16_t i, idle, count = 0;
+    uint32_t held, ncs_count;
+
+    /* checked by one of the workers at most once a second */
+    now = time(NULL);
+    check = __atomic_load_n(&sr_hibernate_check, __ATOMIC_RELAXED);
+    if ((now < check) || !__atomic_compare_exchange_n(&sr_hibernate_check, &check, now + 1, 0, __ATOMIC_RELAXED,
+                                                      __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    pthread_mutex_lock(&sr_pool.lock);
+    idle = sr_pool.count;
+    i = 0;
+    while (i < sr_pool.count) {
+        if (now - sr_pool.list[i].since < NP2SRV_SR_IDLE_TIMEOUT) {
+            ++i;
+            continue;
+        }
+        stop[count++] = sr_pool.list[i].handle.srs;
+        free(sr_pool.list[i].user);
+        sr_pool.list[i] = sr_pool.list[--sr_pool.count];
+    }
+    pthread_mutex_unlock(&sr_pool.lock);
+
+    if (!count) {
+        return;
+    }
+    for (i = 0; i < count; ++i) {
+        sr_session_stop(stop[i]);
+    }
+
+    held = __atomic_load_n(&sr_held, __ATOMIC_RELAXED);
+    ncs_count = np2srv.nc_ps ? nc_ps_session_count(np2srv.nc_ps) : 0;
+    VRB("Hibernated %u sysrepo sessions idle for %d s, sysrepo sessions per NETCONF session %.2f -> %.2f.",
+        count, NP2SRV_SR_IDLE_TIMEOUT, ncs_count ? (double)(held + idle) / ncs_count : 0.0,
+        ncs_count ? (double)(held + idle - count) / ncs_count : 0.0);
+}
+
+void
+np2srv_sr_pool_destroy(void)
+{
+    pthread_mutex_lock(&sr_pool.lock);
+    while (sr_pool.count) {
+        --sr_pool.count;
+        sr_session_stop(sr_pool.list[sr_pool.count].handle.srs);
+        free(sr_pool.list[sr_pool.count].user);
+    }
+    pthread_mutex_unlock(&sr_pool.lock);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file sr_pool.h
+ * @brief Pool of sysrepo sessions leased to NETCONF sessions
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_SR_POOL_H_
+#define NP2SRV_SR_POOL_H_
+
+#include "common.h"
+
+/**
+ * @brief Select a sysrepo session of a NETCONF session for reading a datastore.
+ *
+ * Running and startup are read by a separate sysrepo session for each datastore and config-only option, so
+ * they are never switched. Candidate is read by the edit session, which has its changes. Missing sessions are
+ * leased from the pool of idle sessions of the same user, a new session is started only if there is none.
+ *
+ * @param[in] s NETCONF session's sysrepo connections, srs, ds and opts are set to the selected session.
+ * @param[in] ds Datastore.
+ * @param[in] opts Session options, only SR_SESS_CONFIG_ONLY is considered.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int np2srv_sr_select(struct np2_sessions *s, sr_datastore_t ds, sr_sess_options_t opts);
+
+/**
+ * @brief Select the edit sysrepo session of a NETCONF session for modifying or locking a datastore.
+ *
+ * Modifications, locks and commits of candidate must all be done by the same sysrepo session.
+ *
+ * @param[in] s NETCONF session's sysrepo connections, srs, ds and opts are set to the selected session.
+ * @param[in] ds Datastore.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int np2srv_sr_select_edit(struct np2_sessions *s, sr_datastore_t ds);
+
+/**
+ * @brief Refresh the data of the selected sysrepo session before reading them.
+ *
+ * Other sysrepo clients may have committed changes at any time, so the data are always refreshed, only candidate
+ * with changes of the session no longer follows running.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ * @return Sysrepo error code.
+ */
+int np2srv_sr_refresh(struct np2_sessions *s);
+
+/**
+ * @brief Return the sysrepo sessions of a NETCONF session to the pool after an RPC.
+ *
+ * The edit session stays leased while it has any state of the NETCONF session, which are datastore locks
+ * and uncommitted candidate changes. Otherwise any changes left in it by a failed RPC are discarded first.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ */
+void np2srv_sr_release(struct np2_sessions *s);
+
+/**
+ * @brief Release the sysrepo sessions of a terminating NETCONF session, the edit session with any state is stopped.
+ *
+ * Must be called before the datastore locks of the NETCONF session are cleaned.
+ *
+ * @param[in] s NETCONF session's sysrepo connections.
+ */
+void np2srv_sr_free(struct np2_sessions *s);
+
+/**
+ * @brief Stop the sysrepo sessions idle in the pool for NP2SRV_SR_IDLE_TIMEOUT.
+ *
+ * Idle NETCONF sessions keep no sysrepo session apart from an edit session with locks or candidate changes,
+ * so this releases whatever sysrepo keeps for them. The next RPC of their user starts new sessions.
+ * Cheap to call often, the pool is checked at most once a second.
+ */
+void np2srv_sr_hibernate(void);
+
+/**
+ * @brief Stop all the idle sysrepo sessions in the pool.
+ */
+void np2srv_sr_pool_destroy(void);
+
+#endif /* NP2SRV_SR_POOL_H_ */
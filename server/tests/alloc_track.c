@@ -0,0 +1,151 @@
+/**
+ * @file alloc_track.c
+ * @brief Allocation-counting replacement of the malloc family.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "alloc_track.h"
+
+/* glibc allocator, the replacement functions below only count and forward to it */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t alloc_count, alloc_bytes, alloc_live, alloc_peak, alloc_largest;
+
+static void
+alloc_track_max(uint64_t *max, uint64_t value)
+{
+    uint64_t cur;
+
+    cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while ((value > cur) && !__atomic_compare_exchange_n(max, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/* ptr is the new block, usable is the size of the replaced block */
+static void
+alloc_track_add(void *ptr, size_t size, size_t usable)
+{
+    uint64_t live;
+
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+    live = __atomic_add_fetch(&alloc_live, malloc_usable_size(ptr) - usable, __ATOMIC_RELAXED);
+    alloc_track_max(&alloc_peak, live);
+    alloc_track_max(&alloc_largest, size);
+}
+
+void *
+malloc(size_t size)
+{
+    void *ptr;
+
+    ptr = __libc_malloc(size);
+    if (ptr) {
+        alloc_track_add(ptr, size, 0);
+    }
+    return ptr;
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+
+    ptr = __libc_calloc(nmemb, size);
+    if (ptr) {
+        alloc_track_add(ptr, nmemb * size, 0);
+    }
+    return ptr;
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+    size_t usable;
+
+    usable = ptr ? malloc_usable_size(ptr) : 0;
+    new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr) {
+        alloc_track_add(new_ptr, size, usable);
+    } else if (ptr && !size) {
+        /* realloc(ptr, 0) freed the block */
+        __atomic_sub_fetch(&alloc_live, usable, __ATOMIC_RELAXED);
+    }
+    return new_ptr;
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+    void *ptr;
+
+    ptr = __libc_memalign(alignment, size);
+    if (ptr) {
+        alloc_track_add(ptr, size, 0);
+    }
+    return ptr;
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (!alignment || (alignment % sizeof(void *)) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+    ptr = memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void
+free(void *ptr)
+{
+    if (ptr) {
+        __atomic_sub_fetch(&alloc_live, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    }
+    __libc_free(ptr);
+}
+
+void
+alloc_track_get(struct alloc_stats *stats)
+{
+    stats->count = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+    stats->live = __atomic_load_n(&alloc_live, __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&alloc_peak, __ATOMIC_RELAXED);
+    stats->largest = __atomic_load_n(&alloc_largest, __ATOMIC_RELAXED);
+}
+
+void
+alloc_track_reset_peak(void)
+{
+    __atomic_store_n(&alloc_peak, __atomic_load_n(&alloc_live, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&alloc_largest, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,44 @@
+/**
+ * @file alloc_track.h
+ * @brief Allocation-counting replacement of the malloc family header.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef ALLOC_TRACK_H_
+#define ALLOC_TRACK_H_
+
+#include <stdint.h>
+
+/*
+ * Linking alloc_track.c into an executable replaces malloc(), calloc(), realloc(), the aligned allocations
+ * and free() of the whole process, including the ones made by libyang and libnetconf2, with glibc functions
+ * wrapped by counters. The heap in use is the sum of the usable sizes of the live blocks.
+ */
+
+struct alloc_stats {
+    uint64_t count;         /**< successful allocation calls, including realloc() */
+    uint64_t bytes;         /**< bytes requested by them */
+    uint64_t live;          /**< heap in use */
+    uint64_t peak;          /**< maximum heap in use since the last alloc_track_reset_peak() */
+    uint64_t largest;       /**< largest single request since the last alloc_track_reset_peak() */
+};
+
+/**
+ * @brief Get the counters, count and bytes are accumulated since the process start, subtract two snapshots
+ * to get a delta.
+ */
+void alloc_track_get(struct alloc_stats *stats);
+
+/**
+ * @brief Start a new peak measurement, the peak is set to the current heap in use and the largest request to 0.
+ */
+void alloc_track_reset_peak(void);
+
+#endif /* ALLOC_TRACK_H_ */
@@ -0,0 +1,175 @@
+/**
+ * @file bench_accept.c
+ * @brief Connection-rate benchmark of a running netopeer2-server.
+ *
+ * Copyright (c) 2016 - 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+struct client {
+    pthread_t tid;
+    uint64_t conns;          /**< connections accepted by the server */
+    uint64_t fails;          /**< failed connection attempts */
+    uint64_t lat_ns;         /**< sum of connect-to-banner times */
+};
+
+static struct addrinfo *addr;
+static volatile int stop;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* the server has accepted the connection once it sends the SSH identification string */
+static int
+connect_banner(void)
+{
+    int sock, ret = -1;
+    ssize_t r;
+    char buf[256];
+
+    sock = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (sock == -1) {
+        return -1;
+    }
+    if (connect(sock, addr->ai_addr, addr->ai_addrlen) == -1) {
+        goto cleanup;
+    }
+    do {
+        r = read(sock, buf, sizeof buf);
+    } while ((r == -1) && (errno == EINTR));
+    if ((r > 4) && !strncmp(buf, "SSH-", 4)) {
+        ret = 0;
+    }
+
+cleanup:
+    close(sock);
+    return ret;
+}
+
+static void *
+client_thread(void *arg)
+{
+    struct client *cl = arg;
+    uint64_t start;
+
+    while (!stop) {
+        start = now_ns();
+        if (connect_banner()) {
+            ++cl->fails;
+            /* do not spin on a refused connection */
+            usleep(1000);
+            continue;
+        }
+        cl->lat_ns += now_ns() - start;
+        ++cl->conns;
+    }
+
+    return NULL;
+}
+
+static void
+print_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-H host] [-p port] [-c clients] [-t seconds]\n", progname);
+    fprintf(stdout, " -H host             server address (default 127.0.0.1)\n");
+    fprintf(stdout, " -p port             server SSH port (default 830)\n");
+    fprintf(stdout, " -c clients          number of concurrent connecting clients (default 16)\n");
+    fprintf(stdout, " -t seconds          benchmark duration (default 5)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *host = "127.0.0.1", *port = "830";
+    int c, clients = 16, seconds = 5, i;
+    struct client *cls;
+    struct addrinfo hints;
+    uint64_t conns = 0, fails = 0, lat_ns = 0, start, elapsed;
+
+    while ((c = getopt(argc, argv, "H:p:c:t:h")) != -1) {
+        switch (c) {
+        case 'H':
+            host = optarg;
+            break;
+        case 'p':
+            port = optarg;
+            break;
+        case 'c':
+            clients = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((clients < 1) || (seconds < 1)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((c = getaddrinfo(host, port, &hints, &addr))) {
+        fprintf(stderr, "Failed to resolve \"%s\" (%s).\n", host, gai_strerror(c));
+        return EXIT_FAILURE;
+    }
+
+    cls = calloc(clients, sizeof *cls);
+    if (!cls) {
+        freeaddrinfo(addr);
+        return EXIT_FAILURE;
+    }
+
+    start = now_ns();
+    for (i = 0; i < clients; ++i) {
+        pthread_create(&cls[i].tid, NULL, client_thread, &cls[i]);
+    }
+    sleep(seconds);
+    stop = 1;
+    for (i = 0; i < clients; ++i) {
+        pthread_join(cls[i].tid, NULL);
+        conns += cls[i].conns;
+        fails += cls[i].fails;
+        lat_ns += cls[i].lat_ns;
+    }
+    elapsed = now_ns() - start;
+
+    fprintf(stdout, "clients: %d, duration: %.2f s\n", clients, elapsed / 1e9);
+    fprintf(stdout, "accepted: %llu (%.1f conn/s), failed: %llu\n", (unsigned long long)conns,
+            conns / (elapsed / 1e9), (unsigned long long)fails);
+    if (conns) {
+        fprintf(stdout, "mean accept latency: %.3f ms\n", (lat_ns / conns) / 1e6);
+    }
+
+    free(cls);
+    freeaddrinfo(addr);
+    return fails && !conns ? EXIT_FAILURE : EXIT_SUCCESS;
+}
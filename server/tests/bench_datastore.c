@@ -0,0 +1,349 @@
+/**
+ * @file bench_datastore.c
+ * @brief Benchmark of np2srv datastore operations on large synthetic datastores.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/bench_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "fake_session.h"
+#include "perf_report.h"
+#include "sr_synth.h"
+
+#define BENCH_NC_NS "urn:ietf:params:xml:ns:netconf:base:1.0"
+
+typedef enum {
+    BENCH_GET,
+    BENCH_GET_FILTERED,
+    BENCH_EDIT,
+    BENCH_COPY,
+    BENCH_OP_COUNT
+} BENCH_OP;
+
+static const char *bench_op_names[BENCH_OP_COUNT] = {"get", "filtered get", "edit-config", "copy-config"};
+
+/* the common beginning of all the libnetconf2 server replies, mirrors their NC_RPL type */
+struct bench_reply {
+    enum {
+        BENCH_RPL_OK,
+        BENCH_RPL_DATA,
+        BENCH_RPL_ERROR
+    } type;
+};
+
+static struct np2_sessions bench_sess;
+
+/*
+ * LIBNETCONF2 WRAPPER FUNCTIONS
+ */
+void *
+__wrap_nc_session_get_data(const struct nc_session *session)
+{
+    (void)session;
+    return &bench_sess;
+}
+
+/* value of the first leaf, different in every iteration */
+static const char *
+edit_value(SYNTH_TYPE type, uint32_t iter, char *buf)
+{
+    static const char *enums[] = {"two", "three", "four"};
+
+    switch (type) {
+    case SYNTH_STRING:
+        sprintf(buf, "edit%u", iter);
+        return buf;
+    case SYNTH_UINT32:
+        sprintf(buf, "%u", iter + 1);
+        return buf;
+    case SYNTH_BOOL:
+        return (iter & 1) ? "false" : "true";
+    default:
+        return enums[iter % 3];
+    }
+}
+
+/* builds the RPC of an operation, it is consumed by the operation so it is built for every iteration */
+static char *
+bench_rpc_xml(BENCH_OP op, const struct synth_shape *shape, uint32_t edits, uint32_t iter, const char *config)
+{
+    FILE *rpc;
+    char *xml = NULL, buf[32];
+    size_t size;
+    uint32_t i, step;
+
+    rpc = open_memstream(&xml, &size);
+    if (!rpc) {
+        return NULL;
+    }
+
+    switch (op) {
+    case BENCH_GET:
+        fprintf(rpc, "<get xmlns=\"%s\"/>", BENCH_NC_NS);
+        break;
+    case BENCH_GET_FILTERED:
+        /* one top-level list instance with all its descendants */
+        fprintf(rpc, "<get xmlns=\"%s\"><filter type=\"subtree\"><synth xmlns=\"%s\"><l1><name>e%u</name></l1>"
+                "</synth></filter></get>", BENCH_NC_NS, SYNTH_NS, shape->list_size[0] / 2);
+        break;
+    case BENCH_EDIT:
+        /* merge of the first leaf of top-level list instances spread over the whole list */
+        fprintf(rpc, "<edit-config xmlns=\"%s\"><target><running/></target><config><synth xmlns=\"%s\">",
+                BENCH_NC_NS, SYNTH_NS);
+        step = (shape->list_size[0] > edits) ? shape->list_size[0] / edits : 1;
+        for (i = 0; (i < edits) && (i * step < shape->list_size[0]); ++i) {
+            fprintf(rpc, "<l1><name>e%u</name><f0>%s</f0></l1>", i * step, edit_value(shape->types[0], iter, buf));
+        }
+        fprintf(rpc, "</synth></config></edit-config>");
+        break;
+    case BENCH_COPY:
+        fprintf(rpc, "<copy-config xmlns=\"%s\"><target><running/></target><source><config>%s</config></source>"
+                "</copy-config>", BENCH_NC_NS, config);
+        break;
+    default:
+        break;
+    }
+
+    if (fclose(rpc)) {
+        free(xml);
+        return NULL;
+    }
+    return xml;
+}
+
+static int
+bench_op(BENCH_OP op, const struct synth_shape *shape, uint64_t nodes, uint32_t edits, uint32_t iterations,
+         const char *config)
+{
+    struct nc_server_reply *(*op_clb)(struct lyd_node *, struct nc_session *);
+    struct nc_server_reply *reply;
+    struct lyd_node *rpc;
+    uint64_t start, ns, min = UINT64_MAX, max = 0, sum = 0;
+    uint32_t i;
+    char *xml;
+
+    switch (op) {
+    case BENCH_EDIT:
+        op_clb = op_editconfig;
+        break;
+    case BENCH_COPY:
+        op_clb = op_copyconfig;
+        break;
+    default:
+        op_clb = op_get;
+        break;
+    }
+
+    for (i = 0; i < iterations; ++i) {
+        xml = bench_rpc_xml(op, shape, edits, i, config);
+        if (!xml) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            return -1;
+        }
+        rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+        free(xml);
+        if (!rpc) {
+            fprintf(stderr, "Failed to parse the %s RPC.\n", bench_op_names[op]);
+            return -1;
+        }
+
+        start = now_ns();
+        reply = op_clb(rpc, NULL);
+        ns = now_ns() - start;
+
+        lyd_free(rpc);
+        if (!reply || (((struct bench_reply *)reply)->type == BENCH_RPL_ERROR)) {
+            fprintf(stderr, "Operation %s failed (%s).\n", bench_op_names[op], np2log_lasterr());
+            nc_server_reply_free(reply);
+            return -1;
+        }
+        nc_server_reply_free(reply);
+        /* what the worker does after sending the reply */
+        np2_arena_reset();
+
+        sum += ns;
+        if (ns < min) {
+            min = ns;
+        }
+        if (ns > max) {
+            max = ns;
+        }
+    }
+
+    fprintf(stdout, "%-14s iterations: %u, time (ms) min: %.2f, avg: %.2f, max: %.2f\n", bench_op_names[op],
+            iterations, min / 1e6, sum / 1e6 / iterations, max / 1e6);
+    perf_report_add("ms", min / 1e6, "%s/%lu/min", bench_op_names[op], (unsigned long)nodes);
+    perf_report_add("ms", sum / 1e6 / iterations, "%s/%lu/avg", bench_op_names[op], (unsigned long)nodes);
+    perf_report_add("ms", max / 1e6, "%s/%lu/max", bench_op_names[op], (unsigned long)nodes);
+    return 0;
+}
+
+static void
+bench_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n nodes[,...]] [-d depth] [-l leaves] [-t types] [-r ratio] [-i iterations] [-e edits]\n"
+            "       [-s seed] [-o report]\n", progname);
+    fprintf(stdout, " -n nodes            datastore sizes to measure (default 10000,100000,1000000)\n");
+    fprintf(stdout, " -d depth            nested list levels, 1 - %d (default 2)\n", SYNTH_MAX_DEPTH);
+    fprintf(stdout, " -l leaves           leaves of every list instance besides the key (default 8)\n");
+    fprintf(stdout, " -t types            leaf types used in turns, of string, uint32, boolean and enumeration\n");
+    fprintf(stdout, "                     (default string,uint32,boolean,enumeration)\n");
+    fprintf(stdout, " -r ratio            share of leaves with their default value (default 0.25)\n");
+    fprintf(stdout, " -i iterations       iterations of every operation (default 3)\n");
+    fprintf(stdout, " -e edits            top-level list instances changed by one edit-config (default 100)\n");
+    fprintf(stdout, " -s seed             seed of the generated values (default 1)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct synth_shape shape;
+    const char *sizes = "10000,100000,1000000", *report = NULL;
+    char *ptr, *config = NULL;
+    uint32_t iterations = 3, edits = 100, i;
+    uint64_t nodes, start;
+    int c, ret = EXIT_FAILURE;
+    BENCH_OP op;
+
+    memset(&shape, 0, sizeof shape);
+    shape.depth = 2;
+    shape.leaves = 8;
+    shape.default_ratio = 0.25;
+    shape.seed = 1;
+    synth_shape_types(&shape, "string,uint32,boolean,enumeration");
+
+    while ((c = getopt(argc, argv, "n:d:l:t:r:i:e:s:o:h")) != -1) {
+        switch (c) {
+        case 'n':
+            sizes = optarg;
+            break;
+        case 'd':
+            shape.depth = strtoul(optarg, NULL, 10);
+            break;
+        case 'l':
+            shape.leaves = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            if (synth_shape_types(&shape, optarg)) {
+                fprintf(stderr, "Invalid leaf types \"%s\".\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            shape.default_ratio = strtod(optarg, NULL);
+            break;
+        case 'i':
+            iterations = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            edits = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            shape.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    /* edit-config changes the first leaf */
+    if (!shape.depth || (shape.depth > SYNTH_MAX_DEPTH) || !shape.leaves || (shape.default_ratio < 0)
+            || (shape.default_ratio > 1) || !iterations || !edits) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (report && perf_report_open(report, "bench_datastore")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* only errors, the operations are measured with the logging the server uses by default */
+    openlog("bench_datastore", LOG_PERROR, LOG_USER);
+    np2_verbose_level = NC_VERB_ERROR;
+    nc_verbosity(np2_verbose_level);
+    nc_set_print_clb(np2log_clb_nc2);
+    ly_set_log_clb(np2log_clb_ly, 1);
+
+    /* the module depends only on the depth, leaves and types, so it is shared by all the sizes */
+    if (synth_init(&shape) || server_init()) {
+        fprintf(stderr, "Server init failed.\n");
+        goto cleanup;
+    }
+
+    fprintf(stdout, "Depth: %u, leaves: %u, default ratio: %.2f\n", shape.depth, shape.leaves, shape.default_ratio);
+    for (ptr = (char *)sizes; *ptr; ptr += (*ptr == ',') ? 1 : 0) {
+        nodes = strtoull(ptr, &ptr, 10);
+        if (!nodes || (*ptr && (*ptr != ','))) {
+            fprintf(stderr, "Invalid datastore sizes \"%s\".\n", sizes);
+            goto cleanup;
+        }
+
+        synth_shape_fit(&shape, nodes);
+        start = now_ns();
+        if (synth_generate(np2srv.ly_ctx, &shape, SR_DS_RUNNING)) {
+            fprintf(stderr, "Generating %lu nodes failed.\n", (unsigned long)nodes);
+            goto cleanup;
+        }
+        fprintf(stdout, "Nodes: %lu (lists", (unsigned long)synth_node_count(&shape));
+        for (i = 0; i < shape.depth; ++i) {
+            fprintf(stdout, " %u", shape.list_size[i]);
+        }
+        fprintf(stdout, "), generated in %.1f ms\n", (now_ns() - start) / 1e6);
+
+        /* copy-config replaces running with its own data printed without the defaults */
+        free(config);
+        if (lyd_print_mem(&config, synth_data(SR_DS_RUNNING), LYD_XML, LYP_WITHSIBLINGS)) {
+            fprintf(stderr, "Printing the data failed.\n");
+            goto cleanup;
+        }
+
+        for (op = 0; op < BENCH_OP_COUNT; ++op) {
+            if (bench_op(op, &shape, nodes, edits, iterations, config)) {
+                goto cleanup;
+            }
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    free(config);
+    synth_destroy();
+    chm_destroy();
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    nc_ps_free(np2srv.nc_ps);
+    nc_server_destroy();
+    ncm_destroy();
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file bench_generic.c
+ * @brief RPC and action forwarding benchmark of np2srv with large inputs and outputs.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/bench_generic_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "alloc_track.h"
+#include "fake_session.h"
+#include "perf_report.h"
+#include "sr_synth.h"
+
+#define BENCH_SIZE_MAX 16
+
+/* the common beginning of all the libnetconf2 server replies, mirrors their NC_RPL type */
+struct bench_reply {
+    enum {
+        BENCH_RPL_OK,
+        BENCH_RPL_DATA,
+        BENCH_RPL_ERROR
+    } type;
+};
+
+/* the bulk RPC or action with entries in its input, as libnetconf2 would parse it */
+static struct lyd_node *
+bench_parse(int action, uint32_t entries)
+{
+    struct lyd_node *rpc = NULL;
+    char *xml = NULL;
+    size_t size;
+    FILE *f;
+    uint32_t i;
+
+    f = open_memstream(&xml, &size);
+    if (!f) {
+        return NULL;
+    }
+    if (action) {
+        fprintf(f, "<action xmlns=\"urn:ietf:params:xml:ns:yang:1\"><objects xmlns=\"%s\"><object><id>1</id><bulk>",
+                SYNTH_NS);
+    } else {
+        fprintf(f, "<bulk xmlns=\"%s\">", SYNTH_NS);
+    }
+    for (i = 0; i < entries; ++i) {
+        fprintf(f, "<entry><name>e%u</name><value>%u</value><descr>synthetic bulk entry</descr></entry>", i, i);
+    }
+    fprintf(f, action ? "</bulk></object></objects></action>" : "</bulk>");
+    if (fclose(f)) {
+        free(xml);
+        return NULL;
+    }
+
+    rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+    free(xml);
+    return rpc;
+}
+
+/* the RPC/action forwarded by op_generic() as the worker does it, the provider's time is not included */
+static int
+bench_run(struct nc_session *session, struct lyd_node *rpc, const char *name, uint32_t in, uint32_t out,
+          uint32_t iters)
+{
+    struct nc_server_reply *reply;
+    struct alloc_stats before, after;
+    uint64_t start, total = 0, provider, peak = 0;
+    uint32_t i;
+    int error;
+
+    synth_rpc_output(out);
+    for (i = 0; i <= iters; ++i) {
+        /* the first run is a warm-up */
+        alloc_track_get(&before);
+        alloc_track_reset_peak();
+        provider = synth_rpc_ns();
+
+        start = now_ns();
+        reply = np2srv_op_generic(rpc, session);
+        error = !reply || (((struct bench_reply *)reply)->type != (out ? BENCH_RPL_DATA : BENCH_RPL_OK));
+        nc_server_reply_free(reply);
+        np2_arena_reset();
+        if (i) {
+            total += now_ns() - start - (synth_rpc_ns() - provider);
+        }
+        alloc_track_get(&after);
+
+        if (error || (synth_rpc_input() != in)) {
+            fprintf(stderr, "%s with %u input and %u output entries failed (%s).\n", name, in, out, np2log_lasterr());
+            return -1;
+        }
+        if (after.peak - before.live > peak) {
+            peak = after.peak - before.live;
+        }
+    }
+
+    fprintf(stdout, "%-7s in: %8u  out: %8u  avg: %11.1f us  (%6.3f us/entry)  allocs: %9lu  peak heap: %10lu B\n",
+            name, in, out, total / 1e3 / iters, total / 1e3 / iters / (in > out ? in : out),
+            (unsigned long)(after.count - before.count), (unsigned long)peak);
+    perf_report_add("us", total / 1e3 / iters, "%s/%u/%u/avg", name, in, out);
+    perf_report_add("allocs", after.count - before.count, "%s/%u/%u/allocs", name, in, out);
+    perf_report_add("B", peak, "%s/%u/%u/peak", name, in, out);
+    return 0;
+}
+
+static int
+parse_sizes(const char *str, uint32_t *sizes, uint32_t *count)
+{
+    char *ptr;
+    unsigned long size;
+
+    *count = 0;
+    do {
+        size = strtoul(str, &ptr, 10);
+        if ((ptr == str) || !size || (size > UINT32_MAX) || (*count == BENCH_SIZE_MAX)) {
+            return -1;
+        }
+        sizes[(*count)++] = size;
+        str = ptr + 1;
+    } while (*ptr == ',');
+
+    return *ptr ? -1 : 0;
+}
+
+static void
+bench_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n entries] [-i iterations] [-o report]\n", progname);
+    fprintf(stdout, " -n entries          comma-separated entry counts of the large inputs and outputs\n");
+    fprintf(stdout, "                     (default 100,10000,100000)\n");
+    fprintf(stdout, " -i iterations       runs of every RPC/action after a warm-up run (default 5)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct synth_shape shape;
+    struct nc_session *session = NULL;
+    struct lyd_node *small[2] = {NULL, NULL}, *large;
+    const char *report = NULL, *names[2] = {"rpc", "action"};
+    uint32_t sizes[BENCH_SIZE_MAX], size_count, iters = 5, i;
+    int c, action, ret = EXIT_FAILURE;
+
+    parse_sizes("100,10000,100000", sizes, &size_count);
+    while ((c = getopt(argc, argv, "n:i:o:h")) != -1) {
+        switch (c) {
+        case 'n':
+            if (parse_sizes(optarg, sizes, &size_count)) {
+                fprintf(stderr, "Invalid entry counts \"%s\".\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'i':
+            iters = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!iters) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (report && perf_report_open(report, "bench_generic")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    openlog("bench_generic", LOG_PERROR, LOG_USER);
+    np2_verbose_level = NC_VERB_ERROR;
+    nc_verbosity(np2_verbose_level);
+    nc_set_print_clb(np2log_clb_nc2);
+    ly_set_log_clb(np2log_clb_ly, 1);
+
+    /* the datastores are not used, only the module with the RPC and the action */
+    memset(&shape, 0, sizeof shape);
+    shape.depth = 1;
+    shape.leaves = 1;
+    synth_shape_types(&shape, "string");
+    synth_rpc_enable();
+    if (synth_init(&shape) || server_init()) {
+        fprintf(stderr, "Server init failed.\n");
+        goto cleanup;
+    }
+
+    session = session_new(1, -1, "user1");
+    if (!session || connect_ds(session)) {
+        fprintf(stderr, "Creating the session failed.\n");
+        goto cleanup;
+    }
+    for (action = 0; action < 2; ++action) {
+        small[action] = bench_parse(action, 1);
+        if (!small[action]) {
+            fprintf(stderr, "Failed to parse the %s.\n", names[action]);
+            goto cleanup;
+        }
+    }
+
+    fprintf(stdout, "Iterations: %u\n", iters);
+    for (i = 0; i < size_count; ++i) {
+        for (action = 0; action < 2; ++action) {
+            /* large input, then large output, then both */
+            large = bench_parse(action, sizes[i]);
+            if (!large) {
+                fprintf(stderr, "Failed to parse the %s with %u entries.\n", names[action], sizes[i]);
+                goto cleanup;
+            }
+            if (bench_run(session, large, names[action], sizes[i], 1, iters)
+                    || bench_run(session, small[action], names[action], 1, sizes[i], iters)
+                    || bench_run(session, large, names[action], sizes[i], sizes[i], iters)) {
+                lyd_free_withsiblings(large);
+                goto cleanup;
+            }
+            lyd_free_withsiblings(large);
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    for (action = 0; action < 2; ++action) {
+        lyd_free_withsiblings(small[action]);
+    }
+    if (session) {
+        free_ds(nc_session_get_data(session));
+        session_free(session);
+    }
+    np2srv_sr_pool_destroy();
+    synth_destroy();
+    chm_destroy();
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    nc_ps_free(np2srv.nc_ps);
+    nc_server_destroy();
+    ncm_destroy();
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
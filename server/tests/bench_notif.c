@@ -0,0 +1,910 @@
+/**
+ * @file bench_notif.c
+ * @brief Notification fan-out benchmark of np2srv over fake transport sessions.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/bench_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "fake_session.h"
+#include "perf_report.h"
+
+#define BENCH_NCN_NS "urn:ietf:params:xml:ns:yang:ietf-netconf-notifications"
+#define BENCH_NTF_XPATH "/ietf-netconf-notifications:netconf-session-start"
+
+typedef enum {
+    BENCH_FLT_NONE,
+    BENCH_FLT_IDENTICAL,
+    BENCH_FLT_DISTINCT,
+    BENCH_FLT_COUNT
+} BENCH_FLT;
+
+static const char *bench_flt_names[BENCH_FLT_COUNT] = {"none", "identical", "distinct"};
+
+/* the common beginning of all the libnetconf2 server replies, mirrors their NC_RPL type */
+struct bench_reply {
+    enum {
+        BENCH_RPL_OK,
+        BENCH_RPL_DATA,
+        BENCH_RPL_ERROR
+    } type;
+};
+
+/* values in ns */
+struct bench_lat {
+    uint64_t *val;
+    uint64_t count;
+    uint64_t size;
+};
+
+/* one subscriber on a fake session, the server writes into out, the reader reads from in */
+struct bench_sub {
+    struct nc_session *session;
+    int in;
+    int out;
+    BENCH_FLT filter;
+    uint32_t group;
+    int stalled;
+
+    char *buf;
+    size_t len;
+    size_t size;
+    uint64_t expected;
+    uint64_t received;
+    uint64_t lat_sum;
+    uint64_t lat_max;
+};
+
+struct bench_reader {
+    pthread_t tid;
+    struct bench_sub *subs;
+    uint32_t sub_count;
+    struct bench_lat lat[BENCH_FLT_COUNT];
+    int failed;
+};
+
+/* mirrors the subscribers list of op_notifications.c, only the lock address is needed */
+extern struct {
+    uint32_t size;
+    uint32_t num;
+    void *list;
+    pthread_mutex_t lock;
+} subscribers;
+
+static sr_event_notif_tree_cb notif_tree_clb;
+static uint64_t *inject_ns;
+static volatile uint64_t delivered, stall_end;
+static volatile int readers_stop;
+
+/* subscribers lock hold times, measured only during the injection */
+static volatile int lock_measure;
+static uint64_t lock_acquired;
+static struct bench_lat lock_held;
+
+static int
+lat_add(struct bench_lat *lat, uint64_t ns)
+{
+    void *mem;
+
+    if (lat->count == lat->size) {
+        mem = realloc(lat->val, (lat->size ? lat->size * 2 : 1024) * sizeof *lat->val);
+        if (!mem) {
+            return -1;
+        }
+        lat->val = mem;
+        lat->size = lat->size ? lat->size * 2 : 1024;
+    }
+    lat->val[lat->count++] = ns;
+
+    return 0;
+}
+
+/*
+ * SYSREPO WRAPPER FUNCTIONS
+ */
+int
+__wrap_sr_connect(const char *app_name, const sr_conn_options_t opts, sr_conn_ctx_t **conn_ctx)
+{
+    (void)app_name;
+    (void)opts;
+    (void)conn_ctx;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_start(sr_conn_ctx_t *conn_ctx, const sr_datastore_t datastore,
+                        const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)conn_ctx;
+    (void)datastore;
+    (void)opts;
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_list_schemas(sr_session_ctx_t *session, sr_schema_t **schemas, size_t *schema_cnt)
+{
+    (void)session;
+
+    *schema_cnt = 5;
+    *schemas = calloc(5, sizeof **schemas);
+
+    (*schemas)[0].module_name = strdup("ietf-netconf-server");
+    (*schemas)[0].installed = 1;
+
+    (*schemas)[1].module_name = strdup("ietf-netconf");
+    (*schemas)[1].ns = strdup("urn:ietf:params:xml:ns:netconf:base:1.0");
+    (*schemas)[1].prefix = strdup("nc");
+    (*schemas)[1].revision.revision = strdup("2011-06-01");
+    (*schemas)[1].revision.file_path_yin = strdup(TESTS_DIR"/files/ietf-netconf.yin");
+    (*schemas)[1].installed = 1;
+
+    (*schemas)[2].module_name = strdup("ietf-netconf-notifications");
+    (*schemas)[2].ns = strdup(BENCH_NCN_NS);
+    (*schemas)[2].prefix = strdup("ncn");
+    (*schemas)[2].revision.revision = strdup("2012-02-06");
+    (*schemas)[2].revision.file_path_yin = strdup(TESTS_DIR"/files/ietf-netconf-notifications.yin");
+    (*schemas)[2].installed = 1;
+
+    (*schemas)[3].module_name = strdup("notifications");
+    (*schemas)[3].ns = strdup("urn:ietf:params:xml:ns:netconf:notification:1.0");
+    (*schemas)[3].prefix = strdup("ncEvent");
+    (*schemas)[3].revision.revision = strdup("2008-07-14");
+    (*schemas)[3].revision.file_path_yin = strdup(TESTS_DIR"/files/notifications.yin");
+    (*schemas)[3].installed = 1;
+
+    (*schemas)[4].module_name = strdup("nc-notifications");
+    (*schemas)[4].ns = strdup("urn:ietf:params:xml:ns:netmod:notification");
+    (*schemas)[4].prefix = strdup("manageEvent");
+    (*schemas)[4].revision.revision = strdup("2008-07-14");
+    (*schemas)[4].revision.file_path_yin = strdup(TESTS_DIR"/files/nc-notifications.yin");
+    (*schemas)[4].installed = 1;
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_schema(sr_session_ctx_t *session, const char *module_name, const char *revision,
+                     const char *submodule_name, sr_schema_format_t format, char **schema_content)
+{
+    int fd;
+    struct stat st;
+    (void)session;
+    (void)revision;
+    (void)submodule_name;
+    (void)format;
+
+    if (!strcmp(module_name, "ietf-netconf-server")) {
+        *schema_content = strdup("<module name=\"ietf-netconf-server\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\"><namespace uri=\"ns\"/><prefix value=\"pr\"/></module>");
+        return SR_ERR_OK;
+    }
+    if (!strcmp(module_name, "ietf-netconf")) {
+        fd = open(TESTS_DIR "/files/ietf-netconf.yin", O_RDONLY);
+    } else if (!strcmp(module_name, "ietf-netconf-notifications")) {
+        fd = open(TESTS_DIR "/files/ietf-netconf-notifications.yin", O_RDONLY);
+    } else if (!strcmp(module_name, "notifications")) {
+        fd = open(TESTS_DIR "/files/notifications.yin", O_RDONLY);
+    } else if (!strcmp(module_name, "nc-notifications")) {
+        fd = open(TESTS_DIR "/files/nc-notifications.yin", O_RDONLY);
+    } else {
+        return SR_ERR_NOT_FOUND;
+    }
+    if ((fd == -1) || fstat(fd, &st)) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return SR_ERR_IO;
+    }
+
+    *schema_content = malloc(st.st_size + 1);
+    if (read(fd, *schema_content, st.st_size) != st.st_size) {
+        free(*schema_content);
+        close(fd);
+        return SR_ERR_IO;
+    }
+    close(fd);
+    (*schema_content)[st.st_size] = '\0';
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_start_user(sr_conn_ctx_t *conn_ctx, const char *user_name, const sr_datastore_t datastore,
+                             const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)conn_ctx;
+    (void)user_name;
+    (void)datastore;
+    (void)opts;
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_stop(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+void
+__wrap_sr_disconnect(sr_conn_ctx_t *conn_ctx)
+{
+    (void)conn_ctx;
+}
+
+int
+__wrap_sr_session_refresh(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_install_subscribe(sr_session_ctx_t *session, sr_module_install_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_feature_enable_subscribe(sr_session_ctx_t *session, sr_feature_enable_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_change_subscribe(sr_session_ctx_t *session, const char *module_name, sr_module_change_cb callback,
+                                  void *private_ctx, uint32_t priority, sr_subscr_options_t opts,
+                                  sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)module_name;
+    (void)callback;
+    (void)private_ctx;
+    (void)priority;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *values,
+                           const size_t values_cnt, sr_ev_notif_flag_t opts)
+{
+    (void)session;
+    (void)xpath;
+    (void)values;
+    (void)values_cnt;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+/* the server subscribes with the same callback for every module, it is all the injector needs */
+int
+__wrap_sr_event_notif_subscribe_tree(sr_session_ctx_t *session, const char *xpath, sr_event_notif_tree_cb callback,
+                                     void *private_ctx, sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)xpath;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+
+    notif_tree_clb = callback;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_replay(sr_session_ctx_t *session, sr_subscription_ctx_t *subscription, time_t start_time,
+                             time_t stop_time)
+{
+    (void)session;
+    (void)subscription;
+    (void)start_time;
+    (void)stop_time;
+    return SR_ERR_OK;
+}
+
+/*
+ * PTHREAD WRAPPER FUNCTIONS
+ */
+int __real_pthread_mutex_lock(pthread_mutex_t *mutex);
+int __real_pthread_mutex_unlock(pthread_mutex_t *mutex);
+
+int
+__wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    int ret;
+
+    ret = __real_pthread_mutex_lock(mutex);
+    if (!ret && (mutex == &subscribers.lock)) {
+        lock_acquired = now_ns();
+    }
+    return ret;
+}
+
+int
+__wrap_pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    /* the hold times are protected by the lock itself */
+    if ((mutex == &subscribers.lock) && lock_measure) {
+        lat_add(&lock_held, now_ns() - lock_acquired);
+    }
+    return __real_pthread_mutex_unlock(mutex);
+}
+
+/* subscribes the session the same way a create-subscription RPC would */
+static int
+sub_subscribe(struct bench_sub *sub)
+{
+    struct nc_server_reply *reply;
+    struct lyd_node *rpc;
+    char xml[512];
+
+    switch (sub->filter) {
+    case BENCH_FLT_NONE:
+        sprintf(xml, "<create-subscription xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"/>");
+        break;
+    case BENCH_FLT_IDENTICAL:
+        sprintf(xml, "<create-subscription xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\">"
+                "<filter type=\"subtree\"><netconf-session-start xmlns=\"%s\"><session-id/></netconf-session-start>"
+                "</filter></create-subscription>", BENCH_NCN_NS);
+        break;
+    default:
+        sprintf(xml, "<create-subscription xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\">"
+                "<filter type=\"subtree\"><netconf-session-start xmlns=\"%s\"><username>user%u</username><session-id/>"
+                "</netconf-session-start></filter></create-subscription>", BENCH_NCN_NS, sub->group);
+        break;
+    }
+
+    rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+    if (!rpc) {
+        return -1;
+    }
+    reply = op_ntf_subscribe(rpc, sub->session);
+    lyd_free(rpc);
+    if (!reply || (((struct bench_reply *)reply)->type != BENCH_RPL_OK)) {
+        nc_server_reply_free(reply);
+        return -1;
+    }
+    nc_server_reply_free(reply);
+
+    return 0;
+}
+
+/*
+ * READERS
+ */
+/* reads what is available and processes every complete notification */
+static int
+sub_recv(struct bench_reader *reader, struct bench_sub *sub)
+{
+    char *msg, *end, *id;
+    ssize_t r;
+    uint64_t seq, lat;
+    void *mem;
+
+    while (1) {
+        if (sub->size - sub->len < 4096) {
+            mem = realloc(sub->buf, sub->size + 16384);
+            if (!mem) {
+                return -1;
+            }
+            sub->buf = mem;
+            sub->size += 16384;
+        }
+
+        r = read(sub->in, sub->buf + sub->len, sub->size - sub->len - 1);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            fprintf(stderr, "Subscriber %u: read failed (%s).\n", nc_session_get_id(sub->session), strerror(errno));
+            return -1;
+        } else if (!r) {
+            return 0;
+        }
+        sub->len += r;
+        sub->buf[sub->len] = '\0';
+
+        /* the notification number is its session-id */
+        for (msg = sub->buf; (end = strstr(msg, "]]>]]>")); msg = end + 6) {
+            *end = '\0';
+            id = strstr(msg, "<session-id>");
+            if (!id) {
+                continue;
+            }
+            seq = strtoull(id + 12, NULL, 10) - 1;
+            lat = now_ns() - inject_ns[seq];
+
+            ++sub->received;
+            sub->lat_sum += lat;
+            if (lat > sub->lat_max) {
+                sub->lat_max = lat;
+            }
+            if (!sub->stalled && lat_add(&reader->lat[sub->filter], lat)) {
+                return -1;
+            }
+            __atomic_add_fetch(&delivered, 1, __ATOMIC_RELAXED);
+        }
+        sub->len -= msg - sub->buf;
+        memmove(sub->buf, msg, sub->len);
+    }
+}
+
+static void *
+reader_thread(void *arg)
+{
+    struct bench_reader *reader = arg;
+    struct pollfd *pfds;
+    uint32_t i;
+
+    pfds = calloc(reader->sub_count, sizeof *pfds);
+    if (!pfds) {
+        reader->failed = 1;
+        return NULL;
+    }
+
+    while (!readers_stop && !reader->failed) {
+        /* the stalled subscriber is not read until its stall ends */
+        for (i = 0; i < reader->sub_count; ++i) {
+            pfds[i].fd = (reader->subs[i].stalled && (now_ns() < stall_end)) ? -1 : reader->subs[i].in;
+            pfds[i].events = POLLIN;
+        }
+        if (poll(pfds, reader->sub_count, 10) < 1) {
+            continue;
+        }
+        for (i = 0; i < reader->sub_count; ++i) {
+            if ((pfds[i].revents & (POLLIN | POLLHUP)) && sub_recv(reader, &reader->subs[i])) {
+                reader->failed = 1;
+                break;
+            }
+        }
+    }
+
+    free(pfds);
+    return NULL;
+}
+
+/*
+ * RESULTS
+ */
+static int
+cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* nearest-rank percentile of sorted values, in us */
+static double
+percentile(const struct bench_lat *lat, double p)
+{
+    uint64_t rank;
+
+    rank = (uint64_t)((p / 100.0) * lat->count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return lat->val[rank - 1] / 1e3;
+}
+
+static void
+lat_print(const char *name, struct bench_lat *lat)
+{
+    qsort(lat->val, lat->count, sizeof *lat->val, cmp_u64);
+    fprintf(stdout, "%-12s count: %lu, (us) p50: %.1f, p90: %.1f, p99: %.1f, p99.9: %.1f, max: %.1f\n", name,
+            (unsigned long)lat->count, percentile(lat, 50), percentile(lat, 90), percentile(lat, 99),
+            percentile(lat, 99.9), lat->val[lat->count - 1] / 1e3);
+    perf_report_add("us", percentile(lat, 50), "%s/p50", name);
+    perf_report_add("us", percentile(lat, 99), "%s/p99", name);
+}
+
+static int
+parse_mix(const char *mix, uint32_t *weights)
+{
+    char *dup, *item, *eq, *ptr, *saveptr;
+    unsigned long w;
+    BENCH_FLT flt;
+
+    memset(weights, 0, BENCH_FLT_COUNT * sizeof *weights);
+    dup = strdup(mix);
+    if (!dup) {
+        return -1;
+    }
+    for (item = strtok_r(dup, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        eq = strchr(item, '=');
+        if (!eq) {
+            goto error;
+        }
+        *eq = '\0';
+        for (flt = 0; (flt < BENCH_FLT_COUNT) && strcmp(item, bench_flt_names[flt]); ++flt);
+        w = strtoul(eq + 1, &ptr, 10);
+        if ((flt == BENCH_FLT_COUNT) || ptr[0] || (w > UINT16_MAX)) {
+            goto error;
+        }
+        weights[flt] = w;
+    }
+    free(dup);
+
+    return (weights[BENCH_FLT_NONE] + weights[BENCH_FLT_IDENTICAL] + weights[BENCH_FLT_DISTINCT]) ? 0 : -1;
+
+error:
+    free(dup);
+    return -1;
+}
+
+static void
+bench_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-s subscribers] [-m mix] [-g groups] [-n notifications] [-r rate] [-c readers] [-x ms]\n"
+            "       [-o report]\n", progname);
+    fprintf(stdout, " -s subscribers      number of subscribed fake sessions (default 64)\n");
+    fprintf(stdout, " -m mix              <filter>=<weight>[,...] of none, identical and distinct\n");
+    fprintf(stdout, "                     (default none=1,identical=1,distinct=1)\n");
+    fprintf(stdout, " -g groups           distinct filters match the username of 1 of groups notifications (default 4)\n");
+    fprintf(stdout, " -n notifications    injected notifications (default 10000)\n");
+    fprintf(stdout, " -r rate             target injection rate per second, 0 for unlimited (default 1000)\n");
+    fprintf(stdout, " -c readers          threads reading the subscriber sessions (default 4)\n");
+    fprintf(stdout, " -x ms               the first subscriber is not read for ms since the injection start,\n");
+    fprintf(stdout, "                     0 for no stalled subscriber (default 0)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_sub *subs = NULL;
+    struct bench_reader *readers = NULL;
+    struct bench_lat total, inject;
+    sr_node_t trees[3];
+    char username[16];
+    uint32_t sub_count = 64, groups = 4, reader_count = 4, rate = 1000, stall = 0, notif_count = 10000;
+    uint32_t weights[BENCH_FLT_COUNT], i, j, per_reader, started = 0, class_count[BENCH_FLT_COUNT];
+    uint64_t start, elapsed, last, expected = 0, ns, avg, avg_min, avg_max;
+    const char *report = NULL;
+    struct timespec ts;
+    int c, fds[2], ret = EXIT_FAILURE;
+    BENCH_FLT flt;
+
+    memset(&inject, 0, sizeof inject);
+    parse_mix("none=1,identical=1,distinct=1", weights);
+
+    while ((c = getopt(argc, argv, "s:m:g:n:r:c:x:o:h")) != -1) {
+        switch (c) {
+        case 's':
+            sub_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (parse_mix(optarg, weights)) {
+                fprintf(stderr, "Invalid filter mix \"%s\".\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'g':
+            groups = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            notif_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rate = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            reader_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'x':
+            stall = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!sub_count || (sub_count > UINT16_MAX) || !groups || !notif_count || !reader_count) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (reader_count > sub_count) {
+        reader_count = sub_count;
+    }
+    if (report && perf_report_open(report, "bench_notif")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* a stalled transport fills its buffer and blocks the writer, it is what is measured */
+    signal(SIGPIPE, SIG_IGN);
+
+    openlog("bench_notif", LOG_PERROR, LOG_USER);
+    np2_verbose_level = NC_VERB_ERROR;
+    nc_verbosity(np2_verbose_level);
+    nc_set_print_clb(np2log_clb_nc2);
+    ly_set_log_clb(np2log_clb_ly, 1);
+
+    if (server_init() || !notif_tree_clb) {
+        fprintf(stderr, "Server init failed.\n");
+        goto cleanup;
+    }
+
+    subs = calloc(sub_count, sizeof *subs);
+    readers = calloc(reader_count, sizeof *readers);
+    inject_ns = calloc(notif_count, sizeof *inject_ns);
+    if (!subs || !readers || !inject_ns) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        goto cleanup;
+    }
+
+    /* filter classes are assigned to the subscribers in proportion to their weights */
+    memset(class_count, 0, sizeof class_count);
+    for (i = 0; i < sub_count; ++i) {
+        subs[i].in = subs[i].out = -1;
+        for (flt = 0, j = i % (weights[0] + weights[1] + weights[2]); j >= weights[flt]; ++flt) {
+            j -= weights[flt];
+        }
+        subs[i].filter = flt;
+        subs[i].group = i % groups;
+        ++class_count[flt];
+
+        if (pipe(fds) == -1) {
+            fprintf(stderr, "Failed to create session %u (%s).\n", i + 1, strerror(errno));
+            goto cleanup;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        subs[i].in = fds[0];
+        subs[i].out = fds[1];
+
+        subs[i].session = session_new(i + 1, subs[i].out, "user1");
+        if (subs[i].session) {
+            /* the subscriber index is kept there */
+            nc_session_set_data(subs[i].session, calloc(1, sizeof(struct np2_sessions)));
+        }
+        if (!subs[i].session || !nc_session_get_data(subs[i].session) || sub_subscribe(&subs[i])) {
+            fprintf(stderr, "Failed to subscribe session %u.\n", i + 1);
+            goto cleanup;
+        }
+
+        /* every notification has the username of one of the groups */
+        subs[i].expected = notif_count;
+        if (subs[i].filter == BENCH_FLT_DISTINCT) {
+            subs[i].expected = notif_count / groups + ((subs[i].group < notif_count % groups) ? 1 : 0);
+        }
+        expected += subs[i].expected;
+    }
+    if (stall) {
+        /* the smallest transport buffer, so that it fills up soon, the stalled subscriber is reported alone */
+        fcntl(subs[0].out, F_SETPIPE_SZ, 4096);
+        --class_count[subs[0].filter];
+        subs[0].stalled = 1;
+    }
+
+    /* subscribers are split evenly among the readers */
+    per_reader = sub_count / reader_count;
+    for (i = 0, j = 0; i < reader_count; ++i) {
+        readers[i].subs = &subs[j];
+        readers[i].sub_count = per_reader + ((i < sub_count % reader_count) ? 1 : 0);
+        j += readers[i].sub_count;
+    }
+
+    /* the notification sysrepo would deliver, session-id carries its number */
+    memset(trees, 0, sizeof trees);
+    trees[0].name = "username";
+    trees[0].type = SR_STRING_T;
+    trees[0].data.string_val = username;
+    trees[0].module_name = "ietf-netconf-notifications";
+    trees[1].name = "session-id";
+    trees[1].type = SR_UINT32_T;
+    trees[1].module_name = "ietf-netconf-notifications";
+    trees[2].name = "source-host";
+    trees[2].type = SR_STRING_T;
+    trees[2].data.string_val = "127.0.0.1";
+    trees[2].module_name = "ietf-netconf-notifications";
+
+    stall_end = stall ? UINT64_MAX : 0;
+    for (i = 0; i < reader_count; ++i) {
+        if (pthread_create(&readers[i].tid, NULL, reader_thread, &readers[i])) {
+            fprintf(stderr, "Failed to start a reader thread.\n");
+            goto cleanup;
+        }
+        ++started;
+    }
+
+    /* open loop, every notification has its scheduled time, a late one is injected at once */
+    lock_measure = 1;
+    start = now_ns();
+    if (stall) {
+        stall_end = start + (uint64_t)stall * 1000000;
+    }
+    for (i = 0; i < notif_count; ++i) {
+        if (rate) {
+            ns = start + (uint64_t)i * 1000000000 / rate;
+            ts.tv_sec = ns / 1000000000;
+            ts.tv_nsec = ns % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+
+        sprintf(username, "user%u", i % groups);
+        trees[1].data.uint32_val = i + 1;
+
+        inject_ns[i] = now_ns();
+        notif_tree_clb(SR_EV_NOTIF_T_REALTIME, BENCH_NTF_XPATH, trees, 3, time(NULL), NULL);
+        if (lat_add(&inject, now_ns() - inject_ns[i])) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+    }
+    elapsed = now_ns() - start;
+    lock_measure = 0;
+
+    /* wait for the readers to receive everything, what was not delivered in 10 s after the stall is lost */
+    last = now_ns();
+    while ((delivered < expected) && (now_ns() < ((stall_end > last) ? stall_end : last) + 10000000000ULL)) {
+        usleep(1000);
+    }
+    last = now_ns() - start;
+    readers_stop = 1;
+    for (i = 0; i < started; ++i) {
+        pthread_join(readers[i].tid, NULL);
+    }
+    started = 0;
+    for (i = 0; i < reader_count; ++i) {
+        if (readers[i].failed) {
+            fprintf(stderr, "Reader %u failed, the results are not valid.\n", i + 1);
+            goto cleanup;
+        }
+    }
+
+    fprintf(stdout, "Subscribers: %u (none %u, identical %u, distinct %u in %u groups%s), notifications: %u, "
+            "target rate: %u/s\n", sub_count, class_count[BENCH_FLT_NONE], class_count[BENCH_FLT_IDENTICAL],
+            class_count[BENCH_FLT_DISTINCT], groups, stall ? ", 1 stalled" : "", notif_count, rate);
+    fprintf(stdout, "Injection    rate: %.1f/s, duration: %.2f s\n", notif_count / (elapsed / 1e9), elapsed / 1e9);
+    perf_report_add("1/s", notif_count / (elapsed / 1e9), "injection/rate");
+    lat_print("callback", &inject);
+    if (lock_held.count) {
+        lat_print("lock held", &lock_held);
+    }
+    fprintf(stdout, "Delivery     deliveries: %lu of %lu, throughput: %.1f/s, last after: %.2f s\n",
+            (unsigned long)delivered, (unsigned long)expected, delivered / (last / 1e9), last / 1e9);
+    perf_report_add("1/s", delivered / (last / 1e9), "delivery/throughput");
+    perf_report_add("notifications", expected - delivered, "delivery/lost");
+
+    /* latencies from the injection to the reception by the subscriber */
+    for (flt = 0; flt < BENCH_FLT_COUNT; ++flt) {
+        memset(&total, 0, sizeof total);
+        for (i = 0; i < reader_count; ++i) {
+            total.count += readers[i].lat[flt].count;
+        }
+        if (!total.count) {
+            continue;
+        }
+        total.val = malloc(total.count * sizeof *total.val);
+        if (!total.val) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+        for (i = 0, j = 0; i < reader_count; ++i) {
+            memcpy(total.val + j, readers[i].lat[flt].val, readers[i].lat[flt].count * sizeof *total.val);
+            j += readers[i].lat[flt].count;
+        }
+        lat_print(bench_flt_names[flt], &total);
+        free(total.val);
+
+        /* spread of the subscriber averages, the fan-out order makes the later subscribers wait longer */
+        avg_min = UINT64_MAX;
+        avg_max = 0;
+        for (i = 0; i < sub_count; ++i) {
+            if ((subs[i].filter != flt) || subs[i].stalled || !subs[i].received) {
+                continue;
+            }
+            avg = subs[i].lat_sum / subs[i].received;
+            if (avg < avg_min) {
+                avg_min = avg;
+            }
+            if (avg > avg_max) {
+                avg_max = avg;
+            }
+        }
+        fprintf(stdout, "%-12s subscriber avg (us) min: %.1f, max: %.1f\n", "", avg_min / 1e3, avg_max / 1e3);
+    }
+    if (stall) {
+        fprintf(stdout, "stalled      deliveries: %lu of %lu, stalled for %u ms, latency (us) avg: %.1f, max: %.1f\n",
+                (unsigned long)subs[0].received, (unsigned long)subs[0].expected, stall,
+                subs[0].received ? subs[0].lat_sum / 1e3 / subs[0].received : 0, subs[0].lat_max / 1e3);
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    readers_stop = 1;
+    for (i = 0; i < started; ++i) {
+        pthread_join(readers[i].tid, NULL);
+    }
+    for (i = 0; subs && (i < sub_count); ++i) {
+        /* notificationComplete fails at once on a closed transport */
+        if (subs[i].in > -1) {
+            close(subs[i].in);
+        }
+        if (subs[i].session) {
+            if (nc_session_get_notif_status(subs[i].session)) {
+                op_ntf_unsubscribe(subs[i].session, 0);
+            }
+            free(nc_session_get_data(subs[i].session));
+            session_free(subs[i].session);
+        }
+        if (subs[i].out > -1) {
+            close(subs[i].out);
+        }
+        free(subs[i].buf);
+    }
+    for (i = 0; readers && (i < reader_count); ++i) {
+        for (flt = 0; flt < BENCH_FLT_COUNT; ++flt) {
+            free(readers[i].lat[flt].val);
+        }
+    }
+    free(subs);
+    free(readers);
+    free(inject_ns);
+    free(inject.val);
+    free(lock_held.val);
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    chm_destroy();
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    nc_ps_free(np2srv.nc_ps);
+    nc_server_destroy();
+    ncm_destroy();
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
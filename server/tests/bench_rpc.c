@@ -0,0 +1,377 @@
+/**
+ * @file bench_rpc.c
+ * @brief RPC round-trip latency benchmark of a running netopeer2-server.
+ *
+ * Copyright (c) 2016 - 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HELLO "<hello xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><capabilities>" \
+              "<capability>urn:ietf:params:netconf:base:1.1</capability></capabilities></hello>]]>]]>"
+
+/* a small get, it goes through sysrepo and the monitoring state data */
+#define RPC "<rpc xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\" message-id=\"%u\"><get>" \
+            "<filter type=\"subtree\"><netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\">" \
+            "<statistics/></netconf-state></filter></get></rpc>"
+
+#define CLOSE "<rpc xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\" message-id=\"0\"><close-session/></rpc>"
+
+/* NETCONF over a pair of file descriptors, the transport is someone else's business */
+struct conn {
+    int in;
+    int out;
+    pid_t pid;               /**< ssh subprocess, 0 for a UNIX socket */
+    char buf[4096];
+    size_t len;
+    size_t pos;
+};
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+write_all(int fd, const char *data, size_t len)
+{
+    ssize_t w;
+
+    while (len) {
+        w = write(fd, data, len);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += w;
+        len -= w;
+    }
+
+    return 0;
+}
+
+static int
+read_char(struct conn *cn)
+{
+    ssize_t r;
+
+    if (cn->pos == cn->len) {
+        do {
+            r = read(cn->in, cn->buf, sizeof cn->buf);
+        } while ((r == -1) && (errno == EINTR));
+        if (r < 1) {
+            return -1;
+        }
+        cn->len = r;
+        cn->pos = 0;
+    }
+
+    return (unsigned char)cn->buf[cn->pos++];
+}
+
+/* skips the server hello, framed by the end-of-message delimiter */
+static int
+read_hello(struct conn *cn)
+{
+    const char *delim = "]]>]]>";
+    size_t matched = 0;
+    int c;
+
+    while (delim[matched]) {
+        c = read_char(cn);
+        if (c == -1) {
+            return -1;
+        }
+        if (c == delim[matched]) {
+            ++matched;
+        } else {
+            matched = (c == delim[0]);
+        }
+    }
+
+    return 0;
+}
+
+/* skips a chunked-framed message, its content is of no interest */
+static int
+read_message(struct conn *cn)
+{
+    size_t chunk;
+    int c;
+
+    while (1) {
+        if ((read_char(cn) != '\n') || (read_char(cn) != '#')) {
+            return -1;
+        }
+        c = read_char(cn);
+        if (c == '#') {
+            /* end of chunks */
+            return (read_char(cn) == '\n') ? 0 : -1;
+        }
+
+        chunk = 0;
+        while ((c >= '0') && (c <= '9')) {
+            chunk = chunk * 10 + (c - '0');
+            c = read_char(cn);
+        }
+        if ((c != '\n') || !chunk) {
+            return -1;
+        }
+        while (chunk--) {
+            if (read_char(cn) == -1) {
+                return -1;
+            }
+        }
+    }
+}
+
+static int
+write_message(struct conn *cn, const char *msg)
+{
+    char header[32];
+    size_t len;
+
+    len = strlen(msg);
+    sprintf(header, "\n#%zu\n", len);
+    if (write_all(cn->out, header, strlen(header)) || write_all(cn->out, msg, len)
+            || write_all(cn->out, "\n##\n", 4)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+connect_unix(struct conn *cn, const char *path)
+{
+    struct sockaddr_un saddr;
+    int sock;
+
+    if (strlen(path) >= sizeof saddr.sun_path) {
+        fprintf(stderr, "UNIX socket path \"%s\" is too long.\n", path);
+        return -1;
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1) {
+        fprintf(stderr, "Failed to create UNIX socket (%s).\n", strerror(errno));
+        return -1;
+    }
+    memset(&saddr, 0, sizeof saddr);
+    saddr.sun_family = AF_UNIX;
+    strcpy(saddr.sun_path, path);
+    if (connect(sock, (struct sockaddr *)&saddr, sizeof saddr) == -1) {
+        fprintf(stderr, "Failed to connect to \"%s\" (%s).\n", path, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    cn->in = cn->out = sock;
+    cn->pid = 0;
+    return 0;
+}
+
+/* the NETCONF subsystem through the ssh client, authenticated as the user would on the command line */
+static int
+connect_ssh(struct conn *cn, const char *dest, const char *port)
+{
+    int to_ssh[2], from_ssh[2];
+    pid_t pid;
+
+    if (pipe(to_ssh) == -1) {
+        return -1;
+    }
+    if (pipe(from_ssh) == -1) {
+        close(to_ssh[0]);
+        close(to_ssh[1]);
+        return -1;
+    }
+
+    pid = fork();
+    if (pid == -1) {
+        close(to_ssh[0]);
+        close(to_ssh[1]);
+        close(from_ssh[0]);
+        close(from_ssh[1]);
+        return -1;
+    } else if (!pid) {
+        dup2(to_ssh[0], STDIN_FILENO);
+        dup2(from_ssh[1], STDOUT_FILENO);
+        close(to_ssh[0]);
+        close(to_ssh[1]);
+        close(from_ssh[0]);
+        close(from_ssh[1]);
+        execlp("ssh", "ssh", "-q", "-p", port, "-s", dest, "netconf", (char *)NULL);
+        fprintf(stderr, "Failed to execute ssh (%s).\n", strerror(errno));
+        _exit(127);
+    }
+
+    close(to_ssh[0]);
+    close(from_ssh[1]);
+    cn->in = from_ssh[0];
+    cn->out = to_ssh[1];
+    cn->pid = pid;
+    return 0;
+}
+
+static void
+conn_close(struct conn *cn)
+{
+    close(cn->in);
+    if (cn->out != cn->in) {
+        close(cn->out);
+    }
+    if (cn->pid) {
+        waitpid(cn->pid, NULL, 0);
+    }
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* sends count RPCs one after another, each waiting for its reply */
+static int
+bench(const char *name, struct conn *cn, unsigned int count)
+{
+    char rpc[sizeof RPC + 16];
+    uint64_t *lat, sum = 0, start;
+    unsigned int i;
+    int ret = -1;
+
+    lat = malloc(count * sizeof *lat);
+    if (!lat) {
+        return -1;
+    }
+
+    if (write_all(cn->out, HELLO, strlen(HELLO)) || read_hello(cn)) {
+        fprintf(stderr, "%s: NETCONF hello exchange failed.\n", name);
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; ++i) {
+        sprintf(rpc, RPC, i + 1);
+        start = now_ns();
+        if (write_message(cn, rpc) || read_message(cn)) {
+            fprintf(stderr, "%s: RPC %u failed.\n", name, i + 1);
+            goto cleanup;
+        }
+        lat[i] = now_ns() - start;
+        sum += lat[i];
+    }
+
+    if (!write_message(cn, CLOSE)) {
+        read_message(cn);
+    }
+
+    qsort(lat, count, sizeof *lat, cmp_u64);
+    fprintf(stdout, "%-6s RPCs: %u, latency (us) min: %.1f, mean: %.1f, p50: %.1f, p99: %.1f, max: %.1f\n", name,
+            count, lat[0] / 1e3, (sum / count) / 1e3, lat[count / 2] / 1e3, lat[(count * 99) / 100] / 1e3,
+            lat[count - 1] / 1e3);
+    ret = 0;
+
+cleanup:
+    free(lat);
+    return ret;
+}
+
+static void
+print_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-U path] [-S [user@]host] [-p port] [-n count]\n", progname);
+    fprintf(stdout, " -U path             server UNIX socket\n");
+    fprintf(stdout, " -S [user@]host      server reachable by the ssh client\n");
+    fprintf(stdout, " -p port             server SSH port (default 830)\n");
+    fprintf(stdout, " -n count            number of RPCs per transport (default 1000)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *path = NULL, *dest = NULL, *port = "830";
+    int c, ret = EXIT_SUCCESS;
+    unsigned int count = 1000;
+    struct conn cn;
+
+    while ((c = getopt(argc, argv, "U:S:p:n:h")) != -1) {
+        switch (c) {
+        case 'U':
+            path = optarg;
+            break;
+        case 'S':
+            dest = optarg;
+            break;
+        case 'p':
+            port = optarg;
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((!path && !dest) || !count) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* a failed write is reported, not fatal */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path) {
+        memset(&cn, 0, sizeof cn);
+        if (connect_unix(&cn, path)) {
+            ret = EXIT_FAILURE;
+        } else {
+            if (bench("unix", &cn, count)) {
+                ret = EXIT_FAILURE;
+            }
+            conn_close(&cn);
+        }
+    }
+
+    if (dest) {
+        memset(&cn, 0, sizeof cn);
+        if (connect_ssh(&cn, dest, port)) {
+            fprintf(stderr, "Failed to start ssh (%s).\n", strerror(errno));
+            ret = EXIT_FAILURE;
+        } else {
+            if (bench("ssh", &cn, count)) {
+                ret = EXIT_FAILURE;
+            }
+            conn_close(&cn);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,1018 @@
+/**
+ * @file bench_sessions.c
+ * @brief Concurrent-session RPC throughput benchmark of np2srv over fake transport sessions.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/bench_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "fake_session.h"
+#include "perf_report.h"
+
+#define BENCH_RPC_START "<rpc message-id=\"%u\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+#define BENCH_RPC_END "</rpc>]]>]]>"
+
+typedef enum {
+    BENCH_GET,
+    BENCH_GETCONFIG,
+    BENCH_EDIT,
+    BENCH_LOCK,
+    BENCH_UNLOCK,
+    BENCH_OP_COUNT
+} BENCH_OP;
+
+static const char *bench_op_names[BENCH_OP_COUNT] = {"get", "get-config", "edit-config", "lock", "unlock"};
+
+/* operation content, edit-config gets the number of the session */
+static const char *bench_op_content[BENCH_OP_COUNT] = {
+    "<get><filter type=\"subtree\"><netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\">"
+        "<statistics/></netconf-state></filter></get>",
+    "<get-config><source><running/></source></get-config>",
+    "<edit-config><target><running/></target><config>"
+        "<interfaces xmlns=\"urn:ietf:params:xml:ns:yang:ietf-interfaces\""
+        " xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\"><interface>"
+        "<name>iface%u</name><type>ianaift:ethernetCsmacd</type><enabled>true</enabled>"
+        "</interface></interfaces></config></edit-config>",
+    "<lock><target><running/></target></lock>",
+    "<unlock><target><running/></target></unlock>"
+};
+
+/* one fake session, the server uses srv_in and srv_out, the client the other pipe ends */
+struct bench_conn {
+    int srv_in;
+    int srv_out;
+    int in;
+    int out;
+    uint32_t id;
+
+    char *buf;
+    size_t len;
+    size_t size;
+    BENCH_OP op;
+    int busy;
+    int locked;                 /* the last lock succeeded */
+    uint64_t sent;              /* ns */
+    uint32_t msgid;
+};
+
+/* latencies of one operation, in us */
+struct bench_lat {
+    uint32_t *lat;
+    uint64_t count;
+    uint64_t size;
+    uint64_t errors;
+};
+
+struct bench_client {
+    pthread_t tid;
+    struct bench_conn *conns;
+    uint32_t conn_count;
+    struct bench_lat ops[BENCH_OP_COUNT];
+    unsigned int seed;
+    int failed;
+};
+
+static struct bench_conn *conns;
+static uint32_t conn_count, accepted;
+static pthread_mutex_t accept_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t weights[BENCH_OP_COUNT], weight_sum;
+static pthread_barrier_t start_barrier;
+static volatile uint64_t bench_end;
+
+/*
+ * SYSREPO WRAPPER FUNCTIONS
+ */
+int
+__wrap_sr_connect(const char *app_name, const sr_conn_options_t opts, sr_conn_ctx_t **conn_ctx)
+{
+    (void)app_name;
+    (void)opts;
+    (void)conn_ctx;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_start(sr_conn_ctx_t *conn_ctx, const sr_datastore_t datastore,
+                        const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)conn_ctx;
+    (void)datastore;
+    (void)opts;
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_list_schemas(sr_session_ctx_t *session, sr_schema_t **schemas, size_t *schema_cnt)
+{
+    (void)session;
+
+    *schema_cnt = 4;
+
+    *schemas = calloc(4, sizeof **schemas);
+
+    (*schemas)[0].module_name = strdup("ietf-netconf-server");
+    (*schemas)[0].installed = 1;
+
+    (*schemas)[1].module_name = strdup("ietf-interfaces");
+    (*schemas)[1].ns = strdup("urn:ietf:params:xml:ns:yang:ietf-interfaces");
+    (*schemas)[1].prefix = strdup("if");
+    (*schemas)[1].revision.revision = strdup("2014-05-08");
+    (*schemas)[1].revision.file_path_yin = strdup(TESTS_DIR"/files/ietf-interfaces.yin");
+    (*schemas)[1].enabled_features = malloc(sizeof(char *));
+    (*schemas)[1].enabled_features[0] = strdup("if-mib");
+    (*schemas)[1].enabled_feature_cnt = 1;
+    (*schemas)[1].installed = 1;
+
+    (*schemas)[2].module_name = strdup("ietf-ip");
+    (*schemas)[2].ns = strdup("urn:ietf:params:xml:ns:yang:ietf-ip");
+    (*schemas)[2].prefix = strdup("ip");
+    (*schemas)[2].revision.revision = strdup("2014-06-16");
+    (*schemas)[2].revision.file_path_yin = strdup(TESTS_DIR"/files/ietf-ip.yin");
+    (*schemas)[2].enabled_features = malloc(2 * sizeof(char *));
+    (*schemas)[2].enabled_features[0] = strdup("ipv4-non-contiguous-netmasks");
+    (*schemas)[2].enabled_features[1] = strdup("ipv6-privacy-autoconf");
+    (*schemas)[2].enabled_feature_cnt = 2;
+    (*schemas)[2].installed = 1;
+
+    (*schemas)[3].module_name = strdup("iana-if-type");
+    (*schemas)[3].ns = strdup("urn:ietf:params:xml:ns:yang:iana-if-type");
+    (*schemas)[3].prefix = strdup("if");
+    (*schemas)[3].revision.revision = strdup("2014-05-08");
+    (*schemas)[3].revision.file_path_yin = strdup(TESTS_DIR"/files/iana-if-type.yin");
+    (*schemas)[3].installed = 1;
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_schema(sr_session_ctx_t *session, const char *module_name, const char *revision,
+                     const char *submodule_name, sr_schema_format_t format, char **schema_content)
+{
+    int fd;
+    struct stat st;
+    (void)session;
+    (void)revision;
+    (void)submodule_name;
+    (void)format;
+
+    if (!strcmp(module_name, "ietf-netconf-server")) {
+        *schema_content = strdup("<module name=\"ietf-netconf-server\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\"><namespace uri=\"ns\"/><prefix value=\"pr\"/></module>");
+        return SR_ERR_OK;
+    }
+    if (!strcmp(module_name, "iana-if-type")) {
+        fd = open(TESTS_DIR "/files/iana-if-type.yin", O_RDONLY);
+    } else if (!strcmp(module_name, "ietf-interfaces")) {
+        fd = open(TESTS_DIR "/files/ietf-interfaces.yin", O_RDONLY);
+    } else if (!strcmp(module_name, "ietf-ip")) {
+        fd = open(TESTS_DIR "/files/ietf-ip.yin", O_RDONLY);
+    } else {
+        return SR_ERR_NOT_FOUND;
+    }
+    if ((fd == -1) || fstat(fd, &st)) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return SR_ERR_IO;
+    }
+
+    *schema_content = malloc(st.st_size + 1);
+    if (read(fd, *schema_content, st.st_size) != st.st_size) {
+        free(*schema_content);
+        close(fd);
+        return SR_ERR_IO;
+    }
+    close(fd);
+    (*schema_content)[st.st_size] = '\0';
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_start_user(sr_conn_ctx_t *conn_ctx, const char *user_name, const sr_datastore_t datastore,
+                             const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)conn_ctx;
+    (void)user_name;
+    (void)datastore;
+    (void)opts;
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_stop(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+void
+__wrap_sr_disconnect(sr_conn_ctx_t *conn_ctx)
+{
+    (void)conn_ctx;
+}
+
+int
+__wrap_sr_session_refresh(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_switch_ds(sr_session_ctx_t *session, sr_datastore_t ds)
+{
+    (void)session;
+    (void)ds;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_install_subscribe(sr_session_ctx_t *session, sr_module_install_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_feature_enable_subscribe(sr_session_ctx_t *session, sr_feature_enable_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_change_subscribe(sr_session_ctx_t *session, const char *module_name, sr_module_change_cb callback,
+                                  void *private_ctx, uint32_t priority, sr_subscr_options_t opts,
+                                  sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)module_name;
+    (void)callback;
+    (void)private_ctx;
+    (void)priority;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+/* the datastore is empty, only the server itself is measured */
+int
+__wrap_sr_get_items_iter(sr_session_ctx_t *session, const char *xpath, sr_val_iter_t **iter)
+{
+    (void)session;
+
+    *iter = (sr_val_iter_t *)strdup(xpath);
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_item_next(sr_session_ctx_t *session, sr_val_iter_t *iter, sr_val_t **value)
+{
+    (void)session;
+    (void)iter;
+
+    *value = NULL;
+    return SR_ERR_NOT_FOUND;
+}
+
+void
+__wrap_sr_free_val_iter(sr_val_iter_t *iter)
+{
+    free(iter);
+}
+
+int
+__wrap_sr_set_item(sr_session_ctx_t *session, const char *xpath, const sr_val_t *value, const sr_edit_options_t opts)
+{
+    (void)session;
+    (void)xpath;
+    (void)value;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_delete_item(sr_session_ctx_t *session, const char *xpath, const sr_edit_options_t opts)
+{
+    (void)session;
+    (void)xpath;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_move_item(sr_session_ctx_t *session, const char *xpath, const sr_move_position_t position, const char *relative_item)
+{
+    (void)session;
+    (void)xpath;
+    (void)position;
+    (void)relative_item;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_commit(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_discard_changes(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_lock_datastore(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_unlock_datastore(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *values,
+                           const size_t values_cnt, sr_ev_notif_flag_t opts)
+{
+    (void)session;
+    (void)xpath;
+    (void)values;
+    (void)values_cnt;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+/*
+ * LIBNETCONF2 WRAPPER FUNCTIONS
+ */
+struct nc_session {
+    NC_STATUS status;
+    NC_SESSION_TERM_REASON term_reason;
+    int side;
+
+    uint32_t id;
+    int version;
+
+    NC_TRANSPORT_IMPL ti_type;
+    pthread_mutex_t *ti_lock;
+    pthread_cond_t *ti_cond;
+    volatile int *ti_inuse;
+    union {
+        struct {
+            int in;
+            int out;
+        } fd;
+#ifdef NC_ENABLED_SSH
+        struct {
+            void *channel;
+            void *session;
+            struct nc_session *next;
+        } libssh;
+#endif
+#ifdef NC_ENABLED_TLS
+        void *tls;
+#endif
+    } ti;
+    const char *username;
+    const char *host;
+    uint16_t port;
+
+    struct ly_ctx *ctx;
+    void *data;
+    uint8_t flags;
+
+    union {
+        struct {
+            uint64_t msgid;
+            const char **cpblts;
+            struct nc_msg_cont *replies;
+            struct nc_msg_cont *notifs;
+            volatile pthread_t *ntf_tid;
+        } client;
+        struct {
+            time_t session_start;
+            time_t last_rpc;
+            int ntf_status;
+            pthread_mutex_t *ch_lock;
+            pthread_cond_t *ch_cond;
+#ifdef NC_ENABLED_SSH
+            uint16_t ssh_auth_attempts;
+#endif
+#ifdef NC_ENABLED_TLS
+            void *client_cert;
+#endif
+        } server;
+    } opts;
+};
+
+/* every accepting worker gets the next prepared session until there are none left */
+NC_MSG_TYPE
+__wrap_nc_accept(int timeout, struct nc_session **session)
+{
+    struct bench_conn *conn = NULL;
+
+    pthread_mutex_lock(&accept_lock);
+    if (accepted < conn_count) {
+        conn = &conns[accepted++];
+    }
+    pthread_mutex_unlock(&accept_lock);
+
+    if (!conn) {
+        /* what nc_accept() does with no new connection */
+        usleep(timeout * 1000);
+        return NC_MSG_WOULDBLOCK;
+    }
+
+    *session = calloc(1, sizeof **session);
+    (*session)->status = NC_STATUS_RUNNING;
+    (*session)->side = 1;
+    (*session)->id = conn->id;
+    (*session)->ti_lock = malloc(sizeof *(*session)->ti_lock);
+    pthread_mutex_init((*session)->ti_lock, NULL);
+    (*session)->ti_cond = malloc(sizeof *(*session)->ti_cond);
+    pthread_cond_init((*session)->ti_cond, NULL);
+    (*session)->ti_inuse = malloc(sizeof *(*session)->ti_inuse);
+    *(*session)->ti_inuse = 0;
+    (*session)->ti_type = NC_TI_FD;
+    (*session)->ti.fd.in = conn->srv_in;
+    (*session)->ti.fd.out = conn->srv_out;
+    (*session)->ctx = np2srv.ly_ctx;
+    (*session)->flags = 1; //shared ctx
+    (*session)->username = "user1";
+    (*session)->host = "localhost";
+    (*session)->opts.server.session_start = (*session)->opts.server.last_rpc = time(NULL);
+
+    return NC_MSG_HELLO;
+}
+
+void
+__wrap_nc_session_free(struct nc_session *session, void (*data_free)(void *))
+{
+    if (data_free) {
+        data_free(session->data);
+    }
+    pthread_mutex_destroy(session->ti_lock);
+    free(session->ti_lock);
+    pthread_cond_destroy(session->ti_cond);
+    free(session->ti_cond);
+    free((int *)session->ti_inuse);
+    free(session);
+}
+
+int
+__wrap_nc_server_endpt_count(void)
+{
+    return 1;
+}
+
+/*
+ * SERVER THREAD
+ */
+static pthread_t server_tid;
+static char server_shards[16];
+
+static void *
+server_thread(void *arg)
+{
+    (void)arg;
+    char *argv[] = {"netopeer2-server", "-d", "-v0", "-a", server_shards};
+
+    return (void *)(int64_t)server_main(5, argv);
+}
+
+/*
+ * CLIENTS
+ */
+static int
+conn_send(struct bench_conn *conn, BENCH_OP op)
+{
+    char msg[1024];
+    struct pollfd pfd;
+    int len, off;
+    ssize_t w;
+
+    len = sprintf(msg, BENCH_RPC_START, ++conn->msgid);
+    len += sprintf(msg + len, bench_op_content[op], conn->id);
+    len += sprintf(msg + len, "%s", BENCH_RPC_END);
+
+    conn->op = op;
+    conn->len = 0;
+    conn->busy = 1;
+    conn->sent = now_ns();
+
+    for (off = 0; off < len; off += w) {
+        w = write(conn->out, msg + off, len - off);
+        if (w == -1) {
+            if ((errno != EAGAIN) && (errno != EINTR)) {
+                fprintf(stderr, "Session %u: write failed (%s).\n", conn->id, strerror(errno));
+                return -1;
+            }
+            pfd.fd = conn->out;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, 100);
+            w = 0;
+        }
+    }
+
+    return 0;
+}
+
+/* reads what is available, returns 1 when the whole reply was received */
+static int
+conn_recv(struct bench_conn *conn)
+{
+    ssize_t r;
+    void *mem;
+
+    while (1) {
+        if (conn->size - conn->len < 4096) {
+            mem = realloc(conn->buf, conn->size + 16384);
+            if (!mem) {
+                return -1;
+            }
+            conn->buf = mem;
+            conn->size += 16384;
+        }
+
+        r = read(conn->in, conn->buf + conn->len, conn->size - conn->len - 1);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            fprintf(stderr, "Session %u: read failed (%s).\n", conn->id, strerror(errno));
+            return -1;
+        } else if (!r) {
+            fprintf(stderr, "Session %u: terminated by the server.\n", conn->id);
+            return -1;
+        }
+        conn->len += r;
+        conn->buf[conn->len] = '\0';
+
+        /* one RPC at a time, the delimiter ends the buffer */
+        if ((conn->len >= 6) && !strcmp(conn->buf + conn->len - 6, "]]>]]>")) {
+            conn->busy = 0;
+            return 1;
+        }
+    }
+}
+
+static int
+lat_add(struct bench_lat *lat, uint64_t ns, int error)
+{
+    void *mem;
+
+    if (lat->count == lat->size) {
+        mem = realloc(lat->lat, (lat->size ? lat->size * 2 : 1024) * sizeof *lat->lat);
+        if (!mem) {
+            return -1;
+        }
+        lat->lat = mem;
+        lat->size = lat->size ? lat->size * 2 : 1024;
+    }
+    lat->lat[lat->count++] = ns / 1000;
+    if (error) {
+        ++lat->errors;
+    }
+
+    return 0;
+}
+
+static BENCH_OP
+next_op(struct bench_client *client, struct bench_conn *conn)
+{
+    uint32_t r;
+    BENCH_OP op;
+
+    /* a lock is always released by the same session */
+    if (conn->locked) {
+        return BENCH_UNLOCK;
+    }
+
+    r = rand_r(&client->seed) % weight_sum;
+    for (op = 0; r >= weights[op]; ++op) {
+        r -= weights[op];
+    }
+    return op;
+}
+
+static void *
+client_thread(void *arg)
+{
+    struct bench_client *client = arg;
+    struct pollfd *pfds;
+    uint32_t i, busy, timeouts = 0;
+    int r, error;
+
+    pfds = calloc(client->conn_count, sizeof *pfds);
+    if (!pfds) {
+        client->failed = 1;
+        pthread_barrier_wait(&start_barrier);
+        return NULL;
+    }
+    for (i = 0; i < client->conn_count; ++i) {
+        pfds[i].fd = client->conns[i].in;
+        pfds[i].events = POLLIN;
+    }
+
+    /* one unmeasured RPC on every session, it is then surely accepted */
+    for (i = 0; i < client->conn_count; ++i) {
+        if (conn_send(&client->conns[i], BENCH_GETCONFIG)) {
+            client->failed = 1;
+        }
+    }
+    busy = client->conn_count;
+    while (busy && !client->failed) {
+        r = poll(pfds, client->conn_count, 1000);
+        if (!r && (++timeouts == 30)) {
+            fprintf(stderr, "The server did not accept the sessions.\n");
+            client->failed = 1;
+        }
+        if (r < 1) {
+            continue;
+        }
+        for (i = 0; i < client->conn_count; ++i) {
+            if ((pfds[i].revents & (POLLIN | POLLHUP)) && client->conns[i].busy) {
+                r = conn_recv(&client->conns[i]);
+                if (r == -1) {
+                    client->failed = 1;
+                } else if (r) {
+                    --busy;
+                }
+            }
+        }
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    if (client->failed) {
+        free(pfds);
+        return NULL;
+    }
+
+    /* closed loop, every session has always one RPC outstanding until the end */
+    for (i = 0; i < client->conn_count; ++i) {
+        if (conn_send(&client->conns[i], next_op(client, &client->conns[i]))) {
+            client->failed = 1;
+            break;
+        }
+    }
+    busy = i;
+    while (busy && !client->failed) {
+        if (poll(pfds, client->conn_count, 1000) == -1) {
+            continue;
+        }
+        for (i = 0; i < client->conn_count; ++i) {
+            if (!(pfds[i].revents & (POLLIN | POLLHUP)) || !client->conns[i].busy) {
+                continue;
+            }
+            r = conn_recv(&client->conns[i]);
+            if (r == -1) {
+                client->failed = 1;
+                break;
+            } else if (!r) {
+                continue;
+            }
+
+            error = strstr(client->conns[i].buf, "<rpc-error") ? 1 : 0;
+            if (lat_add(&client->ops[client->conns[i].op], now_ns() - client->conns[i].sent, error)) {
+                client->failed = 1;
+                break;
+            }
+            client->conns[i].locked = ((client->conns[i].op == BENCH_LOCK) && !error);
+            if ((now_ns() < bench_end) || client->conns[i].locked) {
+                if (conn_send(&client->conns[i], next_op(client, &client->conns[i]))) {
+                    client->failed = 1;
+                    break;
+                }
+            } else {
+                --busy;
+            }
+        }
+    }
+
+    free(pfds);
+    return NULL;
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* nearest-rank percentile of sorted latencies */
+static uint32_t
+percentile(const struct bench_lat *lat, double p)
+{
+    uint64_t rank;
+
+    rank = (uint64_t)((p / 100.0) * lat->count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return lat->lat[rank - 1];
+}
+
+static int
+parse_mix(const char *mix)
+{
+    char *dup, *item, *eq, *ptr, *saveptr;
+    unsigned long w;
+    BENCH_OP op;
+
+    memset(weights, 0, sizeof weights);
+    dup = strdup(mix);
+    if (!dup) {
+        return -1;
+    }
+    for (item = strtok_r(dup, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        eq = strchr(item, '=');
+        if (!eq) {
+            goto error;
+        }
+        *eq = '\0';
+        for (op = 0; (op < BENCH_UNLOCK) && strcmp(item, bench_op_names[op]); ++op);
+        w = strtoul(eq + 1, &ptr, 10);
+        if ((op == BENCH_UNLOCK) || ptr[0] || (w > UINT16_MAX)) {
+            goto error;
+        }
+        weights[op] = w;
+    }
+    free(dup);
+
+    for (weight_sum = 0, op = 0; op < BENCH_OP_COUNT; ++op) {
+        weight_sum += weights[op];
+    }
+    return weight_sum ? 0 : -1;
+
+error:
+    free(dup);
+    return -1;
+}
+
+static void
+bench_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-s sessions] [-c clients] [-t seconds] [-a shards] [-m mix] [-o report]\n", progname);
+    fprintf(stdout, " -s sessions         number of fake transport sessions (default 64)\n");
+    fprintf(stdout, " -c clients          number of client threads driving the sessions (default 4)\n");
+    fprintf(stdout, " -t seconds          measured duration (default 10)\n");
+    fprintf(stdout, " -a shards           server workers accepting sessions (default 1 of %d)\n", NP2SRV_THREAD_COUNT);
+    fprintf(stdout, " -m mix              <op>=<weight>[,...] of get, get-config, edit-config and lock\n");
+    fprintf(stdout, "                     (default get=1,get-config=1), lock is always followed by unlock\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_client *clients = NULL;
+    struct bench_lat total;
+    uint32_t client_count = 4, duration = 10, shards = 1, i, j, per_client;
+    const char *report = NULL;
+    uint64_t start, elapsed, rpcs = 0, errors = 0;
+    int c, pipes[2][2], ret = EXIT_FAILURE;
+    int64_t srv_ret;
+    BENCH_OP op;
+
+    conn_count = 64;
+    parse_mix("get=1,get-config=1");
+
+    while ((c = getopt(argc, argv, "s:c:t:a:m:o:h")) != -1) {
+        switch (c) {
+        case 's':
+            conn_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            client_count = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            duration = strtoul(optarg, NULL, 10);
+            break;
+        case 'a':
+            shards = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (parse_mix(optarg)) {
+                fprintf(stderr, "Invalid operation mix \"%s\".\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!conn_count || !client_count || !duration || !shards || (shards > NP2SRV_THREAD_COUNT)) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (client_count > conn_count) {
+        client_count = conn_count;
+    }
+    if (report && perf_report_open(report, "bench_sessions")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    sprintf(server_shards, "%u", shards);
+
+    /* all the sessions exist before the server starts accepting them */
+    conns = calloc(conn_count, sizeof *conns);
+    clients = calloc(client_count, sizeof *clients);
+    if (!conns || !clients) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        goto cleanup;
+    }
+    for (i = 0; i < conn_count; ++i) {
+        conns[i].srv_in = conns[i].srv_out = conns[i].in = conns[i].out = -1;
+    }
+    for (i = 0; i < conn_count; ++i) {
+        if (pipe(pipes[0]) == -1) {
+            fprintf(stderr, "Failed to create session %u (%s).\n", i + 1, strerror(errno));
+            goto cleanup;
+        }
+        if (pipe(pipes[1]) == -1) {
+            fprintf(stderr, "Failed to create session %u (%s).\n", i + 1, strerror(errno));
+            close(pipes[0][0]);
+            close(pipes[0][1]);
+            goto cleanup;
+        }
+        for (j = 0; j < 4; ++j) {
+            fcntl(pipes[j / 2][j % 2], F_SETFL, O_NONBLOCK);
+        }
+
+        conns[i].in = pipes[0][0];
+        conns[i].out = pipes[1][1];
+        conns[i].srv_in = pipes[1][0];
+        conns[i].srv_out = pipes[0][1];
+        conns[i].id = i + 1;
+    }
+
+    /* sessions are split evenly among the clients */
+    per_client = conn_count / client_count;
+    for (i = 0, j = 0; i < client_count; ++i) {
+        clients[i].conns = &conns[j];
+        clients[i].conn_count = per_client + ((i < conn_count % client_count) ? 1 : 0);
+        clients[i].seed = i + 1;
+        j += clients[i].conn_count;
+    }
+
+    /* the server parses its own arguments */
+    optind = 1;
+    control = LOOP_CONTINUE;
+    if (pthread_create(&server_tid, NULL, server_thread, NULL)) {
+        fprintf(stderr, "Failed to start the server.\n");
+        goto cleanup;
+    }
+
+    pthread_barrier_init(&start_barrier, NULL, client_count + 1);
+    bench_end = UINT64_MAX;
+    for (i = 0; i < client_count; ++i) {
+        if (pthread_create(&clients[i].tid, NULL, client_thread, &clients[i])) {
+            fprintf(stderr, "Failed to start a client thread.\n");
+            /* the barrier would never be reached */
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* all the sessions were accepted and answered an RPC */
+    pthread_barrier_wait(&start_barrier);
+    start = now_ns();
+    bench_end = start + (uint64_t)duration * 1000000000;
+
+    for (i = 0; i < client_count; ++i) {
+        pthread_join(clients[i].tid, NULL);
+    }
+    elapsed = now_ns() - start;
+    pthread_barrier_destroy(&start_barrier);
+
+    control = LOOP_STOP;
+    pthread_join(server_tid, (void **)&srv_ret);
+
+    for (i = 0; i < client_count; ++i) {
+        if (clients[i].failed) {
+            fprintf(stderr, "Client %u failed, the results are not valid.\n", i + 1);
+            goto cleanup;
+        }
+    }
+
+    /* merge the latencies of all the clients */
+    fprintf(stdout, "Sessions: %u, clients: %u, server workers: %d (%u accepting), duration: %.1f s\n", conn_count,
+            client_count, NP2SRV_THREAD_COUNT, shards, elapsed / 1e9);
+    for (op = 0; op < BENCH_OP_COUNT; ++op) {
+        memset(&total, 0, sizeof total);
+        for (i = 0; i < client_count; ++i) {
+            total.count += clients[i].ops[op].count;
+            total.errors += clients[i].ops[op].errors;
+        }
+        if (!total.count) {
+            continue;
+        }
+        total.lat = malloc(total.count * sizeof *total.lat);
+        if (!total.lat) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+        for (i = 0, j = 0; i < client_count; ++i) {
+            memcpy(total.lat + j, clients[i].ops[op].lat, clients[i].ops[op].count * sizeof *total.lat);
+            j += clients[i].ops[op].count;
+        }
+        qsort(total.lat, total.count, sizeof *total.lat, cmp_u32);
+
+        fprintf(stdout, "%-12s RPCs: %lu, errors: %lu, RPC/s: %.1f, latency (us) p50: %u, p90: %u, p99: %u, p99.9: %u, max: %u\n",
+                bench_op_names[op], (unsigned long)total.count, (unsigned long)total.errors, total.count / (elapsed / 1e9),
+                percentile(&total, 50), percentile(&total, 90), percentile(&total, 99), percentile(&total, 99.9),
+                total.lat[total.count - 1]);
+        perf_report_add("1/s", total.count / (elapsed / 1e9), "%s/rate", bench_op_names[op]);
+        perf_report_add("us", percentile(&total, 50), "%s/p50", bench_op_names[op]);
+        perf_report_add("us", percentile(&total, 99), "%s/p99", bench_op_names[op]);
+        perf_report_add("errors", total.errors, "%s/errors", bench_op_names[op]);
+        rpcs += total.count;
+        errors += total.errors;
+        free(total.lat);
+    }
+    fprintf(stdout, "%-12s RPCs: %lu, errors: %lu, RPC/s: %.1f\n", "total", (unsigned long)rpcs, (unsigned long)errors,
+            rpcs / (elapsed / 1e9));
+    perf_report_add("1/s", rpcs / (elapsed / 1e9), "total/rate");
+    ret = srv_ret ? EXIT_FAILURE : EXIT_SUCCESS;
+
+cleanup:
+    for (i = 0; conns && (i < conn_count); ++i) {
+        if (conns[i].in > -1) {
+            close(conns[i].in);
+            close(conns[i].out);
+            close(conns[i].srv_in);
+            close(conns[i].srv_out);
+        }
+        free(conns[i].buf);
+    }
+    for (i = 0; clients && (i < client_count); ++i) {
+        for (op = 0; op < BENCH_OP_COUNT; ++op) {
+            free(clients[i].ops[op].lat);
+        }
+    }
+    free(clients);
+    free(conns);
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    return ret;
+}
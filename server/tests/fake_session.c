@@ -0,0 +1,136 @@
+/**
+ * @file fake_session.c
+ * @brief Fake NETCONF sessions of the in-process benchmarks.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
+#include <sysrepo.h>
+
+#include "../common.h"
+#include "fake_session.h"
+
+/*
+ * LIBNETCONF2 SESSION
+ */
+struct nc_session {
+    NC_STATUS status;
+    NC_SESSION_TERM_REASON term_reason;
+    int side;
+
+    uint32_t id;
+    int version;
+
+    NC_TRANSPORT_IMPL ti_type;
+    pthread_mutex_t *ti_lock;
+    pthread_cond_t *ti_cond;
+    volatile int *ti_inuse;
+    union {
+        struct {
+            int in;
+            int out;
+        } fd;
+#ifdef NC_ENABLED_SSH
+        struct {
+            void *channel;
+            void *session;
+            struct nc_session *next;
+        } libssh;
+#endif
+#ifdef NC_ENABLED_TLS
+        void *tls;
+#endif
+    } ti;
+    const char *username;
+    const char *host;
+    uint16_t port;
+
+    struct ly_ctx *ctx;
+    void *data;
+    uint8_t flags;
+
+    union {
+        struct {
+            uint64_t msgid;
+            const char **cpblts;
+            struct nc_msg_cont *replies;
+            struct nc_msg_cont *notifs;
+            volatile pthread_t *ntf_tid;
+        } client;
+        struct {
+            time_t session_start;
+            time_t last_rpc;
+            int ntf_status;
+            pthread_mutex_t *ch_lock;
+            pthread_cond_t *ch_cond;
+#ifdef NC_ENABLED_SSH
+            uint16_t ssh_auth_attempts;
+#endif
+#ifdef NC_ENABLED_TLS
+            void *client_cert;
+#endif
+        } server;
+    } opts;
+};
+
+struct nc_session *
+session_new(uint32_t id, int out, const char *username)
+{
+    struct nc_session *session;
+
+    session = calloc(1, sizeof *session);
+    if (!session) {
+        return NULL;
+    }
+    session->status = NC_STATUS_RUNNING;
+    session->side = 1;
+    session->id = id;
+    session->ti_lock = malloc(sizeof *session->ti_lock);
+    pthread_mutex_init(session->ti_lock, NULL);
+    session->ti_cond = malloc(sizeof *session->ti_cond);
+    pthread_cond_init(session->ti_cond, NULL);
+    session->ti_inuse = malloc(sizeof *session->ti_inuse);
+    *session->ti_inuse = 0;
+    session->ti_type = NC_TI_FD;
+    session->ti.fd.in = -1;
+    session->ti.fd.out = out;
+    session->ctx = np2srv.ly_ctx;
+    session->flags = 1; //shared ctx
+    session->username = username;
+    session->host = "localhost";
+    session->opts.server.session_start = session->opts.server.last_rpc = time(NULL);
+
+    return session;
+}
+
+void
+session_free(struct nc_session *session)
+{
+    pthread_mutex_destroy(session->ti_lock);
+    free(session->ti_lock);
+    pthread_cond_destroy(session->ti_cond);
+    free(session->ti_cond);
+    free((int *)session->ti_inuse);
+    free(session);
+}
+
+uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
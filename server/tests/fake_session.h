@@ -0,0 +1,50 @@
+/**
+ * @file fake_session.h
+ * @brief Fake NETCONF sessions of the in-process benchmarks header.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef FAKE_SESSION_H_
+#define FAKE_SESSION_H_
+
+#include <stdint.h>
+
+#include <nc_server.h>
+
+/*
+ * The sessions are created directly, without any transport or <hello>, so that the server functions can be
+ * called with them. They use the server context np2srv.ly_ctx and their data are left to the caller.
+ */
+
+/**
+ * @brief Create a running server session.
+ *
+ * @param[in] id Session ID.
+ * @param[in] out File descriptor the server writes to, -1 if nothing is ever sent.
+ * @param[in] username Username of the session, not duplicated.
+ * @return Session, NULL on error.
+ */
+struct nc_session *session_new(uint32_t id, int out, const char *username);
+
+/**
+ * @brief Free a session created by session_new(), its data must be freed before.
+ *
+ * @param[in] session Session to free.
+ */
+void session_free(struct nc_session *session);
+
+/**
+ * @brief Get the monotonic time.
+ *
+ * @return Time in nanoseconds.
+ */
+uint64_t now_ns(void);
+
+#endif /* FAKE_SESSION_H_ */
@@ -0,0 +1,488 @@
+/**
+ * @file memprof.c
+ * @brief Peak-memory profiling of large np2srv operations with thresholds.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/memprof_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "alloc_track.h"
+#include "fake_session.h"
+#include "perf_report.h"
+#include "sr_synth.h"
+
+#define MP_NC_NS "urn:ietf:params:xml:ns:netconf:base:1.0"
+#define MP_NTF_XPATH "/ietf-netconf-notifications:netconf-session-start"
+
+typedef enum {
+    MP_GETCONFIG,
+    MP_EDIT,
+    MP_COPY,
+    MP_REPLAY,
+    MP_OP_COUNT
+} MP_OP;
+
+static const char *mp_op_names[MP_OP_COUNT] = {"get-config", "edit-config", "copy-config", "replay"};
+
+/* the common beginning of all the libnetconf2 server replies, mirrors their NC_RPL type */
+struct mp_reply {
+    enum {
+        MP_RPL_OK,
+        MP_RPL_DATA,
+        MP_RPL_ERROR
+    } type;
+};
+
+/* heap usage of one operation, relative to the heap in use before it */
+struct mp_usage {
+    uint64_t peak;
+    uint64_t count;
+    uint64_t largest;
+    int64_t retained;
+};
+
+/* thresholds */
+struct mp_limits {
+    double peak_factor;         /* peak of the datastore operations to the data size */
+    double largest_factor;      /* largest allocation to the data size, to the peak for replay */
+    uint64_t replay_bytes;      /* replay peak per notification */
+};
+
+static struct np2_sessions mp_sess;
+static struct alloc_stats mp_before;
+static volatile int drain_stop;
+
+/*
+ * LIBNETCONF2 WRAPPER FUNCTIONS
+ */
+void *
+__wrap_nc_session_get_data(const struct nc_session *session)
+{
+    (void)session;
+    return &mp_sess;
+}
+
+/* reads everything the server sends to the subscriber, without any allocation */
+static void *
+drain_thread(void *arg)
+{
+    struct pollfd pfd;
+    char buf[16384];
+
+    pfd.fd = *(int *)arg;
+    pfd.events = POLLIN;
+    while (!drain_stop) {
+        if (poll(&pfd, 1, 10) < 1) {
+            continue;
+        }
+        while (read(pfd.fd, buf, sizeof buf) > 0);
+    }
+
+    return NULL;
+}
+
+/*
+ * MEASUREMENT
+ */
+static void
+mp_start(void)
+{
+    alloc_track_get(&mp_before);
+    alloc_track_reset_peak();
+}
+
+static void
+mp_stop(struct mp_usage *usage)
+{
+    struct alloc_stats after;
+
+    alloc_track_get(&after);
+    usage->peak = after.peak - mp_before.live;
+    usage->count = after.count - mp_before.count;
+    usage->largest = after.largest;
+    usage->retained = (int64_t)(after.live - mp_before.live);
+}
+
+/* builds the RPC of a datastore operation */
+static char *
+mp_rpc_xml(MP_OP op, const struct synth_shape *shape, const char *config)
+{
+    FILE *rpc;
+    char *xml = NULL;
+    size_t size;
+    uint32_t i;
+
+    rpc = open_memstream(&xml, &size);
+    if (!rpc) {
+        return NULL;
+    }
+
+    switch (op) {
+    case MP_GETCONFIG:
+        fprintf(rpc, "<get-config xmlns=\"%s\"><source><running/></source></get-config>", MP_NC_NS);
+        break;
+    case MP_EDIT:
+        /* merge of the first leaf of every top-level list instance */
+        fprintf(rpc, "<edit-config xmlns=\"%s\"><target><running/></target><config><synth xmlns=\"%s\">",
+                MP_NC_NS, SYNTH_NS);
+        for (i = 0; i < shape->list_size[0]; ++i) {
+            fprintf(rpc, "<l1><name>e%u</name><f0>%s</f0></l1>", i, (shape->types[0] == SYNTH_STRING) ? "edited"
+                    : (shape->types[0] == SYNTH_UINT32) ? "7" : (shape->types[0] == SYNTH_BOOL) ? "true" : "four");
+        }
+        fprintf(rpc, "</synth></config></edit-config>");
+        break;
+    case MP_COPY:
+        fprintf(rpc, "<copy-config xmlns=\"%s\"><target><running/></target><source><config>%s</config></source>"
+                "</copy-config>", MP_NC_NS, config);
+        break;
+    default:
+        break;
+    }
+
+    if (fclose(rpc)) {
+        free(xml);
+        return NULL;
+    }
+    return xml;
+}
+
+/* the operation with its reply, the parsed RPC is not measured */
+static int
+mp_datastore_op(MP_OP op, const struct synth_shape *shape, const char *config, struct mp_usage *usage)
+{
+    struct nc_server_reply *(*op_clb)(struct lyd_node *, struct nc_session *);
+    struct nc_server_reply *reply;
+    struct lyd_node *rpc;
+    char *xml;
+    int error;
+
+    switch (op) {
+    case MP_EDIT:
+        op_clb = op_editconfig;
+        break;
+    case MP_COPY:
+        op_clb = op_copyconfig;
+        break;
+    default:
+        op_clb = op_get;
+        break;
+    }
+
+    xml = mp_rpc_xml(op, shape, config);
+    if (!xml) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return -1;
+    }
+    rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+    free(xml);
+    if (!rpc) {
+        fprintf(stderr, "Failed to parse the %s RPC.\n", mp_op_names[op]);
+        return -1;
+    }
+
+    mp_start();
+    reply = op_clb(rpc, NULL);
+    error = !reply || (((struct mp_reply *)reply)->type == MP_RPL_ERROR);
+    nc_server_reply_free(reply);
+    /* what the worker does after sending the reply */
+    np2_arena_reset();
+    mp_stop(usage);
+
+    lyd_free(rpc);
+    if (error) {
+        fprintf(stderr, "Operation %s failed (%s).\n", mp_op_names[op], np2log_lasterr());
+        return -1;
+    }
+    return 0;
+}
+
+/* replay of stored notifications to a subscriber, they are all kept until the replay completes */
+static int
+mp_replay(uint32_t notif_count, struct mp_usage *usage)
+{
+    struct nc_server_reply *reply;
+    struct nc_session *session = NULL;
+    struct lyd_node *rpc = NULL;
+    pthread_t drain_tid;
+    sr_node_t trees[3];
+    char xml[256], username[16], *start_str;
+    time_t start;
+    uint32_t i;
+    int fds[2] = {-1, -1}, drain = 0, ret = -1;
+
+    if (pipe(fds) == -1) {
+        fprintf(stderr, "Failed to create the session (%s).\n", strerror(errno));
+        return -1;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    session = session_new(1, fds[1], "user1");
+    if (!session) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        goto cleanup;
+    }
+    if (pthread_create(&drain_tid, NULL, drain_thread, &fds[0])) {
+        fprintf(stderr, "Failed to start the session reader.\n");
+        goto cleanup;
+    }
+    drain = 1;
+
+    /* the notifications of the last hour */
+    start = time(NULL) - 3600;
+    start_str = nc_time2datetime(start, NULL, NULL);
+    sprintf(xml, "<create-subscription xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\">"
+            "<startTime>%s</startTime></create-subscription>", start_str);
+    free(start_str);
+    rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+    if (!rpc) {
+        fprintf(stderr, "Failed to parse the create-subscription RPC.\n");
+        goto cleanup;
+    }
+    reply = op_ntf_subscribe(rpc, session);
+    if (!reply || (((struct mp_reply *)reply)->type != MP_RPL_OK)) {
+        fprintf(stderr, "Subscription failed (%s).\n", np2log_lasterr());
+        nc_server_reply_free(reply);
+        goto cleanup;
+    }
+    nc_server_reply_free(reply);
+
+    memset(trees, 0, sizeof trees);
+    trees[0].name = "username";
+    trees[0].type = SR_STRING_T;
+    trees[0].data.string_val = username;
+    trees[0].module_name = "ietf-netconf-notifications";
+    trees[1].name = "session-id";
+    trees[1].type = SR_UINT32_T;
+    trees[1].module_name = "ietf-netconf-notifications";
+    trees[2].name = "source-host";
+    trees[2].type = SR_STRING_T;
+    trees[2].data.string_val = "127.0.0.1";
+    trees[2].module_name = "ietf-netconf-notifications";
+
+    /* what sysrepo does, all the replayed notifications and then replay complete from every subscription */
+    mp_start();
+    for (i = 0; i < notif_count; ++i) {
+        sprintf(username, "user%u", i % 16);
+        trees[1].data.uint32_val = i + 1;
+        np2srv_ntf_clb(SR_EV_NOTIF_T_REPLAY, MP_NTF_XPATH, trees, 3, start + (time_t)((uint64_t)i * 3600 / notif_count),
+                       NULL);
+    }
+    for (i = 0; i < sr_subsc_count; ++i) {
+        np2srv_ntf_clb(SR_EV_NOTIF_T_REPLAY_COMPLETE, MP_NTF_XPATH, NULL, 0, time(NULL), NULL);
+    }
+    mp_stop(usage);
+    ret = 0;
+
+cleanup:
+    lyd_free(rpc);
+    if (session) {
+        if (nc_session_get_notif_status(session)) {
+            op_ntf_unsubscribe(session, 0);
+        }
+        session_free(session);
+    }
+    if (drain) {
+        drain_stop = 1;
+        pthread_join(drain_tid, NULL);
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return ret;
+}
+
+/* prints the usage of an operation and checks it against the limits, returns 1 if any is exceeded */
+static int
+mp_check(MP_OP op, const struct mp_usage *usage, uint64_t peak_limit, uint64_t largest_limit)
+{
+    int exceeded;
+
+    exceeded = (usage->peak > peak_limit) || (usage->largest > largest_limit);
+    fprintf(stdout, "%-12s peak: %9.1f KiB (limit %.1f), allocations: %9lu, largest: %9.1f KiB (limit %.1f),"
+            " retained: %ld B%s\n", mp_op_names[op], usage->peak / 1024.0, peak_limit / 1024.0,
+            (unsigned long)usage->count, usage->largest / 1024.0, largest_limit / 1024.0, (long)usage->retained,
+            exceeded ? " EXCEEDED" : "");
+    perf_report_add("B", usage->peak, "%s/peak", mp_op_names[op]);
+    perf_report_add("allocs", usage->count, "%s/allocs", mp_op_names[op]);
+    perf_report_add("B", usage->largest, "%s/largest", mp_op_names[op]);
+
+    return exceeded;
+}
+
+static void
+mp_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n nodes] [-d depth] [-l leaves] [-N notifications] [-P factor] [-L factor] [-R bytes]\n"
+            "       [-o report]\n", progname);
+    fprintf(stdout, " -n nodes            datastore size (default 100000)\n");
+    fprintf(stdout, " -d depth            nested list levels, 1 - %d (default 2)\n", SYNTH_MAX_DEPTH);
+    fprintf(stdout, " -l leaves           leaves of every list instance besides the key (default 8)\n");
+    fprintf(stdout, " -N notifications    replayed notifications (default 100000)\n");
+    fprintf(stdout, " -P factor           peak heap limit of the datastore operations, times the data size (default 8)\n");
+    fprintf(stdout, " -L factor           largest allocation limit, times the data size, for replay times its peak\n");
+    fprintf(stdout, "                     (default 0.25)\n");
+    fprintf(stdout, " -R bytes            replay peak heap limit per notification (default 4096)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct synth_shape shape;
+    struct mp_limits limits;
+    struct mp_usage usage;
+    struct alloc_stats before, after;
+    const char *report = NULL;
+    char *config = NULL;
+    uint64_t nodes = 100000, data_size;
+    uint32_t notif_count = 100000;
+    int c, exceeded = 0, ret = EXIT_FAILURE;
+    MP_OP op;
+
+    memset(&shape, 0, sizeof shape);
+    shape.depth = 2;
+    shape.leaves = 8;
+    shape.default_ratio = 0.25;
+    shape.seed = 1;
+    synth_shape_types(&shape, "string,uint32,boolean,enumeration");
+    limits.peak_factor = 8;
+    limits.largest_factor = 0.25;
+    limits.replay_bytes = 4096;
+
+    while ((c = getopt(argc, argv, "n:d:l:N:P:L:R:o:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nodes = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            shape.depth = strtoul(optarg, NULL, 10);
+            break;
+        case 'l':
+            shape.leaves = strtoul(optarg, NULL, 10);
+            break;
+        case 'N':
+            notif_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'P':
+            limits.peak_factor = strtod(optarg, NULL);
+            break;
+        case 'L':
+            limits.largest_factor = strtod(optarg, NULL);
+            break;
+        case 'R':
+            limits.replay_bytes = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            mp_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!nodes || !shape.depth || (shape.depth > SYNTH_MAX_DEPTH) || !shape.leaves || !notif_count) {
+        mp_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (report && perf_report_open(report, "memprof")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* the subscriber transport is closed before unsubscribing */
+    signal(SIGPIPE, SIG_IGN);
+
+    openlog("memprof", LOG_PERROR, LOG_USER);
+    np2_verbose_level = NC_VERB_ERROR;
+    nc_verbosity(np2_verbose_level);
+    nc_set_print_clb(np2log_clb_nc2);
+    ly_set_log_clb(np2log_clb_ly, 1);
+
+    synth_ntf_enable();
+    if (synth_init(&shape) || server_init()) {
+        fprintf(stderr, "Server init failed.\n");
+        goto cleanup;
+    }
+    if (!sr_subsc_count) {
+        fprintf(stderr, "The server did not subscribe for any notifications.\n");
+        goto cleanup;
+    }
+
+    /* the operations are compared with the heap the data take */
+    synth_shape_fit(&shape, nodes);
+    alloc_track_get(&before);
+    if (synth_generate(np2srv.ly_ctx, &shape, SR_DS_RUNNING)) {
+        fprintf(stderr, "Generating %lu nodes failed.\n", (unsigned long)nodes);
+        goto cleanup;
+    }
+    alloc_track_get(&after);
+    data_size = after.live - before.live;
+    if (lyd_print_mem(&config, synth_data(SR_DS_RUNNING), LYD_XML, LYP_WITHSIBLINGS)) {
+        fprintf(stderr, "Printing the data failed.\n");
+        goto cleanup;
+    }
+    fprintf(stdout, "Nodes: %lu, data: %.1f KiB, replayed notifications: %u\n", (unsigned long)synth_node_count(&shape),
+            data_size / 1024.0, notif_count);
+    perf_report_add("B", data_size, "data/size");
+
+    for (op = 0; op < MP_OP_COUNT; ++op) {
+        if (op == MP_REPLAY) {
+            if (mp_replay(notif_count, &usage)) {
+                goto cleanup;
+            }
+            exceeded += mp_check(op, &usage, limits.replay_bytes * notif_count, limits.largest_factor * usage.peak);
+        } else {
+            if (mp_datastore_op(op, &shape, config, &usage)) {
+                goto cleanup;
+            }
+            exceeded += mp_check(op, &usage, limits.peak_factor * data_size, limits.largest_factor * data_size);
+        }
+    }
+    if (exceeded) {
+        fprintf(stdout, "%d operation(s) exceeded the memory limits.\n", exceeded);
+    } else {
+        ret = EXIT_SUCCESS;
+    }
+
+cleanup:
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    free(config);
+    synth_destroy();
+    chm_destroy();
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    nc_ps_free(np2srv.nc_ps);
+    nc_server_destroy();
+    ncm_destroy();
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
@@ -0,0 +1,515 @@
+/**
+ * @file microbench.c
+ * @brief Microbenchmarks of the np2srv subtree filter compilation and XPath evaluation.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+/* the filter functions are static */
+#include "../operations.c"
+
+#include "alloc_track.h"
+#include "fake_session.h"
+#include "perf_report.h"
+
+#define MB_NC_NS "urn:ietf:params:xml:ns:netconf:base:1.0"
+#define MB_IF_NS "urn:ietf:params:xml:ns:yang:ietf-interfaces"
+#define MB_IP_NS "urn:ietf:params:xml:ns:yang:ietf-ip"
+#define MB_NCN_NS "urn:ietf:params:xml:ns:netmod:notification"
+
+#define MB_MAX_TOP 8
+#define MB_MIN_ITERATIONS 10
+
+#define MB_IF_NAME(n) "<interface><name>eth" #n "</name></interface>"
+
+struct np2srv np2srv;
+
+struct mb_filter {
+    const char *name;
+    int xpath;                  /* content is an XPath select, not a subtree */
+    const char *content;
+};
+
+/* corpus of filters, the data have interfaces "eth0" - "eth<n - 1>" */
+static const struct mb_filter mb_corpus[] = {
+    {"wildcard top-level", 0,
+        "<interfaces/>"},
+    {"selection", 0,
+        "<interfaces xmlns=\"" MB_IF_NS "\"/>"},
+    {"deep containment", 0,
+        "<interfaces xmlns=\"" MB_IF_NS "\"><interface><ipv4 xmlns=\"" MB_IP_NS "\"><address><prefix-length/>"
+        "</address></ipv4></interface></interfaces>"
+        "<interfaces-state xmlns=\"" MB_IF_NS "\"><interface><statistics><in-octets/></statistics></interface>"
+        "</interfaces-state>"},
+    {"many content matches", 0,
+        "<interfaces xmlns=\"" MB_IF_NS "\">"
+        MB_IF_NAME(1) MB_IF_NAME(63) MB_IF_NAME(125) MB_IF_NAME(187) MB_IF_NAME(249) MB_IF_NAME(311)
+        MB_IF_NAME(373) MB_IF_NAME(435) MB_IF_NAME(497) MB_IF_NAME(559) MB_IF_NAME(621) MB_IF_NAME(683)
+        MB_IF_NAME(745) MB_IF_NAME(807) MB_IF_NAME(869) MB_IF_NAME(931)
+        "</interfaces>"},
+    {"multi-namespace", 0,
+        "<interfaces xmlns=\"" MB_IF_NS "\"><interface><name>eth3</name><description/><ipv4 xmlns=\"" MB_IP_NS "\"/>"
+        "</interface></interfaces>"
+        "<interfaces-state xmlns=\"" MB_IF_NS "\"><interface><name>eth3</name></interface></interfaces-state>"
+        "<netconf xmlns=\"" MB_NCN_NS "\"><streams/></netconf>"},
+    {"xpath", 1,
+        "/ietf-interfaces:interfaces/interface[name='eth5']/ietf-ip:ipv4"}
+};
+
+typedef enum {
+    MB_CREATE,
+    MB_BUILD,
+    MB_BUF_ADD,
+    MB_GET_TREE,
+    MB_CASE_COUNT
+} MB_CASE;
+
+static const char *mb_case_names[MB_CASE_COUNT] = {
+    "op_filter_create", "build_xpath_from_subtree", "filter_xpath_buf_add", "get_tree_from_data"
+};
+
+struct mb_state {
+    const struct mb_filter *filter;
+    struct lyd_node *data;
+
+    /* prepared for every iteration */
+    struct lyd_node *rpc;
+    struct lyd_node *filter_node;
+    struct lyxml_elem *xml;
+    const struct lys_module *top_mods[MB_MAX_TOP];
+
+    /* prepared once, XPaths of the filter */
+    char **paths;
+    int path_count;
+
+    /* results */
+    char **filters;
+    int filter_count;
+    struct lyd_node *root;
+};
+
+static uint64_t timer_overhead;
+
+static void
+free_filters(char **filters, int filter_count)
+{
+    int i;
+
+    for (i = 0; i < filter_count; ++i) {
+        free(filters[i]);
+    }
+    free(filters);
+}
+
+static const struct lys_module *
+mb_top_module(struct lyxml_elem *elem)
+{
+    const struct lys_module *module;
+    const struct lys_node *node;
+    uint32_t i = 0;
+
+    if (elem->ns && strcmp(elem->ns->value, MB_NC_NS)) {
+        return ly_ctx_get_module_by_ns(np2srv.ly_ctx, elem->ns->value, NULL);
+    }
+
+    while ((module = ly_ctx_get_module_iter(np2srv.ly_ctx, &i))) {
+        node = NULL;
+        while ((node = lys_getnext(node, NULL, module, 0))) {
+            if (!strcmp(node->name, elem->name)) {
+                return module;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int
+mb_setup(MB_CASE c, struct mb_state *st)
+{
+    struct lyxml_elem *elem;
+    struct ly_set *set;
+    char *xml;
+    int i;
+
+    switch (c) {
+    case MB_CREATE:
+        if (st->filter->xpath) {
+            i = asprintf(&xml, "<get xmlns=\"%s\"><filter type=\"xpath\" select=\"%s\"/></get>", MB_NC_NS,
+                         st->filter->content);
+        } else {
+            i = asprintf(&xml, "<get xmlns=\"%s\"><filter type=\"subtree\">%s</filter></get>", MB_NC_NS,
+                         st->filter->content);
+        }
+        if (i == -1) {
+            return -1;
+        }
+        st->rpc = lyd_parse_mem(np2srv.ly_ctx, xml, LYD_XML, LYD_OPT_RPC, NULL);
+        free(xml);
+        if (!st->rpc) {
+            return -1;
+        }
+        set = lyd_find_xpath(st->rpc, "/ietf-netconf:get/filter");
+        if (!set || (set->number != 1)) {
+            ly_set_free(set);
+            return -1;
+        }
+        st->filter_node = set->set.d[0];
+        ly_set_free(set);
+        break;
+    case MB_BUILD:
+    case MB_BUF_ADD:
+        st->xml = lyxml_parse_mem(np2srv.ly_ctx, st->filter->content, LYXML_PARSE_MULTIROOT);
+        if (!st->xml) {
+            return -1;
+        }
+        if (c == MB_BUILD) {
+            break;
+        }
+
+        /* the same module the filter builder would choose first */
+        i = 0;
+        LY_TREE_FOR(st->xml, elem) {
+            if (i == MB_MAX_TOP) {
+                return -1;
+            }
+            st->top_mods[i] = mb_top_module(elem);
+            if (!st->top_mods[i]) {
+                return -1;
+            }
+            ++i;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int
+mb_call(MB_CASE c, struct mb_state *st)
+{
+    struct lyxml_elem *elem;
+    char *buf;
+    int i;
+
+    switch (c) {
+    case MB_CREATE:
+        return op_filter_create(st->filter_node, &st->filters, &st->filter_count);
+    case MB_BUILD:
+        return op_filter_build_xpath_from_subtree(np2srv.ly_ctx, st->xml, &st->filters, &st->filter_count);
+    case MB_BUF_ADD:
+        i = 0;
+        LY_TREE_FOR(st->xml, elem) {
+            if (!elem->child && elem->content && !strws(elem->content)) {
+                if (filter_xpath_buf_add_top_content(np2srv.ly_ctx, elem, st->top_mods[i]->name, &st->filters,
+                                                     &st->filter_count)) {
+                    return -1;
+                }
+            } else {
+                buf = NULL;
+                if (filter_xpath_buf_add(np2srv.ly_ctx, elem, st->top_mods[i]->name, st->top_mods[i]->ns, &buf, 1,
+                                         &st->filters, &st->filter_count)) {
+                    return -1;
+                }
+            }
+            ++i;
+        }
+        return 0;
+    case MB_GET_TREE:
+        for (i = 0; i < st->path_count; ++i) {
+            if (op_filter_get_tree_from_data(&st->root, st->data, st->paths[i])) {
+                return -1;
+            }
+        }
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static void
+mb_teardown(struct mb_state *st)
+{
+    free_filters(st->filters, st->filter_count);
+    st->filters = NULL;
+    st->filter_count = 0;
+
+    /* the filter XML is owned by the RPC */
+    lyd_free(st->rpc);
+    st->rpc = NULL;
+    st->filter_node = NULL;
+    lyxml_free_withsiblings(np2srv.ly_ctx, st->xml);
+    st->xml = NULL;
+
+    lyd_free_withsiblings(st->root);
+    st->root = NULL;
+}
+
+/* repeats the case for at least the time, only the call itself is measured */
+static int
+mb_measure(MB_CASE c, struct mb_state *st, uint32_t min_ms)
+{
+    struct alloc_stats before, after;
+    uint64_t start, end, wall_end, ns = 0, allocs = 0, bytes = 0;
+    uint32_t iterations = 0;
+    int rc;
+
+    /* warm-up */
+    if (mb_setup(c, st) || mb_call(c, st)) {
+        mb_teardown(st);
+        return -1;
+    }
+    mb_teardown(st);
+
+    wall_end = now_ns() + (uint64_t)min_ms * 1000000;
+    do {
+        if (mb_setup(c, st)) {
+            mb_teardown(st);
+            return -1;
+        }
+
+        alloc_track_get(&before);
+        start = now_ns();
+        rc = mb_call(c, st);
+        end = now_ns();
+        alloc_track_get(&after);
+
+        mb_teardown(st);
+        if (rc) {
+            return -1;
+        }
+
+        ns += (end - start > timer_overhead) ? end - start - timer_overhead : 0;
+        allocs += after.count - before.count;
+        bytes += after.bytes - before.bytes;
+        ++iterations;
+    } while ((iterations < MB_MIN_ITERATIONS) || (now_ns() < wall_end));
+
+    fprintf(stdout, "  %-26s ns/op: %10.0f, allocs/op: %8.1f, bytes/op: %10.0f, iterations: %u\n", mb_case_names[c],
+            (double)ns / iterations, (double)allocs / iterations, (double)bytes / iterations, iterations);
+    perf_report_add("ns", (double)ns / iterations, "%s/%s/time", st->filter->name, mb_case_names[c]);
+    perf_report_add("allocs", (double)allocs / iterations, "%s/%s/allocs", st->filter->name, mb_case_names[c]);
+    perf_report_add("bytes", (double)bytes / iterations, "%s/%s/bytes", st->filter->name, mb_case_names[c]);
+    return 0;
+}
+
+static void
+calibrate_timer(void)
+{
+    uint64_t start, end;
+    int i;
+
+    timer_overhead = UINT64_MAX;
+    for (i = 0; i < 1000; ++i) {
+        start = now_ns();
+        end = now_ns();
+        if (end - start < timer_overhead) {
+            timer_overhead = end - start;
+        }
+    }
+}
+
+static int
+load_modules(void)
+{
+    const char *files[] = {"ietf-netconf", "ietf-interfaces", "iana-if-type", "ietf-ip", "notifications",
+                           "nc-notifications"};
+    char path[256];
+    unsigned int i;
+
+    np2srv.ly_ctx = ly_ctx_new(TESTS_DIR "/files");
+    if (!np2srv.ly_ctx) {
+        return -1;
+    }
+    for (i = 0; i < sizeof files / sizeof *files; ++i) {
+        snprintf(path, sizeof path, "%s/files/%s.yin", TESTS_DIR, files[i]);
+        if (!lys_parse_path(np2srv.ly_ctx, path, LYS_IN_YIN)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* configuration and state of the interfaces with addresses and the notification streams */
+static struct lyd_node *
+build_data(uint32_t if_count)
+{
+    struct lyd_node *data = NULL, *node;
+    char path[256], value[64];
+    uint32_t i, j;
+
+    for (i = 0; i < if_count; ++i) {
+        for (j = 0; j < 8; ++j) {
+            switch (j) {
+            case 0:
+                sprintf(path, "/ietf-interfaces:interfaces/interface[name='eth%u']/type", i);
+                strcpy(value, "iana-if-type:ethernetCsmacd");
+                break;
+            case 1:
+                sprintf(path, "/ietf-interfaces:interfaces/interface[name='eth%u']/enabled", i);
+                strcpy(value, "true");
+                break;
+            case 2:
+                sprintf(path, "/ietf-interfaces:interfaces/interface[name='eth%u']/description", i);
+                sprintf(value, "port %u", i);
+                break;
+            case 3:
+                sprintf(path, "/ietf-interfaces:interfaces/interface[name='eth%u']/ietf-ip:ipv4/address[ip='10.%u.%u.1']"
+                        "/prefix-length", i, (i >> 8) & 0xFF, i & 0xFF);
+                strcpy(value, "24");
+                break;
+            case 4:
+                sprintf(path, "/ietf-interfaces:interfaces/interface[name='eth%u']/ietf-ip:ipv6/address[ip='2001:db8::%x']"
+                        "/prefix-length", i, i + 1);
+                strcpy(value, "64");
+                break;
+            case 5:
+                sprintf(path, "/ietf-interfaces:interfaces-state/interface[name='eth%u']/type", i);
+                strcpy(value, "iana-if-type:ethernetCsmacd");
+                break;
+            case 6:
+                sprintf(path, "/ietf-interfaces:interfaces-state/interface[name='eth%u']/oper-status", i);
+                strcpy(value, (i % 3) ? "up" : "down");
+                break;
+            default:
+                sprintf(path, "/ietf-interfaces:interfaces-state/interface[name='eth%u']/statistics/in-octets", i);
+                sprintf(value, "%u", i * 1000);
+                break;
+            }
+
+            ly_errno = LY_SUCCESS;
+            node = lyd_new_path(data, np2srv.ly_ctx, path, value, 0, 0);
+            if (ly_errno) {
+                lyd_free_withsiblings(data);
+                return NULL;
+            }
+            if (!data) {
+                data = node;
+            }
+        }
+    }
+
+    ly_errno = LY_SUCCESS;
+    lyd_new_path(data, np2srv.ly_ctx, "/nc-notifications:netconf/streams/stream[name='NETCONF']/replaySupport",
+                 "false", 0, 0);
+    if (ly_errno) {
+        lyd_free_withsiblings(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+static void
+mb_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n interfaces] [-t ms] [-o report]\n", progname);
+    fprintf(stdout, " -n interfaces       interfaces in the data filtered by get_tree_from_data (default 1000)\n");
+    fprintf(stdout, " -t ms               minimal duration of every benchmark (default 200)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct mb_state st;
+    uint32_t if_count = 1000, min_ms = 200, i;
+    const char *report = NULL;
+    int c, ret = EXIT_FAILURE;
+    MB_CASE mc;
+
+    while ((c = getopt(argc, argv, "n:t:o:h")) != -1) {
+        switch (c) {
+        case 'n':
+            if_count = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            min_ms = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            mb_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!if_count) {
+        mb_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (report && perf_report_open(report, "np2-microbench")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    memset(&st, 0, sizeof st);
+    if (load_modules()) {
+        fprintf(stderr, "Loading the modules failed.\n");
+        goto cleanup;
+    }
+    st.data = build_data(if_count);
+    if (!st.data) {
+        fprintf(stderr, "Building the data failed.\n");
+        goto cleanup;
+    }
+    calibrate_timer();
+
+    fprintf(stdout, "Interfaces: %u, timer overhead: %lu ns (subtracted)\n", if_count, (unsigned long)timer_overhead);
+    for (i = 0; i < sizeof mb_corpus / sizeof *mb_corpus; ++i) {
+        st.filter = &mb_corpus[i];
+
+        /* XPaths for get_tree_from_data */
+        if (mb_setup(MB_CREATE, &st) || op_filter_create(st.filter_node, &st.paths, &st.path_count)) {
+            fprintf(stderr, "Compiling filter \"%s\" failed.\n", st.filter->name);
+            mb_teardown(&st);
+            goto cleanup;
+        }
+        mb_teardown(&st);
+
+        fprintf(stdout, "Filter: %s (%d XPaths)\n", st.filter->name, st.path_count);
+        for (mc = 0; mc < MB_CASE_COUNT; ++mc) {
+            if (st.filter->xpath && ((mc == MB_BUILD) || (mc == MB_BUF_ADD))) {
+                /* subtree filters only */
+                continue;
+            }
+            if (mb_measure(mc, &st, min_ms)) {
+                fprintf(stderr, "Benchmark %s of filter \"%s\" failed.\n", mb_case_names[mc], st.filter->name);
+                goto cleanup;
+            }
+        }
+
+        free_filters(st.paths, st.path_count);
+        st.paths = NULL;
+        st.path_count = 0;
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    free_filters(st.paths, st.path_count);
+    lyd_free_withsiblings(st.data);
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
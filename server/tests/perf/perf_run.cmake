@@ -0,0 +1,19 @@
+# runs one benchmark in the fixed configuration of the perf tests and compares its report with the baselines,
+# variables BENCH, BENCH_ARGS (space-separated), REPORT, COMPARE and BASELINES are expected, UNRECORDED are
+# the comma-separated units of the metrics that may have no baseline
+separate_arguments(BENCH_ARGS)
+get_filename_component(REPORT_DIR ${REPORT} DIRECTORY)
+file(MAKE_DIRECTORY ${REPORT_DIR})
+
+execute_process(COMMAND ${BENCH} ${BENCH_ARGS} -o ${REPORT} RESULT_VARIABLE BENCH_RESULT)
+if(NOT BENCH_RESULT EQUAL 0)
+    message(FATAL_ERROR "Benchmark ${BENCH} failed (${BENCH_RESULT}).")
+endif()
+
+if(UNRECORDED)
+    set(COMPARE_ARGS -n ${UNRECORDED})
+endif()
+execute_process(COMMAND ${COMPARE} ${COMPARE_ARGS} ${BASELINES} ${REPORT} RESULT_VARIABLE COMPARE_RESULT)
+if(NOT COMPARE_RESULT EQUAL 0)
+    message(FATAL_ERROR "Performance regression or unrecorded baseline of ${BENCH}, see the comparison above and ${REPORT}.")
+endif()
@@ -0,0 +1,331 @@
+/**
+ * @file perf_compare.c
+ * @brief Comparison of benchmark reports with the stored baselines.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * The baselines file is a CSV file with the "benchmark,metric,unit,baseline,tolerance,better" header, lines
+ * starting with '#' are comments. Tolerance is in percent of the baseline, better is "lower" or "higher".
+ * For a zero baseline the tolerance is an absolute value. Baseline "-" means it was not recorded yet, such
+ * a metric fails the comparison unless its unit is explicitly allowed to be unrecorded (-n), then it is only
+ * reported. Only the metrics in the baselines are compared, all of them of every benchmark present in the reports.
+ */
+
+struct perf_result {
+    char *benchmark;
+    char *metric;
+    double value;
+};
+
+static struct perf_result *results;
+static size_t result_count;
+
+/* comma-separated units of the metrics that may have no baseline */
+static const char *unrecorded_units;
+
+/* splits a CSV line into at most max fields in place, returns their number */
+static int
+csv_split(char *line, char **fields, int max)
+{
+    int count = 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    while (count < max) {
+        fields[count++] = line;
+        line = strchr(line, ',');
+        if (!line) {
+            break;
+        }
+        *line = '\0';
+        ++line;
+    }
+
+    return count;
+}
+
+static int
+load_report(const char *path)
+{
+    FILE *f;
+    char *line = NULL, *fields[4];
+    size_t size = 0;
+    void *mem;
+    int ret = -1;
+
+    f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* header */
+    if (getline(&line, &size, f) == -1) {
+        fprintf(stderr, "Report \"%s\" is empty.\n", path);
+        goto cleanup;
+    }
+    while (getline(&line, &size, f) != -1) {
+        if (csv_split(line, fields, 4) != 4) {
+            fprintf(stderr, "Invalid line in report \"%s\".\n", path);
+            goto cleanup;
+        }
+
+        mem = realloc(results, (result_count + 1) * sizeof *results);
+        if (!mem) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+        results = mem;
+        results[result_count].benchmark = strdup(fields[0]);
+        results[result_count].metric = strdup(fields[1]);
+        results[result_count].value = strtod(fields[3], NULL);
+        ++result_count;
+    }
+    ret = 0;
+
+cleanup:
+    free(line);
+    fclose(f);
+    return ret;
+}
+
+static int
+benchmark_reported(const char *benchmark)
+{
+    size_t i;
+
+    for (i = 0; i < result_count; ++i) {
+        if (!strcmp(results[i].benchmark, benchmark)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static struct perf_result *
+find_result(const char *benchmark, const char *metric)
+{
+    size_t i;
+
+    for (i = 0; i < result_count; ++i) {
+        if (!strcmp(results[i].benchmark, benchmark) && !strcmp(results[i].metric, metric)) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+static int
+unit_may_be_unrecorded(const char *unit)
+{
+    const char *ptr;
+    size_t len;
+
+    len = strlen(unit);
+    for (ptr = unrecorded_units; ptr && *ptr; ptr += strcspn(ptr, ",")) {
+        if (*ptr == ',') {
+            ++ptr;
+        }
+        if (!strncmp(ptr, unit, len) && ((ptr[len] == ',') || (ptr[len] == '\0'))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* compares one baseline line, returns 1 on a regression or a baseline that must have been recorded */
+static int
+compare_line(char **fields)
+{
+    struct perf_result *res;
+    double baseline, tolerance, change;
+    int lower;
+
+    res = find_result(fields[0], fields[1]);
+    if (!res) {
+        fprintf(stdout, "%-16s %-56s MISSING from the report\n", fields[0], fields[1]);
+        return 1;
+    }
+    if (!strcmp(fields[3], "-")) {
+        if (unit_may_be_unrecorded(fields[2])) {
+            fprintf(stdout, "%-16s %-56s %14.3f %-8s no baseline\n", fields[0], fields[1], res->value, fields[2]);
+            return 0;
+        }
+        fprintf(stdout, "%-16s %-56s %14.3f %-8s NO BASELINE, record it\n", fields[0], fields[1], res->value,
+                fields[2]);
+        return 1;
+    }
+
+    baseline = strtod(fields[3], NULL);
+    tolerance = strtod(fields[4], NULL);
+    lower = strcmp(fields[5], "higher");
+    change = baseline ? (res->value - baseline) * 100 / baseline : res->value;
+
+    /* a regression is a change to the worse side beyond the tolerance */
+    fprintf(stdout, "%-16s %-56s %14.3f %-8s baseline %14.3f %+7.1f %% (tolerance %.0f %%)", fields[0], fields[1],
+            res->value, fields[2], baseline, change, tolerance);
+    if (lower ? (change > tolerance) : (-change > tolerance)) {
+        fprintf(stdout, " REGRESSION\n");
+        return 1;
+    } else if (lower ? (-change > tolerance) : (change > tolerance)) {
+        fprintf(stdout, " improved, update the baseline\n");
+    } else {
+        fprintf(stdout, "\n");
+    }
+    return 0;
+}
+
+/* replaces the baseline value of the line with the reported one, if there is any */
+static int
+update_line(FILE *out, char **fields)
+{
+    struct perf_result *res;
+
+    res = find_result(fields[0], fields[1]);
+    if (!res) {
+        fprintf(stderr, "Metric %s/%s is missing from the reports, the baseline is kept.\n", fields[0], fields[1]);
+        return fprintf(out, "%s,%s,%s,%s,%s,%s\n", fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]);
+    }
+    return fprintf(out, "%s,%s,%s,%.3f,%s,%s\n", fields[0], fields[1], fields[2], res->value, fields[4], fields[5]);
+}
+
+static void
+usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n units | -u [-U unit]] baselines report...\n", progname);
+    fprintf(stdout, " -n unit[,unit...]   metrics in these units may have no baseline, they are only reported\n");
+    fprintf(stdout, " -u                  update the baselines with the reported values instead of comparing\n");
+    fprintf(stdout, " -U unit             update only the baselines of the metrics in this unit\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    FILE *f = NULL, *out = NULL;
+    char *line = NULL, *copy = NULL, *fields[6], *tmp_path = NULL;
+    const char *unit = NULL;
+    size_t size = 0, i;
+    int c, update = 0, regressions = 0, ret = EXIT_FAILURE;
+
+    while ((c = getopt(argc, argv, "n:uU:h")) != -1) {
+        switch (c) {
+        case 'n':
+            unrecorded_units = optarg;
+            break;
+        case 'u':
+            update = 1;
+            break;
+        case 'U':
+            unit = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (c = optind + 1; c < argc; ++c) {
+        if (load_report(argv[c])) {
+            goto cleanup;
+        }
+    }
+
+    f = fopen(argv[optind], "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open baselines \"%s\" (%s).\n", argv[optind], strerror(errno));
+        goto cleanup;
+    }
+    if (update) {
+        /* written next to the baselines and renamed over them at the end */
+        if (asprintf(&tmp_path, "%s.new", argv[optind]) == -1) {
+            tmp_path = NULL;
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+        out = fopen(tmp_path, "w");
+        if (!out) {
+            fprintf(stderr, "Failed to open \"%s\" (%s).\n", tmp_path, strerror(errno));
+            goto cleanup;
+        }
+    }
+
+    while (getline(&line, &size, f) != -1) {
+        free(copy);
+        copy = strdup(line);
+        if (!copy) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            goto cleanup;
+        }
+
+        /* comments, the header, the benchmarks that did not run and the metrics in other units are kept as they are */
+        if ((line[0] == '#') || !strncmp(line, "benchmark,", 10) || (csv_split(line, fields, 6) != 6)
+                || !benchmark_reported(fields[0]) || (out && unit && strcmp(fields[2], unit))) {
+            if (out && (fputs(copy, out) == EOF)) {
+                fprintf(stderr, "Writing \"%s\" failed.\n", tmp_path);
+                goto cleanup;
+            }
+            continue;
+        }
+
+        if (out) {
+            if (update_line(out, fields) < 0) {
+                fprintf(stderr, "Writing \"%s\" failed.\n", tmp_path);
+                goto cleanup;
+            }
+        } else {
+            regressions += compare_line(fields);
+        }
+    }
+
+    if (out) {
+        if (fclose(out)) {
+            out = NULL;
+            fprintf(stderr, "Writing \"%s\" failed.\n", tmp_path);
+            goto cleanup;
+        }
+        out = NULL;
+        if (rename(tmp_path, argv[optind])) {
+            fprintf(stderr, "Failed to replace \"%s\" (%s).\n", argv[optind], strerror(errno));
+            goto cleanup;
+        }
+    } else if (regressions) {
+        fprintf(stdout, "%d metric(s) regressed, are missing or have no baseline.\n", regressions);
+        goto cleanup;
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (out) {
+        fclose(out);
+        unlink(tmp_path);
+    }
+    if (f) {
+        fclose(f);
+    }
+    free(tmp_path);
+    free(copy);
+    free(line);
+    for (i = 0; i < result_count; ++i) {
+        free(results[i].benchmark);
+        free(results[i].metric);
+    }
+    free(results);
+    return ret;
+}
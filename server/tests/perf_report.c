@@ -0,0 +1,74 @@
+/**
+ * @file perf_report.c
+ * @brief Machine-readable benchmark reports.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "perf_report.h"
+
+static FILE *report;
+static const char *report_bench;
+
+int
+perf_report_open(const char *path, const char *benchmark)
+{
+    report = fopen(path, "w");
+    if (!report) {
+        return -1;
+    }
+    report_bench = benchmark;
+    fprintf(report, "benchmark,metric,unit,value\n");
+
+    return 0;
+}
+
+void
+perf_report_add(const char *unit, double value, const char *metric_fmt, ...)
+{
+    char metric[256], *ptr;
+    va_list ap;
+
+    if (!report) {
+        return;
+    }
+
+    va_start(ap, metric_fmt);
+    vsnprintf(metric, sizeof metric, metric_fmt, ap);
+    va_end(ap);
+
+    /* the metric is one CSV field */
+    for (ptr = metric; *ptr; ++ptr) {
+        if ((*ptr == ' ') || (*ptr == ',')) {
+            *ptr = '-';
+        }
+    }
+    fprintf(report, "%s,%s,%s,%.3f\n", report_bench, metric, unit, value);
+}
+
+int
+perf_report_close(void)
+{
+    int ret = 0;
+
+    if (report) {
+        if (ferror(report)) {
+            ret = -1;
+        }
+        if (fclose(report)) {
+            ret = -1;
+        }
+        report = NULL;
+    }
+
+    return ret;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file perf_report.h
+ * @brief Machine-readable benchmark reports header.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef PERF_REPORT_H_
+#define PERF_REPORT_H_
+
+/*
+ * A report is a CSV file with the "benchmark,metric,unit,value" header and one line per result. The metric
+ * names are paths of the measured items, such as "get/10000/avg", spaces in them are replaced by '-'.
+ * The reports are compared with the baselines in tests/perf/baselines.csv by perf_compare.
+ */
+
+/**
+ * @brief Open a report, all the following results are written into it.
+ *
+ * @param[in] path Report file, it is overwritten.
+ * @param[in] benchmark Name of the benchmark in every line.
+ * @return 0 on success, -1 on error.
+ */
+int perf_report_open(const char *path, const char *benchmark);
+
+/**
+ * @brief Add a result into the report, does nothing if no report is open.
+ *
+ * @param[in] unit Unit of the value.
+ * @param[in] value Measured value.
+ * @param[in] metric_fmt Format of the metric name, followed by its arguments.
+ */
+void perf_report_add(const char *unit, double value, const char *metric_fmt, ...);
+
+/**
+ * @brief Close the report.
+ *
+ * @return 0 on success, -1 if writing the report failed.
+ */
+int perf_report_close(void);
+
+#endif /* PERF_REPORT_H_ */
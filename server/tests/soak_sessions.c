@@ -0,0 +1,365 @@
+/**
+ * @file soak_sessions.c
+ * @brief Session-count soak test of the np2srv session bookkeeping over fake sessions.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define main server_main
+#include "../config.h"
+#undef NP2SRV_PIDFILE
+#define NP2SRV_PIDFILE "/tmp/soak_np2srv.pid"
+
+#include "../main.c"
+
+#undef main
+
+#include "alloc_track.h"
+#include "fake_session.h"
+#include "perf_report.h"
+#include "sr_synth.h"
+
+#define SOAK_NC_NS "urn:ietf:params:xml:ns:netconf:base:1.0"
+#define SOAK_USER_COUNT 16
+
+/* the common beginning of all the libnetconf2 server replies, mirrors their NC_RPL type */
+struct soak_reply {
+    enum {
+        SOAK_RPL_OK,
+        SOAK_RPL_DATA,
+        SOAK_RPL_ERROR
+    } type;
+};
+
+/* results of one step, latencies in us per session or RPC */
+struct soak_step {
+    uint32_t count;
+    double add;
+    double rpc;
+    double remove;
+    uint64_t memory;            /* heap per session */
+};
+
+static char soak_users[SOAK_USER_COUNT][16];
+static struct lyd_node *subscribe_rpc, *getconfig_rpc;
+static uint64_t heap_base;
+
+static uint64_t
+heap_live(void)
+{
+    struct alloc_stats stats;
+
+    alloc_track_get(&stats);
+    return stats.live;
+}
+
+/*
+ * SESSION BOOKKEEPING
+ */
+
+/* what the server does for a new monitored session and its create-subscription */
+static int
+soak_add(struct nc_session *session)
+{
+    struct nc_server_reply *reply;
+    int error;
+
+    if (connect_ds(session)) {
+        return -1;
+    }
+    ncm_session_add(session);
+
+    reply = op_ntf_subscribe(subscribe_rpc, session);
+    error = !reply || (((struct soak_reply *)reply)->type != SOAK_RPL_OK);
+    nc_server_reply_free(reply);
+    np2_arena_reset();
+
+    return error ? -1 : 0;
+}
+
+/* what the server does when a subscribed session is closed */
+static void
+soak_remove(struct nc_session *session)
+{
+    if (nc_session_get_notif_status(session)) {
+        op_ntf_unsubscribe(session, 0);
+    }
+    nc_session_set_status(session, NC_STATUS_INVALID);
+    nc_session_set_term_reason(session, NC_SESSION_TERM_CLOSED);
+    ncm_session_del(session);
+    free_ds(nc_session_get_data(session));
+    session_free(session);
+}
+
+/* get-config of a random session, as the worker handles it */
+static int
+soak_rpc(struct nc_session **sessions, uint32_t count, uint32_t rpc_count, unsigned int *seed, double *avg)
+{
+    struct nc_server_reply *reply;
+    struct nc_session *session;
+    uint64_t start, total = 0;
+    uint32_t i;
+    int error;
+
+    for (i = 0; i < rpc_count; ++i) {
+        session = sessions[rand_r(seed) % count];
+
+        start = now_ns();
+        ncm_session_rpc(session);
+        reply = np2srv_op_get(getconfig_rpc, session);
+        error = !reply || (((struct soak_reply *)reply)->type == SOAK_RPL_ERROR);
+        nc_server_reply_free(reply);
+        np2_arena_reset();
+        total += now_ns() - start;
+
+        if (error) {
+            fprintf(stderr, "get-config of session %u failed (%s).\n", nc_session_get_id(session), np2log_lasterr());
+            return -1;
+        }
+    }
+
+    *avg = (double)total / rpc_count / 1000.0;
+    return 0;
+}
+
+static void
+soak_usage(const char *progname)
+{
+    fprintf(stdout, "Usage: %s [-n sessions] [-s step] [-r rpcs] [-g factor] [-M bytes] [-o report]\n", progname);
+    fprintf(stdout, " -n sessions         maximum number of concurrent sessions (default 2000)\n");
+    fprintf(stdout, " -s step             sessions added and then removed in one step (default 200)\n");
+    fprintf(stdout, " -r rpcs             get-config RPCs of random sessions after every step (default 1000)\n");
+    fprintf(stdout, " -g factor           latency growth limit, the last step to the first one (default 4)\n");
+    fprintf(stdout, " -M bytes            heap limit per session (default 4096)\n");
+    fprintf(stdout, " -o report           write also a machine-readable CSV report\n");
+}
+
+/* prints one step of the ramp */
+static void
+soak_print(const struct soak_step *step, int down)
+{
+    if (!down) {
+        fprintf(stdout, "%9u sessions  add: %8.2f us  get-config: %8.2f us  heap: %6lu B/session\n", step->count,
+                step->add, step->rpc, (unsigned long)step->memory);
+        perf_report_add("us", step->add, "add/%u", step->count);
+        perf_report_add("us", step->rpc, "get-config/%u", step->count);
+        perf_report_add("B", step->memory, "memory/%u", step->count);
+    } else {
+        fprintf(stdout, "%9u sessions  remove: %5.2f us  get-config: %8.2f us\n", step->count, step->remove,
+                step->rpc);
+        perf_report_add("us", step->remove, "remove/%u", step->count);
+    }
+}
+
+/* returns 1 if the latency grew more than the limit, short latencies are compared with 1 us */
+static int
+soak_growth(const char *name, double first, double last, double factor)
+{
+    if (last <= factor * (first > 1.0 ? first : 1.0)) {
+        return 0;
+    }
+
+    fprintf(stdout, "%s latency grew from %.2f us to %.2f us (limit %.1fx).\n", name, first, last, factor);
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct synth_shape shape;
+    struct nc_session **sessions = NULL;
+    struct soak_step *up = NULL, *down = NULL;
+    const char *report = NULL;
+    uint32_t max_count = 2000, step = 200, rpc_count = 1000, count = 0, steps, i, j, idx;
+    uint64_t start, mem_limit = 4096;
+    unsigned int seed = 1;
+    double factor = 4;
+    int c, out = -1, exceeded = 0, ret = EXIT_FAILURE;
+
+    while ((c = getopt(argc, argv, "n:s:r:g:M:o:h")) != -1) {
+        switch (c) {
+        case 'n':
+            max_count = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            step = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rpc_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            factor = strtod(optarg, NULL);
+            break;
+        case 'M':
+            mem_limit = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            report = optarg;
+            break;
+        default:
+            soak_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!max_count || !step || (step > max_count) || !rpc_count || (factor < 1)) {
+        soak_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (report && perf_report_open(report, "soak_sessions")) {
+        fprintf(stderr, "Failed to open report \"%s\" (%s).\n", report, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    steps = (max_count + step - 1) / step;
+    for (i = 0; i < SOAK_USER_COUNT; ++i) {
+        sprintf(soak_users[i], "user%u", i);
+    }
+
+    openlog("soak_sessions", LOG_PERROR, LOG_USER);
+    np2_verbose_level = NC_VERB_ERROR;
+    nc_verbosity(np2_verbose_level);
+    nc_set_print_clb(np2log_clb_nc2);
+    ly_set_log_clb(np2log_clb_ly, 1);
+
+    /* a small datastore, only the bookkeeping is supposed to grow with the sessions */
+    memset(&shape, 0, sizeof shape);
+    shape.depth = 1;
+    shape.leaves = 4;
+    shape.default_ratio = 0.25;
+    shape.seed = 1;
+    synth_shape_types(&shape, "string,uint32,boolean,enumeration");
+    synth_ntf_enable();
+    if (synth_init(&shape) || server_init()) {
+        fprintf(stderr, "Server init failed.\n");
+        goto cleanup;
+    }
+    synth_shape_fit(&shape, 100);
+    if (synth_generate(np2srv.ly_ctx, &shape, SR_DS_RUNNING)) {
+        fprintf(stderr, "Generating the data failed.\n");
+        goto cleanup;
+    }
+
+    subscribe_rpc = lyd_parse_mem(np2srv.ly_ctx, "<create-subscription"
+                                  " xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"/>",
+                                  LYD_XML, LYD_OPT_RPC, NULL);
+    getconfig_rpc = lyd_parse_mem(np2srv.ly_ctx, "<get-config xmlns=\"" SOAK_NC_NS "\"><source><running/></source>"
+                                  "</get-config>", LYD_XML, LYD_OPT_RPC, NULL);
+    if (!subscribe_rpc || !getconfig_rpc) {
+        fprintf(stderr, "Failed to parse the RPCs.\n");
+        goto cleanup;
+    }
+
+    /* notificationComplete of the closed sessions */
+    out = open("/dev/null", O_WRONLY);
+    sessions = malloc(max_count * sizeof *sessions);
+    up = calloc(steps, sizeof *up);
+    down = calloc(steps, sizeof *down);
+    if ((out == -1) || !sessions || !up || !down) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        goto cleanup;
+    }
+
+    fprintf(stdout, "Sessions: %u, step: %u, get-config RPCs per step: %u\n", max_count, step, rpc_count);
+    heap_base = heap_live();
+
+    /* ramp up */
+    for (i = 0; i < steps; ++i) {
+        start = now_ns();
+        for (j = 0; (j < step) && (count < max_count); ++j) {
+            sessions[count] = session_new(count + 1, out, soak_users[(count + 1) % SOAK_USER_COUNT]);
+            if (!sessions[count]) {
+                fprintf(stderr, "Memory allocation failed.\n");
+                goto cleanup;
+            }
+            if (soak_add(sessions[count])) {
+                fprintf(stderr, "Adding session %u failed (%s).\n", count + 1, np2log_lasterr());
+                session_free(sessions[count]);
+                goto cleanup;
+            }
+            ++count;
+        }
+        up[i].add = (double)(now_ns() - start) / j / 1000.0;
+        up[i].count = count;
+        up[i].memory = (heap_live() - heap_base) / count;
+        if (soak_rpc(sessions, count, rpc_count, &seed, &up[i].rpc)) {
+            goto cleanup;
+        }
+        soak_print(&up[i], 0);
+    }
+
+    /* ramp down, the sessions are closed in random order */
+    for (i = 0; i < steps; ++i) {
+        down[i].count = count;
+        if (soak_rpc(sessions, count, rpc_count, &seed, &down[i].rpc)) {
+            goto cleanup;
+        }
+
+        start = now_ns();
+        for (j = 0; (j < step) && count; ++j) {
+            idx = rand_r(&seed) % count;
+            soak_remove(sessions[idx]);
+            sessions[idx] = sessions[--count];
+        }
+        down[i].remove = (double)(now_ns() - start) / j / 1000.0;
+        soak_print(&down[i], 1);
+    }
+
+    /* the latencies must not depend on the session count */
+    exceeded += soak_growth("add", up[0].add, up[steps - 1].add, factor);
+    exceeded += soak_growth("get-config", up[0].rpc, up[steps - 1].rpc, factor);
+    exceeded += soak_growth("remove", down[steps - 1].remove, down[0].remove, factor);
+    if (up[steps - 1].memory > mem_limit) {
+        fprintf(stdout, "Heap per session %lu B exceeds the limit %lu B.\n", (unsigned long)up[steps - 1].memory,
+                (unsigned long)mem_limit);
+        ++exceeded;
+    }
+    if (exceeded) {
+        fprintf(stdout, "%d check(s) failed.\n", exceeded);
+    } else {
+        ret = EXIT_SUCCESS;
+    }
+
+cleanup:
+    if (perf_report_close()) {
+        fprintf(stderr, "Writing report \"%s\" failed.\n", report);
+        ret = EXIT_FAILURE;
+    }
+    for (i = 0; i < count; ++i) {
+        soak_remove(sessions[i]);
+    }
+    free(sessions);
+    free(up);
+    free(down);
+    if (out > -1) {
+        close(out);
+    }
+    lyd_free(subscribe_rpc);
+    lyd_free(getconfig_rpc);
+    np2srv_sr_pool_destroy();
+    synth_destroy();
+    chm_destroy();
+    nc_ps_clear(np2srv.nc_ps, 1, free_ds);
+    nc_ps_free(np2srv.nc_ps);
+    nc_server_destroy();
+    ncm_destroy();
+    ly_ctx_destroy(np2srv.ly_ctx, NULL);
+    return ret;
+}
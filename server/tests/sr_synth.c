@@ -0,0 +1,952 @@
+/**
+ * @file sr_synth.c
+ * @brief In-process sysrepo stand-in with deterministic synthetic datastores.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "config.h"
+#include "../common.h"
+#include "../operations.h"
+#include "sr_synth.h"
+
+#define SYNTH_DS_COUNT (SR_DS_CANDIDATE + 1)
+
+/* the generated values are spread evenly, so the default ratio needs only this precision */
+#define SYNTH_RATIO_SCALE 1000000
+
+struct synth_iter {
+    struct ly_set *set;
+    uint32_t idx;
+};
+
+static const char *synth_type_names[SYNTH_TYPE_COUNT] = {"string", "uint32", "boolean", "enumeration"};
+static const char *synth_type_dflts[SYNTH_TYPE_COUNT] = {"dflt", "0", "false", "one"};
+static const char *synth_enums[] = {"one", "two", "three", "four"};
+
+static struct {
+    char *yin;
+    struct lyd_node *data[SYNTH_DS_COUNT];
+    sr_datastore_t ds;          /* datastore of the sessions not started here */
+    int ntf;                    /* ietf-netconf-notifications provided */
+    int rpc;                    /* bulk RPC and action in the module */
+    uint32_t rpc_out;           /* entries of the RPC/action output */
+    uint32_t rpc_in;            /* entries of the last RPC/action input */
+    uint64_t rpc_ns;            /* time spent building the outputs */
+} synth;
+
+/* sysrepo session stand-in, it only knows its datastore */
+struct synth_session {
+    sr_datastore_t ds;
+};
+
+/* 64-bit finalizer of MurmurHash3, enough to decorrelate neighbouring instances */
+static uint32_t
+synth_hash(uint64_t a, uint64_t b)
+{
+    uint64_t x;
+
+    x = (a * 0x9E3779B97F4A7C15ULL) ^ b;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+
+    return (uint32_t)x;
+}
+
+int
+synth_shape_types(struct synth_shape *shape, const char *types)
+{
+    const char *ptr, *end;
+    size_t len;
+    int i;
+
+    shape->type_count = 0;
+    for (ptr = types; *ptr; ptr = *end ? end + 1 : end) {
+        end = strchrnul(ptr, ',');
+        len = end - ptr;
+        for (i = 0; i < SYNTH_TYPE_COUNT; ++i) {
+            if ((strlen(synth_type_names[i]) == len) && !strncmp(ptr, synth_type_names[i], len)) {
+                break;
+            }
+        }
+        if ((i == SYNTH_TYPE_COUNT) || (shape->type_count == SYNTH_TYPE_COUNT)) {
+            return -1;
+        }
+        shape->types[shape->type_count++] = i;
+    }
+
+    return shape->type_count ? 0 : -1;
+}
+
+void
+synth_shape_fit(struct synth_shape *shape, uint64_t nodes)
+{
+    uint64_t entries, upper, pow;
+    uint32_t size, i;
+
+    /* every list instance is the list node, its key and the leaves */
+    entries = (nodes > 1) ? (nodes - 1) / (shape->leaves + 2) : 1;
+
+    /* the largest size with size^depth <= entries */
+    for (size = 1; ; ++size) {
+        for (pow = 1, i = 0; (i < shape->depth) && (pow <= entries); ++i) {
+            pow *= size + 1;
+        }
+        if (pow > entries) {
+            break;
+        }
+    }
+
+    /* instances of all the upper levels */
+    upper = 0;
+    for (pow = 1, i = 0; i < shape->depth - 1; ++i) {
+        shape->list_size[i] = size;
+        pow *= size;
+        upper += pow;
+    }
+    shape->list_size[shape->depth - 1] = (entries >= upper + pow) ? (entries - upper) / pow : 1;
+}
+
+uint64_t
+synth_node_count(const struct synth_shape *shape)
+{
+    uint64_t count = 1, instances = 1;
+    uint32_t i;
+
+    for (i = 0; i < shape->depth; ++i) {
+        instances *= shape->list_size[i];
+        count += instances * (shape->leaves + 2);
+    }
+
+    return count;
+}
+
+static void
+synth_yin_level(FILE *yin, const struct synth_shape *shape, uint32_t level)
+{
+    uint32_t i;
+    SYNTH_TYPE type;
+
+    fprintf(yin, "<list name=\"l%u\"><key value=\"name\"/><leaf name=\"name\"><type name=\"string\"/></leaf>", level + 1);
+    for (i = 0; i < shape->leaves; ++i) {
+        type = shape->types[i % shape->type_count];
+        fprintf(yin, "<leaf name=\"f%u\"><type name=\"%s\"/><default value=\"%s\"/></leaf>", i,
+                (type == SYNTH_ENUM) ? "synth-enum" : synth_type_names[type], synth_type_dflts[type]);
+    }
+    if (level + 1 < shape->depth) {
+        synth_yin_level(yin, shape, level + 1);
+    }
+    fprintf(yin, "</list>");
+}
+
+int
+synth_init(const struct synth_shape *shape)
+{
+    FILE *yin;
+    size_t size;
+
+    if (!shape->depth || (shape->depth > SYNTH_MAX_DEPTH) || !shape->type_count) {
+        EINT;
+        return -1;
+    }
+
+    free(synth.yin);
+    synth.yin = NULL;
+    yin = open_memstream(&synth.yin, &size);
+    if (!yin) {
+        EMEM;
+        return -1;
+    }
+
+    fprintf(yin, "<module name=\"%s\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\"><namespace uri=\"%s\"/>"
+            "<prefix value=\"sy\"/>%s<typedef name=\"synth-enum\"><type name=\"enumeration\">"
+            "<enum name=\"one\"/><enum name=\"two\"/><enum name=\"three\"/><enum name=\"four\"/></type></typedef>"
+            "<container name=\"synth\">", SYNTH_MODULE, SYNTH_NS,
+            synth.rpc ? "<yang-version value=\"1.1\"/>" : "");
+    synth_yin_level(yin, shape, 0);
+    fprintf(yin, "</container>");
+    if (synth.rpc) {
+        fprintf(yin, "<grouping name=\"bulk-entries\"><list name=\"entry\"><key value=\"name\"/>"
+                "<leaf name=\"name\"><type name=\"string\"/></leaf><leaf name=\"value\"><type name=\"uint32\"/></leaf>"
+                "<leaf name=\"descr\"><type name=\"string\"/></leaf></list></grouping>"
+                "<rpc name=\"bulk\"><input><uses name=\"bulk-entries\"/></input>"
+                "<output><uses name=\"bulk-entries\"/></output></rpc>"
+                "<container name=\"objects\"><list name=\"object\"><key value=\"id\"/>"
+                "<leaf name=\"id\"><type name=\"uint32\"/></leaf>"
+                "<action name=\"bulk\"><input><uses name=\"bulk-entries\"/></input>"
+                "<output><uses name=\"bulk-entries\"/></output></action></list></container>");
+    }
+    fprintf(yin, "</module>");
+
+    if (fclose(yin)) {
+        EMEM;
+        return -1;
+    }
+    return 0;
+}
+
+static int
+synth_generate_level(struct lyd_node *parent, const struct lys_module *mod, const struct synth_shape *shape,
+                     uint32_t level, uint64_t *seq)
+{
+    struct lyd_node *list;
+    uint32_t i, j, hash;
+    char lname[16], name[16], buf[16];
+    const char *value;
+    SYNTH_TYPE type;
+
+    sprintf(lname, "l%u", level + 1);
+    for (i = 0; i < shape->list_size[level]; ++i) {
+        list = lyd_new(parent, mod, lname);
+        sprintf(buf, "e%u", i);
+        if (!list || !lyd_new_leaf(list, mod, "name", buf)) {
+            return -1;
+        }
+
+        for (j = 0; j < shape->leaves; ++j) {
+            hash = synth_hash(shape->seed ^ *seq, j);
+            if (hash % SYNTH_RATIO_SCALE < shape->default_ratio * SYNTH_RATIO_SCALE) {
+                /* left for validation to add the default */
+                continue;
+            }
+
+            hash = synth_hash(hash, *seq);
+            type = shape->types[j % shape->type_count];
+            switch (type) {
+            case SYNTH_STRING:
+                sprintf(buf, "v%08x", hash);
+                value = buf;
+                break;
+            case SYNTH_UINT32:
+                sprintf(buf, "%u", hash);
+                value = buf;
+                break;
+            case SYNTH_BOOL:
+                value = (hash & 1) ? "true" : "false";
+                break;
+            default:
+                value = synth_enums[hash % (sizeof synth_enums / sizeof *synth_enums)];
+                break;
+            }
+
+            sprintf(name, "f%u", j);
+            if (!lyd_new_leaf(list, mod, name, value)) {
+                return -1;
+            }
+        }
+        ++(*seq);
+
+        if ((level + 1 < shape->depth) && synth_generate_level(list, mod, shape, level + 1, seq)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+synth_generate(struct ly_ctx *ctx, const struct synth_shape *shape, sr_datastore_t ds)
+{
+    const struct lys_module *mod;
+    struct lyd_node *root;
+    uint64_t seq = 0;
+
+    mod = ly_ctx_get_module(ctx, SYNTH_MODULE, NULL);
+    if (!mod) {
+        ERR("Module \"%s\" is not in the context.", SYNTH_MODULE);
+        return -1;
+    }
+
+    root = lyd_new(NULL, mod, "synth");
+    if (!root || synth_generate_level(root, mod, shape, 0, &seq)) {
+        lyd_free(root);
+        return -1;
+    }
+
+    /* adds all the default leaves */
+    if (lyd_validate(&root, LYD_OPT_CONFIG, ctx)) {
+        lyd_free_withsiblings(root);
+        return -1;
+    }
+
+    lyd_free_withsiblings(synth.data[ds]);
+    synth.data[ds] = root;
+    return 0;
+}
+
+struct lyd_node *
+synth_data(sr_datastore_t ds)
+{
+    return synth.data[ds];
+}
+
+void
+synth_destroy(void)
+{
+    int i;
+
+    for (i = 0; i < SYNTH_DS_COUNT; ++i) {
+        lyd_free_withsiblings(synth.data[i]);
+        synth.data[i] = NULL;
+    }
+    free(synth.yin);
+    synth.yin = NULL;
+}
+
+void
+synth_ntf_enable(void)
+{
+    synth.ntf = 1;
+}
+
+void
+synth_rpc_enable(void)
+{
+    synth.rpc = 1;
+}
+
+void
+synth_rpc_output(uint32_t entries)
+{
+    synth.rpc_out = entries;
+}
+
+uint32_t
+synth_rpc_input(void)
+{
+    return synth.rpc_in;
+}
+
+uint64_t
+synth_rpc_ns(void)
+{
+    return synth.rpc_ns;
+}
+
+static char *
+synth_read_file(const char *path)
+{
+    FILE *f;
+    char *buf = NULL;
+    long size;
+
+    f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) || ((size = ftell(f)) < 0) || fseek(f, 0, SEEK_SET)) {
+        goto cleanup;
+    }
+    buf = malloc(size + 1);
+    if (!buf) {
+        goto cleanup;
+    }
+    if (fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+        goto cleanup;
+    }
+    buf[size] = '\0';
+
+cleanup:
+    fclose(f);
+    return buf;
+}
+
+/*
+ * SYSREPO WRAPPER FUNCTIONS
+ */
+int
+__wrap_sr_connect(const char *app_name, const sr_conn_options_t opts, sr_conn_ctx_t **conn_ctx)
+{
+    (void)app_name;
+    (void)opts;
+    (void)conn_ctx;
+    return SR_ERR_OK;
+}
+
+void
+__wrap_sr_disconnect(sr_conn_ctx_t *conn_ctx)
+{
+    (void)conn_ctx;
+}
+
+static sr_datastore_t
+synth_ds(sr_session_ctx_t *session)
+{
+    return session ? ((struct synth_session *)session)->ds : synth.ds;
+}
+
+int
+__wrap_sr_session_start(sr_conn_ctx_t *conn_ctx, const sr_datastore_t datastore,
+                        const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)conn_ctx;
+    (void)opts;
+
+    *session = calloc(1, sizeof(struct synth_session));
+    if (!*session) {
+        return SR_ERR_NOMEM;
+    }
+    ((struct synth_session *)*session)->ds = datastore;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_start_user(sr_conn_ctx_t *conn_ctx, const char *user_name, const sr_datastore_t datastore,
+                             const sr_sess_options_t opts, sr_session_ctx_t **session)
+{
+    (void)user_name;
+
+    return __wrap_sr_session_start(conn_ctx, datastore, opts, session);
+}
+
+int
+__wrap_sr_session_stop(sr_session_ctx_t *session)
+{
+    free(session);
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_switch_ds(sr_session_ctx_t *session, sr_datastore_t ds)
+{
+    if (session) {
+        ((struct synth_session *)session)->ds = ds;
+    } else {
+        synth.ds = ds;
+    }
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_set_options(sr_session_ctx_t *session, const sr_sess_options_t opts)
+{
+    (void)session;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_session_refresh(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_list_schemas(sr_session_ctx_t *session, sr_schema_t **schemas, size_t *schema_cnt)
+{
+    (void)session;
+
+    *schema_cnt = synth.ntf ? 3 : 2;
+    *schemas = calloc(*schema_cnt, sizeof **schemas);
+
+    (*schemas)[0].module_name = strdup("ietf-netconf-server");
+    (*schemas)[0].installed = 1;
+
+    (*schemas)[1].module_name = strdup(SYNTH_MODULE);
+    (*schemas)[1].ns = strdup(SYNTH_NS);
+    (*schemas)[1].prefix = strdup("sy");
+    (*schemas)[1].installed = 1;
+    (*schemas)[1].implemented = 1;
+
+    if (synth.ntf) {
+        (*schemas)[2].module_name = strdup("ietf-netconf-notifications");
+        (*schemas)[2].ns = strdup("urn:ietf:params:xml:ns:yang:ietf-netconf-notifications");
+        (*schemas)[2].prefix = strdup("ncn");
+        (*schemas)[2].revision.revision = strdup("2012-02-06");
+        (*schemas)[2].installed = 1;
+        (*schemas)[2].implemented = 1;
+    }
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_schema(sr_session_ctx_t *session, const char *module_name, const char *revision,
+                     const char *submodule_name, sr_schema_format_t format, char **schema_content)
+{
+    (void)session;
+    (void)revision;
+    (void)submodule_name;
+    (void)format;
+
+    if (!strcmp(module_name, "ietf-netconf-server")) {
+        *schema_content = strdup("<module name=\"ietf-netconf-server\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\"><namespace uri=\"ns\"/><prefix value=\"pr\"/></module>");
+    } else if (!strcmp(module_name, SYNTH_MODULE) && synth.yin) {
+        *schema_content = strdup(synth.yin);
+    } else if (synth.ntf && !strcmp(module_name, "ietf-netconf-notifications")) {
+        /* ietf-netconf is its import */
+        *schema_content = synth_read_file(TESTS_DIR "/files/ietf-netconf-notifications.yin");
+    } else if (synth.ntf && !strcmp(module_name, "ietf-netconf")) {
+        *schema_content = synth_read_file(TESTS_DIR "/files/ietf-netconf.yin");
+    } else {
+        return SR_ERR_NOT_FOUND;
+    }
+    if (!*schema_content) {
+        return SR_ERR_IO;
+    }
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_install_subscribe(sr_session_ctx_t *session, sr_module_install_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_feature_enable_subscribe(sr_session_ctx_t *session, sr_feature_enable_cb callback, void *private_ctx,
+                                   sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_module_change_subscribe(sr_session_ctx_t *session, const char *module_name, sr_module_change_cb callback,
+                                  void *private_ctx, uint32_t priority, sr_subscr_options_t opts,
+                                  sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)module_name;
+    (void)callback;
+    (void)private_ctx;
+    (void)priority;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *values,
+                           const size_t values_cnt, sr_ev_notif_flag_t opts)
+{
+    (void)session;
+    (void)xpath;
+    (void)values;
+    (void)values_cnt;
+    (void)opts;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_subscribe_tree(sr_session_ctx_t *session, const char *xpath, sr_event_notif_tree_cb callback,
+                                     void *private_ctx, sr_subscr_options_t opts, sr_subscription_ctx_t **subscription)
+{
+    (void)session;
+    (void)xpath;
+    (void)callback;
+    (void)private_ctx;
+    (void)opts;
+    (void)subscription;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_event_notif_replay(sr_session_ctx_t *session, sr_subscription_ctx_t *subscription, time_t start_time,
+                             time_t stop_time)
+{
+    (void)session;
+    (void)subscription;
+    (void)start_time;
+    (void)stop_time;
+    return SR_ERR_OK;
+}
+
+static int
+synth_val(struct lyd_node *node, sr_val_t **value)
+{
+    char *path;
+
+    path = lyd_path(node);
+    *value = calloc(1, sizeof **value);
+    if (!path || !*value || op_set_srval(node, path, 1, *value, NULL)) {
+        free(path);
+        free(*value);
+        *value = NULL;
+        return SR_ERR_NOMEM;
+    }
+    (*value)->dflt = node->dflt;
+    free(path);
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_item(sr_session_ctx_t *session, const char *xpath, sr_val_t **value)
+{
+    struct ly_set *set;
+    int rc;
+
+    if (!synth.data[synth_ds(session)]) {
+        return SR_ERR_NOT_FOUND;
+    }
+    set = lyd_find_xpath(synth.data[synth_ds(session)], xpath);
+    if (!set) {
+        return SR_ERR_UNKNOWN_MODEL;
+    }
+
+    rc = set->number ? synth_val(set->set.d[0], value) : SR_ERR_NOT_FOUND;
+    ly_set_free(set);
+    return rc;
+}
+
+int
+__wrap_sr_get_items_iter(sr_session_ctx_t *session, const char *xpath, sr_val_iter_t **iter)
+{
+    struct synth_iter *siter;
+    struct ly_set *set;
+
+    if (!synth.data[synth_ds(session)]) {
+        return SR_ERR_NOT_FOUND;
+    }
+    set = lyd_find_xpath(synth.data[synth_ds(session)], xpath);
+    if (!set) {
+        return SR_ERR_UNKNOWN_MODEL;
+    } else if (!set->number) {
+        ly_set_free(set);
+        return SR_ERR_NOT_FOUND;
+    }
+
+    siter = malloc(sizeof *siter);
+    if (!siter) {
+        ly_set_free(set);
+        return SR_ERR_NOMEM;
+    }
+    siter->set = set;
+    siter->idx = 0;
+
+    *iter = (sr_val_iter_t *)siter;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_get_item_next(sr_session_ctx_t *session, sr_val_iter_t *iter, sr_val_t **value)
+{
+    struct synth_iter *siter = (struct synth_iter *)iter;
+    (void)session;
+
+    if (siter->idx == siter->set->number) {
+        *value = NULL;
+        return SR_ERR_NOT_FOUND;
+    }
+
+    return synth_val(siter->set->set.d[siter->idx++], value);
+}
+
+void
+__wrap_sr_free_val_iter(sr_val_iter_t *iter)
+{
+    struct synth_iter *siter = (struct synth_iter *)iter;
+
+    if (siter) {
+        ly_set_free(siter->set);
+        free(siter);
+    }
+}
+
+int
+__wrap_sr_set_item(sr_session_ctx_t *session, const char *xpath, const sr_val_t *value, const sr_edit_options_t opts)
+{
+    struct lyd_node *node;
+    char buf[128];
+    const char *str = NULL;
+    int opt = 0;
+
+    if (opts & SR_EDIT_NON_RECURSIVE) {
+        opt |= LYD_PATH_OPT_NOPARENT;
+    }
+    if (!(opts & SR_EDIT_STRICT)) {
+        opt |= LYD_PATH_OPT_UPDATE;
+    }
+
+    switch (value->type) {
+    case SR_LIST_T:
+    case SR_CONTAINER_T:
+    case SR_CONTAINER_PRESENCE_T:
+    case SR_LEAF_EMPTY_T:
+        break;
+    default:
+        str = op_get_srval(np2srv.ly_ctx, (sr_val_t *)value, buf);
+        break;
+    }
+
+    ly_errno = LY_SUCCESS;
+    node = lyd_new_path(synth.data[synth_ds(session)], np2srv.ly_ctx, xpath, (void *)str, 0, opt);
+    if (ly_errno) {
+        if ((ly_errno == LY_EVALID) && (ly_vecode == LYVE_PATH_EXISTS)) {
+            return SR_ERR_DATA_EXISTS;
+        }
+        return SR_ERR_VALIDATION_FAILED;
+    }
+    if (!synth.data[synth_ds(session)]) {
+        synth.data[synth_ds(session)] = node;
+    }
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_delete_item(sr_session_ctx_t *session, const char *xpath, const sr_edit_options_t opts)
+{
+    struct ly_set *set;
+    uint32_t i;
+
+    if (!synth.data[synth_ds(session)]) {
+        return (opts & SR_EDIT_STRICT) ? SR_ERR_DATA_MISSING : SR_ERR_OK;
+    }
+    set = lyd_find_xpath(synth.data[synth_ds(session)], xpath);
+    if (!set) {
+        return SR_ERR_UNKNOWN_MODEL;
+    }
+
+    if ((opts & SR_EDIT_STRICT) && !set->number) {
+        ly_set_free(set);
+        return SR_ERR_DATA_MISSING;
+    }
+    for (i = 0; i < set->number; ++i) {
+        if ((opts & SR_EDIT_NON_RECURSIVE) && set->set.d[i]->child) {
+            ly_set_free(set);
+            return SR_ERR_UNSUPPORTED;
+        }
+
+        if (set->set.d[i] == synth.data[synth_ds(session)]) {
+            synth.data[synth_ds(session)] = set->set.d[i]->next;
+        }
+        lyd_free(set->set.d[i]);
+    }
+    ly_set_free(set);
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_move_item(sr_session_ctx_t *session, const char *xpath, const sr_move_position_t position, const char *relative_item)
+{
+    struct ly_set *set, *set2 = NULL;
+    struct lyd_node *node = NULL;
+    int rc = SR_ERR_OK;
+
+    set = synth.data[synth_ds(session)] ? lyd_find_xpath(synth.data[synth_ds(session)], xpath) : NULL;
+    if (!set || (set->number != 1)) {
+        ly_set_free(set);
+        return SR_ERR_DATA_MISSING;
+    }
+
+    switch (position) {
+    case SR_MOVE_BEFORE:
+    case SR_MOVE_AFTER:
+        set2 = lyd_find_xpath(synth.data[synth_ds(session)], relative_item);
+        if (!set2 || (set2->number != 1)) {
+            rc = SR_ERR_DATA_MISSING;
+            break;
+        }
+        node = set2->set.d[0];
+        break;
+    case SR_MOVE_FIRST:
+        node = set->set.d[0]->parent->child;
+        break;
+    case SR_MOVE_LAST:
+        node = set->set.d[0]->parent->child->prev;
+        break;
+    }
+
+    if (!rc && (node != set->set.d[0])) {
+        if ((position == SR_MOVE_BEFORE) || (position == SR_MOVE_FIRST)) {
+            rc = lyd_insert_before(node, set->set.d[0]) ? SR_ERR_INTERNAL : SR_ERR_OK;
+        } else {
+            rc = lyd_insert_after(node, set->set.d[0]) ? SR_ERR_INTERNAL : SR_ERR_OK;
+        }
+    }
+
+    ly_set_free(set);
+    ly_set_free(set2);
+    return rc;
+}
+
+int
+__wrap_sr_commit(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_validate(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_discard_changes(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_copy_config(sr_session_ctx_t *session, const char *module_name, sr_datastore_t src_datastore,
+                      sr_datastore_t dst_datastore)
+{
+    struct lyd_node *iter, *dup, *copy = NULL;
+    (void)session;
+    (void)module_name;
+
+    if (src_datastore == dst_datastore) {
+        return SR_ERR_OK;
+    }
+
+    LY_TREE_FOR(synth.data[src_datastore], iter) {
+        dup = lyd_dup(iter, 1);
+        if (!dup) {
+            lyd_free_withsiblings(copy);
+            return SR_ERR_NOMEM;
+        }
+        if (!copy) {
+            copy = dup;
+        } else if (lyd_insert_after(copy->prev, dup)) {
+            lyd_free(dup);
+            lyd_free_withsiblings(copy);
+            return SR_ERR_INTERNAL;
+        }
+    }
+
+    lyd_free_withsiblings(synth.data[dst_datastore]);
+    synth.data[dst_datastore] = copy;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_lock_datastore(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_unlock_datastore(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
+/* the provider of the bulk RPC and action, it checks the input and builds the output entries */
+static int
+synth_rpc_provide(const sr_node_t *input, size_t input_cnt, sr_node_t **output, size_t *output_cnt)
+{
+    sr_node_t *entry, *child;
+    struct timespec start, end;
+    char name[16];
+    size_t i;
+    int rc;
+
+    for (i = 0; i < input_cnt; ++i) {
+        if (strcmp(input[i].name, "entry") || (input[i].type != SR_LIST_T) || !input[i].first_child) {
+            return SR_ERR_INVAL_ARG;
+        }
+    }
+    synth.rpc_in = input_cnt;
+
+    *output = NULL;
+    *output_cnt = 0;
+    if (!synth.rpc_out) {
+        return SR_ERR_OK;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rc = sr_new_trees(synth.rpc_out, output);
+    for (i = 0; (rc == SR_ERR_OK) && (i < synth.rpc_out); ++i) {
+        entry = &(*output)[i];
+        sprintf(name, "e%u", (uint32_t)i);
+        rc = sr_node_set_name(entry, "entry");
+        if (rc == SR_ERR_OK) {
+            rc = sr_node_set_module(entry, SYNTH_MODULE);
+        }
+        entry->type = SR_LIST_T;
+        if (rc == SR_ERR_OK) {
+            rc = sr_node_add_child(entry, "name", NULL, &child);
+        }
+        if (rc == SR_ERR_OK) {
+            rc = sr_node_set_str_data(child, SR_STRING_T, name);
+        }
+        if (rc == SR_ERR_OK) {
+            rc = sr_node_add_child(entry, "value", NULL, &child);
+        }
+        if (rc == SR_ERR_OK) {
+            child->type = SR_UINT32_T;
+            child->data.uint32_val = synth_hash(i, 0);
+            rc = sr_node_add_child(entry, "descr", NULL, &child);
+        }
+        if (rc == SR_ERR_OK) {
+            rc = sr_node_set_str_data(child, SR_STRING_T, "synthetic bulk entry");
+        }
+    }
+    if (rc != SR_ERR_OK) {
+        sr_free_trees(*output, synth.rpc_out);
+        *output = NULL;
+        return rc;
+    }
+    *output_cnt = synth.rpc_out;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    synth.rpc_ns += (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + end.tv_nsec - start.tv_nsec;
+
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_rpc_send_tree(sr_session_ctx_t *session, const char *xpath, const sr_node_t *input, const size_t input_cnt,
+                        sr_node_t **output, size_t *output_cnt)
+{
+    (void)session;
+
+    if (!synth.rpc || strcmp(xpath, "/" SYNTH_MODULE ":bulk")) {
+        return SR_ERR_NOT_FOUND;
+    }
+    return synth_rpc_provide(input, input_cnt, output, output_cnt);
+}
+
+int
+__wrap_sr_action_send_tree(sr_session_ctx_t *session, const char *xpath, const sr_node_t *input, const size_t input_cnt,
+                           sr_node_t **output, size_t *output_cnt)
+{
+    const char *prefix = "/" SYNTH_MODULE ":objects/object[";
+    (void)session;
+
+    if (!synth.rpc || strncmp(xpath, prefix, strlen(prefix)) || strcmp(xpath + strlen(xpath) - 5, "/bulk")) {
+        return SR_ERR_NOT_FOUND;
+    }
+    return synth_rpc_provide(input, input_cnt, output, output_cnt);
+}
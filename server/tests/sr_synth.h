@@ -0,0 +1,143 @@
+/**
+ * @file sr_synth.h
+ * @brief In-process sysrepo stand-in with deterministic synthetic datastores header.
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef SR_SYNTH_H_
+#define SR_SYNTH_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+/*
+ * The stand-in implements (as __wrap_ functions) the sysrepo API np2srv uses, so it must be linked with
+ * the functions in synth_mock_funcs of tests/CMakeLists.txt wrapped. The data live in one libyang tree
+ * per datastore, edits are applied directly to it and there is no access control nor locking, so the
+ * stand-in must be used from a single thread. Commit does not validate, so default nodes are added
+ * only to the generated data.
+ *
+ * The generated "synth" module has the following shape, with SYNTH_MAX_DEPTH levels at most:
+ *
+ *   container synth
+ *     list l1 (key "name", values "e0", "e1", ...)
+ *       leaf f0 .. f<leaves - 1> (type by position in the types list, all with a default value)
+ *       list l2
+ *         ...
+ *
+ * With synth_rpc_enable() it has also the "bulk" RPC and the "objects" container with the "bulk" action.
+ */
+
+#define SYNTH_MODULE "synth"
+#define SYNTH_NS "urn:cesnet:params:xml:ns:yang:synth"
+#define SYNTH_MAX_DEPTH 8
+
+typedef enum {
+    SYNTH_STRING,
+    SYNTH_UINT32,
+    SYNTH_BOOL,
+    SYNTH_ENUM,
+    SYNTH_TYPE_COUNT
+} SYNTH_TYPE;
+
+struct synth_shape {
+    uint32_t depth;                         /**< number of nested list levels */
+    uint32_t list_size[SYNTH_MAX_DEPTH];    /**< instances of the list of each level in every parent */
+    uint32_t leaves;                        /**< leaves of every list instance besides the key */
+    SYNTH_TYPE types[SYNTH_TYPE_COUNT];     /**< leaf types, used in turns */
+    uint32_t type_count;
+    double default_ratio;                   /**< share of the leaves left with their default value */
+    uint32_t seed;                          /**< seed of the generated values */
+};
+
+/**
+ * @brief Set the leaf types of a shape from a comma-separated list of "string", "uint32", "boolean"
+ * and "enumeration".
+ *
+ * @return 0 on success, -1 on an unknown type.
+ */
+int synth_shape_types(struct synth_shape *shape, const char *types);
+
+/**
+ * @brief Set the list sizes of a shape so that its data have about the number of nodes.
+ *
+ * All the levels get the same size except the last one, which is adjusted.
+ */
+void synth_shape_fit(struct synth_shape *shape, uint64_t nodes);
+
+/**
+ * @brief Number of data nodes of a shape including the default ones.
+ */
+uint64_t synth_node_count(const struct synth_shape *shape);
+
+/**
+ * @brief Generate the "synth" module of a shape, call before the server loads its schemas.
+ *
+ * Only the depth, leaves and types of the shape affect the module.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int synth_init(const struct synth_shape *shape);
+
+/**
+ * @brief Make the stand-in provide also the ietf-netconf-notifications module from tests/files, so that
+ * the server subscribes for its notifications. Call before the server loads its schemas.
+ *
+ * The notifications are then delivered by calling np2srv_ntf_clb() directly, the replay subscriptions
+ * are accepted and the replay itself is left to the caller.
+ */
+void synth_ntf_enable(void);
+
+/**
+ * @brief Add also the "bulk" RPC and the "bulk" action of the "objects/object" list (key "id") into the
+ * generated module. Both have a list "entry" (key "name", leaves "value" and "descr") as their input and
+ * output. Call before synth_init().
+ *
+ * The stand-in then provides them, the input must consist of the entries only and the output has
+ * the number of entries set by synth_rpc_output().
+ */
+void synth_rpc_enable(void);
+
+/**
+ * @brief Set the number of entries of the bulk RPC/action output, 0 for no output.
+ */
+void synth_rpc_output(uint32_t entries);
+
+/**
+ * @brief Number of entries of the last bulk RPC/action input.
+ */
+uint32_t synth_rpc_input(void);
+
+/**
+ * @brief Time spent building the bulk RPC/action outputs in ns, it is the provider's and not np2srv's.
+ */
+uint64_t synth_rpc_ns(void);
+
+/**
+ * @brief Generate the data of a shape into a datastore, replacing its previous content.
+ *
+ * @param[in] ctx Context with the module generated by synth_init().
+ * @return 0 on success, -1 on error.
+ */
+int synth_generate(struct ly_ctx *ctx, const struct synth_shape *shape, sr_datastore_t ds);
+
+/**
+ * @brief Current data of a datastore, owned by the stand-in.
+ */
+struct lyd_node *synth_data(sr_datastore_t ds);
+
+/**
+ * @brief Free all the datastores and the generated module.
+ */
+void synth_destroy(void);
+
+#endif /* SR_SYNTH_H_ */
@@ -41,7 +41,15 @@
 #undef main
 
 volatile int initialized;
-int pipes[2][2], p_in, p_out;
+int pipes[4][2], p_in, p_out, p_in2, p_out2;
+
+/* fake sysrepo sessions, the second NETCONF session of the same user gets the pooled one */
+struct test_srs {
+    int denied;
+};
+struct test_srs test_srs[4];
+int test_srs_count;
+struct test_srs *test_srs_denied, *test_srs_committed;
 
 /*
  * SYSREPO WRAPPER FUNCTIONS
@@ -156,7 +164,9 @@ __wrap_sr_session_start_user(sr_conn_ctx_t *conn_ctx, const char *user_name, con
     (void)user_name;
     (void)datastore;
     (void)opts;
-    (void)session;
+
+    assert_int_not_equal(test_srs_count, 4);
+    *session = (sr_session_ctx_t *)&test_srs[test_srs_count++];
     return SR_ERR_OK;
 }
 
@@ -239,11 +249,17 @@ __wrap_sr_free_val_iter(sr_val_iter_t *iter)
 int
 __wrap_sr_set_item(sr_session_ctx_t *session, const char *xpath, const sr_val_t *value, const sr_edit_options_t opts)
 {
-    (void)session;
     (void)value;
     (void)opts;
     static int count = 0;
 
+    if (strstr(xpath, "[name='denied']/description")) {
+        /* the change of the list instance is left in the session */
+        ((struct test_srs *)session)->denied = 1;
+        test_srs_denied = (struct test_srs *)session;
+        return SR_ERR_UNAUTHORIZED;
+    }
+
     switch (count) {
     case 0:
         assert_string_equal(xpath, "/ietf-interfaces:interfaces/interface[name='iface1']");
@@ -311,7 +327,16 @@ __wrap_sr_set_item(sr_session_ctx_t *session, const char *xpath, const sr_val_t
 int
 __wrap_sr_commit(sr_session_ctx_t *session)
 {
-    (void)session;
+    /* changes of a failed RPC must not be committed */
+    assert_int_equal(((struct test_srs *)session)->denied, 0);
+    test_srs_committed = (struct test_srs *)session;
+    return SR_ERR_OK;
+}
+
+int
+__wrap_sr_discard_changes(sr_session_ctx_t *session)
+{
+    ((struct test_srs *)session)->denied = 0;
     return SR_ERR_OK;
 }
 
@@ -399,44 +424,60 @@ struct nc_session {
     } opts;
 };
 
+static struct nc_session *
+test_new_session(uint32_t id, int p[][2])
+{
+    struct nc_session *session;
+
+    pipe(p[0]);
+    pipe(p[1]);
+
+    fcntl(p[0][0], F_SETFL, O_NONBLOCK);
+    fcntl(p[0][1], F_SETFL, O_NONBLOCK);
+    fcntl(p[1][0], F_SETFL, O_NONBLOCK);
+    fcntl(p[1][1], F_SETFL, O_NONBLOCK);
+
+    session = calloc(1, sizeof *session);
+    session->status = NC_STATUS_RUNNING;
+    session->side = 1;
+    session->id = id;
+    session->ti_lock = malloc(sizeof *session->ti_lock);
+    pthread_mutex_init(session->ti_lock, NULL);
+    session->ti_cond = malloc(sizeof *session->ti_cond);
+    pthread_cond_init(session->ti_cond, NULL);
+    session->ti_inuse = malloc(sizeof *session->ti_inuse);
+    *session->ti_inuse = 0;
+    session->ti_type = NC_TI_FD;
+    session->ti.fd.in = p[1][0];
+    session->ti.fd.out = p[0][1];
+    session->ctx = np2srv.ly_ctx;
+    session->flags = 1; //shared ctx
+    session->username = "user1";
+    session->host = "localhost";
+    session->opts.server.session_start = session->opts.server.last_rpc = time(NULL);
+    printf("test: New session %u\n", id);
+
+    return session;
+}
+
 NC_MSG_TYPE
 __wrap_nc_accept(int timeout, struct nc_session **session)
 {
     NC_MSG_TYPE ret;
 
     if (!initialized) {
-        pipe(pipes[0]);
-        pipe(pipes[1]);
-
-        fcntl(pipes[0][0], F_SETFL, O_NONBLOCK);
-        fcntl(pipes[0][1], F_SETFL, O_NONBLOCK);
-        fcntl(pipes[1][0], F_SETFL, O_NONBLOCK);
-        fcntl(pipes[1][1], F_SETFL, O_NONBLOCK);
-
+        *session = test_new_session(1, pipes);
         p_in = pipes[0][0];
         p_out = pipes[1][1];
-
-        *session = calloc(1, sizeof **session);
-        (*session)->status = NC_STATUS_RUNNING;
-        (*session)->side = 1;
-        (*session)->id = 1;
-        (*session)->ti_lock = malloc(sizeof *(*session)->ti_lock);
-        pthread_mutex_init((*session)->ti_lock, NULL);
-        (*session)->ti_cond = malloc(sizeof *(*session)->ti_cond);
-        pthread_cond_init((*session)->ti_cond, NULL);
-        (*session)->ti_inuse = malloc(sizeof *(*session)->ti_inuse);
-        *(*session)->ti_inuse = 0;
-        (*session)->ti_type = NC_TI_FD;
-        (*session)->ti.fd.in = pipes[1][0];
-        (*session)->ti.fd.out = pipes[0][1];
-        (*session)->ctx = np2srv.ly_ctx;
-        (*session)->flags = 1; //shared ctx
-        (*session)->username = "user1";
-        (*session)->host = "localhost";
-        (*session)->opts.server.session_start = (*session)->opts.server.last_rpc = time(NULL);
-        printf("test: New session 1\n");
         initialized = 1;
         ret = NC_MSG_HELLO;
+    } else if (initialized == 2) {
+        /* another session of the same user */
+        *session = test_new_session(2, pipes + 2);
+        p_in2 = pipes[2][0];
+        p_out2 = pipes[3][1];
+        initialized = 3;
+        ret = NC_MSG_HELLO;
     } else {
         usleep(timeout * 1000);
         ret = NC_MSG_WOULDBLOCK;
@@ -599,6 +640,12 @@ np_stop(void **state)
     close(pipes[0][1]);
     close(pipes[1][0]);
     close(pipes[1][1]);
+    if (initialized == 3) {
+        close(pipes[2][0]);
+        close(pipes[2][1]);
+        close(pipes[3][0]);
+        close(pipes[3][1]);
+    }
     return ret;
 }
 
@@ -649,6 +696,83 @@ test_edit_config(void **state)
     test_read(p_in, copy_rpl, __LINE__);
 }
 
+static void
+test_copy_config_denied(void **state)
+{
+    (void)state; /* unused */
+    const char *copy_rpc =
+    "<rpc msgid=\"2\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<copy-config>"
+            "<target>"
+                "<running/>"
+            "</target>"
+            "<source>"
+                "<config>"
+"<interfaces xmlns=\"urn:ietf:params:xml:ns:yang:ietf-interfaces\">"
+  "<interface>"
+    "<name>denied</name>"
+    "<description>denied dsc</description>"
+    "<type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:ethernetCsmacd</type>"
+  "</interface>"
+"</interfaces>"
+                "</config>"
+            "</source>"
+        "</copy-config>"
+    "</rpc>";
+    const char *copy_rpl =
+    "<rpc-reply msgid=\"2\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<rpc-error>"
+            "<error-type>protocol</error-type>"
+            "<error-tag>access-denied</error-tag>"
+            "<error-severity>error</error-severity>"
+            "<error-path>/ietf-interfaces:interfaces/interface[name='denied']/description</error-path>"
+            "<error-message xml:lang=\"en\">Access to the requested protocol operation or data model is denied because authorization failed.</error-message>"
+        "</rpc-error>"
+    "</rpc-reply>";
+
+    test_write(p_out, copy_rpc, __LINE__);
+    test_read(p_in, copy_rpl, __LINE__);
+    assert_non_null(test_srs_denied);
+}
+
+static void
+test_copy_config_other_session(void **state)
+{
+    (void)state; /* unused */
+    const char *copy_rpc =
+    "<rpc msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<copy-config>"
+            "<target>"
+                "<running/>"
+            "</target>"
+            "<source>"
+                "<config>"
+"<interfaces xmlns=\"urn:ietf:params:xml:ns:yang:ietf-interfaces\">"
+  "<interface>"
+    "<name>iface2</name>"
+    "<type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:ethernetCsmacd</type>"
+  "</interface>"
+"</interfaces>"
+                "</config>"
+            "</source>"
+        "</copy-config>"
+    "</rpc>";
+    const char *copy_rpl =
+    "<rpc-reply msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<ok/>"
+    "</rpc-reply>";
+
+    /* a new session of the same user leases the sysrepo session the failed copy used */
+    initialized = 2;
+    while (initialized != 3) {
+        usleep(100000);
+    }
+
+    test_write(p_out2, copy_rpc, __LINE__);
+    test_read(p_in2, copy_rpl, __LINE__);
+    assert_ptr_equal(test_srs_committed, test_srs_denied);
+}
+
 static void
 test_startstop(void **state)
 {
@@ -663,6 +787,8 @@ main(void)
     const struct CMUnitTest tests[] = {
                     cmocka_unit_test_setup(test_startstop, np_start),
                     cmocka_unit_test(test_edit_config),
+                    cmocka_unit_test(test_copy_config_denied),
+                    cmocka_unit_test(test_copy_config_other_session),
                     cmocka_unit_test_teardown(test_startstop, np_stop),
     };
 
@@ -41,6 +41,7 @@
 #undef main
 
 struct lyd_node *data;
+const char *ext_iface1_dsc;
 volatile int initialized;
 int pipes[2][2], p_in, p_out;
 
@@ -178,6 +179,16 @@ int
 __wrap_sr_session_refresh(sr_session_ctx_t *session)
 {
     (void)session;
+
+    /* a change committed by another sysrepo client becomes visible only now */
+    if (ext_iface1_dsc) {
+        ly_errno = LY_SUCCESS;
+        lyd_new_path(data, np2srv.ly_ctx, "/ietf-interfaces:interfaces/interface[name='iface1']/description",
+                     (void *)ext_iface1_dsc, 0, LYD_PATH_OPT_UPDATE);
+        assert_int_equal(ly_errno, LY_SUCCESS);
+        ext_iface1_dsc = NULL;
+    }
+
     return SR_ERR_OK;
 }
 
@@ -400,6 +411,13 @@ __wrap_sr_commit(sr_session_ctx_t *session)
     return SR_ERR_OK;
 }
 
+int
+__wrap_sr_discard_changes(sr_session_ctx_t *session)
+{
+    (void)session;
+    return SR_ERR_OK;
+}
+
 int
 __wrap_sr_event_notif_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *values,
                            const size_t values_cnt, sr_ev_notif_flag_t opts)
@@ -864,6 +882,87 @@ test_edit_delete1(void **state)
     test_read(p_in, get_config_rpl, __LINE__);
 }
 
+static void
+test_get_config_external_commit(void **state)
+{
+    (void)state; /* unused */
+    const char *get_config_rpc =
+    "<rpc msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<get-config>"
+            "<source>"
+                "<running/>"
+            "</source>"
+        "</get-config>"
+    "</rpc>";
+    const char *get_config_rpl_fmt =
+    "<rpc-reply msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<data xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+"<interfaces xmlns=\"urn:ietf:params:xml:ns:yang:ietf-interfaces\">"
+  "<interface>"
+    "<name>iface1</name>"
+    "<description>%s</description>"
+    "<type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:ethernetCsmacd</type>"
+    "<enabled>true</enabled>"
+    "<link-up-down-trap-enable>disabled</link-up-down-trap-enable>"
+    "<ipv4 xmlns=\"urn:ietf:params:xml:ns:yang:ietf-ip\">"
+      "<enabled>true</enabled>"
+      "<forwarding>true</forwarding>"
+      "<mtu>68</mtu>"
+      "<address>"
+        "<ip>10.0.0.1</ip>"
+        "<netmask>255.0.0.0</netmask>"
+      "</address>"
+      "<address>"
+        "<ip>172.0.0.1</ip>"
+        "<prefix-length>16</prefix-length>"
+      "</address>"
+      "<neighbor>"
+        "<ip>10.0.0.2</ip>"
+        "<link-layer-address>01:34:56:78:9a:bc:de:f0</link-layer-address>"
+      "</neighbor>"
+    "</ipv4>"
+  "</interface>"
+  "<interface>"
+    "<name>iface2</name>"
+    "<description>iface2 dsc</description>"
+    "<type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:softwareLoopback</type>"
+    "<enabled>false</enabled>"
+    "<link-up-down-trap-enable>disabled</link-up-down-trap-enable>"
+    "<ipv4 xmlns=\"urn:ietf:params:xml:ns:yang:ietf-ip\">"
+      "<address>"
+        "<ip>10.0.0.5</ip>"
+        "<netmask>255.0.0.0</netmask>"
+      "</address>"
+      "<address>"
+        "<ip>172.0.0.5</ip>"
+        "<prefix-length>16</prefix-length>"
+      "</address>"
+      "<neighbor>"
+        "<ip>10.0.0.1</ip>"
+        "<link-layer-address>01:34:56:78:9a:bc:de:fa</link-layer-address>"
+      "</neighbor>"
+    "</ipv4>"
+  "</interface>"
+"</interfaces>"
+        "</data>"
+    "</rpc-reply>";
+    char get_config_rpl[4096];
+
+    /* the data after test_edit_delete1(), another sysrepo client commits and the server is not notified about it */
+    ext_iface1_dsc = "iface1 external dsc";
+    sprintf(get_config_rpl, get_config_rpl_fmt, "iface1 external dsc");
+
+    test_write(p_out, get_config_rpc, __LINE__);
+    test_read(p_in, get_config_rpl, __LINE__);
+
+    /* and commits the original description back */
+    ext_iface1_dsc = "iface1 dsc";
+    sprintf(get_config_rpl, get_config_rpl_fmt, "iface1 dsc");
+
+    test_write(p_out, get_config_rpc, __LINE__);
+    test_read(p_in, get_config_rpl, __LINE__);
+}
+
 static void
 test_edit_delete2(void **state)
 {
@@ -1412,6 +1511,7 @@ main(void)
     const struct CMUnitTest tests[] = {
                     cmocka_unit_test_setup(test_startstop, np_start),
                     cmocka_unit_test(test_edit_delete1),
+                    cmocka_unit_test(test_get_config_external_commit),
                     cmocka_unit_test(test_edit_delete2),
                     cmocka_unit_test(test_edit_delete3),
                     cmocka_unit_test(test_edit_create1),
@@ -37,6 +37,7 @@
 
 volatile int initialized;
 int pipes[2][2], p_in, p_out;
+struct nc_session *test_session;
 
 /*
  * SYSREPO WRAPPER FUNCTIONS
@@ -205,39 +206,53 @@ __wrap_sr_module_change_subscribe(sr_session_ctx_t *session, const char *module_
 }
 
 int
-__wrap_sr_rpc_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *input, const size_t input_cnt,
-                   sr_val_t **output, size_t *output_cnt)
+__wrap_sr_rpc_send_tree(sr_session_ctx_t *session, const char *xpath, const sr_node_t *input, const size_t input_cnt,
+                        sr_node_t **output, size_t *output_cnt)
 {
+    struct np2_sessions *sessions;
+
     (void)session;
 
     assert_string_equal(xpath, "/custom-op:rpc1");
     assert_int_equal(input_cnt, 1);
+    assert_string_equal(input[0].name, "l1");
+    assert_string_equal(input[0].module_name, "custom-op");
     assert_int_equal(input[0].type, SR_STRING_T);
+    if (!strcmp(input[0].data.string_val, "killed")) {
+        /* the session is killed by session 2 while the provider processes the RPC */
+        sessions = (struct np2_sessions *)nc_session_get_data(test_session);
+        sessions->killed_by = 2;
+        sessions->killed = 1;
+    } else {
+        assert_string_equal(input[0].data.string_val, "valuee");
+    }
 
+    assert_int_equal(sr_new_trees(1, output), SR_ERR_OK);
     *output_cnt = 1;
-    *output = calloc(1, sizeof **output);
-    (*output)[0].xpath = strdup("/custom-op:rpc1/l2");
-    (*output)[0].type = SR_STRING_T;
-    (*output)[0].data.string_val = strdup("other_value");
+    sr_node_set_name(&(*output)[0], "l2");
+    sr_node_set_module(&(*output)[0], "custom-op");
+    sr_node_set_str_data(&(*output)[0], SR_STRING_T, "other_value");
 
     return SR_ERR_OK;
 }
 
 int
-__wrap_sr_action_send(sr_session_ctx_t *session, const char *xpath, const sr_val_t *input, const size_t input_cnt,
-                      sr_val_t **output, size_t *output_cnt)
+__wrap_sr_action_send_tree(sr_session_ctx_t *session, const char *xpath, const sr_node_t *input, const size_t input_cnt,
+                           sr_node_t **output, size_t *output_cnt)
 {
     (void)session;
 
     assert_string_equal(xpath, "/custom-op:li1[li1-key='key']/cont/act");
     assert_int_equal(input_cnt, 1);
+    assert_string_equal(input[0].name, "l3");
     assert_int_equal(input[0].type, SR_STRING_T);
+    assert_string_equal(input[0].data.string_val, "vl");
 
+    assert_int_equal(sr_new_trees(1, output), SR_ERR_OK);
     *output_cnt = 1;
-    *output = calloc(1, sizeof **output);
-    (*output)[0].xpath = strdup("/custom-op:li1[li1-key='key']/cont/act/l4");
-    (*output)[0].type = SR_STRING_T;
-    (*output)[0].data.string_val = strdup("other_val");
+    sr_node_set_name(&(*output)[0], "l4");
+    sr_node_set_module(&(*output)[0], "custom-op");
+    sr_node_set_str_data(&(*output)[0], SR_STRING_T, "other_val");
 
     return SR_ERR_OK;
 }
@@ -351,6 +366,7 @@ __wrap_nc_accept(int timeout, struct nc_session **session)
         (*session)->username = "user1";
         (*session)->host = "localhost";
         (*session)->opts.server.session_start = (*session)->opts.server.last_rpc = time(NULL);
+        test_session = *session;
         printf("test: New session 1\n");
         initialized = 1;
         ret = NC_MSG_HELLO;
@@ -534,6 +550,33 @@ test_rpc(void **state)
     test_read(p_in, op_rpl, __LINE__);
 }
 
+static void
+test_rpc_killed(void **state)
+{
+    (void)state; /* unused */
+    struct np2_sessions *sessions;
+    const char *op_rpc = "<rpc msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+                            "<rpc1 xmlns=\"custom-op\"><l1>killed</l1></rpc1>"
+                         "</rpc>";
+    const char *op_rpl =
+    "<rpc-reply msgid=\"1\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+        "<rpc-error>"
+            "<error-type>application</error-type>"
+            "<error-tag>operation-failed</error-tag>"
+            "<error-severity>error</error-severity>"
+            "<error-message xml:lang=\"en\">Operation aborted, session 1 was killed by session 2.</error-message>"
+        "</rpc-error>"
+    "</rpc-reply>";
+
+    /* the output of the provider is dropped */
+    test_write(p_out, op_rpc, __LINE__);
+    test_read(p_in, op_rpl, __LINE__);
+
+    /* the session itself was not terminated, revive it for the next tests */
+    sessions = (struct np2_sessions *)nc_session_get_data(test_session);
+    sessions->killed = 0;
+}
+
 static void
 test_action(void **state)
 {
@@ -564,6 +607,7 @@ main(void)
 {
     const struct CMUnitTest tests[] = {
                     cmocka_unit_test_setup(test_rpc, np_start),
+                    cmocka_unit_test(test_rpc_killed),
                     cmocka_unit_test_teardown(test_action, np_stop),
     };
 
@@ -535,7 +535,13 @@ test_get(void **state)
                     "<namespace>urn:ietf:params:xml:ns:yang:ietf-netconf-notifications</namespace>"
                     "<conformance-type>implement</conformance-type>"
                 "</module>"
-                "<module-set-id>13</module-set-id>"
+                "<module>"
+                    "<name>netopeer2-monitoring</name>"
+                    "<revision>2026-10-18</revision>"
+                    "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                    "<conformance-type>implement</conformance-type>"
+                "</module>"
+                "<module-set-id>14</module-set-id>"
             "</modules-state>"
             "<netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\">"
                 "<capabilities>"
@@ -554,7 +560,7 @@ test_get(void **state)
                     "<capability>urn:ietf:params:xml:ns:yang:1?module=yang&amp;revision=2017-02-20</capability>"
                     "<capability>urn:ietf:params:xml:ns:yang:ietf-inet-types?module=ietf-inet-types&amp;revision=2013-07-15</capability>"
                     "<capability>urn:ietf:params:xml:ns:yang:ietf-yang-types?module=ietf-yang-types&amp;revision=2013-07-15</capability>"
-                    "<capability>urn:ietf:params:xml:ns:yang:ietf-yang-library?module=ietf-yang-library&amp;revision=2016-06-21&amp;module-set-id=13</capability>"
+                    "<capability>urn:ietf:params:xml:ns:yang:ietf-yang-library?module=ietf-yang-library&amp;revision=2016-06-21&amp;module-set-id=14</capability>"
                     "<capability>ns?module=ietf-netconf-server</capability>"
                     "<capability>urn:ietf:params:xml:ns:netconf:base:1.0?module=ietf-netconf&amp;revision=2011-06-01&amp;features=writable-running,candidate,rollback-on-error,validate,startup,xpath</capability>"
                     "<capability>urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring?module=ietf-netconf-monitoring&amp;revision=2010-10-04</capability>"
@@ -562,6 +568,7 @@ test_get(void **state)
                     "<capability>urn:ietf:params:xml:ns:netconf:notification:1.0?module=notifications&amp;revision=2008-07-14</capability>"
                     "<capability>urn:ietf:params:xml:ns:netmod:notification?module=nc-notifications&amp;revision=2008-07-14</capability>"
                     "<capability>urn:ietf:params:xml:ns:yang:ietf-netconf-notifications?module=ietf-netconf-notifications&amp;revision=2012-02-06</capability>"
+                    "<capability>urn:cesnet:netopeer2-monitoring?module=netopeer2-monitoring&amp;revision=2026-10-18</capability>"
                 "</capabilities>"
                 "<datastores>"
                     "<datastore>"
@@ -743,6 +750,20 @@ test_get(void **state)
                         "<namespace>urn:ietf:params:xml:ns:yang:ietf-netconf-notifications</namespace>"
                         "<location>NETCONF</location>"
                     "</schema>"
+                    "<schema>"
+                        "<identifier>netopeer2-monitoring</identifier>"
+                        "<version>2026-10-18</version>"
+                        "<format>yang</format>"
+                        "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                        "<location>NETCONF</location>"
+                    "</schema>"
+                    "<schema>"
+                        "<identifier>netopeer2-monitoring</identifier>"
+                        "<version>2026-10-18</version>"
+                        "<format>yin</format>"
+                        "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                        "<location>NETCONF</location>"
+                    "</schema>"
                 "</schemas>"
                 "<statistics>"
                     "<netconf-start-time>0000-00-00T00:00:00+00:00</netconf-start-time>"
@@ -754,6 +775,9 @@ test_get(void **state)
                     "<out-rpc-errors>0</out-rpc-errors>"
                     "<out-notifications>0</out-notifications>"
                 "</statistics>"
+                "<call-home xmlns=\"urn:cesnet:netopeer2-monitoring\">"
+                    "<connecting>0</connecting>"
+                "</call-home>"
             "</netconf-state>"
             "<netconf xmlns=\"urn:ietf:params:xml:ns:netmod:notification\">"
                 "<streams>"
@@ -883,6 +907,12 @@ test_get_filter2(void **state)
                     "<conformance-type>implement</conformance-type>"
                     "<namespace>urn:ietf:params:xml:ns:yang:ietf-netconf-notifications</namespace>"
                 "</module>"
+                "<module>"
+                    "<name>netopeer2-monitoring</name>"
+                    "<revision>2026-10-18</revision>"
+                    "<conformance-type>implement</conformance-type>"
+                    "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                "</module>"
             "</modules-state>"
         "</data>"
     "</rpc-reply>";
@@ -957,6 +987,11 @@ test_get_filter3(void **state)
                     "<revision>2012-02-06</revision>"
                     "<conformance-type>implement</conformance-type>"
                 "</module>"
+                "<module>"
+                    "<name>netopeer2-monitoring</name>"
+                    "<revision>2026-10-18</revision>"
+                    "<conformance-type>implement</conformance-type>"
+                "</module>"
             "</modules-state>"
         "</data>"
     "</rpc-reply>";
@@ -1040,6 +1075,10 @@ test_get_filter4(void **state)
                     "<name>ietf-netconf-notifications</name>"
                     "<revision>2012-02-06</revision>"
                 "</module>"
+                "<module>"
+                    "<name>netopeer2-monitoring</name>"
+                    "<revision>2026-10-18</revision>"
+                "</module>"
             "</modules-state>"
         "</data>"
     "</rpc-reply>";
@@ -1237,6 +1276,20 @@ test_get_filter5(void **state)
                         "<namespace>urn:ietf:params:xml:ns:yang:ietf-netconf-notifications</namespace>"
                         "<location>NETCONF</location>"
                     "</schema>"
+                    "<schema>"
+                        "<identifier>netopeer2-monitoring</identifier>"
+                        "<version>2026-10-18</version>"
+                        "<format>yang</format>"
+                        "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                        "<location>NETCONF</location>"
+                    "</schema>"
+                    "<schema>"
+                        "<identifier>netopeer2-monitoring</identifier>"
+                        "<version>2026-10-18</version>"
+                        "<format>yin</format>"
+                        "<namespace>urn:cesnet:netopeer2-monitoring</namespace>"
+                        "<location>NETCONF</location>"
+                    "</schema>"
                 "</schemas>"
             "</netconf-state>"
         "</data>"
@@ -90,15 +90,19 @@ __wrap_sr_get_schema(sr_session_ctx_t *session, const char *module_name, const c
     return SR_ERR_OK;
 }
 
+sr_datastore_t cur_ds;
+
 int
 __wrap_sr_session_start_user(sr_conn_ctx_t *conn_ctx, const char *user_name, const sr_datastore_t datastore,
                              const sr_sess_options_t opts, sr_session_ctx_t **session)
 {
     (void)conn_ctx;
     (void)user_name;
-    (void)datastore;
     (void)opts;
     (void)session;
+
+    /* the sessions stay NULL, so they are started for every RPC */
+    cur_ds = datastore;
     return SR_ERR_OK;
 }
 
@@ -174,7 +178,6 @@ __wrap_sr_get_items(sr_session_ctx_t *session, const char *xpath, sr_val_t **val
 #define LOCK_COUNT 16
 
 int locks[3];
-sr_datastore_t cur_ds;
 
 int
 __wrap_sr_session_switch_ds(sr_session_ctx_t *session, sr_datastore_t ds)
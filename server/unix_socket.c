@@ -0,0 +1,519 @@
+/**
+ * @file unix_socket.c
+ * @brief netopeer2-server UNIX socket listen endpoints
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <nc_server.h>
+
+#include "unix_socket.h"
+#include "common.h"
+#include "log.h"
+
+/*
+ * libnetconf2 has no UNIX socket transport, so the sockets are owned here. A connection is accepted,
+ * the peer is authenticated by its credentials and the connected socket is passed to libnetconf2 as
+ * a file descriptor transport, which leaves closing it on us once the session is freed.
+ */
+
+/* defaults of netopeer2-netconf-server unix-socket leaves */
+#define USOCK_DEFAULT_PATH "/var/run/netopeer2-server.sock"
+#define USOCK_DEFAULT_MODE 0600
+
+struct usock_endpt {
+    char *name;
+    char *path;         /* NULL for the default */
+    mode_t mode;
+    char *owner;        /* NULL to keep the server user */
+    char *group;        /* NULL to keep the server group */
+    int changed;        /* to be (re)bound by usock_apply() */
+
+    int sock;           /* listening socket, -1 if not bound */
+    char *bound_path;   /* path the socket is bound to */
+};
+
+/* connected socket of a NETCONF session */
+struct usock_session {
+    struct nc_session *session;
+    int fd;
+};
+
+static struct {
+    struct usock_endpt *endpts;
+    uint32_t endpt_count;
+    uint32_t next;                  /* endpoint to try to accept on first */
+
+    struct usock_session *sessions;
+    uint32_t session_count;
+    uint32_t session_size;
+
+    pthread_mutex_t lock;
+} usock = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static struct usock_endpt *
+usock_endpt_find(const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < usock.endpt_count; ++i) {
+        if (!strcmp(usock.endpts[i].name, name)) {
+            return &usock.endpts[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void
+usock_endpt_unbind(struct usock_endpt *endpt)
+{
+    struct stat st;
+
+    if (endpt->sock > -1) {
+        close(endpt->sock);
+        endpt->sock = -1;
+    }
+    if (endpt->bound_path) {
+        /* do not remove anything that replaced our socket meanwhile */
+        if (!lstat(endpt->bound_path, &st) && S_ISSOCK(st.st_mode)) {
+            unlink(endpt->bound_path);
+        }
+        free(endpt->bound_path);
+        endpt->bound_path = NULL;
+    }
+}
+
+int
+usock_endpt_add(const char *name)
+{
+    struct usock_endpt *endpt;
+    int rc = EXIT_SUCCESS;
+
+    pthread_mutex_lock(&usock.lock);
+
+    if (usock_endpt_find(name)) {
+        ERR("UNIX socket endpoint \"%s\" already exists.", name);
+        rc = EXIT_FAILURE;
+        goto cleanup;
+    }
+
+    endpt = realloc(usock.endpts, (usock.endpt_count + 1) * sizeof *usock.endpts);
+    if (!endpt) {
+        EMEM;
+        rc = EXIT_FAILURE;
+        goto cleanup;
+    }
+    usock.endpts = endpt;
+
+    endpt = &usock.endpts[usock.endpt_count];
+    memset(endpt, 0, sizeof *endpt);
+    endpt->name = strdup(name);
+    if (!endpt->name) {
+        EMEM;
+        rc = EXIT_FAILURE;
+        goto cleanup;
+    }
+    endpt->mode = USOCK_DEFAULT_MODE;
+    endpt->changed = 1;
+    endpt->sock = -1;
+    ++usock.endpt_count;
+
+cleanup:
+    pthread_mutex_unlock(&usock.lock);
+    return rc;
+}
+
+/* removes the endpoint or all of them (NULL) */
+void
+usock_endpt_del(const char *name)
+{
+    uint32_t i;
+    struct usock_endpt *endpt;
+
+    pthread_mutex_lock(&usock.lock);
+
+    i = 0;
+    while (i < usock.endpt_count) {
+        endpt = &usock.endpts[i];
+        if (name && strcmp(endpt->name, name)) {
+            ++i;
+            continue;
+        }
+
+        usock_endpt_unbind(endpt);
+        free(endpt->name);
+        free(endpt->path);
+        free(endpt->owner);
+        free(endpt->group);
+        --usock.endpt_count;
+        if (i < usock.endpt_count) {
+            memcpy(endpt, &usock.endpts[usock.endpt_count], sizeof *endpt);
+        }
+    }
+
+    if (!usock.endpt_count) {
+        free(usock.endpts);
+        usock.endpts = NULL;
+    }
+    usock.next = 0;
+
+    pthread_mutex_unlock(&usock.lock);
+}
+
+/* sets a unix-socket leaf of the endpoint, NULL value for its default */
+int
+usock_endpt_set(const char *name, const char *leaf, const char *value)
+{
+    struct usock_endpt *endpt;
+    char **str = NULL, *dup = NULL;
+    int rc = EXIT_SUCCESS;
+
+    pthread_mutex_lock(&usock.lock);
+
+    endpt = usock_endpt_find(name);
+    if (!endpt) {
+        ERR("UNIX socket endpoint \"%s\" does not exist.", name);
+        rc = EXIT_FAILURE;
+        goto cleanup;
+    }
+
+    if (!strcmp(leaf, "mode")) {
+        endpt->mode = (value ? (mode_t)strtoul(value, NULL, 8) : USOCK_DEFAULT_MODE);
+    } else {
+        if (!strcmp(leaf, "path")) {
+            str = &endpt->path;
+        } else if (!strcmp(leaf, "owner")) {
+            str = &endpt->owner;
+        } else if (!strcmp(leaf, "group")) {
+            str = &endpt->group;
+        } else {
+            EINT;
+            rc = EXIT_FAILURE;
+            goto cleanup;
+        }
+
+        if (value) {
+            dup = strdup(value);
+            if (!dup) {
+                EMEM;
+                rc = EXIT_FAILURE;
+                goto cleanup;
+            }
+        }
+        free(*str);
+        *str = dup;
+    }
+    endpt->changed = 1;
+
+cleanup:
+    pthread_mutex_unlock(&usock.lock);
+    return rc;
+}
+
+static int
+usock_bind(struct usock_endpt *endpt)
+{
+    struct sockaddr_un saddr;
+    struct passwd pwd, *pw;
+    struct group grp, *gr;
+    struct stat st;
+    char buf[1024];
+    const char *path;
+    uid_t uid = -1;
+    gid_t gid = -1;
+    int sock = -1, rc;
+
+    path = (endpt->path ? endpt->path : USOCK_DEFAULT_PATH);
+    if (strlen(path) >= sizeof saddr.sun_path) {
+        ERR("UNIX socket path \"%s\" is too long.", path);
+        return EXIT_FAILURE;
+    }
+
+    if (endpt->owner) {
+        rc = getpwnam_r(endpt->owner, &pwd, buf, sizeof buf, &pw);
+        if (!pw) {
+            ERR("Unable to get UNIX socket owner \"%s\" (%s).", endpt->owner, rc ? strerror(rc) : "no such user");
+            return EXIT_FAILURE;
+        }
+        uid = pw->pw_uid;
+    }
+    if (endpt->group) {
+        rc = getgrnam_r(endpt->group, &grp, buf, sizeof buf, &gr);
+        if (!gr) {
+            ERR("Unable to get UNIX socket group \"%s\" (%s).", endpt->group, rc ? strerror(rc) : "no such group");
+            return EXIT_FAILURE;
+        }
+        gid = gr->gr_gid;
+    }
+
+    /* the previous socket, it may have been bound to the same path */
+    usock_endpt_unbind(endpt);
+
+    /* a socket left behind by a previous run */
+    if (!lstat(path, &st) && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        ERR("Failed to create UNIX socket (%s).", strerror(errno));
+        goto error;
+    }
+
+    memset(&saddr, 0, sizeof saddr);
+    saddr.sun_family = AF_UNIX;
+    strcpy(saddr.sun_path, path);
+    if (bind(sock, (struct sockaddr *)&saddr, sizeof saddr) == -1) {
+        ERR("Failed to bind UNIX socket \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+    endpt->bound_path = strdup(path);
+    if (!endpt->bound_path) {
+        EMEM;
+        goto error;
+    }
+
+    /* connections are refused until listen(), so nobody connects with the permissions not yet set */
+    if (chmod(path, endpt->mode) == -1) {
+        ERR("Failed to set UNIX socket \"%s\" permissions (%s).", path, strerror(errno));
+        goto error;
+    }
+    if (((uid != (uid_t)-1) || (gid != (gid_t)-1)) && (chown(path, uid, gid) == -1)) {
+        ERR("Failed to set UNIX socket \"%s\" owner (%s).", path, strerror(errno));
+        goto error;
+    }
+    if (listen(sock, SOMAXCONN) == -1) {
+        ERR("Failed to listen on UNIX socket \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+
+    endpt->sock = sock;
+    VRB("Listening on UNIX socket \"%s\" (endpoint \"%s\").", path, endpt->name);
+    return EXIT_SUCCESS;
+
+error:
+    if (sock > -1) {
+        close(sock);
+    }
+    usock_endpt_unbind(endpt);
+    return EXIT_FAILURE;
+}
+
+/* (re)binds all the endpoints changed since the last call */
+int
+usock_apply(void)
+{
+    uint32_t i;
+    int rc = EXIT_SUCCESS;
+
+    pthread_mutex_lock(&usock.lock);
+
+    for (i = 0; i < usock.endpt_count; ++i) {
+        if (!usock.endpts[i].changed) {
+            continue;
+        }
+
+        usock.endpts[i].changed = 0;
+        if (usock_bind(&usock.endpts[i])) {
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    pthread_mutex_unlock(&usock.lock);
+    return rc;
+}
+
+/* accepts a pending connection on any endpoint, does not wait for one */
+static int
+usock_accept_fd(char *username, size_t username_len)
+{
+    struct ucred cred;
+    struct passwd pwd, *pw;
+    socklen_t len;
+    char buf[1024];
+    uint32_t i, idx;
+    int fd = -1, rc;
+
+    pthread_mutex_lock(&usock.lock);
+
+    for (i = 0; i < usock.endpt_count; ++i) {
+        /* start with a different endpoint each time so that none is starved */
+        idx = (usock.next + i) % usock.endpt_count;
+        if (usock.endpts[idx].sock == -1) {
+            continue;
+        }
+
+        fd = accept4(usock.endpts[idx].sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd > -1) {
+            usock.next = idx + 1;
+            break;
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+            ERR("Failed to accept on UNIX socket \"%s\" (%s).", usock.endpts[idx].bound_path, strerror(errno));
+        }
+    }
+
+    pthread_mutex_unlock(&usock.lock);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    /* the peer is who it is, no other authentication is needed */
+    len = sizeof cred;
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+        ERR("Failed to get UNIX socket peer credentials (%s).", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    rc = getpwuid_r(cred.uid, &pwd, buf, sizeof buf, &pw);
+    if (!pw) {
+        ERR("Refusing UNIX socket connection of process %d, unable to get user with UID %d (%s).", (int)cred.pid,
+            (int)cred.uid, rc ? strerror(rc) : "no such user");
+        close(fd);
+        return -1;
+    }
+    if (strlen(pw->pw_name) >= username_len) {
+        ERR("Refusing UNIX socket connection of process %d, username too long.", (int)cred.pid);
+        close(fd);
+        return -1;
+    }
+    strcpy(username, pw->pw_name);
+
+    VRB("Accepted UNIX socket connection of process %d (user \"%s\").", (int)cred.pid, username);
+    return fd;
+}
+
+NC_MSG_TYPE
+usock_accept(struct nc_session **session)
+{
+    NC_MSG_TYPE msgtype;
+    struct usock_session *sessions;
+    char username[256];
+    uint32_t size;
+    int fd;
+
+    fd = usock_accept_fd(username, sizeof username);
+    if (fd == -1) {
+        return NC_MSG_WOULDBLOCK;
+    }
+
+    msgtype = nc_accept_inout(fd, fd, username, session);
+    if (msgtype != NC_MSG_HELLO) {
+        close(fd);
+        return msgtype;
+    }
+
+    pthread_mutex_lock(&usock.lock);
+    if (usock.session_count == usock.session_size) {
+        size = usock.session_size ? usock.session_size * 2 : 16;
+        sessions = realloc(usock.sessions, size * sizeof *usock.sessions);
+        if (!sessions) {
+            pthread_mutex_unlock(&usock.lock);
+            EMEM;
+            nc_session_free(*session, NULL);
+            *session = NULL;
+            close(fd);
+            return NC_MSG_ERROR;
+        }
+        usock.sessions = sessions;
+        usock.session_size = size;
+    }
+    usock.sessions[usock.session_count].session = *session;
+    usock.sessions[usock.session_count].fd = fd;
+    ++usock.session_count;
+    pthread_mutex_unlock(&usock.lock);
+
+    return msgtype;
+}
+
+/* learns whether the session was accepted on a UNIX socket endpoint */
+int
+usock_session_is(struct nc_session *session)
+{
+    uint32_t i;
+    int found = 0;
+
+    if (nc_session_get_ti(session) != NC_TI_FD) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&usock.lock);
+
+    for (i = 0; i < usock.session_count; ++i) {
+        if (usock.sessions[i].session == session) {
+            found = 1;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&usock.lock);
+    return found;
+}
+
+/* closes the socket of the session, if it is a UNIX socket session */
+void
+usock_session_del(struct nc_session *session)
+{
+    uint32_t i;
+
+    if (nc_session_get_ti(session) != NC_TI_FD) {
+        /* SSH and TLS sessions need not be looked for */
+        return;
+    }
+
+    pthread_mutex_lock(&usock.lock);
+
+    for (i = 0; i < usock.session_count; ++i) {
+        if (usock.sessions[i].session == session) {
+            close(usock.sessions[i].fd);
+            --usock.session_count;
+            if (i < usock.session_count) {
+                usock.sessions[i] = usock.sessions[usock.session_count];
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&usock.lock);
+}
+
+void
+usock_destroy(void)
+{
+    uint32_t i;
+
+    usock_endpt_del(NULL);
+
+    pthread_mutex_lock(&usock.lock);
+    for (i = 0; i < usock.session_count; ++i) {
+        close(usock.sessions[i].fd);
+    }
+    free(usock.sessions);
+    usock.sessions = NULL;
+    usock.session_count = 0;
+    usock.session_size = 0;
+    pthread_mutex_unlock(&usock.lock);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file unix_socket.h
+ * @brief netopeer2-server UNIX socket listen endpoints
+ *
+ * Copyright (c) 2017 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_UNIX_SOCKET_H_
+#define NP2SRV_UNIX_SOCKET_H_
+
+#include <nc_server.h>
+
+int usock_endpt_add(const char *name);
+void usock_endpt_del(const char *name);
+int usock_endpt_set(const char *name, const char *leaf, const char *value);
+int usock_apply(void);
+
+NC_MSG_TYPE usock_accept(struct nc_session **session);
+int usock_session_is(struct nc_session *session);
+void usock_session_del(struct nc_session *session);
+
+void usock_destroy(void);
+
+#endif /* NP2SRV_UNIX_SOCKET_H_ */